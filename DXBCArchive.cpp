@@ -0,0 +1,223 @@
+//================================================================================================================
+// Include files
+//================================================================================================================
+#include "DXBCArchive.h"
+#include "DXBCValidator.h"
+#include <algorithm>
+#include <string.h>
+#include <vector>
+
+
+
+
+
+//================================================================================================================
+// Function definitions
+//================================================================================================================
+bool DXBCArchiveEntryLess::operator()(const DXBCArchiveEntry &a, const DXBCArchiveEntry &b) const
+{
+	return memcmp(a.checksum, b.checksum, sizeof(a.checksum)) < 0;
+}
+
+
+
+
+
+//================================================================================================================
+// DXBCArchiveWriter
+//================================================================================================================
+DXBCArchiveWriter::DXBCArchiveWriter() : m_pFile(NULL), m_offset(0), m_ok(false)
+{
+}
+
+DXBCArchiveWriter::~DXBCArchiveWriter()
+{
+	if(m_pFile)
+		fclose(m_pFile);
+}
+
+bool DXBCArchiveWriter::Open(const char *pPath)
+{
+	if(m_pFile)
+		fclose(m_pFile);
+
+	m_pFile = fopen(pPath, "wb");
+	m_entries.clear();
+
+	if(!m_pFile)
+		return false;
+
+	// Header is written for real once the index is known
+	DXBCArchiveHeader header;
+	memset(&header, 0, sizeof(header));
+
+	m_offset = 0;
+	m_ok = fwrite(&header, sizeof(header), 1, m_pFile) == 1;
+	m_offset += sizeof(header);
+
+	return m_ok;
+}
+
+bool DXBCArchiveWriter::WritePadding(unsigned int inAlignment)
+{
+	static const BYTE zeros[DXBC_ARCHIVE_ALIGNMENT] = {};
+
+	unsigned int padding = (inAlignment - m_offset % inAlignment) % inAlignment;
+
+	if(padding && fwrite(zeros, 1, padding, m_pFile) != padding)
+		m_ok = false;
+
+	m_offset += padding;
+	return m_ok;
+}
+
+bool DXBCArchiveWriter::Add(const void *pDataShader, unsigned int inShaderSize)
+{
+	if(!m_pFile || !m_ok || inShaderSize < 20)
+		return false;
+
+	DXBCArchiveEntry entry;
+	memcpy(entry.checksum, (const DWORD*)pDataShader + 1, sizeof(entry.checksum));
+
+	// Same checksum, same shader - nothing to write
+	if(m_entries.count(entry))
+		return true;
+
+	if(!WritePadding(DXBC_ARCHIVE_ALIGNMENT))
+		return false;
+
+	entry.offset = m_offset;
+	entry.size = inShaderSize;
+
+	// Offsets are DWORDs
+	if(m_offset + (unsigned long long)inShaderSize > 0xFFFFFFFF - DXBC_ARCHIVE_ALIGNMENT)
+		return m_ok = false;
+
+	if(fwrite(pDataShader, 1, inShaderSize, m_pFile) != inShaderSize)
+		return m_ok = false;
+
+	m_offset += inShaderSize;
+	m_entries.insert(entry);
+
+	return true;
+}
+
+bool DXBCArchiveWriter::Close()
+{
+	if(!m_pFile)
+		return false;
+
+	WritePadding(sizeof(DWORD));
+
+	DXBCArchiveHeader header;
+	header.magic		= DXBC_ARCHIVE_MAGIC;
+	header.version		= DXBC_ARCHIVE_VERSION;
+	header.shaderCount	= (DWORD)m_entries.size();
+	header.indexOffset	= m_offset;
+
+	// Index is already sorted
+	std::vector<DXBCArchiveEntry> index(m_entries.begin(), m_entries.end());
+
+	if(m_ok && !index.empty())
+		m_ok = fwrite(index.data(), sizeof(DXBCArchiveEntry), index.size(), m_pFile) == index.size();
+
+	if(m_ok)
+		m_ok = (fseek(m_pFile, 0, SEEK_SET) == 0) && (fwrite(&header, sizeof(header), 1, m_pFile) == 1);
+
+	if(fclose(m_pFile) != 0)
+		m_ok = false;
+
+	m_pFile = NULL;
+	m_entries.clear();
+
+	return m_ok;
+}
+
+
+
+
+
+//================================================================================================================
+// DXBCArchive
+//================================================================================================================
+bool DXBCArchive::Open(const char *pPath)
+{
+	if(!m_file.OpenRead(pPath))
+		return false;
+
+	// Check header and that the index and every shader fit into the file
+	const DXBCArchiveHeader* pHeader = (const DXBCArchiveHeader*)m_file.GetData();
+	unsigned int size = m_file.GetSize();
+
+	bool valid =	size >= sizeof(DXBCArchiveHeader) &&
+					pHeader->magic == DXBC_ARCHIVE_MAGIC &&
+					pHeader->version == DXBC_ARCHIVE_VERSION &&
+					pHeader->indexOffset % sizeof(DWORD) == 0 &&
+					pHeader->indexOffset <= size &&
+					pHeader->shaderCount <= (size - pHeader->indexOffset) / sizeof(DXBCArchiveEntry);
+
+	const DXBCArchiveEntry* pEntries = (const DXBCArchiveEntry*)(m_file.GetData() + (valid ? pHeader->indexOffset : 0));
+
+	for(unsigned int i = 0; valid && i < pHeader->shaderCount; i++)
+		valid = pEntries[i].offset <= size && pEntries[i].size <= size - pEntries[i].offset;
+
+	if(!valid)
+		m_file.Close();
+
+	return valid;
+}
+
+void DXBCArchive::Close()
+{
+	m_file.Close();
+}
+
+unsigned int DXBCArchive::GetShaderCount() const
+{
+	return m_file.GetData() ? ((const DXBCArchiveHeader*)m_file.GetData())->shaderCount : 0;
+}
+
+const BYTE* DXBCArchive::Find(const DWORD inChecksum[4], unsigned int *pSize) const
+{
+	unsigned int count = GetShaderCount();
+
+	if(!count)
+		return NULL;
+
+	const DXBCArchiveEntry* pEntries = (const DXBCArchiveEntry*)(m_file.GetData() + ((const DXBCArchiveHeader*)m_file.GetData())->indexOffset);
+
+	DXBCArchiveEntry key;
+	memcpy(key.checksum, inChecksum, sizeof(key.checksum));
+
+	const DXBCArchiveEntry* pEntry = std::lower_bound(pEntries, pEntries + count, key, DXBCArchiveEntryLess());
+
+	if(pEntry == pEntries + count || memcmp(pEntry->checksum, inChecksum, sizeof(pEntry->checksum)) != 0)
+		return NULL;
+
+	return GetValidShader(pEntry, pSize);
+}
+
+const BYTE* DXBCArchive::GetShader(unsigned int inShader, unsigned int *pSize) const
+{
+	if(inShader >= GetShaderCount())
+		return NULL;
+
+	const DXBCArchiveEntry* pEntry = (const DXBCArchiveEntry*)(m_file.GetData() + ((const DXBCArchiveHeader*)m_file.GetData())->indexOffset) + inShader;
+
+	return GetValidShader(pEntry, pSize);
+}
+
+// Archive comes from disk, so every shader is validated (see DXBCValidator.h) before it is handed out. Opening
+// only checks that shaders fit into the file, validating all of them there would read the whole archive.
+const BYTE* DXBCArchive::GetValidShader(const DXBCArchiveEntry *pEntry, unsigned int *pSize) const
+{
+	const BYTE* pShader = m_file.GetData() + pEntry->offset;
+
+	if(ValidateDXBC(pShader, pEntry->size, NULL) != DXBC_PATCH_OK)
+		return NULL;
+
+	if(pSize)
+		*pSize = pEntry->size;
+
+	return pShader;
+}
@@ -0,0 +1,94 @@
+// Author: Henryk Kosobucki, 2016
+
+//=============================================	OVERVIEW =========================================================
+//	Shader archive - many DXBC shaders packed into a single file which is used directly through a memory mapping.
+//
+//	Layout:
+//		DXBCArchiveHeader
+//		shaders, each one starting at 4 KB boundary (so every shader starts on its own page)
+//		index - DXBCArchiveEntry for every shader, sorted by DXBC checksum
+//
+//	Shaders are keyed by their DXBC checksum (the one stored in the DXBC header), so finding a shader is a binary
+//	search over the index and returns pointer straight into the mapping - nothing is read or copied. Shaders with
+//	a checksum already in the archive are stored only once. All values are little endian DWORDs, so archives are
+//	limited to 4 GB.
+//================================================================================================================
+
+#ifndef DXBC_ARCHIVE_H
+#define DXBC_ARCHIVE_H
+
+#include "DXBCMappedFile.h"
+#include <stdio.h>
+#include <set>
+
+#define DXBC_ARCHIVE_MAGIC		MAKEFOURCC('D', 'X', 'A', 'R')
+#define DXBC_ARCHIVE_VERSION	1
+#define DXBC_ARCHIVE_ALIGNMENT	4096
+
+struct DXBCArchiveHeader
+{
+	DWORD			magic;				// DXBC_ARCHIVE_MAGIC
+	DWORD			version;			// DXBC_ARCHIVE_VERSION
+	DWORD			shaderCount;		// Number of index entries
+	DWORD			indexOffset;		// Offset of index (in bytes from the beginning of archive)
+};
+
+struct DXBCArchiveEntry
+{
+	DWORD			checksum[4];		// DXBC checksum of the shader
+	DWORD			offset;				// Offset of the shader (in bytes from the beginning of archive)
+	DWORD			size;				// Size of the shader
+};
+
+// Orders index entries by checksum
+struct DXBCArchiveEntryLess
+{
+	bool operator()(const DXBCArchiveEntry &a, const DXBCArchiveEntry &b) const;
+};
+
+// Builds archive file. Shaders are written as they are added, only the index is kept in memory.
+class DXBCArchiveWriter
+{
+public:
+	DXBCArchiveWriter();
+	~DXBCArchiveWriter();
+
+	bool				Open(const char *pPath);
+
+	// Adds DXBC to the archive, unless shader with the same checksum is already there.
+	bool				Add(const void *pDataShader, unsigned int inShaderSize);
+
+	// Writes the index and header. Archive is not valid until it is closed.
+	bool				Close();
+
+private:
+	bool				WritePadding(unsigned int inAlignment);
+
+	FILE*												m_pFile;
+	unsigned int										m_offset;		// Current end of file
+	bool												m_ok;			// No write failed so far
+	std::set<DXBCArchiveEntry, DXBCArchiveEntryLess>	m_entries;
+};
+
+// Memory mapped archive.
+class DXBCArchive
+{
+public:
+	bool				Open(const char *pPath);
+	void				Close();
+
+	unsigned int		GetShaderCount() const;
+
+	// Shader with given DXBC checksum, NULL if there is none (or it is corrupt).
+	const BYTE*			Find(const DWORD inChecksum[4], unsigned int *pSize) const;
+
+	// Shader number inShader in checksum order, NULL if it is corrupt.
+	const BYTE*			GetShader(unsigned int inShader, unsigned int *pSize) const;
+
+private:
+	const BYTE*			GetValidShader(const DXBCArchiveEntry *pEntry, unsigned int *pSize) const;
+
+	DXBCMappedFile		m_file;
+};
+
+#endif // DXBC_ARCHIVE_H
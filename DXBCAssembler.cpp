@@ -0,0 +1,1466 @@
+//================================================================================================================
+// Include files
+//================================================================================================================
+#include "DXBCAssembler.h"
+#include "DXBCOpcodeInfo.h"
+#include "DXBCSyntax.h"
+#include <stdlib.h>
+#include <string.h>
+
+
+
+
+
+//================================================================================================================
+// Structures
+//================================================================================================================
+// Read position in the assembly text, together with the first error found
+struct DXBCTextCursor
+{
+	const char*			p;
+	const char*			pEnd;
+	const char*			pLineStart;
+	unsigned int		line;
+	DXBCAssemblyError	error;				// pMessage stays NULL while there is no error
+};
+
+
+
+
+
+//================================================================================================================
+// Mnemonic lookup
+//================================================================================================================
+// Opcode of the mnemonic or -1 if there is no such one. Immediate constant buffer is the only custom data block
+// written as text.
+static int FindOpcode(const char *pName, size_t inLength)
+{
+	static const char s_immediateConstantBuffer[] = "dcl_immediateConstantBuffer";
+
+	if(inLength == sizeof(s_immediateConstantBuffer) - 1 && memcmp(pName, s_immediateConstantBuffer, inLength) == 0)
+		return D3D10_SB_OPCODE_CUSTOMDATA;
+
+	int opcode = FindDXBCOpcode(pName, inLength);
+
+	return (opcode == D3D10_SB_OPCODE_CUSTOMDATA) ? -1 : opcode;
+}
+
+
+
+
+
+//================================================================================================================
+// Text reading
+//================================================================================================================
+static bool Fail(DXBCTextCursor &text, const char *pMessage)
+{
+	if(!text.error.pMessage)
+	{
+		text.error.line = text.line;
+		text.error.column = (unsigned int)(text.p - text.pLineStart) + 1;
+		text.error.pMessage = pMessage;
+	}
+
+	return false;
+}
+
+static bool IsLetter(char inChar)
+{
+	return (inChar >= 'a' && inChar <= 'z') || (inChar >= 'A' && inChar <= 'Z') || inChar == '_';
+}
+
+static bool IsDigit(char inChar)
+{
+	return inChar >= '0' && inChar <= '9';
+}
+
+// Skips spaces and comments up to the end of line
+static void SkipBlanks(DXBCTextCursor &text)
+{
+	while(text.p < text.pEnd)
+	{
+		if(*text.p == ' ' || *text.p == '\t' || *text.p == '\r')
+		{
+			text.p++;
+		}
+		else if(*text.p == '/' && text.p + 1 < text.pEnd && text.p[1] == '/')
+		{
+			while(text.p < text.pEnd && *text.p != '\n')
+				text.p++;
+		}
+		else
+		{
+			break;
+		}
+	}
+}
+
+// Skips blanks and line ends
+static void SkipWhitespace(DXBCTextCursor &text)
+{
+	for(SkipBlanks(text); text.p < text.pEnd && *text.p == '\n'; SkipBlanks(text))
+	{
+		text.p++;
+		text.line++;
+		text.pLineStart = text.p;
+	}
+}
+
+static bool IsLineEnd(DXBCTextCursor &text)
+{
+	SkipBlanks(text);
+	return text.p >= text.pEnd || *text.p == '\n';
+}
+
+static bool Accept(DXBCTextCursor &text, char inChar)
+{
+	SkipBlanks(text);
+
+	if(text.p < text.pEnd && *text.p == inChar)
+	{
+		text.p++;
+		return true;
+	}
+
+	return false;
+}
+
+static bool Expect(DXBCTextCursor &text, char inChar, const char *pMessage)
+{
+	return Accept(text, inChar) || Fail(text, pMessage);
+}
+
+// Word of letters, digits and '_' starting with a letter
+static bool ReadWord(DXBCTextCursor &text, const char **ppWord, size_t *pLength)
+{
+	SkipBlanks(text);
+
+	const char* pWord = text.p;
+
+	if(text.p < text.pEnd && IsLetter(*text.p))
+	{
+		while(text.p < text.pEnd && (IsLetter(*text.p) || IsDigit(*text.p)))
+			text.p++;
+	}
+
+	*ppWord = pWord;
+	*pLength = text.p - pWord;
+	return *pLength != 0;
+}
+
+static bool IsWord(const char *pWord, size_t inLength, const char *pName)
+{
+	return strncmp(pName, pWord, inLength) == 0 && pName[inLength] == 0;
+}
+
+#define DXBC_FIND_NAME(table, pWord, length)	FindName(table, sizeof(table) / sizeof(table[0]), pWord, length)
+
+// Index of the name in the table or -1 if it is not there
+static int FindName(const char* const *pNames, unsigned int inNameCount, const char *pWord, size_t inLength)
+{
+	for(unsigned int i = 0; i < inNameCount; i++)
+	{
+		if(pNames[i] && IsWord(pWord, inLength, pNames[i]))
+			return (int)i;
+	}
+
+	return -1;
+}
+
+// Reads a word that has to be one of the names of the table
+static bool ParseName(DXBCTextCursor &text, const char* const *pNames, unsigned int inNameCount, const char *pMessage, unsigned int *pIndex)
+{
+	const char* pWord;
+	size_t length;
+
+	if(!ReadWord(text, &pWord, &length))
+		return Fail(text, pMessage);
+
+	int index = FindName(pNames, inNameCount, pWord, length);
+
+	if(index < 0)
+	{
+		text.p = pWord;
+		return Fail(text, pMessage);
+	}
+
+	*pIndex = (unsigned int)index;
+	return true;
+}
+
+#define DXBC_PARSE_NAME(text, table, pMessage, pIndex)	ParseName(text, table, sizeof(table) / sizeof(table[0]), pMessage, pIndex)
+
+// Copies characters of a number (decimal, hex or float, with sign) into a null terminated buffer for strto*
+static bool ReadNumber(DXBCTextCursor &text, char (&buffer)[64])
+{
+	SkipBlanks(text);
+
+	size_t length = 0;
+
+	while(text.p + length < text.pEnd && length < sizeof(buffer) - 1)
+	{
+		char c = text.p[length];
+		bool isSign = (c == '-' || c == '+') && (length == 0 || buffer[length - 1] == 'e' || buffer[length - 1] == 'E');
+
+		if(!IsDigit(c) && !IsLetter(c) && c != '.' && !isSign)
+			break;
+
+		buffer[length++] = c;
+	}
+
+	buffer[length] = 0;
+
+	if(!length)
+		return Fail(text, "number expected");
+
+	text.p += length;
+	return true;
+}
+
+static bool IsHexNumber(const char *pNumber)
+{
+	return pNumber[0] == '0' && (pNumber[1] == 'x' || pNumber[1] == 'X');
+}
+
+// Decimal or hex digits only, as register indices are directly followed by components (r1.xy)
+static bool ParseUnsigned(DXBCTextCursor &text, unsigned long long *pValue)
+{
+	SkipBlanks(text);
+
+	const char* pStart = text.p;
+	bool isHex = (text.pEnd - text.p > 2) && IsHexNumber(text.p);
+	unsigned long long value = 0;
+	bool overflow = false;
+
+	if(isHex)
+		text.p += 2;
+
+	const char* pDigits = text.p;
+
+	for(; text.p < text.pEnd; text.p++)
+	{
+		char c = *text.p;
+		unsigned int digit;
+
+		if(IsDigit(c))
+			digit = c - '0';
+		else if(isHex && c >= 'a' && c <= 'f')
+			digit = c - 'a' + 10;
+		else if(isHex && c >= 'A' && c <= 'F')
+			digit = c - 'A' + 10;
+		else
+			break;
+
+		unsigned int base = isHex ? 16 : 10;
+
+		overflow |= value > (~0ull - digit) / base;
+		value = value * base + digit;
+	}
+
+	if(text.p == pDigits || overflow || (text.p < text.pEnd && (IsLetter(*text.p) || IsDigit(*text.p))))
+	{
+		text.p = pStart;
+		return Fail(text, "unsigned integer expected");
+	}
+
+	*pValue = value;
+	return true;
+}
+
+static bool ParseDWORD(DXBCTextCursor &text, DWORD *pValue)
+{
+	const char* pStart = text.p;
+	unsigned long long value;
+
+	if(!ParseUnsigned(text, &value))
+		return false;
+
+	if(value > 0xffffffffull)
+	{
+		text.p = pStart;
+		return Fail(text, "value does not fit in 32 bits");
+	}
+
+	*pValue = (DWORD)value;
+	return true;
+}
+
+// Parses the number and appends it
+static bool ParseDWORDTo(DXBCTextCursor &text, std::vector<DWORD> &opcodes)
+{
+	DWORD value;
+
+	if(!ParseDWORD(text, &value))
+		return false;
+
+	opcodes.push_back(value);
+	return true;
+}
+
+static bool ParseSigned(DXBCTextCursor &text, int *pValue)
+{
+	const char* pStart = text.p;
+	char buffer[64];
+	char* pNumberEnd;
+
+	if(!ReadNumber(text, buffer))
+		return false;
+
+	long value = strtol(buffer, &pNumberEnd, 10);
+
+	if(*pNumberEnd || value < -0x7fffffffL - 1 || value > 0x7fffffffL)
+	{
+		text.p = pStart;
+		return Fail(text, "integer expected");
+	}
+
+	*pValue = (int)value;
+	return true;
+}
+
+// 32 bit immediate: hex is taken as raw bits, numbers with '.', exponent, inf or nan as float, others as integer
+static bool ParseImmediate32(DXBCTextCursor &text, DWORD *pValue)
+{
+	const char* pStart = text.p;
+	char buffer[64];
+	char* pNumberEnd;
+	bool valid;
+
+	if(!ReadNumber(text, buffer))
+		return false;
+
+	const char* pDigits = buffer + ((buffer[0] == '-' || buffer[0] == '+') ? 1 : 0);
+
+	if(IsHexNumber(pDigits))
+	{
+		unsigned long long value = strtoull(pDigits, &pNumberEnd, 16);
+
+		valid = value <= 0xffffffffull;
+		*pValue = (buffer[0] == '-') ? 0u - (DWORD)value : (DWORD)value;
+	}
+	else if(strpbrk(pDigits, ".eEnN"))
+	{
+		float value = strtof(buffer, &pNumberEnd);
+
+		valid = true;
+		memcpy(pValue, &value, sizeof(*pValue));
+	}
+	else
+	{
+		long long value = strtoll(buffer, &pNumberEnd, 10);
+
+		valid = value >= -0x80000000LL && value <= 0xffffffffLL;
+		*pValue = (DWORD)value;
+	}
+
+	if(!valid || *pNumberEnd)
+	{
+		text.p = pStart;
+		return Fail(text, "invalid immediate value");
+	}
+
+	return true;
+}
+
+static bool ParseDouble(DXBCTextCursor &text, double *pValue)
+{
+	const char* pStart = text.p;
+	char buffer[64];
+	char* pNumberEnd;
+
+	if(!ReadNumber(text, buffer))
+		return false;
+
+	*pValue = strtod(buffer, &pNumberEnd);
+
+	if(*pNumberEnd)
+	{
+		text.p = pStart;
+		return Fail(text, "invalid double value");
+	}
+
+	return true;
+}
+
+// Reads up to four of x, y, z, w and returns their indices
+static unsigned int ReadComponents(DXBCTextCursor &text, unsigned int (&components)[4])
+{
+	unsigned int count = 0;
+
+	while(count < 4 && text.p < text.pEnd)
+	{
+		const char* pComponent = (const char*)memchr(s_componentNames, *text.p, 4);
+
+		if(!pComponent)
+			break;
+
+		components[count++] = (unsigned int)(pComponent - s_componentNames);
+		text.p++;
+	}
+
+	return count;
+}
+
+// "(float,float,float,float)" of resource declarations and _indexable instructions
+static bool ParseReturnTypes(DXBCTextCursor &text, unsigned int (&returnTypes)[4])
+{
+	for(unsigned int i = 0; i < 4; i++)
+	{
+		if(i && !Expect(text, ',', "',' expected"))
+			return false;
+
+		if(!DXBC_PARSE_NAME(text, s_returnTypeNames, "resource return type expected", &returnTypes[i]))
+			return false;
+	}
+
+	return Expect(text, ')', "')' expected");
+}
+
+
+
+
+
+//================================================================================================================
+// Operands
+//================================================================================================================
+// Components of register operands without component selection, the way the compiler writes them
+static D3D10_SB_OPERAND_NUM_COMPONENTS GetDefaultComponentCount(D3D10_SB_OPERAND_TYPE inType)
+{
+	switch(inType)
+	{
+	case D3D10_SB_OPERAND_TYPE_SAMPLER:
+	case D3D10_SB_OPERAND_TYPE_RESOURCE:
+	case D3D10_SB_OPERAND_TYPE_LABEL:
+	case D3D10_SB_OPERAND_TYPE_NULL:
+	case D3D10_SB_OPERAND_TYPE_RASTERIZER:
+	case D3D11_SB_OPERAND_TYPE_STREAM:
+	case D3D11_SB_OPERAND_TYPE_FUNCTION_BODY:
+	case D3D11_SB_OPERAND_TYPE_FUNCTION_TABLE:
+	case D3D11_SB_OPERAND_TYPE_INTERFACE:
+	case D3D11_SB_OPERAND_TYPE_FUNCTION_INPUT:
+	case D3D11_SB_OPERAND_TYPE_FUNCTION_OUTPUT:
+	case D3D11_SB_OPERAND_TYPE_THIS_POINTER:
+	case D3D11_SB_OPERAND_TYPE_UNORDERED_ACCESS_VIEW:
+	case D3D11_SB_OPERAND_TYPE_THREAD_GROUP_SHARED_MEMORY:
+		return D3D10_SB_OPERAND_0_COMPONENT;
+
+	case D3D10_SB_OPERAND_TYPE_INPUT_PRIMITIVEID:
+	case D3D10_SB_OPERAND_TYPE_OUTPUT_DEPTH:
+	case D3D10_SB_OPERAND_TYPE_OUTPUT_COVERAGE_MASK:
+	case D3D11_SB_OPERAND_TYPE_OUTPUT_CONTROL_POINT_ID:
+	case D3D11_SB_OPERAND_TYPE_INPUT_FORK_INSTANCE_ID:
+	case D3D11_SB_OPERAND_TYPE_INPUT_JOIN_INSTANCE_ID:
+	case D3D11_SB_OPERAND_TYPE_INPUT_COVERAGE_MASK:
+	case D3D11_SB_OPERAND_TYPE_INPUT_THREAD_ID_IN_GROUP_FLATTENED:
+	case D3D11_SB_OPERAND_TYPE_INPUT_GS_INSTANCE_ID:
+	case D3D11_SB_OPERAND_TYPE_OUTPUT_DEPTH_GREATER_EQUAL:
+	case D3D11_SB_OPERAND_TYPE_OUTPUT_DEPTH_LESS_EQUAL:
+		return D3D10_SB_OPERAND_1_COMPONENT;
+
+	default:
+		return D3D10_SB_OPERAND_4_COMPONENT;
+	}
+}
+
+static bool ParseOperand(DXBCTextCursor &text, std::vector<DWORD> &opcodes, bool inDestination);
+
+// One register index: "3" right after register name or "[3]", "[r0.x]", "[r0.x + 3]" in brackets. Immediate
+// part is written before the relative operand, the way they follow in the token stream.
+static bool ParseOperandIndex(DXBCTextCursor &text, std::vector<DWORD> &opcodes, bool inBracketed, D3D10_SB_OPERAND_INDEX_REPRESENTATION *pRepresentation)
+{
+	std::vector<DWORD> relative;
+	unsigned long long immediate = 0;
+	bool hasImmediate = true;
+
+	if(inBracketed)
+	{
+		SkipBlanks(text);
+
+		if(text.p < text.pEnd && !IsDigit(*text.p))
+		{
+			if(!ParseOperand(text, relative, false))
+				return false;
+
+			hasImmediate = Accept(text, '+');
+		}
+	}
+
+	if(hasImmediate && !ParseUnsigned(text, &immediate))
+		return false;
+
+	if(inBracketed && !Expect(text, ']', "']' expected"))
+		return false;
+
+	bool is64Bit = immediate > 0xffffffffull;
+
+	if(hasImmediate)
+	{
+		// High DWORD first
+		if(is64Bit)
+			opcodes.push_back((DWORD)(immediate >> 32));
+
+		opcodes.push_back((DWORD)immediate);
+	}
+
+	opcodes.insert(opcodes.end(), relative.begin(), relative.end());
+
+	if(!hasImmediate)
+		*pRepresentation = D3D10_SB_OPERAND_INDEX_RELATIVE;
+	else if(relative.empty())
+		*pRepresentation = is64Bit ? D3D10_SB_OPERAND_INDEX_IMMEDIATE64 : D3D10_SB_OPERAND_INDEX_IMMEDIATE32;
+	else
+		*pRepresentation = is64Bit ? D3D10_SB_OPERAND_INDEX_IMMEDIATE64_PLUS_RELATIVE : D3D10_SB_OPERAND_INDEX_IMMEDIATE32_PLUS_RELATIVE;
+
+	return true;
+}
+
+// l(1.0, 2, 0x3, 4.5) or d(1.0, 2.0)
+static bool ParseImmediateOperand(DXBCTextCursor &text, std::vector<DWORD> &opcodes, bool inIsDouble, DWORD *pToken)
+{
+	unsigned int maxCount = inIsDouble ? 2 : 4;
+	unsigned int count = 0;
+
+	do
+	{
+		if(count == maxCount)
+			return Fail(text, "too many immediate values");
+
+		if(inIsDouble)
+		{
+			double value;
+			DWORD parts[2];
+
+			if(!ParseDouble(text, &value))
+				return false;
+
+			// Low DWORD first
+			memcpy(parts, &value, sizeof(parts));
+			opcodes.push_back(parts[0]);
+			opcodes.push_back(parts[1]);
+		}
+		else
+		{
+			DWORD value;
+
+			if(!ParseImmediate32(text, &value))
+				return false;
+
+			opcodes.push_back(value);
+		}
+
+		count++;
+	}
+	while(Accept(text, ','));
+
+	if(!Expect(text, ')', "')' expected"))
+		return false;
+
+	if(count != 1 && count != maxCount)
+		return Fail(text, inIsDouble ? "d() takes 1 or 2 values" : "l() takes 1 or 4 values");
+
+	*pToken |=	ENCODE_D3D10_SB_OPERAND_TYPE(inIsDouble ? D3D10_SB_OPERAND_TYPE_IMMEDIATE64 : D3D10_SB_OPERAND_TYPE_IMMEDIATE32) |
+				ENCODE_D3D10_SB_OPERAND_NUM_COMPONENTS((count == 1) ? D3D10_SB_OPERAND_1_COMPONENT : D3D10_SB_OPERAND_4_COMPONENT) |
+				ENCODE_D3D10_SB_OPERAND_INDEX_DIMENSION(D3D10_SB_OPERAND_INDEX_0D);
+	return true;
+}
+
+// Register, its indices and component selection: "r0.xy", "cb0[r1.x + 2].xyzw", "vPrim"
+static bool ParseRegisterOperand(DXBCTextCursor &text, std::vector<DWORD> &opcodes, const char *pName, size_t inNameLength, bool inDestination, DWORD *pToken)
+{
+	int type = -1;
+
+	// "l" is both immediate and label, immediates are handled before
+	for(unsigned int i = 0; i < sizeof(s_registerNames) / sizeof(s_registerNames[0]) && type < 0; i++)
+	{
+		if(i != D3D10_SB_OPERAND_TYPE_IMMEDIATE32 && i != D3D10_SB_OPERAND_TYPE_IMMEDIATE64 && IsWord(pName, inNameLength, s_registerNames[i]))
+			type = (int)i;
+	}
+
+	if(type < 0)
+	{
+		text.p = pName;
+		return Fail(text, "unknown register");
+	}
+
+	DWORD token = ENCODE_D3D10_SB_OPERAND_TYPE(type);
+	unsigned int indexCount = 0;
+
+	while(text.p < text.pEnd && (IsDigit(*text.p) || *text.p == '['))
+	{
+		bool bracketed = (*text.p == '[');
+		D3D10_SB_OPERAND_INDEX_REPRESENTATION representation;
+
+		if(indexCount == 3 || (indexCount && !bracketed))
+			return Fail(text, "unexpected register index");
+
+		if(bracketed)
+			text.p++;
+
+		if(!ParseOperandIndex(text, opcodes, bracketed, &representation))
+			return false;
+
+		token |= ENCODE_D3D10_SB_OPERAND_INDEX_REPRESENTATION(indexCount, representation);
+		indexCount++;
+	}
+
+	token |= ENCODE_D3D10_SB_OPERAND_INDEX_DIMENSION(indexCount);
+
+	if(text.p < text.pEnd && *text.p == '.')
+	{
+		unsigned int components[4];
+
+		text.p++;
+
+		unsigned int count = ReadComponents(text, components);
+
+		if(!count)
+			return Fail(text, "component selection expected");
+
+		token |= ENCODE_D3D10_SB_OPERAND_NUM_COMPONENTS(D3D10_SB_OPERAND_4_COMPONENT);
+
+		if(inDestination)
+		{
+			DWORD mask = 0;
+
+			for(unsigned int i = 0; i < count; i++)
+				mask |= D3D10_SB_OPERAND_4_COMPONENT_MASK(components[i]);
+
+			token |= ENCODE_D3D10_SB_OPERAND_4_COMPONENT_SELECTION_MODE(D3D10_SB_OPERAND_4_COMPONENT_MASK_MODE) | ENCODE_D3D10_SB_OPERAND_4_COMPONENT_MASK(mask);
+		}
+		else if(count == 1)
+		{
+			token |= ENCODE_D3D10_SB_OPERAND_4_COMPONENT_SELECTION_MODE(D3D10_SB_OPERAND_4_COMPONENT_SELECT_1_MODE) | ENCODE_D3D10_SB_OPERAND_4_COMPONENT_SELECT_1(components[0]);
+		}
+		else
+		{
+			// Short swizzles repeat their last component
+			for(unsigned int i = count; i < 4; i++)
+				components[i] = components[count - 1];
+
+			token |=	ENCODE_D3D10_SB_OPERAND_4_COMPONENT_SELECTION_MODE(D3D10_SB_OPERAND_4_COMPONENT_SWIZZLE_MODE) |
+						ENCODE_D3D10_SB_OPERAND_4_COMPONENT_SWIZZLE(components[0], components[1], components[2], components[3]);
+		}
+	}
+	else
+	{
+		D3D10_SB_OPERAND_NUM_COMPONENTS numComponents = GetDefaultComponentCount((D3D10_SB_OPERAND_TYPE)type);
+
+		token |= ENCODE_D3D10_SB_OPERAND_NUM_COMPONENTS(numComponents);
+
+		// Constant buffers are read whole, everything else without selection has an empty write mask
+		if(type == D3D10_SB_OPERAND_TYPE_CONSTANT_BUFFER || type == D3D10_SB_OPERAND_TYPE_IMMEDIATE_CONSTANT_BUFFER)
+			token |= ENCODE_D3D10_SB_OPERAND_4_COMPONENT_SELECTION_MODE(D3D10_SB_OPERAND_4_COMPONENT_SWIZZLE_MODE) | D3D10_SB_OPERAND_4_COMPONENT_NOSWIZZLE;
+	}
+
+	*pToken |= token;
+	return true;
+}
+
+// Operand with optional modifiers: "-r0.x", "|r0.x|", "-|r0.x|"
+static bool ParseOperand(DXBCTextCursor &text, std::vector<DWORD> &opcodes, bool inDestination)
+{
+	bool negate = Accept(text, '-');
+	bool absolute = Accept(text, '|');
+	D3D10_SB_OPERAND_MODIFIER modifier = D3D10_SB_OPERAND_MODIFIER_NONE;
+
+	if(negate)
+		modifier = absolute ? D3D10_SB_OPERAND_MODIFIER_ABSNEG : D3D10_SB_OPERAND_MODIFIER_NEG;
+	else if(absolute)
+		modifier = D3D10_SB_OPERAND_MODIFIER_ABS;
+
+	size_t tokenIndex = opcodes.size();
+	DWORD token = ENCODE_D3D10_SB_OPERAND_EXTENDED(modifier != D3D10_SB_OPERAND_MODIFIER_NONE);
+
+	opcodes.push_back(0);
+
+	if(modifier != D3D10_SB_OPERAND_MODIFIER_NONE)
+		opcodes.push_back(ENCODE_D3D10_SB_EXTENDED_OPERAND_MODIFIER(modifier));
+
+	// Register names are letters only, the first index follows right after them
+	SkipBlanks(text);
+
+	const char* pName = text.p;
+
+	while(text.p < text.pEnd && IsLetter(*text.p) && *text.p != '_')
+		text.p++;
+
+	size_t nameLength = text.p - pName;
+
+	if(!nameLength)
+		return Fail(text, "operand expected");
+
+	bool ok;
+
+	if(nameLength == 1 && (*pName == 'l' || *pName == 'd') && text.p < text.pEnd && *text.p == '(')
+	{
+		text.p++;
+		ok = ParseImmediateOperand(text, opcodes, *pName == 'd', &token);
+	}
+	else
+	{
+		ok = ParseRegisterOperand(text, opcodes, pName, nameLength, inDestination, &token);
+	}
+
+	if(!ok || (absolute && !Expect(text, '|', "'|' expected")))
+		return false;
+
+	opcodes[tokenIndex] = token;
+	return true;
+}
+
+// Resource declaration operand with its return types in front: "(float,float,float,float) t0"
+static bool ParseTypedOperand(DXBCTextCursor &text, std::vector<DWORD> &opcodes)
+{
+	unsigned int returnTypes[4];
+
+	if(!Expect(text, '(', "'(' expected") || !ParseReturnTypes(text, returnTypes) || !ParseOperand(text, opcodes, true))
+		return false;
+
+	DWORD returnToken = 0;
+
+	for(unsigned int i = 0; i < 4; i++)
+		returnToken |= ENCODE_D3D10_SB_RESOURCE_RETURN_TYPE(returnTypes[i], i);
+
+	opcodes.push_back(returnToken);
+	return true;
+}
+
+
+
+
+
+//================================================================================================================
+// Instructions
+//================================================================================================================
+// Takes the next '_' separated piece of the text after the mnemonic
+static bool NextSuffix(const char **ppSuffix, const char *pSuffixEnd, const char **ppPiece, size_t *pLength)
+{
+	if(*ppSuffix >= pSuffixEnd)
+		return false;
+
+	const char* pPiece = *ppSuffix + 1;
+	const char* p = pPiece;
+
+	while(p < pSuffixEnd && *p != '_')
+		p++;
+
+	*ppPiece = pPiece;
+	*pLength = p - pPiece;
+	*ppSuffix = p;
+	return true;
+}
+
+// dcl_immediateConstantBuffer { { 1.0, 2.0, 3.0, 4.0 }, { ... } }, rows may continue on following lines
+static bool ParseImmediateConstantBuffer(DXBCTextCursor &text, std::vector<DWORD> &opcodes)
+{
+	SkipWhitespace(text);
+
+	if(!Expect(text, '{', "'{' expected"))
+		return false;
+
+	SkipWhitespace(text);
+
+	if(Accept(text, '}'))
+		return true;
+
+	do
+	{
+		SkipWhitespace(text);
+
+		if(!Expect(text, '{', "'{' expected"))
+			return false;
+
+		do
+		{
+			DWORD value;
+
+			SkipWhitespace(text);
+
+			if(!ParseImmediate32(text, &value))
+				return false;
+
+			opcodes.push_back(value);
+			SkipWhitespace(text);
+		}
+		while(Accept(text, ','));
+
+		if(!Expect(text, '}', "'}' expected"))
+			return false;
+
+		SkipWhitespace(text);
+	}
+	while(Accept(text, ','));
+
+	SkipWhitespace(text);
+	return Expect(text, '}', "'}' expected");
+}
+
+// Interpolation modes have several words, the longest one matching wins
+static bool ParseInterpolationMode(DXBCTextCursor &text, DWORD *pMode)
+{
+	size_t matchLength = 0;
+
+	SkipBlanks(text);
+
+	for(unsigned int i = 0; i < sizeof(s_interpolationNames) / sizeof(s_interpolationNames[0]); i++)
+	{
+		size_t length = strlen(s_interpolationNames[i]);
+
+		if(	length > matchLength && length <= (size_t)(text.pEnd - text.p) && memcmp(text.p, s_interpolationNames[i], length) == 0 &&
+			(text.p + length == text.pEnd || !IsLetter(text.p[length])))
+		{
+			matchLength = length;
+			*pMode = i;
+		}
+	}
+
+	if(!matchLength)
+		return Fail(text, "interpolation mode expected");
+
+	text.p += matchLength;
+	return true;
+}
+
+// "ft3" style reference of function bodies, tables and interfaces
+static bool ParsePrefixedNumber(DXBCTextCursor &text, const char *pPrefix, const char *pMessage, DWORD *pValue)
+{
+	size_t prefixLength = strlen(pPrefix);
+
+	SkipBlanks(text);
+
+	if((size_t)(text.pEnd - text.p) <= prefixLength || memcmp(text.p, pPrefix, prefixLength) != 0 || !IsDigit(text.p[prefixLength]))
+		return Fail(text, pMessage);
+
+	text.p += prefixLength;
+	return ParseDWORD(text, pValue);
+}
+
+// "{ft0, ft1}" lists of function tables and bodies, returns number of entries
+static bool ParseReferenceList(DXBCTextCursor &text, std::vector<DWORD> &opcodes, const char *pPrefix, const char *pMessage, DWORD *pCount)
+{
+	*pCount = 0;
+
+	if(!Expect(text, '=', "'=' expected") || !Expect(text, '{', "'{' expected"))
+		return false;
+
+	if(Accept(text, '}'))
+		return true;
+
+	do
+	{
+		DWORD value;
+
+		if(!ParsePrefixedNumber(text, pPrefix, pMessage, &value))
+			return false;
+
+		opcodes.push_back(value);
+		(*pCount)++;
+	}
+	while(Accept(text, ','));
+
+	return Expect(text, '}', "'}' expected");
+}
+
+// Dimension names can have '_' in them (raw_buffer), so the longest one the suffix starts with is taken
+static int FindResourceDimension(const char *pSuffix, const char *pSuffixEnd, size_t *pLength)
+{
+	int dimension = -1;
+	size_t matchLength = 0;
+
+	for(unsigned int i = 0; i < sizeof(s_resourceDimensionNames) / sizeof(s_resourceDimensionNames[0]); i++)
+	{
+		size_t length = strlen(s_resourceDimensionNames[i]);
+
+		if(	length > matchLength && length <= (size_t)(pSuffixEnd - pSuffix) && memcmp(pSuffix, s_resourceDimensionNames[i], length) == 0 &&
+			(pSuffix + length == pSuffixEnd || pSuffix[length] == '_'))
+		{
+			dimension = (int)i;
+			matchLength = length;
+		}
+	}
+
+	if(dimension >= 0)
+		*pLength = matchLength;
+
+	return dimension;
+}
+
+// Declarations keep most of their settings in the opcode token (added to opcodes[start]) and the rest in the
+// DWORDs after it
+static bool ParseDeclaration(DXBCTextCursor &text, D3D10_SB_OPCODE_TYPE inOpcode, const char *pSuffix, const char *pSuffixEnd, std::vector<DWORD> &opcodes)
+{
+	size_t start = opcodes.size();
+	DWORD token = ENCODE_D3D10_SB_OPCODE_TYPE(inOpcode);
+	bool hasDimension = false;
+	const char* pPiece;
+	size_t length;
+	DWORD value = 0;
+
+	if(inOpcode == D3D10_SB_OPCODE_CUSTOMDATA)
+	{
+		opcodes.push_back(ENCODE_D3D10_SB_CUSTOMDATA_CLASS(D3D10_SB_CUSTOMDATA_DCL_IMMEDIATE_CONSTANT_BUFFER));
+		opcodes.push_back(0);
+		return ParseImmediateConstantBuffer(text, opcodes);
+	}
+
+	opcodes.push_back(0);
+
+	while(NextSuffix(&pSuffix, pSuffixEnd, &pPiece, &length))
+	{
+		int dimension = FindResourceDimension(pPiece, pSuffixEnd, &length);
+		bool isUAV =	inOpcode == D3D11_SB_OPCODE_DCL_UNORDERED_ACCESS_VIEW_TYPED || inOpcode == D3D11_SB_OPCODE_DCL_UNORDERED_ACCESS_VIEW_RAW ||
+						inOpcode == D3D11_SB_OPCODE_DCL_UNORDERED_ACCESS_VIEW_STRUCTURED;
+
+		if((inOpcode == D3D10_SB_OPCODE_DCL_RESOURCE || inOpcode == D3D11_SB_OPCODE_DCL_UNORDERED_ACCESS_VIEW_TYPED) && !hasDimension && dimension >= 0)
+		{
+			token |= ENCODE_D3D10_SB_RESOURCE_DIMENSION(dimension);
+			hasDimension = true;
+			pSuffix = pPiece + length;
+		}
+		else if(isUAV && IsWord(pPiece, length, "glc"))
+		{
+			token |= ENCODE_D3D11_SB_ACCESS_COHERENCY_FLAGS(D3D11_SB_GLOBALLY_COHERENT_ACCESS);
+		}
+		else if(inOpcode == D3D11_SB_OPCODE_DCL_UNORDERED_ACCESS_VIEW_STRUCTURED && IsWord(pPiece, length, "opc"))
+		{
+			token |= ENCODE_D3D11_SB_UAV_FLAGS(D3D11_SB_UAV_HAS_ORDER_PRESERVING_COUNTER);
+		}
+		else if(inOpcode == D3D11_SB_OPCODE_DCL_INTERFACE && IsWord(pPiece, length, "dynamicindexed"))
+		{
+			token |= ENCODE_D3D11_SB_INTERFACE_INDEXED_BIT(1);
+		}
+		else
+		{
+			text.p = pPiece;
+			return Fail(text, "unknown declaration suffix");
+		}
+	}
+
+	if((inOpcode == D3D10_SB_OPCODE_DCL_RESOURCE || inOpcode == D3D11_SB_OPCODE_DCL_UNORDERED_ACCESS_VIEW_TYPED) && !hasDimension)
+		return Fail(text, "resource dimension expected");
+
+	bool ok = true;
+	unsigned int index = 0;
+
+	switch(inOpcode)
+	{
+	case D3D10_SB_OPCODE_DCL_RESOURCE:
+		// Sample count of multisampled textures: dcl_resource_texture2dms(4)
+		if(text.p < text.pEnd && *text.p == '(')
+		{
+			text.p++;
+			ok = ParseDWORD(text, &value) && Expect(text, ')', "')' expected");
+			token |= ENCODE_D3D10_SB_RESOURCE_SAMPLE_COUNT(value);
+		}
+
+		ok = ok && ParseTypedOperand(text, opcodes);
+		break;
+
+	case D3D11_SB_OPCODE_DCL_UNORDERED_ACCESS_VIEW_TYPED:
+		ok = ParseTypedOperand(text, opcodes);
+		break;
+
+	case D3D10_SB_OPCODE_DCL_CONSTANT_BUFFER:
+		ok = ParseOperand(text, opcodes, false) && Expect(text, ',', "',' expected") && ReadWord(text, &pPiece, &length);
+
+		if(ok && IsWord(pPiece, length, "dynamicIndexed"))
+			token |= ENCODE_D3D10_SB_D3D10_SB_CONSTANT_BUFFER_ACCESS_PATTERN(D3D10_SB_CONSTANT_BUFFER_DYNAMIC_INDEXED);
+		else if(!ok || !IsWord(pPiece, length, "immediateIndexed"))
+			ok = Fail(text, "immediateIndexed or dynamicIndexed expected");
+		break;
+
+	case D3D10_SB_OPCODE_DCL_SAMPLER:
+		ok = ParseOperand(text, opcodes, true) && Expect(text, ',', "',' expected") && DXBC_PARSE_NAME(text, s_samplerModeNames, "sampler mode expected", &index);
+		token |= ENCODE_D3D10_SB_SAMPLER_MODE(index);
+		break;
+
+	case D3D10_SB_OPCODE_DCL_INDEX_RANGE:
+		ok = ParseOperand(text, opcodes, true) && ParseDWORDTo(text, opcodes);
+		break;
+
+	case D3D10_SB_OPCODE_DCL_GS_OUTPUT_PRIMITIVE_TOPOLOGY:
+		ok = DXBC_PARSE_NAME(text, s_topologyNames, "primitive topology expected", &index);
+		token |= ENCODE_D3D10_SB_GS_OUTPUT_PRIMITIVE_TOPOLOGY(index);
+		break;
+
+	case D3D10_SB_OPCODE_DCL_GS_INPUT_PRIMITIVE:
+		ok = ReadWord(text, &pPiece, &length);
+
+		if(ok && length > 5 && memcmp(pPiece, "patch", 5) == 0)
+		{
+			DXBCTextCursor count = text;
+
+			count.p = pPiece + 5;
+			ok = ParseDWORD(count, &value) && count.p == pPiece + length && value >= 1 && value <= 32;
+			token |= ENCODE_D3D10_SB_GS_INPUT_PRIMITIVE(D3D11_SB_PRIMITIVE_1_CONTROL_POINT_PATCH + value - 1);
+		}
+		else
+		{
+			int primitive = ok ? DXBC_FIND_NAME(s_primitiveNames, pPiece, length) : -1;
+
+			ok = primitive >= 0;
+			token |= ENCODE_D3D10_SB_GS_INPUT_PRIMITIVE(ok ? primitive : 0);
+		}
+
+		if(!ok)
+			ok = Fail(text, "input primitive expected");
+		break;
+
+	case D3D10_SB_OPCODE_DCL_MAX_OUTPUT_VERTEX_COUNT:
+	case D3D10_SB_OPCODE_DCL_TEMPS:
+	case D3D11_SB_OPCODE_DCL_HS_FORK_PHASE_INSTANCE_COUNT:
+	case D3D11_SB_OPCODE_DCL_HS_JOIN_PHASE_INSTANCE_COUNT:
+	case D3D11_SB_OPCODE_DCL_GS_INSTANCE_COUNT:
+		ok = ParseDWORDTo(text, opcodes);
+		break;
+
+	case D3D10_SB_OPCODE_DCL_INPUT:
+	case D3D10_SB_OPCODE_DCL_OUTPUT:
+	case D3D11_SB_OPCODE_DCL_STREAM:
+	case D3D11_SB_OPCODE_DCL_RESOURCE_RAW:
+	case D3D11_SB_OPCODE_DCL_UNORDERED_ACCESS_VIEW_RAW:
+		ok = ParseOperand(text, opcodes, true);
+		break;
+
+	case D3D10_SB_OPCODE_DCL_INPUT_PS:
+	case D3D10_SB_OPCODE_DCL_INPUT_PS_SGV:
+	case D3D10_SB_OPCODE_DCL_INPUT_PS_SIV:
+		ok = ParseInterpolationMode(text, &value) && ParseOperand(text, opcodes, true);
+		token |= ENCODE_D3D10_SB_INPUT_INTERPOLATION_MODE(value);
+
+		if(ok && inOpcode != D3D10_SB_OPCODE_DCL_INPUT_PS)
+		{
+			ok = Expect(text, ',', "',' expected") && DXBC_PARSE_NAME(text, s_systemValueNames, "system value expected", &index);
+			opcodes.push_back(ENCODE_D3D10_SB_NAME(index));
+		}
+		break;
+
+	case D3D10_SB_OPCODE_DCL_INPUT_SGV:
+	case D3D10_SB_OPCODE_DCL_INPUT_SIV:
+	case D3D10_SB_OPCODE_DCL_OUTPUT_SGV:
+	case D3D10_SB_OPCODE_DCL_OUTPUT_SIV:
+		ok = ParseOperand(text, opcodes, true) && Expect(text, ',', "',' expected") && DXBC_PARSE_NAME(text, s_systemValueNames, "system value expected", &index);
+		opcodes.push_back(ENCODE_D3D10_SB_NAME(index));
+		break;
+
+	case D3D10_SB_OPCODE_DCL_INDEXABLE_TEMP:
+		// x0[16], 4
+		ok = ParsePrefixedNumber(text, "x", "indexable temp expected", &value);
+
+		if(ok)
+		{
+			opcodes.push_back(value);
+			ok =	Expect(text, '[', "'[' expected") && ParseDWORDTo(text, opcodes) && Expect(text, ']', "']' expected") &&
+					Expect(text, ',', "',' expected") && ParseDWORDTo(text, opcodes);
+		}
+		break;
+
+	case D3D10_SB_OPCODE_DCL_GLOBAL_FLAGS:
+		if(!IsLineEnd(text))
+		{
+			do
+			{
+				SkipBlanks(text);
+
+				if(text.p < text.pEnd && IsDigit(*text.p))
+				{
+					ok = ParseDWORD(text, &value);
+					token |= ENCODE_D3D10_SB_GLOBAL_FLAGS(value);
+					continue;
+				}
+
+				ok = ReadWord(text, &pPiece, &length);
+
+				unsigned int i = 0;
+
+				while(ok && i < sizeof(s_globalFlagNames) / sizeof(s_globalFlagNames[0]) && !IsWord(pPiece, length, s_globalFlagNames[i].pName))
+					i++;
+
+				if(ok && i < sizeof(s_globalFlagNames) / sizeof(s_globalFlagNames[0]))
+					token |= ENCODE_D3D10_SB_GLOBAL_FLAGS(s_globalFlagNames[i].flag);
+				else
+					ok = Fail(text, "unknown global flag");
+			}
+			while(ok && Accept(text, '|'));
+		}
+		break;
+
+	case D3D11_SB_OPCODE_DCL_FUNCTION_BODY:
+		ok = ParsePrefixedNumber(text, "fb", "function body expected", &value);
+		opcodes.push_back(value);
+		break;
+
+	case D3D11_SB_OPCODE_DCL_FUNCTION_TABLE:
+		// ft0 = {fb0, fb1}
+		ok = ParsePrefixedNumber(text, "ft", "function table expected", &value);
+
+		if(ok)
+		{
+			size_t countIndex = opcodes.size() + 1;
+
+			opcodes.push_back(value);
+			opcodes.push_back(0);
+			ok = ParseReferenceList(text, opcodes, "fb", "function body expected", &value);
+			opcodes[countIndex] = value;
+		}
+		break;
+
+	case D3D11_SB_OPCODE_DCL_INTERFACE:
+		// fp0[array length][function count] = {ft0, ft1}
+		{
+			DWORD arrayLength = 0, functionCount = 0;
+
+			ok =	ParsePrefixedNumber(text, "fp", "interface expected", &value) &&
+					Expect(text, '[', "'[' expected") && ParseDWORD(text, &arrayLength) && Expect(text, ']', "']' expected") &&
+					Expect(text, '[', "'[' expected") && ParseDWORD(text, &functionCount) && Expect(text, ']', "']' expected");
+
+			if(ok)
+			{
+				size_t lengthIndex = opcodes.size() + 2;
+
+				opcodes.push_back(value);
+				opcodes.push_back(functionCount);
+				opcodes.push_back(0);
+				ok = ParseReferenceList(text, opcodes, "ft", "function table expected", &value);
+				opcodes[lengthIndex] = ENCODE_D3D11_SB_INTERFACE_TABLE_LENGTH(value) | ENCODE_D3D11_SB_INTERFACE_ARRAY_LENGTH(arrayLength);
+			}
+		}
+		break;
+
+	case D3D11_SB_OPCODE_DCL_INPUT_CONTROL_POINT_COUNT:
+		ok = ParseDWORD(text, &value);
+		token |= ENCODE_D3D11_SB_INPUT_CONTROL_POINT_COUNT(value);
+		break;
+
+	case D3D11_SB_OPCODE_DCL_OUTPUT_CONTROL_POINT_COUNT:
+		ok = ParseDWORD(text, &value);
+		token |= ENCODE_D3D11_SB_OUTPUT_CONTROL_POINT_COUNT(value);
+		break;
+
+	case D3D11_SB_OPCODE_DCL_TESS_DOMAIN:
+		ok = DXBC_PARSE_NAME(text, s_tessDomainNames, "tessellator domain expected", &index);
+		token |= ENCODE_D3D11_SB_TESS_DOMAIN(index);
+		break;
+
+	case D3D11_SB_OPCODE_DCL_TESS_PARTITIONING:
+		ok = DXBC_PARSE_NAME(text, s_tessPartitioningNames, "tessellator partitioning expected", &index);
+		token |= ENCODE_D3D11_SB_TESS_PARTITIONING(index);
+		break;
+
+	case D3D11_SB_OPCODE_DCL_TESS_OUTPUT_PRIMITIVE:
+		ok = DXBC_PARSE_NAME(text, s_tessOutputNames, "tessellator output primitive expected", &index);
+		token |= ENCODE_D3D11_SB_TESS_OUTPUT_PRIMITIVE(index);
+		break;
+
+	case D3D11_SB_OPCODE_DCL_HS_MAX_TESSFACTOR:
+		// l(64.0)
+		if(!ReadWord(text, &pPiece, &length) || !IsWord(pPiece, length, "l") || !Accept(text, '('))
+			ok = Fail(text, "l(max tessellation factor) expected");
+		else
+			ok = ParseImmediate32(text, &value) && Expect(text, ')', "')' expected");
+
+		opcodes.push_back(value);
+		break;
+
+	case D3D11_SB_OPCODE_DCL_THREAD_GROUP:
+		ok =	ParseDWORDTo(text, opcodes) && Expect(text, ',', "',' expected") && ParseDWORDTo(text, opcodes) &&
+				Expect(text, ',', "',' expected") && ParseDWORDTo(text, opcodes);
+		break;
+
+	case D3D11_SB_OPCODE_DCL_UNORDERED_ACCESS_VIEW_STRUCTURED:
+	case D3D11_SB_OPCODE_DCL_THREAD_GROUP_SHARED_MEMORY_RAW:
+	case D3D11_SB_OPCODE_DCL_RESOURCE_STRUCTURED:
+		ok = ParseOperand(text, opcodes, true) && Expect(text, ',', "',' expected") && ParseDWORDTo(text, opcodes);
+		break;
+
+	case D3D11_SB_OPCODE_DCL_THREAD_GROUP_SHARED_MEMORY_STRUCTURED:
+		ok =	ParseOperand(text, opcodes, true) && Expect(text, ',', "',' expected") && ParseDWORDTo(text, opcodes) &&
+				Expect(text, ',', "',' expected") && ParseDWORDTo(text, opcodes);
+		break;
+
+	default:
+		break;
+	}
+
+	opcodes[start] = token;
+	return ok;
+}
+
+// Instruction with its suffixes (_sat, _nz, _aoffimmi(...) and such), [precise] and operands
+static bool ParseOperation(DXBCTextCursor &text, D3D10_SB_OPCODE_TYPE inOpcode, const char *pSuffix, const char *pSuffixEnd, std::vector<DWORD> &opcodes)
+{
+	DWORD token = ENCODE_D3D10_SB_OPCODE_TYPE(inOpcode);
+	DWORD sampleControls = ENCODE_D3D10_SB_EXTENDED_OPCODE_TYPE(D3D10_SB_EXTENDED_OPCODE_SAMPLE_CONTROLS);
+	DWORD resourceDimension = ENCODE_D3D10_SB_EXTENDED_OPCODE_TYPE(D3D11_SB_EXTENDED_OPCODE_RESOURCE_DIM);
+	DWORD returnTypes = ENCODE_D3D10_SB_EXTENDED_OPCODE_TYPE(D3D11_SB_EXTENDED_OPCODE_RESOURCE_RETURN_TYPE);
+	bool hasSampleControls = false, hasResourceDimension = false, hasReturnTypes = false;
+	bool readOffsets = false, readDimension = false;
+	const char* pPiece;
+	size_t length;
+
+	while(NextSuffix(&pSuffix, pSuffixEnd, &pPiece, &length))
+	{
+		if(inOpcode != D3D11_SB_OPCODE_SYNC && IsWord(pPiece, length, "sat"))
+			token |= ENCODE_D3D10_SB_INSTRUCTION_SATURATE(1);
+		else if((GetDXBCOpcodeInfo(inOpcode).flags & DXBC_OPCODE_TEST_BOOLEAN) && IsWord(pPiece, length, "nz"))
+			token |= ENCODE_D3D10_SB_INSTRUCTION_TEST_BOOLEAN(D3D10_SB_INSTRUCTION_TEST_NONZERO);
+		else if((GetDXBCOpcodeInfo(inOpcode).flags & DXBC_OPCODE_TEST_BOOLEAN) && IsWord(pPiece, length, "z"))
+			token |= ENCODE_D3D10_SB_INSTRUCTION_TEST_BOOLEAN(D3D10_SB_INSTRUCTION_TEST_ZERO);
+		else if(inOpcode == D3D10_SB_OPCODE_RESINFO && IsWord(pPiece, length, "rcpFloat"))
+			token |= ENCODE_D3D10_SB_RESINFO_INSTRUCTION_RETURN_TYPE(D3D10_SB_RESINFO_INSTRUCTION_RETURN_RCPFLOAT);
+		else if(inOpcode == D3D10_SB_OPCODE_RESINFO && IsWord(pPiece, length, "uint"))
+			token |= ENCODE_D3D10_SB_RESINFO_INSTRUCTION_RETURN_TYPE(D3D10_SB_RESINFO_INSTRUCTION_RETURN_UINT);
+		else if(inOpcode == D3D10_1_SB_OPCODE_SAMPLE_INFO && IsWord(pPiece, length, "uint"))
+			token |= ENCODE_D3D10_SB_INSTRUCTION_RETURN_TYPE(D3D10_SB_INSTRUCTION_RETURN_UINT);
+		else if(inOpcode == D3D11_SB_OPCODE_SYNC && IsWord(pPiece, length, "uglobal"))
+			token |= ENCODE_D3D11_SB_SYNC_FLAGS(D3D11_SB_SYNC_UNORDERED_ACCESS_VIEW_MEMORY_GLOBAL);
+		else if(inOpcode == D3D11_SB_OPCODE_SYNC && IsWord(pPiece, length, "ugroup"))
+			token |= ENCODE_D3D11_SB_SYNC_FLAGS(D3D11_SB_SYNC_UNORDERED_ACCESS_VIEW_MEMORY_GROUP);
+		else if(inOpcode == D3D11_SB_OPCODE_SYNC && IsWord(pPiece, length, "g"))
+			token |= ENCODE_D3D11_SB_SYNC_FLAGS(D3D11_SB_SYNC_THREAD_GROUP_SHARED_MEMORY);
+		else if(inOpcode == D3D11_SB_OPCODE_SYNC && IsWord(pPiece, length, "t"))
+			token |= ENCODE_D3D11_SB_SYNC_FLAGS(D3D11_SB_SYNC_THREADS_IN_GROUP);
+		else if(IsWord(pPiece, length, "aoffimmi"))
+			hasSampleControls = true;
+		else if(IsWord(pPiece, length, "indexable"))
+			hasResourceDimension = true;
+		else
+		{
+			text.p = pPiece;
+			return Fail(text, "unknown instruction suffix");
+		}
+	}
+
+	// Groups right after the mnemonic: texel offsets, resource dimension and return types, in this order
+	while(text.p < text.pEnd && *text.p == '(')
+	{
+		text.p++;
+
+		if(hasSampleControls && !readOffsets)
+		{
+			for(unsigned int i = 0; i < 3; i++)
+			{
+				int offset;
+
+				if((i && !Expect(text, ',', "',' expected")) || !ParseSigned(text, &offset))
+					return false;
+
+				if(offset < -8 || offset > 7)
+					return Fail(text, "texel offset must be within -8..7");
+
+				sampleControls |= ENCODE_IMMEDIATE_D3D10_SB_ADDRESS_OFFSET(i, (DWORD)offset & 0xf);
+			}
+
+			if(!Expect(text, ')', "')' expected"))
+				return false;
+
+			readOffsets = true;
+		}
+		else if(hasResourceDimension && !readDimension)
+		{
+			unsigned int dimension;
+
+			if(!DXBC_PARSE_NAME(text, s_resourceDimensionNames, "resource dimension expected", &dimension) || !Expect(text, ')', "')' expected"))
+				return false;
+
+			resourceDimension |= ENCODE_D3D11_SB_EXTENDED_RESOURCE_DIMENSION(dimension);
+			readDimension = true;
+		}
+		else if(!hasReturnTypes)
+		{
+			unsigned int types[4];
+
+			if(!ParseReturnTypes(text, types))
+				return false;
+
+			for(unsigned int i = 0; i < 4; i++)
+				returnTypes |= ENCODE_D3D11_SB_EXTENDED_RESOURCE_RETURN_TYPE(types[i], i);
+
+			hasReturnTypes = true;
+		}
+		else
+		{
+			return Fail(text, "unexpected '('");
+		}
+	}
+
+	if(hasSampleControls != readOffsets || hasResourceDimension != readDimension)
+		return Fail(text, "'(' expected");
+
+	// [precise] or [precise(xy)]
+	if(Accept(text, '['))
+	{
+		DWORD precise = 0xf;
+
+		if(!ReadWord(text, &pPiece, &length) || !IsWord(pPiece, length, "precise"))
+			return Fail(text, "precise expected");
+
+		if(text.p < text.pEnd && *text.p == '(')
+		{
+			unsigned int components[4];
+
+			text.p++;
+			precise = 0;
+
+			for(unsigned int i = 0, count = ReadComponents(text, components); i < count; i++)
+				precise |= 1 << components[i];
+
+			if(!Expect(text, ')', "')' expected"))
+				return false;
+		}
+
+		if(!Expect(text, ']', "']' expected"))
+			return false;
+
+		token |= ENCODE_D3D11_SB_INSTRUCTION_PRECISE_VALUES(precise);
+	}
+
+	// Extended opcode tokens chain, every one but the last has the extended bit set
+	DWORD extendedTokens[3];
+	unsigned int extendedCount = 0;
+
+	if(hasSampleControls)
+		extendedTokens[extendedCount++] = sampleControls;
+
+	if(hasResourceDimension)
+		extendedTokens[extendedCount++] = resourceDimension;
+
+	if(hasReturnTypes)
+		extendedTokens[extendedCount++] = returnTypes;
+
+	opcodes.push_back(token | ENCODE_D3D10_SB_OPCODE_EXTENDED(extendedCount != 0));
+
+	for(unsigned int i = 0; i < extendedCount; i++)
+		opcodes.push_back(extendedTokens[i] | ENCODE_D3D10_SB_OPCODE_EXTENDED(i + 1 < extendedCount));
+
+	if(IsLineEnd(text))
+		return true;
+
+	unsigned int destinationCount = GetDXBCOpcodeInfo(inOpcode).destinationCount;
+	size_t operandStart = opcodes.size();
+	unsigned int operandCount = 0;
+
+	do
+	{
+		// Interface call: "fcall fp0[0][0], 1" has the function index in front of its operand
+		if(inOpcode == D3D11_SB_OPCODE_INTERFACE_CALL && operandCount == 1)
+		{
+			DWORD functionIndex;
+
+			if(!ParseDWORD(text, &functionIndex))
+				return false;
+
+			opcodes.insert(opcodes.begin() + operandStart, functionIndex);
+		}
+		else if(!ParseOperand(text, opcodes, operandCount < destinationCount))
+		{
+			return false;
+		}
+
+		operandCount++;
+	}
+	while(Accept(text, ','));
+
+	return true;
+}
+
+// Shader version line of disassembly, like ps_5_0
+static bool IsVersionLine(const char *pWord, size_t inLength)
+{
+	return	inLength >= 6 && pWord[1] == 's' && pWord[2] == '_' && IsDigit(pWord[3]) && pWord[4] == '_' && IsDigit(pWord[5]) &&
+			DXBC_FIND_NAME(s_programPrefixes, pWord, 2) >= 0;
+}
+
+static bool ParseInstruction(DXBCTextCursor &text, std::vector<DWORD> &opcodes)
+{
+	const char* pWord;
+	size_t wordLength;
+
+	if(!ReadWord(text, &pWord, &wordLength))
+		return Fail(text, "instruction expected");
+
+	if(IsVersionLine(pWord, wordLength))
+		return true;
+
+	// Longest mnemonic the word starts with, the rest holds '_' separated suffixes (sample_l_aoffimmi_indexable)
+	size_t mnemonicLength = wordLength;
+	int opcode;
+
+	while((opcode = FindOpcode(pWord, mnemonicLength)) < 0)
+	{
+		do
+		{
+			mnemonicLength--;
+		}
+		while(mnemonicLength && pWord[mnemonicLength] != '_');
+
+		if(!mnemonicLength)
+		{
+			text.p = pWord;
+			return Fail(text, "unknown instruction");
+		}
+	}
+
+	size_t start = opcodes.size();
+	const char* pSuffixEnd = pWord + wordLength;
+	bool ok;
+
+	if(IsDXBCDeclaration(opcode) || opcode == D3D10_SB_OPCODE_CUSTOMDATA)
+		ok = ParseDeclaration(text, (D3D10_SB_OPCODE_TYPE)opcode, pWord + mnemonicLength, pSuffixEnd, opcodes);
+	else
+		ok = ParseOperation(text, (D3D10_SB_OPCODE_TYPE)opcode, pWord + mnemonicLength, pSuffixEnd, opcodes);
+
+	if(!ok)
+		return false;
+
+	size_t length = opcodes.size() - start;
+
+	if(opcode == D3D10_SB_OPCODE_CUSTOMDATA)
+	{
+		opcodes[start + 1] = (DWORD)length;
+	}
+	else
+	{
+		if(length > (D3D10_SB_TOKENIZED_INSTRUCTION_LENGTH_MASK >> D3D10_SB_TOKENIZED_INSTRUCTION_LENGTH_SHIFT))
+			return Fail(text, "instruction is too long");
+
+		opcodes[start] |= ENCODE_D3D10_SB_TOKENIZED_INSTRUCTION_LENGTH(length);
+	}
+
+	return true;
+}
+
+
+
+
+
+//================================================================================================================
+// Function definitions
+//================================================================================================================
+DXBCPatchStatus AssembleDXBCOpcodes(	const char			*pText,				//[In]	Assembly text (doesn't need to be null terminated)
+										unsigned int		inTextLength,		//[In]	Length of text
+										std::vector<DWORD>	&opcodes,			//[Out]	Opcodes are appended here
+										DXBCAssemblyError	*pError				//[Out]	Optional error location
+	)
+{
+	DXBCTextCursor text = { pText, pText + inTextLength, pText, 1, { 0, 0, NULL } };
+	size_t originalSize = opcodes.size();
+
+	for(SkipWhitespace(text); text.p < text.pEnd; SkipWhitespace(text))
+	{
+		// Every instruction takes the rest of its line
+		if(!ParseInstruction(text, opcodes) || (!IsLineEnd(text) && !Fail(text, "unexpected text after instruction")))
+			break;
+	}
+
+	if(pError)
+		*pError = text.error;
+
+	if(text.error.pMessage)
+	{
+		opcodes.resize(originalSize);
+		return DXBC_PATCH_SYNTAX_ERROR;
+	}
+
+	return DXBC_PATCH_OK;
+}
@@ -0,0 +1,43 @@
+// Author: Henryk Kosobucki, 2016
+
+//=============================================	OVERVIEW =========================================================
+//	SM4/SM5 assembler producing opcode streams for PatchDXBC, so patches can be written as text instead of
+//	hand-built DWORD arrays:
+//
+//		dcl_temps 2
+//		mov r0.xyzw, cb0[3].xyzw
+//		if_nz r1.x
+//		  mul_sat o0.xyzw, r0.xyzw, l(0.500000, 0.500000, 0.500000, 1.000000)
+//		endif
+//
+//	Syntax is the one DisassembleDXBC prints (instructions with their suffixes, extended opcode groups such as
+//	_aoffimmi(-1,0,0), [precise], operands with modifiers and relative indices, declarations and immediate
+//	constant buffers), so disassembled code assembles back to the same tokens. Comments (//) and shader version
+//	lines (ps_5_0) are skipped. Destination operands (the leading ones of every instruction) take a write mask,
+//	sources a swizzle (.x selects a single component, .xy is padded to .xyyy).
+//
+//	Mnemonics are found through a perfect hash (one hash of the word and a single string compare), so large
+//	patch libraries assemble at the speed they can be read.
+//================================================================================================================
+
+#ifndef DXBC_ASSEMBLER_H
+#define DXBC_ASSEMBLER_H
+
+#include "Patcher.h"
+
+struct DXBCAssemblyError
+{
+	unsigned int		line;				// Line of the error (counted from 1)
+	unsigned int		column;				// Column of the error (counted from 1)
+	const char*			pMessage;			// What is wrong (static string)
+};
+
+// Assembles text and appends opcodes to the stream. On DXBC_PATCH_SYNTAX_ERROR the stream is left as it was
+// and *pError (if given) says where assembly stopped.
+DXBCPatchStatus AssembleDXBCOpcodes(	const char			*pText,				//[In]	Assembly text (doesn't need to be null terminated)
+										unsigned int		inTextLength,		//[In]	Length of text
+										std::vector<DWORD>	&opcodes,			//[Out]	Opcodes are appended here
+										DXBCAssemblyError	*pError				//[Out]	Optional error location
+	);
+
+#endif // DXBC_ASSEMBLER_H
@@ -0,0 +1,573 @@
+// Author: Henryk Kosobucki, 2016
+
+//=============================================	OVERVIEW =========================================================
+//	Compile-time builder of injected code. Snippets are written as C++ expressions close to the assembly:
+//
+//		using namespace DXBCBuilder;
+//
+//		static constexpr auto s_tint = MakeOpcodes(	mul(r(0).xyzw(), r(0).xyzw(), cb(0, 3)),
+//													sat(add(o(0).xyzw(), r(0).xyzw(), l(0.1f, 0.1f, 0.1f, 0.0f))));
+//
+//		PatchDXBCBounded(pShader, shaderSize, s_tint.GetData(), s_tint.GetSize(), insertBeforeOpcode, ...);
+//
+//	Everything is encoded while compiling (through the ENCODE_* macros of the format header), so the snippet is
+//	plain constant data in the binary, with instruction lengths filled in. Malformed operands (unknown
+//	components, writing an immediate or a resource, selecting components of registers that have none) stop the
+//	compilation with the reason, instead of producing a broken shader chunk. Wrong operand counts don't compile
+//	either, every instruction takes exactly its operands.
+//
+//	Operands follow the assembler rules: the leading (destination) operands take a write mask, the others a
+//	swizzle (.x selects single component, xy repeats the last one: xyyy). 4 component registers without any
+//	selection are written / read whole. Mnemonics that are C++ keywords or Windows.h macros end with '_' (and_,
+//	else_, min_).
+//	Immediates are l(1.0f), l(1), l(0x3f800000u) or l(x, y, z, w), the type decides whether the bits are float
+//	or integer (-0.0f is encoded as 0.0f, use -l(0.0f) for negative zero).
+//================================================================================================================
+
+#ifndef DXBC_BUILDER_H
+#define DXBC_BUILDER_H
+
+#include "DXBCOpcodeInfo.h"
+#include <initializer_list>
+#include <stdlib.h>
+
+#define DXBC_BUILDER_MAX_INSTRUCTION_DWORDS		24
+
+namespace DXBCBuilder
+{
+//================================================================================================================
+// Structures
+//================================================================================================================
+// Register index: immediate or temp register component plus immediate (r(1).x() + 3)
+struct Index
+{
+	DWORD			value;
+	bool			isRelative;
+	DWORD			relativeRegister;			// Temp register holding the index
+	DWORD			relativeComponent;			// Its component
+
+	constexpr Index() : value(0), isRelative(false), relativeRegister(0), relativeComponent(0) {}
+	constexpr Index(unsigned int inValue) : value(inValue), isRelative(false), relativeRegister(0), relativeComponent(0) {}
+	constexpr Index(DWORD inRegister, DWORD inComponent, unsigned int inOffset) : value(inOffset), isRelative(true), relativeRegister(inRegister), relativeComponent(inComponent) {}
+};
+
+// Not constexpr on purpose: reaching it while a builder is evaluated at compile time is a compile error (the
+// compiler shows the message in its notes), at run time it stops the program.
+inline void Error(const char *pMessage)
+{
+	OutputDebugStringA(pMessage);
+	OutputDebugStringA("\n");
+	abort();
+}
+
+struct Operand
+{
+	DWORD			type;						// D3D10_SB_OPERAND_TYPE
+	DWORD			numComponents;				// D3D10_SB_OPERAND_NUM_COMPONENTS
+	bool			isWritable;
+	DWORD			indexCount;
+	Index			indices[2];
+	DWORD			components[4];				// Selected components (from the text)
+	DWORD			componentCount;				// 0 when there is no selection
+	DWORD			modifier;					// D3D10_SB_OPERAND_MODIFIER
+	DWORD			immediates[4];				// Values of immediate operands (numComponents of them)
+
+	constexpr Operand(DWORD inType, DWORD inNumComponents, bool inIsWritable, DWORD inIndexCount, Index inIndex0, Index inIndex1)
+		: type(inType), numComponents(inNumComponents), isWritable(inIsWritable), indexCount(inIndexCount), indices{ inIndex0, inIndex1 },
+		  components{ 0, 0, 0, 0 }, componentCount(0), modifier(D3D10_SB_OPERAND_MODIFIER_NONE), immediates{ 0, 0, 0, 0 }
+	{
+	}
+
+	// Components from text, e.g. "xyxx"
+	constexpr Operand select(const char *pComponents) const
+	{
+		Operand operand = *this;
+		DWORD count = 0;
+
+		if(type == D3D10_SB_OPERAND_TYPE_IMMEDIATE32 || numComponents != D3D10_SB_OPERAND_4_COMPONENT)
+			Error("DXBCBuilder: register has no components to select");
+
+		for(; pComponents[count]; count++)
+		{
+			char c = pComponents[count];
+
+			if(count == 4)
+				Error("DXBCBuilder: more than 4 components selected");
+
+			if(c != 'x' && c != 'y' && c != 'z' && c != 'w')
+				Error("DXBCBuilder: components are x, y, z and w");
+
+			operand.components[count] = (c == 'w') ? 3 : (DWORD)(c - 'x');
+		}
+
+		if(!count)
+			Error("DXBCBuilder: empty component selection");
+
+		operand.componentCount = count;
+		return operand;
+	}
+
+	constexpr Operand x() const		{ return select("x"); }
+	constexpr Operand y() const		{ return select("y"); }
+	constexpr Operand z() const		{ return select("z"); }
+	constexpr Operand w() const		{ return select("w"); }
+	constexpr Operand xy() const	{ return select("xy"); }
+	constexpr Operand xyz() const	{ return select("xyz"); }
+	constexpr Operand xyzw() const	{ return select("xyzw"); }
+};
+
+struct Instruction
+{
+	DWORD			tokens[DXBC_BUILDER_MAX_INSTRUCTION_DWORDS];
+	unsigned int	count;
+};
+
+// Opcode stream of a snippet, sized for the instructions it was built from
+template<unsigned int Capacity>
+struct Opcodes
+{
+	DWORD			tokens[Capacity];
+	unsigned int	count;
+
+	const DWORD*	GetData() const { return tokens; }
+	unsigned int	GetSize() const { return count * (unsigned int)sizeof(DWORD); }		// In bytes, as PatchDXBC takes it
+};
+
+
+
+
+
+//================================================================================================================
+// Operands
+//================================================================================================================
+constexpr Operand MakeRegister(D3D10_SB_OPERAND_TYPE inType, D3D10_SB_OPERAND_NUM_COMPONENTS inNumComponents, bool inIsWritable, DWORD inIndexCount, Index inIndex0 = Index(), Index inIndex1 = Index())
+{
+	return Operand(inType, inNumComponents, inIsWritable, inIndexCount, inIndex0, inIndex1);
+}
+
+constexpr Operand r(unsigned int inIndex)					{ return MakeRegister(D3D10_SB_OPERAND_TYPE_TEMP, D3D10_SB_OPERAND_4_COMPONENT, true, 1, inIndex); }
+constexpr Operand v(unsigned int inIndex)					{ return MakeRegister(D3D10_SB_OPERAND_TYPE_INPUT, D3D10_SB_OPERAND_4_COMPONENT, false, 1, inIndex); }
+constexpr Operand o(unsigned int inIndex)					{ return MakeRegister(D3D10_SB_OPERAND_TYPE_OUTPUT, D3D10_SB_OPERAND_4_COMPONENT, true, 1, inIndex); }
+constexpr Operand x(unsigned int inIndex, Index inElement)	{ return MakeRegister(D3D10_SB_OPERAND_TYPE_INDEXABLE_TEMP, D3D10_SB_OPERAND_4_COMPONENT, true, 2, inIndex, inElement); }
+constexpr Operand cb(unsigned int inIndex, Index inElement)	{ return MakeRegister(D3D10_SB_OPERAND_TYPE_CONSTANT_BUFFER, D3D10_SB_OPERAND_4_COMPONENT, false, 2, inIndex, inElement); }
+constexpr Operand icb(Index inElement)						{ return MakeRegister(D3D10_SB_OPERAND_TYPE_IMMEDIATE_CONSTANT_BUFFER, D3D10_SB_OPERAND_4_COMPONENT, false, 1, inElement); }
+constexpr Operand t(unsigned int inIndex)					{ return MakeRegister(D3D10_SB_OPERAND_TYPE_RESOURCE, D3D10_SB_OPERAND_4_COMPONENT, false, 1, inIndex); }
+constexpr Operand s(unsigned int inIndex)					{ return MakeRegister(D3D10_SB_OPERAND_TYPE_SAMPLER, D3D10_SB_OPERAND_0_COMPONENT, false, 1, inIndex); }
+constexpr Operand u(unsigned int inIndex)					{ return MakeRegister(D3D11_SB_OPERAND_TYPE_UNORDERED_ACCESS_VIEW, D3D10_SB_OPERAND_4_COMPONENT, true, 1, inIndex); }
+constexpr Operand g(unsigned int inIndex)					{ return MakeRegister(D3D11_SB_OPERAND_TYPE_THREAD_GROUP_SHARED_MEMORY, D3D10_SB_OPERAND_4_COMPONENT, true, 1, inIndex); }
+constexpr Operand null()									{ return MakeRegister(D3D10_SB_OPERAND_TYPE_NULL, D3D10_SB_OPERAND_0_COMPONENT, true, 0); }
+
+// IEEE bits of the float, computed by scaling (bit casts are not allowed at compile time). Every step is exact.
+constexpr DWORD FloatBits(float inValue)
+{
+	if(inValue != inValue)
+		return 0x7fc00000;
+
+	DWORD sign = (inValue < 0.0f) ? 0x80000000u : 0;
+	float magnitude = (inValue < 0.0f) ? -inValue : inValue;
+	int exponent = 0;
+
+	if(magnitude == 0.0f)
+		return sign;
+
+	if(magnitude > 3.40282347e+38f)
+		return sign | 0x7f800000;
+
+	while(magnitude >= 2.0f)
+	{
+		magnitude /= 2.0f;
+		exponent++;
+	}
+
+	while(magnitude < 1.0f && exponent > -126)
+	{
+		magnitude *= 2.0f;
+		exponent--;
+	}
+
+	// Denormals keep exponent -126 and have no implicit 1
+	if(magnitude < 1.0f)
+		return sign | (DWORD)(magnitude * 8388608.0f);
+
+	return sign | ((DWORD)(exponent + 127) << 23) | (DWORD)((magnitude - 1.0f) * 8388608.0f);
+}
+
+constexpr DWORD ImmediateBits(float inValue)			{ return FloatBits(inValue); }
+constexpr DWORD ImmediateBits(double inValue)			{ return FloatBits((float)inValue); }
+constexpr DWORD ImmediateBits(int inValue)				{ return (DWORD)inValue; }
+constexpr DWORD ImmediateBits(unsigned int inValue)		{ return (DWORD)inValue; }
+
+template<typename T>
+constexpr Operand l(T inValue)
+{
+	Operand operand = MakeRegister(D3D10_SB_OPERAND_TYPE_IMMEDIATE32, D3D10_SB_OPERAND_1_COMPONENT, false, 0);
+	operand.immediates[0] = ImmediateBits(inValue);
+	return operand;
+}
+
+template<typename X, typename Y, typename Z, typename W>
+constexpr Operand l(X inX, Y inY, Z inZ, W inW)
+{
+	Operand operand = MakeRegister(D3D10_SB_OPERAND_TYPE_IMMEDIATE32, D3D10_SB_OPERAND_4_COMPONENT, false, 0);
+	operand.immediates[0] = ImmediateBits(inX);
+	operand.immediates[1] = ImmediateBits(inY);
+	operand.immediates[2] = ImmediateBits(inZ);
+	operand.immediates[3] = ImmediateBits(inW);
+	return operand;
+}
+
+// Relative index: cb(0, r(1).x() + 2)
+constexpr Index operator+(const Operand &reg, unsigned int inOffset)
+{
+	if(reg.type != D3D10_SB_OPERAND_TYPE_TEMP || reg.componentCount != 1 || reg.modifier != D3D10_SB_OPERAND_MODIFIER_NONE)
+		Error("DXBCBuilder: relative index has to be a single temp register component");
+
+	return Index(reg.indices[0].value, reg.components[0], inOffset);
+}
+
+constexpr Operand operator-(const Operand &operand)
+{
+	Operand negated = operand;
+
+	switch(operand.modifier)
+	{
+	case D3D10_SB_OPERAND_MODIFIER_NONE:	negated.modifier = D3D10_SB_OPERAND_MODIFIER_NEG; break;
+	case D3D10_SB_OPERAND_MODIFIER_NEG:		negated.modifier = D3D10_SB_OPERAND_MODIFIER_NONE; break;
+	case D3D10_SB_OPERAND_MODIFIER_ABS:		negated.modifier = D3D10_SB_OPERAND_MODIFIER_ABSNEG; break;
+	default:								negated.modifier = D3D10_SB_OPERAND_MODIFIER_ABS; break;
+	}
+
+	return negated;
+}
+
+constexpr Operand abs(const Operand &operand)
+{
+	Operand absolute = operand;
+	absolute.modifier = D3D10_SB_OPERAND_MODIFIER_ABS;
+	return absolute;
+}
+
+
+
+
+
+//================================================================================================================
+// Encoding
+//================================================================================================================
+constexpr void Append(Instruction &instruction, DWORD inToken)
+{
+	if(instruction.count == DXBC_BUILDER_MAX_INSTRUCTION_DWORDS)
+		Error("DXBCBuilder: instruction is too long");
+
+	instruction.tokens[instruction.count++] = inToken;
+}
+
+// Write mask of destinations, swizzle (or single component) of sources
+constexpr DWORD EncodeComponentSelection(const Operand &operand, bool inDestination)
+{
+	if(inDestination)
+	{
+		DWORD mask = 0;
+
+		for(DWORD i = 0; i < operand.componentCount; i++)
+		{
+			if(mask & D3D10_SB_OPERAND_4_COMPONENT_MASK(operand.components[i]))
+				Error("DXBCBuilder: write mask repeats a component");
+
+			mask |= D3D10_SB_OPERAND_4_COMPONENT_MASK(operand.components[i]);
+		}
+
+		return	ENCODE_D3D10_SB_OPERAND_4_COMPONENT_SELECTION_MODE(D3D10_SB_OPERAND_4_COMPONENT_MASK_MODE) |
+				ENCODE_D3D10_SB_OPERAND_4_COMPONENT_MASK(operand.componentCount ? mask : D3D10_SB_OPERAND_4_COMPONENT_MASK_ALL);
+	}
+
+	if(operand.componentCount == 1)
+	{
+		return	ENCODE_D3D10_SB_OPERAND_4_COMPONENT_SELECTION_MODE(D3D10_SB_OPERAND_4_COMPONENT_SELECT_1_MODE) |
+				ENCODE_D3D10_SB_OPERAND_4_COMPONENT_SELECT_1(operand.components[0]);
+	}
+
+	if(!operand.componentCount)
+		return ENCODE_D3D10_SB_OPERAND_4_COMPONENT_SELECTION_MODE(D3D10_SB_OPERAND_4_COMPONENT_SWIZZLE_MODE) | D3D10_SB_OPERAND_4_COMPONENT_NOSWIZZLE;
+
+	// Short swizzles repeat their last component
+	DWORD swizzle[4] = { 0, 0, 0, 0 };
+
+	for(DWORD i = 0; i < 4; i++)
+		swizzle[i] = operand.components[(i < operand.componentCount) ? i : operand.componentCount - 1];
+
+	return	ENCODE_D3D10_SB_OPERAND_4_COMPONENT_SELECTION_MODE(D3D10_SB_OPERAND_4_COMPONENT_SWIZZLE_MODE) |
+			ENCODE_D3D10_SB_OPERAND_4_COMPONENT_SWIZZLE(swizzle[0], swizzle[1], swizzle[2], swizzle[3]);
+}
+
+constexpr void EncodeOperand(Instruction &instruction, const Operand &operand, bool inDestination)
+{
+	bool isImmediate = (operand.type == D3D10_SB_OPERAND_TYPE_IMMEDIATE32);
+
+	if(inDestination && !operand.isWritable)
+		Error("DXBCBuilder: destination operand can't be written");
+
+	if(inDestination && operand.modifier != D3D10_SB_OPERAND_MODIFIER_NONE)
+		Error("DXBCBuilder: destination operand can't have modifiers");
+
+	DWORD token =	ENCODE_D3D10_SB_OPERAND_TYPE(operand.type) |
+					ENCODE_D3D10_SB_OPERAND_NUM_COMPONENTS(operand.numComponents) |
+					ENCODE_D3D10_SB_OPERAND_INDEX_DIMENSION(operand.indexCount) |
+					ENCODE_D3D10_SB_OPERAND_EXTENDED(operand.modifier != D3D10_SB_OPERAND_MODIFIER_NONE);
+
+	if(!isImmediate && operand.numComponents == D3D10_SB_OPERAND_4_COMPONENT)
+		token |= EncodeComponentSelection(operand, inDestination);
+
+	for(DWORD i = 0; i < operand.indexCount; i++)
+	{
+		token |= ENCODE_D3D10_SB_OPERAND_INDEX_REPRESENTATION(i, operand.indices[i].isRelative ?
+					D3D10_SB_OPERAND_INDEX_IMMEDIATE32_PLUS_RELATIVE : D3D10_SB_OPERAND_INDEX_IMMEDIATE32);
+	}
+
+	Append(instruction, token);
+
+	if(operand.modifier != D3D10_SB_OPERAND_MODIFIER_NONE)
+		Append(instruction, ENCODE_D3D10_SB_EXTENDED_OPERAND_MODIFIER(operand.modifier));
+
+	// Immediate part of an index comes first, then the register holding the relative part
+	for(DWORD i = 0; i < operand.indexCount; i++)
+	{
+		const Index &index = operand.indices[i];
+
+		Append(instruction, index.value);
+
+		if(index.isRelative)
+		{
+			Append(instruction,	ENCODE_D3D10_SB_OPERAND_TYPE(D3D10_SB_OPERAND_TYPE_TEMP) |
+								ENCODE_D3D10_SB_OPERAND_NUM_COMPONENTS(D3D10_SB_OPERAND_4_COMPONENT) |
+								ENCODE_D3D10_SB_OPERAND_4_COMPONENT_SELECTION_MODE(D3D10_SB_OPERAND_4_COMPONENT_SELECT_1_MODE) |
+								ENCODE_D3D10_SB_OPERAND_4_COMPONENT_SELECT_1(index.relativeComponent) |
+								ENCODE_D3D10_SB_OPERAND_INDEX_DIMENSION(D3D10_SB_OPERAND_INDEX_1D) |
+								ENCODE_D3D10_SB_OPERAND_INDEX_REPRESENTATION(0, D3D10_SB_OPERAND_INDEX_IMMEDIATE32));
+			Append(instruction, index.relativeRegister);
+		}
+	}
+
+	if(isImmediate)
+	{
+		for(DWORD i = 0; i < ((operand.numComponents == D3D10_SB_OPERAND_4_COMPONENT) ? 4u : 1u); i++)
+			Append(instruction, operand.immediates[i]);
+	}
+}
+
+constexpr void SetInstructionLength(Instruction &instruction)
+{
+	instruction.tokens[0] = (instruction.tokens[0] & ~D3D10_SB_TOKENIZED_INSTRUCTION_LENGTH_MASK) | ENCODE_D3D10_SB_TOKENIZED_INSTRUCTION_LENGTH(instruction.count);
+}
+
+// Opcode token with controls (test boolean and such), followed by operands. The leading ones are written (as many
+// as the opcode info says).
+constexpr Instruction MakeInstruction(D3D10_SB_OPCODE_TYPE inOpcode, DWORD inControls, std::initializer_list<Operand> operands)
+{
+	Instruction instruction = {};
+	unsigned int i = 0;
+
+	Append(instruction, ENCODE_D3D10_SB_OPCODE_TYPE(inOpcode) | inControls);
+
+	for(const Operand* pOperand = operands.begin(); pOperand != operands.end(); pOperand++, i++)
+		EncodeOperand(instruction, *pOperand, i < GetDXBCOpcodeInfo(inOpcode).destinationCount);
+
+	SetInstructionLength(instruction);
+	return instruction;
+}
+
+// Saturated result: sat(add(...))
+constexpr Instruction sat(Instruction instruction)
+{
+	instruction.tokens[0] |= ENCODE_D3D10_SB_INSTRUCTION_SATURATE(1);
+	return instruction;
+}
+
+// Precise result for the components of the mask (D3D10_SB_OPERAND_4_COMPONENT_MASK_X and such, shifted down)
+constexpr Instruction precise(Instruction instruction, DWORD inComponentMask = 0xf)
+{
+	instruction.tokens[0] |= ENCODE_D3D11_SB_INSTRUCTION_PRECISE_VALUES(inComponentMask);
+	return instruction;
+}
+
+// Immediate texel offset of sample and ld instructions: aoffimmi(sample(...), -1, 0, 0)
+constexpr Instruction aoffimmi(Instruction instruction, int inU, int inV, int inW)
+{
+	int offsets[3] = { inU, inV, inW };
+	DWORD controls = ENCODE_D3D10_SB_EXTENDED_OPCODE_TYPE(D3D10_SB_EXTENDED_OPCODE_SAMPLE_CONTROLS);
+
+	if(DECODE_IS_D3D10_SB_OPCODE_EXTENDED(instruction.tokens[0]))
+		Error("DXBCBuilder: instruction already has extended opcode");
+
+	for(DWORD i = 0; i < 3; i++)
+	{
+		if(offsets[i] < -8 || offsets[i] > 7)
+			Error("DXBCBuilder: texel offset must be within -8..7");
+
+		controls |= ENCODE_IMMEDIATE_D3D10_SB_ADDRESS_OFFSET(i, (DWORD)offsets[i] & 0xf);
+	}
+
+	// Extended token goes right after the opcode token
+	Append(instruction, 0);
+
+	for(unsigned int i = instruction.count - 1; i > 1; i--)
+		instruction.tokens[i] = instruction.tokens[i - 1];
+
+	instruction.tokens[0] |= ENCODE_D3D10_SB_OPCODE_EXTENDED(1);
+	instruction.tokens[1] = controls;
+	SetInstructionLength(instruction);
+	return instruction;
+}
+
+template<typename... Instructions>
+constexpr Opcodes<sizeof...(Instructions) * DXBC_BUILDER_MAX_INSTRUCTION_DWORDS> MakeOpcodes(const Instructions&... instructions)
+{
+	static_assert(sizeof...(Instructions) > 0, "Snippet needs at least one instruction");
+
+	Opcodes<sizeof...(Instructions) * DXBC_BUILDER_MAX_INSTRUCTION_DWORDS> opcodes = {};
+	const Instruction list[] = { instructions... };
+
+	for(const Instruction &instruction : list)
+	{
+		for(unsigned int i = 0; i < instruction.count; i++)
+			opcodes.tokens[opcodes.count++] = instruction.tokens[i];
+	}
+
+	return opcodes;
+}
+
+
+
+
+
+//================================================================================================================
+// Instructions
+//================================================================================================================
+// Operand count is checked against the opcode info, so every instruction takes exactly the operands it has
+#define DXBC_BUILDER_OPERATION(name, opcode, count, parameters, ...) \
+	static_assert(GetDXBCOpcodeInfo(opcode).operandCount == count, #name " has different number of operands"); \
+	constexpr Instruction name parameters { return MakeInstruction(opcode, 0, { __VA_ARGS__ }); }
+
+#define DXBC_BUILDER_OPERATION_0(name, opcode)	DXBC_BUILDER_OPERATION(name, opcode, 0, (), )
+#define DXBC_BUILDER_OPERATION_1(name, opcode)	DXBC_BUILDER_OPERATION(name, opcode, 1, (const Operand &a), a)
+#define DXBC_BUILDER_OPERATION_2(name, opcode)	DXBC_BUILDER_OPERATION(name, opcode, 2, (const Operand &a, const Operand &b), a, b)
+#define DXBC_BUILDER_OPERATION_3(name, opcode)	DXBC_BUILDER_OPERATION(name, opcode, 3, (const Operand &a, const Operand &b, const Operand &c), a, b, c)
+#define DXBC_BUILDER_OPERATION_4(name, opcode)	DXBC_BUILDER_OPERATION(name, opcode, 4, (const Operand &a, const Operand &b, const Operand &c, const Operand &d), a, b, c, d)
+#define DXBC_BUILDER_OPERATION_5(name, opcode)	DXBC_BUILDER_OPERATION(name, opcode, 5, (const Operand &a, const Operand &b, const Operand &c, const Operand &d, const Operand &e), a, b, c, d, e)
+#define DXBC_BUILDER_OPERATION_6(name, opcode)	DXBC_BUILDER_OPERATION(name, opcode, 6, (const Operand &a, const Operand &b, const Operand &c, const Operand &d, const Operand &e, const Operand &f), a, b, c, d, e, f)
+
+// Conditional instructions come as name_z and name_nz
+#define DXBC_BUILDER_CONDITIONAL(name, opcode) \
+	static_assert(GetDXBCOpcodeInfo(opcode).flags & DXBC_OPCODE_TEST_BOOLEAN, #name " has no test"); \
+	constexpr Instruction name##_z(const Operand &a) { return MakeInstruction(opcode, ENCODE_D3D10_SB_INSTRUCTION_TEST_BOOLEAN(D3D10_SB_INSTRUCTION_TEST_ZERO), { a }); } \
+	constexpr Instruction name##_nz(const Operand &a) { return MakeInstruction(opcode, ENCODE_D3D10_SB_INSTRUCTION_TEST_BOOLEAN(D3D10_SB_INSTRUCTION_TEST_NONZERO), { a }); }
+
+// Flow control
+DXBC_BUILDER_CONDITIONAL(if, D3D10_SB_OPCODE_IF)
+DXBC_BUILDER_CONDITIONAL(breakc, D3D10_SB_OPCODE_BREAKC)
+DXBC_BUILDER_CONDITIONAL(continuec, D3D10_SB_OPCODE_CONTINUEC)
+DXBC_BUILDER_CONDITIONAL(retc, D3D10_SB_OPCODE_RETC)
+DXBC_BUILDER_CONDITIONAL(discard, D3D10_SB_OPCODE_DISCARD)
+DXBC_BUILDER_OPERATION_0(else_, D3D10_SB_OPCODE_ELSE)
+DXBC_BUILDER_OPERATION_0(endif, D3D10_SB_OPCODE_ENDIF)
+DXBC_BUILDER_OPERATION_0(loop, D3D10_SB_OPCODE_LOOP)
+DXBC_BUILDER_OPERATION_0(endloop, D3D10_SB_OPCODE_ENDLOOP)
+DXBC_BUILDER_OPERATION_0(break_, D3D10_SB_OPCODE_BREAK)
+DXBC_BUILDER_OPERATION_0(continue_, D3D10_SB_OPCODE_CONTINUE)
+DXBC_BUILDER_OPERATION_1(switch_, D3D10_SB_OPCODE_SWITCH)
+DXBC_BUILDER_OPERATION_1(case_, D3D10_SB_OPCODE_CASE)
+DXBC_BUILDER_OPERATION_0(default_, D3D10_SB_OPCODE_DEFAULT)
+DXBC_BUILDER_OPERATION_0(endswitch, D3D10_SB_OPCODE_ENDSWITCH)
+DXBC_BUILDER_OPERATION_0(ret, D3D10_SB_OPCODE_RET)
+DXBC_BUILDER_OPERATION_0(nop, D3D10_SB_OPCODE_NOP)
+
+// One source
+DXBC_BUILDER_OPERATION_2(mov, D3D10_SB_OPCODE_MOV)
+DXBC_BUILDER_OPERATION_2(frc, D3D10_SB_OPCODE_FRC)
+DXBC_BUILDER_OPERATION_2(exp, D3D10_SB_OPCODE_EXP)
+DXBC_BUILDER_OPERATION_2(log, D3D10_SB_OPCODE_LOG)
+DXBC_BUILDER_OPERATION_2(sqrt, D3D10_SB_OPCODE_SQRT)
+DXBC_BUILDER_OPERATION_2(rsq, D3D10_SB_OPCODE_RSQ)
+DXBC_BUILDER_OPERATION_2(rcp, D3D11_SB_OPCODE_RCP)
+DXBC_BUILDER_OPERATION_2(round_ne, D3D10_SB_OPCODE_ROUND_NE)
+DXBC_BUILDER_OPERATION_2(round_ni, D3D10_SB_OPCODE_ROUND_NI)
+DXBC_BUILDER_OPERATION_2(round_pi, D3D10_SB_OPCODE_ROUND_PI)
+DXBC_BUILDER_OPERATION_2(round_z, D3D10_SB_OPCODE_ROUND_Z)
+DXBC_BUILDER_OPERATION_2(ftoi, D3D10_SB_OPCODE_FTOI)
+DXBC_BUILDER_OPERATION_2(ftou, D3D10_SB_OPCODE_FTOU)
+DXBC_BUILDER_OPERATION_2(itof, D3D10_SB_OPCODE_ITOF)
+DXBC_BUILDER_OPERATION_2(utof, D3D10_SB_OPCODE_UTOF)
+DXBC_BUILDER_OPERATION_2(ineg, D3D10_SB_OPCODE_INEG)
+DXBC_BUILDER_OPERATION_2(not_, D3D10_SB_OPCODE_NOT)
+DXBC_BUILDER_OPERATION_2(deriv_rtx, D3D10_SB_OPCODE_DERIV_RTX)
+DXBC_BUILDER_OPERATION_2(deriv_rty, D3D10_SB_OPCODE_DERIV_RTY)
+DXBC_BUILDER_OPERATION_2(countbits, D3D11_SB_OPCODE_COUNTBITS)
+DXBC_BUILDER_OPERATION_2(bfrev, D3D11_SB_OPCODE_BFREV)
+DXBC_BUILDER_OPERATION_2(firstbit_hi, D3D11_SB_OPCODE_FIRSTBIT_HI)
+DXBC_BUILDER_OPERATION_2(firstbit_lo, D3D11_SB_OPCODE_FIRSTBIT_LO)
+DXBC_BUILDER_OPERATION_2(f32tof16, D3D11_SB_OPCODE_F32TOF16)
+DXBC_BUILDER_OPERATION_2(f16tof32, D3D11_SB_OPCODE_F16TOF32)
+
+// Two sources
+DXBC_BUILDER_OPERATION_3(add, D3D10_SB_OPCODE_ADD)
+DXBC_BUILDER_OPERATION_3(mul, D3D10_SB_OPCODE_MUL)
+DXBC_BUILDER_OPERATION_3(div, D3D10_SB_OPCODE_DIV)
+DXBC_BUILDER_OPERATION_3(dp2, D3D10_SB_OPCODE_DP2)
+DXBC_BUILDER_OPERATION_3(dp3, D3D10_SB_OPCODE_DP3)
+DXBC_BUILDER_OPERATION_3(dp4, D3D10_SB_OPCODE_DP4)
+DXBC_BUILDER_OPERATION_3(min_, D3D10_SB_OPCODE_MIN)
+DXBC_BUILDER_OPERATION_3(max_, D3D10_SB_OPCODE_MAX)
+DXBC_BUILDER_OPERATION_3(eq, D3D10_SB_OPCODE_EQ)
+DXBC_BUILDER_OPERATION_3(ne, D3D10_SB_OPCODE_NE)
+DXBC_BUILDER_OPERATION_3(lt, D3D10_SB_OPCODE_LT)
+DXBC_BUILDER_OPERATION_3(ge, D3D10_SB_OPCODE_GE)
+DXBC_BUILDER_OPERATION_3(iadd, D3D10_SB_OPCODE_IADD)
+DXBC_BUILDER_OPERATION_3(ieq, D3D10_SB_OPCODE_IEQ)
+DXBC_BUILDER_OPERATION_3(ine, D3D10_SB_OPCODE_INE)
+DXBC_BUILDER_OPERATION_3(ige, D3D10_SB_OPCODE_IGE)
+DXBC_BUILDER_OPERATION_3(ilt, D3D10_SB_OPCODE_ILT)
+DXBC_BUILDER_OPERATION_3(imax, D3D10_SB_OPCODE_IMAX)
+DXBC_BUILDER_OPERATION_3(imin, D3D10_SB_OPCODE_IMIN)
+DXBC_BUILDER_OPERATION_3(ishl, D3D10_SB_OPCODE_ISHL)
+DXBC_BUILDER_OPERATION_3(ishr, D3D10_SB_OPCODE_ISHR)
+DXBC_BUILDER_OPERATION_3(ushr, D3D10_SB_OPCODE_USHR)
+DXBC_BUILDER_OPERATION_3(ult, D3D10_SB_OPCODE_ULT)
+DXBC_BUILDER_OPERATION_3(uge, D3D10_SB_OPCODE_UGE)
+DXBC_BUILDER_OPERATION_3(umax, D3D10_SB_OPCODE_UMAX)
+DXBC_BUILDER_OPERATION_3(umin, D3D10_SB_OPCODE_UMIN)
+DXBC_BUILDER_OPERATION_3(and_, D3D10_SB_OPCODE_AND)
+DXBC_BUILDER_OPERATION_3(or_, D3D10_SB_OPCODE_OR)
+DXBC_BUILDER_OPERATION_3(xor_, D3D10_SB_OPCODE_XOR)
+DXBC_BUILDER_OPERATION_3(ld, D3D10_SB_OPCODE_LD)
+DXBC_BUILDER_OPERATION_3(sincos, D3D10_SB_OPCODE_SINCOS)
+
+// Three and more sources
+DXBC_BUILDER_OPERATION_4(mad, D3D10_SB_OPCODE_MAD)
+DXBC_BUILDER_OPERATION_4(imad, D3D10_SB_OPCODE_IMAD)
+DXBC_BUILDER_OPERATION_4(umad, D3D10_SB_OPCODE_UMAD)
+DXBC_BUILDER_OPERATION_4(movc, D3D10_SB_OPCODE_MOVC)
+DXBC_BUILDER_OPERATION_4(ubfe, D3D11_SB_OPCODE_UBFE)
+DXBC_BUILDER_OPERATION_4(ibfe, D3D11_SB_OPCODE_IBFE)
+DXBC_BUILDER_OPERATION_4(sample, D3D10_SB_OPCODE_SAMPLE)
+DXBC_BUILDER_OPERATION_4(udiv, D3D10_SB_OPCODE_UDIV)
+DXBC_BUILDER_OPERATION_4(umul, D3D10_SB_OPCODE_UMUL)
+DXBC_BUILDER_OPERATION_4(imul, D3D10_SB_OPCODE_IMUL)
+DXBC_BUILDER_OPERATION_5(bfi, D3D11_SB_OPCODE_BFI)
+DXBC_BUILDER_OPERATION_5(sample_l, D3D10_SB_OPCODE_SAMPLE_L)
+DXBC_BUILDER_OPERATION_5(sample_b, D3D10_SB_OPCODE_SAMPLE_B)
+DXBC_BUILDER_OPERATION_5(sample_c, D3D10_SB_OPCODE_SAMPLE_C)
+DXBC_BUILDER_OPERATION_5(sample_c_lz, D3D10_SB_OPCODE_SAMPLE_C_LZ)
+DXBC_BUILDER_OPERATION_6(sample_d, D3D10_SB_OPCODE_SAMPLE_D)
+
+#undef DXBC_BUILDER_OPERATION
+#undef DXBC_BUILDER_OPERATION_0
+#undef DXBC_BUILDER_OPERATION_1
+#undef DXBC_BUILDER_OPERATION_2
+#undef DXBC_BUILDER_OPERATION_3
+#undef DXBC_BUILDER_OPERATION_4
+#undef DXBC_BUILDER_OPERATION_5
+#undef DXBC_BUILDER_OPERATION_6
+#undef DXBC_BUILDER_CONDITIONAL
+} // namespace DXBCBuilder
+
+#endif // DXBC_BUILDER_H
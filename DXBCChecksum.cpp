@@ -69,11 +69,21 @@
  **********************************************************************
  */
 
-#include <Windows.h>
+#include "DXBCPlatform.h"
 #include <stdio.h>
 #include <stdlib.h>
 #include "DXBCChecksum.h"
 
+#if defined(_M_X64) || defined(_M_IX86) || defined(__x86_64__) || defined(__i386__)
+    #define DXBC_CHECKSUM_X86 1
+    #include <immintrin.h>
+    #if defined(_MSC_VER)
+        #include <intrin.h>
+    #endif
+#else
+    #define DXBC_CHECKSUM_X86 0
+#endif
+
 /* Padding */
 static unsigned char MD5_PADDING[64] =
 {
@@ -123,9 +133,9 @@ static unsigned char MD5_PADDING[64] =
 #define MD5_S43 15
 #define MD5_S44 21
 
-/* Typedef a 32 bit type */
+/* Typedef a 32 bit type (unsigned long is 64 bits wide on LP64 targets) */
 #ifndef UINT4
-    typedef unsigned long int UINT4;
+    typedef unsigned int UINT4;
 #endif
 
 /* Data structure for MD5 (Message Digest) computation */
@@ -137,14 +147,15 @@ typedef struct
     unsigned char digest[16];     /* Actual digest after MD5Final call */
 } MD5_CTX;
 
-static void MD5_Transform(UINT4* buf, UINT4* in);
+static void MD5_Transform(UINT4* buf, const UINT4* in);
+static void MD5_Blocks(UINT4* buf, const unsigned char* pData, unsigned int blockCount);
 
 void MD5Init(MD5_CTX* mdContext, unsigned long pseudoRandomNumber = 0);
 void MD5Update(MD5_CTX* mdContext, unsigned char* inBuf, unsigned int inLen);
 void MD5Final(MD5_CTX* mdContext);
 
 /* Basic MD5 step. MD5_Transform buf based on in */
-static void MD5_Transform(UINT4* buf, UINT4* in)
+static void MD5_Transform(UINT4* buf, const UINT4* in)
 {
     UINT4 a = buf[0], b = buf[1], c = buf[2], d = buf[3];
 
@@ -238,14 +249,27 @@ void MD5Init(MD5_CTX* mdContext, unsigned long pseudoRandomNumber)
     mdContext->buf[3] = (UINT4)0x10325476 + (pseudoRandomNumber * 97);
 }
 
-void MD5Update(MD5_CTX* mdContext, unsigned char* inBuf, unsigned int inLen)
+/* MD5_Transform whole 64-byte blocks of the input. The words are little-endian in
+   DXBC and on every target it runs on, so no byte shuffling is needed. Blocks are
+   always loaded through memcpy (reading the bytes as UINT4 would break strict
+   aliasing), compilers turn it into plain loads, aligned or not */
+static void MD5_Blocks(UINT4* buf, const unsigned char* pData, unsigned int blockCount)
 {
     UINT4 in[16];
-    int mdi = 0;
-    unsigned int i = 0, ii = 0;
+
+    for (; blockCount; blockCount--, pData += 64)
+    {
+        memcpy(in, pData, 64);
+        MD5_Transform(buf, in);
+    }
+}
+
+void MD5Update(MD5_CTX* mdContext, unsigned char* inBuf, unsigned int inLen)
+{
+    unsigned int mdi = 0, fill = 0;
 
     /* Compute number of bytes mod 64 */
-    mdi = (int)((mdContext->i[0] >> 3) & 0x3F);
+    mdi = (unsigned int)((mdContext->i[0] >> 3) & 0x3F);
 
     /* Update number of bits */
     if ((mdContext->i[0] + ((UINT4)inLen << 3)) < mdContext->i[0])
@@ -256,23 +280,33 @@ void MD5Update(MD5_CTX* mdContext, unsigned char* inBuf, unsigned int inLen)
     mdContext->i[0] += ((UINT4)inLen << 3);
     mdContext->i[1] += ((UINT4)inLen >> 29);
 
-    while (inLen--)
+    /* Top up a partially filled block first */
+    if (mdi)
     {
-        /* Add new character to buffer, increment mdi */
-        mdContext->in[mdi++] = *inBuf++;
+        fill = 64 - mdi;
 
-        /* Transform if necessary */
-        if (mdi == 0x40)
+        if (inLen < fill)
         {
-            for (i = 0, ii = 0; i < 16; i++, ii += 4)
-                in[i] = (((UINT4)mdContext->in[ii + 3]) << 24) |
-                        (((UINT4)mdContext->in[ii + 2]) << 16) |
-                        (((UINT4)mdContext->in[ii + 1]) << 8) |
-                        ((UINT4)mdContext->in[ii]);
-
-            MD5_Transform(mdContext->buf, in);
-            mdi = 0;
+            memcpy(&mdContext->in[mdi], inBuf, inLen);
+            return;
         }
+
+        memcpy(&mdContext->in[mdi], inBuf, fill);
+        MD5_Blocks(mdContext->buf, mdContext->in, 1);
+
+        inBuf += fill;
+        inLen -= fill;
+    }
+
+    /* Then whole blocks directly from the caller's buffer */
+    MD5_Blocks(mdContext->buf, inBuf, inLen / 64);
+    inBuf += inLen & ~0x3Fu;
+    inLen &= 0x3F;
+
+    /* Only the tail is staged in mdContext->in */
+    if (inLen)
+    {
+        memcpy(mdContext->in, inBuf, inLen);
     }
 }
 
@@ -323,6 +357,41 @@ void MD5Final(MD5_CTX* mdContext)
 
 static const DWORD dwHashOffset = 0x14;
 
+/* Lay out the DXBC padding exactly as CalculateDXBCChecksum does, returns number of tail blocks */
+static DWORD DXBC_PadTail(unsigned char tail[128], const unsigned char* pLastChunkData, DWORD dwLastChunkSize, DWORD dwNumberOfBits)
+{
+    UINT4 dwTerminator = (dwNumberOfBits >> 2) | 1;
+
+    memset(tail, 0, 128);
+
+    if (dwLastChunkSize >= 56)
+    {
+        // Data and 0x80 fill the first block, the bit count goes to an extra one
+        memcpy(tail, pLastChunkData, dwLastChunkSize);
+        tail[dwLastChunkSize] = 0x80;
+
+        memcpy(&tail[64], &dwNumberOfBits, 4);
+        memcpy(&tail[64 + 60], &dwTerminator, 4);
+        return 2;
+    }
+
+    // Bit count goes in front of the data
+    memcpy(tail, &dwNumberOfBits, 4);
+    memcpy(&tail[4], pLastChunkData, dwLastChunkSize);
+    tail[4 + dwLastChunkSize] = 0x80;
+    memcpy(&tail[60], &dwTerminator, 4);
+    return 1;
+}
+
+/* Hash the DXBC-padded tail of a blob whose full blocks have already been hashed into buf */
+static void DXBC_TransformTail(UINT4* buf, const unsigned char* pLastChunkData, DWORD dwLastChunkSize, DWORD dwNumberOfBits)
+{
+    unsigned char tail[128];
+    DWORD dwTailBlocks = DXBC_PadTail(tail, pLastChunkData, dwLastChunkSize, dwNumberOfBits);
+
+    MD5_Blocks(buf, tail, dwTailBlocks);
+}
+
 BOOL CalculateDXBCChecksum(BYTE* pData, DWORD dwSize, DWORD dwHash[4])
 {
     MD5_CTX md5Ctx;
@@ -385,5 +454,405 @@ BOOL CalculateDXBCChecksum(BYTE* pData, DWORD dwSize, DWORD dwHash[4])
 
     memcpy(dwHash, md5Ctx.buf, 4 * sizeof(DWORD));
 
+    return TRUE;
+}
+
+
+
+//=====================================================================
+// Multi-buffer checksums
+//
+// Hashing a single blob is a serial chain of dependent adds and
+// rotates, so most of a modern core sits idle. Independent blobs are
+// hashed side by side instead, one blob per 32-bit SIMD lane.
+//=====================================================================
+
+/* One blob being hashed in a SIMD lane */
+typedef struct
+{
+    const unsigned char* pData;   /* Hashed part of the blob (from dwHashOffset) */
+    DWORD dwBlock;                /* Next block to hash */
+    DWORD dwFullBlocks;           /* Number of blocks read directly from pData */
+    DWORD dwTotalBlocks;          /* Including the 1 or 2 padded tail blocks, 0 if the lane is idle */
+    unsigned int dwJob;           /* Index of the blob in the batch */
+    unsigned char tail[128];      /* Last data bytes with the DXBC padding applied */
+} MD5_LANE;
+
+static const unsigned char MD5_ZERO_BLOCK[64] = { 0 };
+
+static void MD5_LaneLoad(MD5_LANE* pLane, BYTE* pData, DWORD dwSize, unsigned int job)
+{
+    dwSize -= dwHashOffset;
+
+    DWORD dwFullChunksSize = dwSize & 0xffffffc0;
+
+    pLane->pData = pData + dwHashOffset;
+    pLane->dwBlock = 0;
+    pLane->dwFullBlocks = dwFullChunksSize / 64;
+    pLane->dwTotalBlocks = pLane->dwFullBlocks + DXBC_PadTail(pLane->tail, pLane->pData + dwFullChunksSize, dwSize - dwFullChunksSize, dwSize * 8);
+    pLane->dwJob = job;
+}
+
+static void MD5_LaneIdle(MD5_LANE* pLane)
+{
+    pLane->dwBlock = 0;
+    pLane->dwTotalBlocks = 0;
+}
+
+static const unsigned char* MD5_LaneBlock(const MD5_LANE* pLane)
+{
+    if (pLane->dwTotalBlocks == 0)
+    {
+        return MD5_ZERO_BLOCK;
+    }
+
+    if (pLane->dwBlock < pLane->dwFullBlocks)
+    {
+        return pLane->pData + pLane->dwBlock * 64;
+    }
+
+    return &pLane->tail[(pLane->dwBlock - pLane->dwFullBlocks) * 64];
+}
+
+#if DXBC_CHECKSUM_X86
+
+#if defined(__GNUC__) && !defined(_MSC_VER)
+    #define DXBC_CHECKSUM_PUSH_TARGET(x) _Pragma("GCC push_options") _Pragma(x)
+    #define DXBC_CHECKSUM_POP_TARGET() _Pragma("GCC pop_options")
+#else
+    #define DXBC_CHECKSUM_PUSH_TARGET(x)
+    #define DXBC_CHECKSUM_POP_TARGET()
+#endif
+
+#if defined(__GNUC__) && !defined(__clang__)
+    #define DXBC_CHECKSUM_PUSH_NO_UNINITIALIZED() _Pragma("GCC diagnostic push") _Pragma("GCC diagnostic ignored \"-Wmaybe-uninitialized\"")
+    #define DXBC_CHECKSUM_POP_NO_UNINITIALIZED() _Pragma("GCC diagnostic pop")
+#else
+    #define DXBC_CHECKSUM_PUSH_NO_UNINITIALIZED()
+    #define DXBC_CHECKSUM_POP_NO_UNINITIALIZED()
+#endif
+
+#define V_LOAD(p)        V_SI(load)((const MD5_VEC*)(p))
+#define V_STORE(p, v)    V_SI(store)((MD5_VEC*)(p), (v))
+#define V_ADD(x, y)      V_EPI32(add)((x), (y))
+#define V_AND(x, y)      V_SI(and)((x), (y))
+#define V_OR(x, y)       V_SI(or)((x), (y))
+#define V_XOR(x, y)      V_SI(xor)((x), (y))
+#define V_ANDNOT(x, y)   V_SI(andnot)((x), (y))
+#define V_SET1(c)        V_EPI32(set1)((int)(c))
+
+// SSE2 - 4 lanes
+DXBC_CHECKSUM_PUSH_TARGET("GCC target(\"sse2\")")
+namespace DXBCChecksumSSE2
+{
+#define MD5_LANES        4
+#define MD5_VEC          __m128i
+#define V_SI(op)         _mm_##op##_si128
+#define V_EPI32(op)      _mm_##op##_epi32
+#define V_ROTL(x, n)     _mm_or_si128(_mm_slli_epi32((x), (n)), _mm_srli_epi32((x), 32 - (n)))
+#include "DXBCChecksumLanes.inl"
+#undef MD5_LANES
+#undef MD5_VEC
+#undef V_SI
+#undef V_EPI32
+#undef V_ROTL
+}
+DXBC_CHECKSUM_POP_TARGET()
+
+// AVX2 - 8 lanes
+DXBC_CHECKSUM_PUSH_TARGET("GCC target(\"avx2\")")
+namespace DXBCChecksumAVX2
+{
+#define MD5_LANES        8
+#define MD5_VEC          __m256i
+#define V_SI(op)         _mm256_##op##_si256
+#define V_EPI32(op)      _mm256_##op##_epi32
+#define V_ROTL(x, n)     _mm256_or_si256(_mm256_slli_epi32((x), (n)), _mm256_srli_epi32((x), 32 - (n)))
+#include "DXBCChecksumLanes.inl"
+#undef MD5_LANES
+#undef MD5_VEC
+#undef V_SI
+#undef V_EPI32
+#undef V_ROTL
+}
+DXBC_CHECKSUM_POP_TARGET()
+
+// AVX-512 - 16 lanes. GCC 12 headers pass _mm512_undefined_epi32() as the unused
+// merge source of _mm512_rol_epi32 and _mm512_andnot_si512, which -Wall reports as
+// "may be used uninitialized" at every use (GCC bug 105593), so it is silenced here.
+DXBC_CHECKSUM_PUSH_TARGET("GCC target(\"avx512f\")")
+DXBC_CHECKSUM_PUSH_NO_UNINITIALIZED()
+namespace DXBCChecksumAVX512
+{
+#define MD5_LANES        16
+#define MD5_VEC          __m512i
+#define V_SI(op)         _mm512_##op##_si512
+#define V_EPI32(op)      _mm512_##op##_epi32
+#define V_ROTL(x, n)     _mm512_rol_epi32((x), (n))
+#include "DXBCChecksumLanes.inl"
+#undef MD5_LANES
+#undef MD5_VEC
+#undef V_SI
+#undef V_EPI32
+#undef V_ROTL
+}
+DXBC_CHECKSUM_POP_NO_UNINITIALIZED()
+DXBC_CHECKSUM_POP_TARGET()
+
+#undef V_LOAD
+#undef V_STORE
+#undef V_ADD
+#undef V_AND
+#undef V_OR
+#undef V_XOR
+#undef V_ANDNOT
+#undef V_SET1
+
+/* Number of lanes of the widest multi-buffer kernel this CPU and OS can run */
+static unsigned int MD5_DetectLanes()
+{
+#if defined(_MSC_VER)
+    int info[4];
+    __cpuid(info, 0);
+    int maxLeaf = info[0];
+
+    __cpuid(info, 1);
+    bool hasOSXSave = (info[2] & (1 << 27)) != 0;
+    bool hasSSE2 = (info[3] & (1 << 26)) != 0;
+
+    if (hasOSXSave && maxLeaf >= 7)
+    {
+        unsigned long long xcr0 = _xgetbv(0);
+
+        __cpuidex(info, 7, 0);
+
+        // ZMM state (opmask, upper ZMM0-15, ZMM16-31) and YMM state enabled by the OS
+        if ((info[1] & (1 << 16)) && (xcr0 & 0xe6) == 0xe6)
+        {
+            return 16;
+        }
+
+        if ((info[1] & (1 << 5)) && (xcr0 & 0x6) == 0x6)
+        {
+            return 8;
+        }
+    }
+
+    return hasSSE2 ? 4 : 1;
+#else
+    __builtin_cpu_init();
+
+    if (__builtin_cpu_supports("avx512f"))
+    {
+        return 16;
+    }
+
+    if (__builtin_cpu_supports("avx2"))
+    {
+        return 8;
+    }
+
+    return __builtin_cpu_supports("sse2") ? 4 : 1;
+#endif
+}
+
+#endif // DXBC_CHECKSUM_X86
+
+BOOL CalculateDXBCChecksumBatch(BYTE* const* ppData, const DWORD* pSizes, unsigned int count, DWORD (*pHashes)[4])
+{
+    for (unsigned int i = 0; i < count; i++)
+    {
+        if (pSizes[i] < dwHashOffset)
+        {
+            return FALSE;
+        }
+    }
+
+#if DXBC_CHECKSUM_X86
+    static const unsigned int lanes = MD5_DetectLanes();
+
+    // A lone blob gains nothing from the lanes
+    if (count > 1)
+    {
+        switch (lanes)
+        {
+            case 16:
+                DXBCChecksumAVX512::MD5_HashBatch(ppData, pSizes, count, pHashes);
+                return TRUE;
+
+            case 8:
+                DXBCChecksumAVX2::MD5_HashBatch(ppData, pSizes, count, pHashes);
+                return TRUE;
+
+            case 4:
+                DXBCChecksumSSE2::MD5_HashBatch(ppData, pSizes, count, pHashes);
+                return TRUE;
+        }
+    }
+#endif // DXBC_CHECKSUM_X86
+
+    for (unsigned int i = 0; i < count; i++)
+    {
+        CalculateDXBCChecksum(ppData[i], pSizes[i], pHashes[i]);
+    }
+
+    return TRUE;
+}
+
+
+
+//=====================================================================
+// Checksum context with saved midstates
+//=====================================================================
+
+DXBCChecksumContext::DXBCChecksumContext() :
+    m_dwReusedBlocks(0)
+{
+}
+
+void DXBCChecksumContext::Reset()
+{
+    m_blocks.clear();
+    m_midstates.clear();
+    m_dwReusedBlocks = 0;
+}
+
+BOOL DXBCChecksumContext::Calculate(const BYTE* pData, DWORD dwSize, DWORD dwHash[4])
+{
+    if (dwSize < dwHashOffset)
+    {
+        return FALSE;
+    }
+
+    // Skip the start of the shader header
+    dwSize -= dwHashOffset;
+    pData += dwHashOffset;
+
+    DWORD dwFullChunksSize = dwSize & 0xffffffc0;
+    DWORD dwFullBlocks = dwFullChunksSize / 64;
+    DWORD dwSavedBlocks = (DWORD)(m_blocks.size() / 64);
+
+    // Find the first block that differs from the previously hashed blob
+    DWORD dwFirstBlock = 0;
+
+    while (dwFirstBlock < dwFullBlocks && dwFirstBlock < dwSavedBlocks &&
+           memcmp(&m_blocks[dwFirstBlock * 64], pData + dwFirstBlock * 64, 64) == 0)
+    {
+        dwFirstBlock++;
+    }
+
+    m_dwReusedBlocks = dwFirstBlock;
+
+    // Midstate 0 is the MD5 initialization constants
+    if (m_midstates.empty())
+    {
+        MD5_CTX md5Ctx;
+        MD5Init(&md5Ctx, 0);
+        m_midstates.assign(md5Ctx.buf, md5Ctx.buf + 4);
+    }
+
+    // Rehash only from the first modified block, saving the midstate after each one
+    m_blocks.resize(dwFullChunksSize);
+    m_midstates.resize((dwFullBlocks + 1) * 4);
+
+    UINT4 buf[4];
+    memcpy(buf, &m_midstates[dwFirstBlock * 4], sizeof(buf));
+
+    for (DWORD i = dwFirstBlock; i < dwFullBlocks; i++)
+    {
+        MD5_Blocks(buf, pData + i * 64, 1);
+        memcpy(&m_midstates[(i + 1) * 4], buf, sizeof(buf));
+    }
+
+    if (dwFullChunksSize > dwFirstBlock * 64)
+    {
+        memcpy(&m_blocks[dwFirstBlock * 64], pData + dwFirstBlock * 64, dwFullChunksSize - dwFirstBlock * 64);
+    }
+
+    DXBC_TransformTail(buf, pData + dwFullChunksSize, dwSize - dwFullChunksSize, dwSize * 8);
+
+    memcpy(dwHash, buf, 4 * sizeof(DWORD));
+
+    return TRUE;
+}
+
+
+
+//=====================================================================
+// Streaming checksum
+//=====================================================================
+
+DXBCChecksumStream::DXBCChecksumStream() :
+    m_dwSize(0)
+{
+    MD5_CTX md5Ctx;
+    MD5Init(&md5Ctx, 0);
+    memcpy(m_state, md5Ctx.buf, sizeof(m_state));
+}
+
+void DXBCChecksumStream::Update(const BYTE* pData, DWORD dwSize)
+{
+    // Skip the start of the shader header
+    if (m_dwSize < dwHashOffset)
+    {
+        DWORD dwSkip = (dwSize < dwHashOffset - m_dwSize) ? dwSize : (dwHashOffset - m_dwSize);
+
+        m_dwSize += dwSkip;
+        pData += dwSkip;
+        dwSize -= dwSkip;
+    }
+
+    if (!dwSize)
+    {
+        return;
+    }
+
+    DWORD dwTailSize = (m_dwSize - dwHashOffset) & 0x3F;
+    m_dwSize += dwSize;
+
+    UINT4 buf[4];
+    memcpy(buf, m_state, sizeof(buf));
+
+    /* Top up a partially filled block first */
+    if (dwTailSize)
+    {
+        DWORD dwFill = 64 - dwTailSize;
+
+        if (dwSize < dwFill)
+        {
+            memcpy(&m_tail[dwTailSize], pData, dwSize);
+            return;
+        }
+
+        memcpy(&m_tail[dwTailSize], pData, dwFill);
+        MD5_Blocks(buf, m_tail, 1);
+
+        pData += dwFill;
+        dwSize -= dwFill;
+    }
+
+    /* Then whole blocks directly from the input, only the tail is staged */
+    MD5_Blocks(buf, pData, dwSize / 64);
+    memcpy(m_tail, pData + (dwSize & ~0x3Fu), dwSize & 0x3F);
+
+    memcpy(m_state, buf, sizeof(buf));
+}
+
+BOOL DXBCChecksumStream::Final(DWORD dwHash[4])
+{
+    if (m_dwSize < dwHashOffset)
+    {
+        return FALSE;
+    }
+
+    DWORD dwHashedSize = m_dwSize - dwHashOffset;
+
+    UINT4 buf[4];
+    memcpy(buf, m_state, sizeof(buf));
+
+    DXBC_TransformTail(buf, m_tail, dwHashedSize & 0x3F, dwHashedSize * 8);
+
+    memcpy(dwHash, buf, 4 * sizeof(DWORD));
+
     return TRUE;
 }
\ No newline at end of file
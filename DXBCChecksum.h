@@ -17,6 +17,8 @@
 #ifndef DXBCCHECKSUM_H
 #define DXBCCHECKSUM_H
 
+#include <vector>
+
 /*
  **********************************************************************
  ** MD5.h                                                            **
@@ -75,4 +77,64 @@
 /// \return TRUE if successful, otherwise FALSE.
 BOOL CalculateDXBCChecksum(BYTE* pData, DWORD dwSize, DWORD dwHash[4]);
 
+/// Calculate the DXBC checksums for a batch of independent blobs. The blobs are
+/// hashed side by side in SIMD lanes (SSE2, AVX2 or AVX-512, picked at runtime)
+/// and may all have different sizes.
+/// \param[in] ppData   An array of pointers to the memory to checksum.
+/// \param[in] pSizes   An array with the size of each blob.
+/// \param[in] count    The number of blobs in the batch.
+/// \param[out] pHashes A DWORD[4] per blob to copy the calculated check sums into.
+/// \return TRUE if successful, FALSE if any blob is too small to carry a DXBC header.
+BOOL CalculateDXBCChecksumBatch(BYTE* const* ppData, const DWORD* pSizes, unsigned int count, DWORD (*pHashes)[4]);
+
+/// Checksum context for a blob that gets hashed over and over with small changes
+/// (e.g. a shader re-patched while iterating on the patch). It saves the MD5
+/// midstate at every 64-byte block boundary of the last blob it hashed, so the
+/// next blob is only rehashed from the first block that differs.
+class DXBCChecksumContext
+{
+public:
+    DXBCChecksumContext();
+
+    /// Calculate the DXBC checksum, reusing the midstates of the previously hashed blob.
+    /// \param[in] pData    A pointer to the memory to checksum.
+    /// \param[in] dwSize   The size of the memory to checksum.
+    /// \param[out] dwHash  A DWORD array to copy the calculated check sum into.
+    /// \return TRUE if successful, otherwise FALSE.
+    BOOL Calculate(const BYTE* pData, DWORD dwSize, DWORD dwHash[4]);
+
+    /// Forget the previously hashed blob.
+    void Reset();
+
+    /// \return Number of 64-byte blocks the last Calculate call did not have to rehash.
+    DWORD GetReusedBlocks() const { return m_dwReusedBlocks; }
+
+private:
+    std::vector<BYTE>   m_blocks;           ///< Full blocks of the last blob (from the hash offset)
+    std::vector<DWORD>  m_midstates;        ///< 4 DWORDs per block boundary, the first is the MD5 IV
+    DWORD               m_dwReusedBlocks;   ///< Blocks skipped by the last Calculate call
+};
+
+/// Incremental DXBC checksum for a blob that is produced front to back (e.g. hashed
+/// right after each piece of it is written out). The blob is fed from offset 0;
+/// the unhashed start of the header is skipped automatically.
+class DXBCChecksumStream
+{
+public:
+    DXBCChecksumStream();
+
+    /// Hash the next dwSize bytes of the blob.
+    void Update(const BYTE* pData, DWORD dwSize);
+
+    /// Finish the checksum once the whole blob has been fed in.
+    /// \param[out] dwHash  A DWORD array to copy the calculated check sum into.
+    /// \return TRUE if successful, FALSE if the blob was too small to carry a DXBC header.
+    BOOL Final(DWORD dwHash[4]);
+
+private:
+    DWORD   m_state[4];     ///< MD5 chaining values
+    DWORD   m_dwSize;       ///< Bytes fed so far, including the skipped header bytes
+    BYTE    m_tail[64];     ///< Hashed bytes not yet forming a full block
+};
+
 #endif // DXBCCHECKSUM_H
\ No newline at end of file
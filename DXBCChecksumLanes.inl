@@ -0,0 +1,202 @@
+//=====================================================================
+/// \file DXBCChecksumLanes.inl
+///
+/// Lane-parallel MD5 kernel shared by the SSE2, AVX2 and AVX-512 paths
+/// of CalculateDXBCChecksumBatch. It is included by DXBCChecksum.cpp
+/// once per instruction set, inside a namespace that provides:
+///
+///   MD5_LANES                           number of 32-bit lanes
+///   MD5_VEC                             vector type
+///   V_LOAD, V_STORE                     aligned load/store
+///   V_SET1, V_ADD, V_AND, V_OR, V_XOR   lane-wise arithmetic
+///   V_ANDNOT(x, y)                      (~x) & y
+///   V_ROTL(x, n)                        rotate left by a constant
+//=====================================================================
+
+/* Vectorised MD5 basic functions, same as MD5_F .. MD5_I */
+#define V_MD5_F(x, y, z) V_OR(V_AND((x), (y)), V_ANDNOT((x), (z)))
+#define V_MD5_G(x, y, z) V_OR(V_AND((x), (z)), V_ANDNOT((z), (y)))
+#define V_MD5_H(x, y, z) V_XOR(V_XOR((x), (y)), (z))
+#define V_MD5_I(x, y, z) V_XOR((y), V_OR((x), V_XOR((z), V_SET1(0xffffffffu))))
+
+#define V_MD5_STEP(f, a, b, c, d, x, s, ac) \
+    { (a) = V_ADD((a), V_ADD(V_ADD(f((b), (c), (d)), (x)), V_SET1(ac))); (a) = V_ROTL((a), (s)); (a) = V_ADD((a), (b)); }
+
+/* MD5_Transform over MD5_LANES independent states; in[w][lane] is word w of each lane's block */
+static void MD5_TransformLanes(UINT4 (*buf)[MD5_LANES], UINT4 (*in)[MD5_LANES])
+{
+    MD5_VEC a = V_LOAD(buf[0]), b = V_LOAD(buf[1]), c = V_LOAD(buf[2]), d = V_LOAD(buf[3]);
+    MD5_VEC x[16];
+
+    for (int i = 0; i < 16; i++)
+    {
+        x[i] = V_LOAD(in[i]);
+    }
+
+    /* Round 1 */
+    V_MD5_STEP(V_MD5_F, a, b, c, d, x[ 0], MD5_S11, 3614090360u);      /* 1 */
+    V_MD5_STEP(V_MD5_F, d, a, b, c, x[ 1], MD5_S12, 3905402710u);      /* 2 */
+    V_MD5_STEP(V_MD5_F, c, d, a, b, x[ 2], MD5_S13,  606105819u);      /* 3 */
+    V_MD5_STEP(V_MD5_F, b, c, d, a, x[ 3], MD5_S14, 3250441966u);      /* 4 */
+    V_MD5_STEP(V_MD5_F, a, b, c, d, x[ 4], MD5_S11, 4118548399u);      /* 5 */
+    V_MD5_STEP(V_MD5_F, d, a, b, c, x[ 5], MD5_S12, 1200080426u);      /* 6 */
+    V_MD5_STEP(V_MD5_F, c, d, a, b, x[ 6], MD5_S13, 2821735955u);      /* 7 */
+    V_MD5_STEP(V_MD5_F, b, c, d, a, x[ 7], MD5_S14, 4249261313u);      /* 8 */
+    V_MD5_STEP(V_MD5_F, a, b, c, d, x[ 8], MD5_S11, 1770035416u);      /* 9 */
+    V_MD5_STEP(V_MD5_F, d, a, b, c, x[ 9], MD5_S12, 2336552879u);      /* 10 */
+    V_MD5_STEP(V_MD5_F, c, d, a, b, x[10], MD5_S13, 4294925233u);      /* 11 */
+    V_MD5_STEP(V_MD5_F, b, c, d, a, x[11], MD5_S14, 2304563134u);      /* 12 */
+    V_MD5_STEP(V_MD5_F, a, b, c, d, x[12], MD5_S11, 1804603682u);      /* 13 */
+    V_MD5_STEP(V_MD5_F, d, a, b, c, x[13], MD5_S12, 4254626195u);      /* 14 */
+    V_MD5_STEP(V_MD5_F, c, d, a, b, x[14], MD5_S13, 2792965006u);      /* 15 */
+    V_MD5_STEP(V_MD5_F, b, c, d, a, x[15], MD5_S14, 1236535329u);      /* 16 */
+
+    /* Round 2 */
+    V_MD5_STEP(V_MD5_G, a, b, c, d, x[ 1], MD5_S21, 4129170786u);      /* 17 */
+    V_MD5_STEP(V_MD5_G, d, a, b, c, x[ 6], MD5_S22, 3225465664u);      /* 18 */
+    V_MD5_STEP(V_MD5_G, c, d, a, b, x[11], MD5_S23,  643717713u);      /* 19 */
+    V_MD5_STEP(V_MD5_G, b, c, d, a, x[ 0], MD5_S24, 3921069994u);      /* 20 */
+    V_MD5_STEP(V_MD5_G, a, b, c, d, x[ 5], MD5_S21, 3593408605u);      /* 21 */
+    V_MD5_STEP(V_MD5_G, d, a, b, c, x[10], MD5_S22,   38016083u);      /* 22 */
+    V_MD5_STEP(V_MD5_G, c, d, a, b, x[15], MD5_S23, 3634488961u);      /* 23 */
+    V_MD5_STEP(V_MD5_G, b, c, d, a, x[ 4], MD5_S24, 3889429448u);      /* 24 */
+    V_MD5_STEP(V_MD5_G, a, b, c, d, x[ 9], MD5_S21,  568446438u);      /* 25 */
+    V_MD5_STEP(V_MD5_G, d, a, b, c, x[14], MD5_S22, 3275163606u);      /* 26 */
+    V_MD5_STEP(V_MD5_G, c, d, a, b, x[ 3], MD5_S23, 4107603335u);      /* 27 */
+    V_MD5_STEP(V_MD5_G, b, c, d, a, x[ 8], MD5_S24, 1163531501u);      /* 28 */
+    V_MD5_STEP(V_MD5_G, a, b, c, d, x[13], MD5_S21, 2850285829u);      /* 29 */
+    V_MD5_STEP(V_MD5_G, d, a, b, c, x[ 2], MD5_S22, 4243563512u);      /* 30 */
+    V_MD5_STEP(V_MD5_G, c, d, a, b, x[ 7], MD5_S23, 1735328473u);      /* 31 */
+    V_MD5_STEP(V_MD5_G, b, c, d, a, x[12], MD5_S24, 2368359562u);      /* 32 */
+
+    /* Round 3 */
+    V_MD5_STEP(V_MD5_H, a, b, c, d, x[ 5], MD5_S31, 4294588738u);      /* 33 */
+    V_MD5_STEP(V_MD5_H, d, a, b, c, x[ 8], MD5_S32, 2272392833u);      /* 34 */
+    V_MD5_STEP(V_MD5_H, c, d, a, b, x[11], MD5_S33, 1839030562u);      /* 35 */
+    V_MD5_STEP(V_MD5_H, b, c, d, a, x[14], MD5_S34, 4259657740u);      /* 36 */
+    V_MD5_STEP(V_MD5_H, a, b, c, d, x[ 1], MD5_S31, 2763975236u);      /* 37 */
+    V_MD5_STEP(V_MD5_H, d, a, b, c, x[ 4], MD5_S32, 1272893353u);      /* 38 */
+    V_MD5_STEP(V_MD5_H, c, d, a, b, x[ 7], MD5_S33, 4139469664u);      /* 39 */
+    V_MD5_STEP(V_MD5_H, b, c, d, a, x[10], MD5_S34, 3200236656u);      /* 40 */
+    V_MD5_STEP(V_MD5_H, a, b, c, d, x[13], MD5_S31,  681279174u);      /* 41 */
+    V_MD5_STEP(V_MD5_H, d, a, b, c, x[ 0], MD5_S32, 3936430074u);      /* 42 */
+    V_MD5_STEP(V_MD5_H, c, d, a, b, x[ 3], MD5_S33, 3572445317u);      /* 43 */
+    V_MD5_STEP(V_MD5_H, b, c, d, a, x[ 6], MD5_S34,   76029189u);      /* 44 */
+    V_MD5_STEP(V_MD5_H, a, b, c, d, x[ 9], MD5_S31, 3654602809u);      /* 45 */
+    V_MD5_STEP(V_MD5_H, d, a, b, c, x[12], MD5_S32, 3873151461u);      /* 46 */
+    V_MD5_STEP(V_MD5_H, c, d, a, b, x[15], MD5_S33,  530742520u);      /* 47 */
+    V_MD5_STEP(V_MD5_H, b, c, d, a, x[ 2], MD5_S34, 3299628645u);      /* 48 */
+
+    /* Round 4 */
+    V_MD5_STEP(V_MD5_I, a, b, c, d, x[ 0], MD5_S41, 4096336452u);      /* 49 */
+    V_MD5_STEP(V_MD5_I, d, a, b, c, x[ 7], MD5_S42, 1126891415u);      /* 50 */
+    V_MD5_STEP(V_MD5_I, c, d, a, b, x[14], MD5_S43, 2878612391u);      /* 51 */
+    V_MD5_STEP(V_MD5_I, b, c, d, a, x[ 5], MD5_S44, 4237533241u);      /* 52 */
+    V_MD5_STEP(V_MD5_I, a, b, c, d, x[12], MD5_S41, 1700485571u);      /* 53 */
+    V_MD5_STEP(V_MD5_I, d, a, b, c, x[ 3], MD5_S42, 2399980690u);      /* 54 */
+    V_MD5_STEP(V_MD5_I, c, d, a, b, x[10], MD5_S43, 4293915773u);      /* 55 */
+    V_MD5_STEP(V_MD5_I, b, c, d, a, x[ 1], MD5_S44, 2240044497u);      /* 56 */
+    V_MD5_STEP(V_MD5_I, a, b, c, d, x[ 8], MD5_S41, 1873313359u);      /* 57 */
+    V_MD5_STEP(V_MD5_I, d, a, b, c, x[15], MD5_S42, 4264355552u);      /* 58 */
+    V_MD5_STEP(V_MD5_I, c, d, a, b, x[ 6], MD5_S43, 2734768916u);      /* 59 */
+    V_MD5_STEP(V_MD5_I, b, c, d, a, x[13], MD5_S44, 1309151649u);      /* 60 */
+    V_MD5_STEP(V_MD5_I, a, b, c, d, x[ 4], MD5_S41, 4149444226u);      /* 61 */
+    V_MD5_STEP(V_MD5_I, d, a, b, c, x[11], MD5_S42, 3174756917u);      /* 62 */
+    V_MD5_STEP(V_MD5_I, c, d, a, b, x[ 2], MD5_S43,  718787259u);      /* 63 */
+    V_MD5_STEP(V_MD5_I, b, c, d, a, x[ 9], MD5_S44, 3951481745u);      /* 64 */
+
+    V_STORE(buf[0], V_ADD(V_LOAD(buf[0]), a));
+    V_STORE(buf[1], V_ADD(V_LOAD(buf[1]), b));
+    V_STORE(buf[2], V_ADD(V_LOAD(buf[2]), c));
+    V_STORE(buf[3], V_ADD(V_LOAD(buf[3]), d));
+}
+
+/* Load the MD5 initialization constants into one lane */
+static void MD5_LaneReset(UINT4 (*buf)[MD5_LANES], unsigned int l)
+{
+    buf[0][l] = (UINT4)0x67452301;
+    buf[1][l] = (UINT4)0xefcdab89;
+    buf[2][l] = (UINT4)0x98badcfe;
+    buf[3][l] = (UINT4)0x10325476;
+}
+
+// Hash all blobs of the batch. Every lane works on its own blob and picks up
+// the next unhashed blob as soon as it finishes, so blobs of different lengths
+// keep all lanes busy until the batch runs dry.
+static void MD5_HashBatch(BYTE* const* ppData, const DWORD* pSizes, unsigned int count, DWORD (*pHashes)[4])
+{
+    MD5_LANE lanes[MD5_LANES];
+    alignas(64) UINT4 buf[4][MD5_LANES];
+    alignas(64) UINT4 in[16][MD5_LANES];
+
+    unsigned int nextJob = 0;
+    unsigned int activeLanes = 0;
+
+    for (unsigned int l = 0; l < MD5_LANES; l++)
+    {
+        if (nextJob < count)
+        {
+            MD5_LaneLoad(&lanes[l], ppData[nextJob], pSizes[nextJob], nextJob);
+            nextJob++;
+            activeLanes++;
+        }
+        else
+        {
+            MD5_LaneIdle(&lanes[l]);
+        }
+
+        MD5_LaneReset(buf, l);
+    }
+
+    while (activeLanes)
+    {
+        /* Transpose the current block of every lane into word-major order */
+        for (unsigned int l = 0; l < MD5_LANES; l++)
+        {
+            UINT4 block[16];
+            memcpy(block, MD5_LaneBlock(&lanes[l]), 64);
+
+            for (int w = 0; w < 16; w++)
+            {
+                in[w][l] = block[w];
+            }
+        }
+
+        MD5_TransformLanes(buf, in);
+
+        for (unsigned int l = 0; l < MD5_LANES; l++)
+        {
+            MD5_LANE* pLane = &lanes[l];
+
+            if (pLane->dwTotalBlocks == 0 || ++pLane->dwBlock < pLane->dwTotalBlocks)
+            {
+                continue;
+            }
+
+            // Blob finished - hand the lane over to the next one
+            for (int i = 0; i < 4; i++)
+            {
+                pHashes[pLane->dwJob][i] = buf[i][l];
+            }
+
+            if (nextJob < count)
+            {
+                MD5_LaneLoad(pLane, ppData[nextJob], pSizes[nextJob], nextJob);
+                nextJob++;
+            }
+            else
+            {
+                MD5_LaneIdle(pLane);
+                activeLanes--;
+            }
+
+            MD5_LaneReset(buf, l);
+        }
+    }
+}
+
+#undef V_MD5_F
+#undef V_MD5_G
+#undef V_MD5_H
+#undef V_MD5_I
+#undef V_MD5_STEP
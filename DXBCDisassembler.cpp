@@ -0,0 +1,994 @@
+//================================================================================================================
+// Include files
+//================================================================================================================
+#include "DXBCDisassembler.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "DXBCInstruction.h"
+#include "DXBCSyntax.h"
+
+
+
+
+
+//================================================================================================================
+// Structures
+//================================================================================================================
+// DWORDs of a single instruction. Everything is read through it, so nothing past the instruction is touched.
+struct DXBCTokenCursor
+{
+	const DWORD*	pToken;
+	const DWORD*	pEnd;
+};
+
+
+
+
+
+//================================================================================================================
+// Function definitions
+//================================================================================================================
+static bool ReadToken(DXBCTokenCursor &cursor, DWORD *pToken)
+{
+	if(cursor.pToken >= cursor.pEnd)
+		return false;
+
+	*pToken = *cursor.pToken++;
+	return true;
+}
+
+// Integers are written by hand, they are by far the most common thing in the listing
+static void AppendUnsigned(std::string &text, unsigned long long inValue)
+{
+	char buffer[24];
+	char* pDigit = buffer + sizeof(buffer);
+
+	do
+	{
+		*--pDigit = (char)('0' + inValue % 10);
+		inValue /= 10;
+	}
+	while(inValue);
+
+	text.append(pDigit, buffer + sizeof(buffer) - pDigit);
+}
+
+static void AppendSigned(std::string &text, int inValue)
+{
+	if(inValue < 0)
+	{
+		text += '-';
+		AppendUnsigned(text, 0ull - (long long)inValue);
+	}
+	else
+	{
+		AppendUnsigned(text, (unsigned int)inValue);
+	}
+}
+
+static void AppendHex(std::string &text, DWORD inValue)
+{
+	static const char s_hexDigits[] = "0123456789abcdef";
+
+	char buffer[10] = { '0', 'x' };
+
+	for(int i = 0; i < 8; i++)
+		buffer[2 + i] = s_hexDigits[(inValue >> (28 - 4 * i)) & 0xf];
+
+	text.append(buffer, sizeof(buffer));
+}
+
+// Values are printed the usual way (1.000000) unless that loses bits, then with as many digits as needed to read
+// the exact value back
+static void AppendFloat(std::string &text, double inValue, bool inIsDouble)
+{
+	char buffer[64];
+	int length = snprintf(buffer, sizeof(buffer), "%f", inValue);
+
+	bool exact = (length > 0 && length < (int)sizeof(buffer)) && (inIsDouble ? strtod(buffer, NULL) == inValue : strtof(buffer, NULL) == (float)inValue);
+
+	if(!exact)
+		length = snprintf(buffer, sizeof(buffer), inIsDouble ? "%.17g" : "%.9g", inValue);
+
+	if(length > 0)
+		text.append(buffer, (length < (int)sizeof(buffer)) ? length : sizeof(buffer) - 1);
+}
+
+// Immediate values carry no type, so they are printed as floats when they look like sensible ones (exponent
+// roughly within 1e-6 .. 1e9) and as integers otherwise. Small integers are denormals and negative ones NaNs,
+// so they never pass for floats.
+static void AppendImmediate32(std::string &text, DWORD inValue, unsigned int inFlags)
+{
+	DWORD exponent = (inValue >> 23) & 0xff;
+
+	if(inFlags & DXBC_DISASM_HEX_LITERALS)
+	{
+		AppendHex(text, inValue);
+	}
+	else if(exponent >= 107 && exponent <= 157)
+	{
+		float value;
+		memcpy(&value, &inValue, sizeof(value));
+		AppendFloat(text, value, false);
+	}
+	else if((int)inValue >= -65536 && (int)inValue <= 65536)
+	{
+		AppendSigned(text, (int)inValue);
+	}
+	else
+	{
+		AppendHex(text, inValue);
+	}
+}
+
+static bool AppendOperand(std::string &text, DXBCTokenCursor &cursor, unsigned int inFlags, bool inSelection = true);
+
+// Single register index: immediate, relative (another operand) or both. First immediate index goes right after
+// register name (r3), everything else in brackets (cb0[r1.x + 2]).
+static bool AppendOperandIndex(std::string &text, DXBCTokenCursor &cursor, D3D10_SB_OPERAND_INDEX_REPRESENTATION inRepresentation, bool inFirst, unsigned int inFlags)
+{
+	unsigned long long immediate = 0;
+	bool hasImmediate = true;
+	bool hasRelative = false;
+	DWORD token;
+
+	switch(inRepresentation)
+	{
+	case D3D10_SB_OPERAND_INDEX_IMMEDIATE32:
+	case D3D10_SB_OPERAND_INDEX_IMMEDIATE32_PLUS_RELATIVE:
+		if(!ReadToken(cursor, &token))
+			return false;
+
+		immediate = token;
+		break;
+
+	case D3D10_SB_OPERAND_INDEX_IMMEDIATE64:
+	case D3D10_SB_OPERAND_INDEX_IMMEDIATE64_PLUS_RELATIVE:
+		// High DWORD first
+		if(!ReadToken(cursor, &token))
+			return false;
+
+		immediate = (unsigned long long)token << 32;
+
+		if(!ReadToken(cursor, &token))
+			return false;
+
+		immediate |= token;
+		break;
+
+	case D3D10_SB_OPERAND_INDEX_RELATIVE:
+		hasImmediate = false;
+		break;
+
+	default:
+		return false;
+	}
+
+	hasRelative = (inRepresentation == D3D10_SB_OPERAND_INDEX_RELATIVE) ||
+				  (inRepresentation == D3D10_SB_OPERAND_INDEX_IMMEDIATE32_PLUS_RELATIVE) ||
+				  (inRepresentation == D3D10_SB_OPERAND_INDEX_IMMEDIATE64_PLUS_RELATIVE);
+
+	if(inFirst && !hasRelative)
+	{
+		AppendUnsigned(text, immediate);
+		return true;
+	}
+
+	text += '[';
+
+	if(hasRelative)
+	{
+		if(!AppendOperand(text, cursor, inFlags))
+			return false;
+
+		if(hasImmediate)
+			text += " + ";
+	}
+
+	if(hasImmediate)
+		AppendUnsigned(text, immediate);
+
+	text += ']';
+	return true;
+}
+
+// Declarations leave out the (meaningless) component selection of some of their operands
+static bool AppendOperand(std::string &text, DXBCTokenCursor &cursor, unsigned int inFlags, bool inSelection)
+{
+	DWORD token;
+
+	if(!ReadToken(cursor, &token))
+		return false;
+
+	D3D10_SB_OPERAND_MODIFIER modifier = D3D10_SB_OPERAND_MODIFIER_NONE;
+
+	// Extended operand tokens can chain, only the modifier one is known
+	if(DECODE_IS_D3D10_SB_OPERAND_EXTENDED(token))
+	{
+		DWORD extendedToken;
+
+		do
+		{
+			if(!ReadToken(cursor, &extendedToken))
+				return false;
+
+			if(DECODE_D3D10_SB_EXTENDED_OPERAND_TYPE(extendedToken) == D3D10_SB_EXTENDED_OPERAND_MODIFIER)
+				modifier = DECODE_D3D10_SB_OPERAND_MODIFIER(extendedToken);
+		}
+		while(DECODE_IS_D3D10_SB_OPERAND_DOUBLE_EXTENDED(extendedToken));
+	}
+
+	if(modifier == D3D10_SB_OPERAND_MODIFIER_NEG || modifier == D3D10_SB_OPERAND_MODIFIER_ABSNEG)
+		text += '-';
+
+	if(modifier == D3D10_SB_OPERAND_MODIFIER_ABS || modifier == D3D10_SB_OPERAND_MODIFIER_ABSNEG)
+		text += '|';
+
+	D3D10_SB_OPERAND_TYPE type = DECODE_D3D10_SB_OPERAND_TYPE(token);
+	D3D10_SB_OPERAND_NUM_COMPONENTS numComponents = DECODE_D3D10_SB_OPERAND_NUM_COMPONENTS(token);
+
+	if(type == D3D10_SB_OPERAND_TYPE_IMMEDIATE32)
+	{
+		unsigned int count = (numComponents == D3D10_SB_OPERAND_4_COMPONENT) ? 4 : 1;
+
+		text += "l(";
+
+		for(unsigned int i = 0; i < count; i++)
+		{
+			if(!ReadToken(cursor, &token))
+				return false;
+
+			if(i)
+				text += ", ";
+
+			AppendImmediate32(text, token, inFlags);
+		}
+
+		text += ')';
+	}
+	else if(type == D3D10_SB_OPERAND_TYPE_IMMEDIATE64)
+	{
+		// Four components hold two doubles, low DWORD first
+		unsigned int count = (numComponents == D3D10_SB_OPERAND_4_COMPONENT) ? 2 : 1;
+
+		text += "d(";
+
+		for(unsigned int i = 0; i < count; i++)
+		{
+			DWORD value[2];
+			double doubleValue;
+
+			if(!ReadToken(cursor, &value[0]) || !ReadToken(cursor, &value[1]))
+				return false;
+
+			if(i)
+				text += ", ";
+
+			memcpy(&doubleValue, value, sizeof(doubleValue));
+			AppendFloat(text, doubleValue, true);
+		}
+
+		text += ')';
+	}
+	else
+	{
+		text += DXBC_NAME(s_registerNames, type);
+
+		unsigned int indexDimension = DECODE_D3D10_SB_OPERAND_INDEX_DIMENSION(token);
+
+		for(unsigned int i = 0; i < indexDimension; i++)
+		{
+			if(!AppendOperandIndex(text, cursor, DECODE_D3D10_SB_OPERAND_INDEX_REPRESENTATION(i, token), i == 0, inFlags))
+				return false;
+		}
+
+		if(numComponents == D3D10_SB_OPERAND_4_COMPONENT && inSelection)
+		{
+			switch(DECODE_D3D10_SB_OPERAND_4_COMPONENT_SELECTION_MODE(token))
+			{
+			case D3D10_SB_OPERAND_4_COMPONENT_MASK_MODE:
+				if(DECODE_D3D10_SB_OPERAND_4_COMPONENT_MASK(token))
+				{
+					text += '.';
+
+					for(unsigned int i = 0; i < 4; i++)
+					{
+						if(token & D3D10_SB_OPERAND_4_COMPONENT_MASK(i))
+							text += s_componentNames[i];
+					}
+				}
+				break;
+
+			case D3D10_SB_OPERAND_4_COMPONENT_SWIZZLE_MODE:
+				text += '.';
+
+				for(unsigned int i = 0; i < 4; i++)
+					text += s_componentNames[DECODE_D3D10_SB_OPERAND_4_COMPONENT_SWIZZLE_SOURCE(token, i)];
+				break;
+
+			case D3D10_SB_OPERAND_4_COMPONENT_SELECT_1_MODE:
+				text += '.';
+				text += s_componentNames[DECODE_D3D10_SB_OPERAND_4_COMPONENT_SELECT_1(token)];
+				break;
+
+			default:
+				break;
+			}
+		}
+	}
+
+	if(modifier == D3D10_SB_OPERAND_MODIFIER_ABS || modifier == D3D10_SB_OPERAND_MODIFIER_ABSNEG)
+		text += '|';
+
+	return true;
+}
+
+// Operand followed by resource return types, printed in front of it: "(float,float,float,float) t0"
+static bool AppendTypedOperand(std::string &text, DXBCTokenCursor &cursor, unsigned int inFlags)
+{
+	size_t operandStart = text.size();
+	DWORD returnTypes;
+
+	if(!AppendOperand(text, cursor, inFlags) || !ReadToken(cursor, &returnTypes))
+		return false;
+
+	std::string types = "(";
+
+	for(unsigned int i = 0; i < 4; i++)
+	{
+		if(i)
+			types += ',';
+
+		types += DXBC_NAME(s_returnTypeNames, DECODE_D3D10_SB_RESOURCE_RETURN_TYPE(returnTypes, i));
+	}
+
+	types += ") ";
+	text.insert(operandStart, types);
+	return true;
+}
+
+static bool AppendDWORD(std::string &text, DXBCTokenCursor &cursor, const char *pSeparator)
+{
+	DWORD value;
+
+	if(!ReadToken(cursor, &value))
+		return false;
+
+	text += pSeparator;
+	AppendUnsigned(text, value);
+	return true;
+}
+
+static void AppendDeclaration(std::string &text, DWORD inToken, DXBCTokenCursor &cursor, unsigned int inFlags)
+{
+	D3D10_SB_OPCODE_TYPE opcode = DECODE_D3D10_SB_OPCODE_TYPE(inToken);
+	bool ok = true;
+	DWORD value;
+
+	text += GetDXBCOpcodeInfo(opcode).pName;
+
+	switch(opcode)
+	{
+	case D3D10_SB_OPCODE_DCL_RESOURCE:
+		{
+			D3D10_SB_RESOURCE_DIMENSION dimension = DECODE_D3D10_SB_RESOURCE_DIMENSION(inToken);
+
+			text += '_';
+			text += DXBC_NAME(s_resourceDimensionNames, dimension);
+
+			if(dimension == D3D10_SB_RESOURCE_DIMENSION_TEXTURE2DMS || dimension == D3D10_SB_RESOURCE_DIMENSION_TEXTURE2DMSARRAY)
+			{
+				text += '(';
+				AppendUnsigned(text, DECODE_D3D10_SB_RESOURCE_SAMPLE_COUNT(inToken));
+				text += ')';
+			}
+
+			text += ' ';
+			ok = AppendTypedOperand(text, cursor, inFlags);
+		}
+		break;
+
+	case D3D10_SB_OPCODE_DCL_CONSTANT_BUFFER:
+		text += ' ';
+		ok = AppendOperand(text, cursor, inFlags, false);
+		text += (DECODE_D3D10_SB_CONSTANT_BUFFER_ACCESS_PATTERN(inToken) == D3D10_SB_CONSTANT_BUFFER_DYNAMIC_INDEXED) ? ", dynamicIndexed" : ", immediateIndexed";
+		break;
+
+	case D3D10_SB_OPCODE_DCL_SAMPLER:
+		text += ' ';
+		ok = AppendOperand(text, cursor, inFlags);
+		text += ", ";
+		text += DXBC_NAME(s_samplerModeNames, DECODE_D3D10_SB_SAMPLER_MODE(inToken));
+		break;
+
+	case D3D10_SB_OPCODE_DCL_INDEX_RANGE:
+		text += ' ';
+		ok = AppendOperand(text, cursor, inFlags) && AppendDWORD(text, cursor, " ");
+		break;
+
+	case D3D10_SB_OPCODE_DCL_GS_OUTPUT_PRIMITIVE_TOPOLOGY:
+		text += ' ';
+		text += DXBC_NAME(s_topologyNames, DECODE_D3D10_SB_GS_OUTPUT_PRIMITIVE_TOPOLOGY(inToken));
+		break;
+
+	case D3D10_SB_OPCODE_DCL_GS_INPUT_PRIMITIVE:
+		{
+			D3D10_SB_PRIMITIVE primitive = DECODE_D3D10_SB_GS_INPUT_PRIMITIVE(inToken);
+
+			if(primitive >= D3D11_SB_PRIMITIVE_1_CONTROL_POINT_PATCH && primitive <= D3D11_SB_PRIMITIVE_32_CONTROL_POINT_PATCH)
+			{
+				text += " patch";
+				AppendUnsigned(text, primitive - D3D11_SB_PRIMITIVE_1_CONTROL_POINT_PATCH + 1);
+			}
+			else
+			{
+				text += ' ';
+				text += DXBC_NAME(s_primitiveNames, primitive);
+			}
+		}
+		break;
+
+	case D3D10_SB_OPCODE_DCL_MAX_OUTPUT_VERTEX_COUNT:
+	case D3D10_SB_OPCODE_DCL_TEMPS:
+	case D3D11_SB_OPCODE_DCL_HS_FORK_PHASE_INSTANCE_COUNT:
+	case D3D11_SB_OPCODE_DCL_HS_JOIN_PHASE_INSTANCE_COUNT:
+	case D3D11_SB_OPCODE_DCL_GS_INSTANCE_COUNT:
+		ok = AppendDWORD(text, cursor, " ");
+		break;
+
+	case D3D10_SB_OPCODE_DCL_INPUT:
+	case D3D10_SB_OPCODE_DCL_OUTPUT:
+	case D3D11_SB_OPCODE_DCL_STREAM:
+	case D3D11_SB_OPCODE_DCL_RESOURCE_RAW:
+		text += ' ';
+		ok = AppendOperand(text, cursor, inFlags);
+		break;
+
+	case D3D10_SB_OPCODE_DCL_INPUT_PS:
+	case D3D10_SB_OPCODE_DCL_INPUT_PS_SGV:
+	case D3D10_SB_OPCODE_DCL_INPUT_PS_SIV:
+		text += ' ';
+		text += DXBC_NAME(s_interpolationNames, DECODE_D3D10_SB_INPUT_INTERPOLATION_MODE(inToken));
+		text += ' ';
+		ok = AppendOperand(text, cursor, inFlags);
+
+		if(ok && opcode != D3D10_SB_OPCODE_DCL_INPUT_PS)
+		{
+			ok = ReadToken(cursor, &value);
+
+			if(ok)
+			{
+				text += ", ";
+				text += DXBC_NAME(s_systemValueNames, DECODE_D3D10_SB_NAME(value));
+			}
+		}
+		break;
+
+	case D3D10_SB_OPCODE_DCL_INPUT_SGV:
+	case D3D10_SB_OPCODE_DCL_INPUT_SIV:
+	case D3D10_SB_OPCODE_DCL_OUTPUT_SGV:
+	case D3D10_SB_OPCODE_DCL_OUTPUT_SIV:
+		text += ' ';
+		ok = AppendOperand(text, cursor, inFlags) && ReadToken(cursor, &value);
+
+		if(ok)
+		{
+			text += ", ";
+			text += DXBC_NAME(s_systemValueNames, DECODE_D3D10_SB_NAME(value));
+		}
+		break;
+
+	case D3D10_SB_OPCODE_DCL_INDEXABLE_TEMP:
+		ok = AppendDWORD(text, cursor, " x") && AppendDWORD(text, cursor, "[") && AppendDWORD(text, cursor, "], ");
+		break;
+
+	case D3D10_SB_OPCODE_DCL_GLOBAL_FLAGS:
+		{
+			DWORD flags = DECODE_D3D10_SB_GLOBAL_FLAGS(inToken);
+			const char* pSeparator = " ";
+
+			for(unsigned int i = 0; i < sizeof(s_globalFlagNames) / sizeof(s_globalFlagNames[0]); i++)
+			{
+				if(flags & s_globalFlagNames[i].flag)
+				{
+					text += pSeparator;
+					text += s_globalFlagNames[i].pName;
+					flags &= ~s_globalFlagNames[i].flag;
+					pSeparator = " | ";
+				}
+			}
+
+			// Flags newer than the format header
+			if(flags)
+			{
+				text += pSeparator;
+				AppendHex(text, flags);
+			}
+		}
+		break;
+
+	case D3D11_SB_OPCODE_DCL_FUNCTION_BODY:
+		ok = AppendDWORD(text, cursor, " fb");
+		break;
+
+	case D3D11_SB_OPCODE_DCL_FUNCTION_TABLE:
+		{
+			DWORD bodyCount;
+
+			ok = AppendDWORD(text, cursor, " ft") && ReadToken(cursor, &bodyCount);
+			text += " = {";
+
+			for(DWORD i = 0; ok && i < bodyCount; i++)
+				ok = AppendDWORD(text, cursor, i ? ", fb" : "fb");
+
+			text += '}';
+		}
+		break;
+
+	case D3D11_SB_OPCODE_DCL_INTERFACE:
+		{
+			DWORD interfaceId, functionCount, lengths;
+
+			if(DECODE_D3D11_SB_INTERFACE_INDEXED_BIT(inToken))
+				text += "_dynamicindexed";
+
+			ok = ReadToken(cursor, &interfaceId) && ReadToken(cursor, &functionCount) && ReadToken(cursor, &lengths);
+
+			if(ok)
+			{
+				text += " fp";
+				AppendUnsigned(text, interfaceId);
+				text += '[';
+				AppendUnsigned(text, DECODE_D3D11_SB_INTERFACE_ARRAY_LENGTH(lengths));
+				text += "][";
+				AppendUnsigned(text, functionCount);
+				text += "] = {";
+
+				for(DWORD i = 0; ok && i < DECODE_D3D11_SB_INTERFACE_TABLE_LENGTH(lengths); i++)
+					ok = AppendDWORD(text, cursor, i ? ", ft" : "ft");
+
+				text += '}';
+			}
+		}
+		break;
+
+	case D3D11_SB_OPCODE_DCL_INPUT_CONTROL_POINT_COUNT:
+		text += ' ';
+		AppendUnsigned(text, DECODE_D3D11_SB_INPUT_CONTROL_POINT_COUNT(inToken));
+		break;
+
+	case D3D11_SB_OPCODE_DCL_OUTPUT_CONTROL_POINT_COUNT:
+		text += ' ';
+		AppendUnsigned(text, DECODE_D3D11_SB_OUTPUT_CONTROL_POINT_COUNT(inToken));
+		break;
+
+	case D3D11_SB_OPCODE_DCL_TESS_DOMAIN:
+		text += ' ';
+		text += DXBC_NAME(s_tessDomainNames, DECODE_D3D11_SB_TESS_DOMAIN(inToken));
+		break;
+
+	case D3D11_SB_OPCODE_DCL_TESS_PARTITIONING:
+		text += ' ';
+		text += DXBC_NAME(s_tessPartitioningNames, DECODE_D3D11_SB_TESS_PARTITIONING(inToken));
+		break;
+
+	case D3D11_SB_OPCODE_DCL_TESS_OUTPUT_PRIMITIVE:
+		text += ' ';
+		text += DXBC_NAME(s_tessOutputNames, DECODE_D3D11_SB_TESS_OUTPUT_PRIMITIVE(inToken));
+		break;
+
+	case D3D11_SB_OPCODE_DCL_HS_MAX_TESSFACTOR:
+		ok = ReadToken(cursor, &value);
+
+		if(ok)
+		{
+			float maxTessFactor;
+			memcpy(&maxTessFactor, &value, sizeof(maxTessFactor));
+
+			text += " l(";
+			AppendFloat(text, maxTessFactor, false);
+			text += ')';
+		}
+		break;
+
+	case D3D11_SB_OPCODE_DCL_THREAD_GROUP:
+		ok = AppendDWORD(text, cursor, " ") && AppendDWORD(text, cursor, ", ") && AppendDWORD(text, cursor, ", ");
+		break;
+
+	case D3D11_SB_OPCODE_DCL_UNORDERED_ACCESS_VIEW_TYPED:
+		text += '_';
+		text += DXBC_NAME(s_resourceDimensionNames, DECODE_D3D10_SB_RESOURCE_DIMENSION(inToken));
+
+		if(DECODE_D3D11_SB_ACCESS_COHERENCY_FLAGS(inToken))
+			text += "_glc";
+
+		text += ' ';
+		ok = AppendTypedOperand(text, cursor, inFlags);
+		break;
+
+	case D3D11_SB_OPCODE_DCL_UNORDERED_ACCESS_VIEW_RAW:
+	case D3D11_SB_OPCODE_DCL_UNORDERED_ACCESS_VIEW_STRUCTURED:
+		if(DECODE_D3D11_SB_ACCESS_COHERENCY_FLAGS(inToken))
+			text += "_glc";
+
+		if(opcode == D3D11_SB_OPCODE_DCL_UNORDERED_ACCESS_VIEW_STRUCTURED && DECODE_D3D11_SB_UAV_FLAGS(inToken))
+			text += "_opc";
+
+		text += ' ';
+		ok = AppendOperand(text, cursor, inFlags);
+
+		if(ok && opcode == D3D11_SB_OPCODE_DCL_UNORDERED_ACCESS_VIEW_STRUCTURED)
+			ok = AppendDWORD(text, cursor, ", ");
+		break;
+
+	case D3D11_SB_OPCODE_DCL_THREAD_GROUP_SHARED_MEMORY_RAW:
+	case D3D11_SB_OPCODE_DCL_RESOURCE_STRUCTURED:
+		text += ' ';
+		ok = AppendOperand(text, cursor, inFlags) && AppendDWORD(text, cursor, ", ");
+		break;
+
+	case D3D11_SB_OPCODE_DCL_THREAD_GROUP_SHARED_MEMORY_STRUCTURED:
+		text += ' ';
+		ok = AppendOperand(text, cursor, inFlags) && AppendDWORD(text, cursor, ", ") && AppendDWORD(text, cursor, ", ");
+		break;
+
+	default:
+		break;
+	}
+
+	if(!ok)
+		text += " <truncated>";
+}
+
+// Custom data blocks: immediate constant buffer, comments and opaque data (debug info and such)
+static void AppendCustomData(std::string &text, const DWORD *pInstruction, unsigned int inLength, unsigned int inLineIndent, unsigned int inFlags)
+{
+	const DWORD* pData = pInstruction + 2;
+	unsigned int dataDWORDs = (inLength >= 2) ? inLength - 2 : 0;
+
+	switch(DECODE_D3D10_SB_CUSTOMDATA_CLASS(pInstruction[0]))
+	{
+	case D3D10_SB_CUSTOMDATA_DCL_IMMEDIATE_CONSTANT_BUFFER:
+		text += "dcl_immediateConstantBuffer {";
+
+		for(unsigned int row = 0; row * 4 < dataDWORDs; row++)
+		{
+			if(row)
+			{
+				text += ",\n";
+				text.append(inLineIndent + 28, ' ');
+			}
+
+			text += " { ";
+
+			for(unsigned int i = row * 4; i < row * 4 + 4 && i < dataDWORDs; i++)
+			{
+				if(i != row * 4)
+					text += ", ";
+
+				AppendImmediate32(text, pData[i], inFlags);
+			}
+
+			text += " }";
+		}
+
+		text += " }";
+		break;
+
+	case D3D10_SB_CUSTOMDATA_COMMENT:
+		{
+			const char* pComment = (const char*)pData;
+			size_t commentLength = dataDWORDs * sizeof(DWORD);
+
+			text += "// ";
+
+			for(size_t i = 0; i < commentLength && pComment[i]; i++)
+			{
+				if(pComment[i] == '\n')
+				{
+					text += '\n';
+					text.append(inLineIndent, ' ');
+					text += "// ";
+				}
+				else
+					text += (pComment[i] >= ' ' && pComment[i] < 127) ? pComment[i] : '?';
+			}
+		}
+		break;
+
+	case D3D10_SB_CUSTOMDATA_DEBUGINFO:
+		text += "// debug info: ";
+		AppendUnsigned(text, dataDWORDs);
+		text += " DWORDs";
+		break;
+
+	case D3D10_SB_CUSTOMDATA_OPAQUE:
+		text += "// opaque data: ";
+		AppendUnsigned(text, dataDWORDs);
+		text += " DWORDs";
+		break;
+
+	default:
+		text += "// custom data class ";
+		AppendUnsigned(text, DECODE_D3D10_SB_CUSTOMDATA_CLASS(pInstruction[0]));
+		text += ": ";
+		AppendUnsigned(text, dataDWORDs);
+		text += " DWORDs";
+		break;
+	}
+}
+
+// inLineIndent is the column the instruction starts at, continuation lines (of multi-line custom data) line up with it
+static void AppendInstruction(std::string &text, const DWORD *pInstruction, unsigned int inLength, unsigned int inLineIndent, unsigned int inFlags)
+{
+	DWORD token = pInstruction[0];
+	D3D10_SB_OPCODE_TYPE opcode = DECODE_D3D10_SB_OPCODE_TYPE(token);
+	DXBCTokenCursor cursor = { pInstruction + 1, pInstruction + inLength };
+
+	if(opcode == D3D10_SB_OPCODE_CUSTOMDATA)
+	{
+		AppendCustomData(text, pInstruction, inLength, inLineIndent, inFlags);
+		return;
+	}
+
+	if(opcode >= D3D10_SB_NUM_OPCODES)
+	{
+		text += "unknown_opcode_";
+		AppendUnsigned(text, opcode);
+		text += " //";
+
+		for(unsigned int i = 0; i < inLength; i++)
+		{
+			text += ' ';
+			AppendHex(text, pInstruction[i]);
+		}
+		return;
+	}
+
+	if(IsDXBCDeclaration(opcode))
+	{
+		AppendDeclaration(text, token, cursor, inFlags);
+		return;
+	}
+
+	text += GetDXBCOpcodeInfo(opcode).pName;
+
+	if(GetDXBCOpcodeInfo(opcode).flags & DXBC_OPCODE_TEST_BOOLEAN)
+		text += (DECODE_D3D10_SB_INSTRUCTION_TEST_BOOLEAN(token) == D3D10_SB_INSTRUCTION_TEST_NONZERO) ? "_nz" : "_z";
+
+	// Opcode specific controls
+	switch(opcode)
+	{
+	case D3D10_SB_OPCODE_RESINFO:
+		if(DECODE_D3D10_SB_RESINFO_INSTRUCTION_RETURN_TYPE(token) == D3D10_SB_RESINFO_INSTRUCTION_RETURN_RCPFLOAT)
+			text += "_rcpFloat";
+		else if(DECODE_D3D10_SB_RESINFO_INSTRUCTION_RETURN_TYPE(token) == D3D10_SB_RESINFO_INSTRUCTION_RETURN_UINT)
+			text += "_uint";
+		break;
+
+	case D3D10_1_SB_OPCODE_SAMPLE_INFO:
+		if(DECODE_D3D10_SB_INSTRUCTION_RETURN_TYPE(token) == D3D10_SB_INSTRUCTION_RETURN_UINT)
+			text += "_uint";
+		break;
+
+	case D3D11_SB_OPCODE_SYNC:
+		if(token & D3D11_SB_SYNC_UNORDERED_ACCESS_VIEW_MEMORY_GLOBAL)
+			text += "_uglobal";
+		if(token & D3D11_SB_SYNC_UNORDERED_ACCESS_VIEW_MEMORY_GROUP)
+			text += "_ugroup";
+		if(token & D3D11_SB_SYNC_THREAD_GROUP_SHARED_MEMORY)
+			text += "_g";
+		if(token & D3D11_SB_SYNC_THREADS_IN_GROUP)
+			text += "_t";
+		break;
+
+	default:
+		break;
+	}
+
+	// Sync flags share the saturate bit
+	if(opcode != D3D11_SB_OPCODE_SYNC && DECODE_IS_D3D10_SB_INSTRUCTION_SATURATE_ENABLED(token))
+		text += "_sat";
+
+	// Extended opcode tokens
+	DWORD extendedToken = token;
+	DWORD sampleControls = 0, resourceDimension = 0, returnTypes = 0;
+	bool hasSampleControls = false, hasResourceDimension = false, hasReturnTypes = false;
+	bool ok = true;
+
+	while(ok && DECODE_IS_D3D10_SB_OPCODE_EXTENDED(extendedToken))
+	{
+		ok = ReadToken(cursor, &extendedToken);
+
+		switch(ok ? DECODE_D3D10_SB_EXTENDED_OPCODE_TYPE(extendedToken) : D3D10_SB_EXTENDED_OPCODE_EMPTY)
+		{
+		case D3D10_SB_EXTENDED_OPCODE_SAMPLE_CONTROLS:
+			hasSampleControls = true;
+			sampleControls = extendedToken;
+			break;
+
+		case D3D11_SB_EXTENDED_OPCODE_RESOURCE_DIM:
+			hasResourceDimension = true;
+			resourceDimension = DECODE_D3D11_SB_EXTENDED_RESOURCE_DIMENSION(extendedToken);
+			break;
+
+		case D3D11_SB_EXTENDED_OPCODE_RESOURCE_RETURN_TYPE:
+			hasReturnTypes = true;
+			returnTypes = extendedToken;
+			break;
+
+		default:
+			break;
+		}
+	}
+
+	if(hasSampleControls)
+		text += "_aoffimmi";
+
+	if(hasResourceDimension)
+		text += "_indexable";
+
+	if(hasSampleControls)
+	{
+		// Texel offsets are 4 bit two's complement numbers
+		for(unsigned int i = 0; i < 3; i++)
+		{
+			int offset = (int)DECODE_IMMEDIATE_D3D10_SB_ADDRESS_OFFSET(i, sampleControls);
+
+			text += i ? ',' : '(';
+			AppendSigned(text, (offset & 8) ? offset - 16 : offset);
+		}
+
+		text += ')';
+	}
+
+	if(hasResourceDimension)
+	{
+		text += '(';
+		text += DXBC_NAME(s_resourceDimensionNames, resourceDimension);
+		text += ')';
+	}
+
+	if(hasReturnTypes)
+	{
+		for(unsigned int i = 0; i < 4; i++)
+		{
+			text += i ? ',' : '(';
+			text += DXBC_NAME(s_returnTypeNames, DECODE_D3D11_SB_EXTENDED_RESOURCE_RETURN_TYPE(returnTypes, i));
+		}
+
+		text += ')';
+	}
+
+	DWORD precise = DECODE_D3D11_SB_INSTRUCTION_PRECISE_VALUES(token);
+
+	if(precise && opcode != D3D11_SB_OPCODE_SYNC)
+	{
+		text += " [precise";
+
+		if(precise != 0xf)
+		{
+			text += '(';
+
+			for(unsigned int i = 0; i < 4; i++)
+			{
+				if(precise & (1 << i))
+					text += s_componentNames[i];
+			}
+
+			text += ')';
+		}
+
+		text += ']';
+	}
+
+	// Interface call has the function index in front of its operand
+	DWORD functionIndex = 0;
+
+	if(ok && opcode == D3D11_SB_OPCODE_INTERFACE_CALL)
+		ok = ReadToken(cursor, &functionIndex);
+
+	for(bool first = true; ok && cursor.pToken < cursor.pEnd; first = false)
+	{
+		text += first ? " " : ", ";
+		ok = AppendOperand(text, cursor, inFlags);
+	}
+
+	if(ok && opcode == D3D11_SB_OPCODE_INTERFACE_CALL)
+	{
+		text += ", ";
+		AppendUnsigned(text, functionIndex);
+	}
+
+	if(!ok)
+		text += " <truncated>";
+}
+
+void DisassembleDXBCOpcodes(	const DWORD		*pOpcodes,				//[In]	First opcode
+								unsigned int	inNumDWORDs,			//[In]	Number of opcode DWORDs
+								unsigned int	inFlags,				//[In]	DXBCDisassemblyFlags
+								std::string		&text					//[Out]	Text is appended here
+	)
+{
+	unsigned int indent = 0;
+	unsigned int opcodeNumber = 0;
+
+	// Same instructions as the patcher walks, so instruction numbers are the ones inInsertBeforeOpcode expects
+	for(DXBCInstruction instruction : IterateDXBCInstructions(pOpcodes, inNumDWORDs))
+	{
+		unsigned int offset = (unsigned int)(instruction.pToken - pOpcodes);
+		D3D10_SB_OPCODE_TYPE opcode = instruction.GetOpcode();
+		int prefixLength = 0;
+
+		if(inFlags & (DXBC_DISASM_INSTRUCTION_NUMBERING | DXBC_DISASM_INSTRUCTION_OFFSET))
+		{
+			char prefix[32];
+
+			if(inFlags & DXBC_DISASM_INSTRUCTION_OFFSET)
+				prefixLength += snprintf(prefix, sizeof(prefix), "%6u ", offset * (unsigned int)sizeof(DWORD));
+
+			if(inFlags & DXBC_DISASM_INSTRUCTION_NUMBERING)
+				prefixLength += snprintf(prefix + prefixLength, sizeof(prefix) - prefixLength, "%4u: ", opcodeNumber);
+
+			text.append(prefix, prefixLength);
+		}
+
+		if(instruction.IsTruncated())
+		{
+			text += "// instruction runs past the end of the opcode stream\n";
+			break;
+		}
+
+		if(indent && (	opcode == D3D10_SB_OPCODE_ELSE || opcode == D3D10_SB_OPCODE_ENDIF ||
+						opcode == D3D10_SB_OPCODE_ENDLOOP || opcode == D3D10_SB_OPCODE_ENDSWITCH))
+			indent--;
+
+		text.append(indent * 2, ' ');
+		AppendInstruction(text, instruction.pToken, instruction.GetLength(), prefixLength + indent * 2, inFlags);
+		text += '\n';
+
+		if(	opcode == D3D10_SB_OPCODE_IF || opcode == D3D10_SB_OPCODE_ELSE ||
+			opcode == D3D10_SB_OPCODE_LOOP || opcode == D3D10_SB_OPCODE_SWITCH)
+			indent++;
+
+		opcodeNumber++;
+	}
+}
+
+DXBCPatchStatus DisassembleDXBC(	const void		*pSrcDataShader,		//[In]	DXBC to disassemble
+									unsigned int	inSrcShaderSize,		//[In]	Size of DXBC
+									unsigned int	inFlags,				//[In]	DXBCDisassemblyFlags
+									std::string		&text					//[Out]	Text is appended here
+	)
+{
+	DXBCLayout layout;
+	DXBCPatchStatus status = ParseDXBCLayout(pSrcDataShader, inSrcShaderSize, &layout);
+
+	if(status != DXBC_PATCH_OK)
+		return status;
+
+	text += "// DXBC chunks:";
+
+	for(unsigned int i = 0; i < layout.chunkCount; i++)
+	{
+		const char* pChunk = (const char*)layout.pSrcData + layout.pChunkOffsets[i];
+
+		text += ' ';
+		text.append(pChunk, 4);
+	}
+
+	text += '\n';
+
+	DWORD versionToken = *(const DWORD*)(layout.pShaderChunk + 8);
+
+	text += DXBC_NAME(s_programPrefixes, DECODE_D3D10_SB_TOKENIZED_PROGRAM_TYPE(versionToken));
+	text += '_';
+	AppendUnsigned(text, DECODE_D3D10_SB_TOKENIZED_PROGRAM_MAJOR_VERSION(versionToken));
+	text += '_';
+	AppendUnsigned(text, DECODE_D3D10_SB_TOKENIZED_PROGRAM_MINOR_VERSION(versionToken));
+	text += '\n';
+
+	DisassembleDXBCOpcodes(layout.pOpcodes, layout.opcodeDWORDs, inFlags, text);
+	return DXBC_PATCH_OK;
+}
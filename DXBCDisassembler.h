@@ -0,0 +1,44 @@
+// Author: Henryk Kosobucki, 2016
+
+//=============================================	OVERVIEW =========================================================
+//	Native SM4/SM5 disassembler. Decodes SHDR/SHEX token streams with the DECODE_* macros of the tokenized
+//	program format and writes D3D style assembly text (instructions with their operands, extended opcode and
+//	operand tokens, declarations and custom data blocks). It needs neither D3DCompiler nor COM, so it works on
+//	every platform the patcher builds on.
+//
+//	Text is appended to a caller owned std::string. Disassembling many shaders into the same (cleared) string
+//	reuses its storage, so once it has grown to the size of the largest listing nothing is allocated anymore.
+//
+//	Malformed streams never make the disassembler read past the data it was given: broken operands are printed
+//	as such and an instruction running past the end of the stream stops the listing.
+//================================================================================================================
+
+#ifndef DXBC_DISASSEMBLER_H
+#define DXBC_DISASSEMBLER_H
+
+#include "Patcher.h"
+#include <string>
+
+enum DXBCDisassemblyFlags
+{
+	DXBC_DISASM_INSTRUCTION_NUMBERING	= 0x1,		// Prefix every instruction with its number
+	DXBC_DISASM_INSTRUCTION_OFFSET		= 0x2,		// Prefix every instruction with its offset (in bytes from the first opcode)
+	DXBC_DISASM_HEX_LITERALS			= 0x4,		// Print immediate values as hex instead of guessing float or integer
+};
+
+// Disassembles the SHDR/SHEX chunk of DXBC container, starting with a comment listing the chunks and the shader
+// version line.
+DXBCPatchStatus DisassembleDXBC(	const void		*pSrcDataShader,		//[In]	DXBC to disassemble
+									unsigned int	inSrcShaderSize,		//[In]	Size of DXBC
+									unsigned int	inFlags,				//[In]	DXBCDisassemblyFlags
+									std::string		&text					//[Out]	Text is appended here
+	);
+
+// Disassembles bare opcode stream, e.g. one to be injected by PatchDXBC.
+void DisassembleDXBCOpcodes(	const DWORD		*pOpcodes,				//[In]	First opcode
+								unsigned int	inNumDWORDs,			//[In]	Number of opcode DWORDs
+								unsigned int	inFlags,				//[In]	DXBCDisassemblyFlags
+								std::string		&text					//[Out]	Text is appended here
+	);
+
+#endif // DXBC_DISASSEMBLER_H
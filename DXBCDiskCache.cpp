@@ -0,0 +1,305 @@
+//================================================================================================================
+// Include files
+//================================================================================================================
+#include "DXBCDiskCache.h"
+#include "Patcher.h"
+#include "DXBCValidator.h"
+#include <stddef.h>
+#include <string.h>
+
+#ifndef _WIN32
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif // _WIN32
+
+
+
+
+
+//================================================================================================================
+// Function definitions
+//================================================================================================================
+// 64-bit FNV-1a, taking a DWORD at a time (4x fewer dependent multiplies than the byte-wise one)
+static void HashBytes(const void *pData, unsigned int inSize, DWORD outHash[2])
+{
+	const BYTE* pBytes = (const BYTE*)pData;
+	unsigned long long hash = 0xCBF29CE484222325ull;
+	unsigned int i = 0;
+
+	for(; i + sizeof(DWORD) <= inSize; i += sizeof(DWORD))
+	{
+		DWORD value;
+		memcpy(&value, pBytes + i, sizeof(value));
+		hash = (hash ^ value) * 0x100000001B3ull;
+	}
+
+	for(; i < inSize; i++)
+		hash = (hash ^ pBytes[i]) * 0x100000001B3ull;
+
+	outHash[0] = (DWORD)hash;
+	outHash[1] = (DWORD)(hash >> 32);
+}
+
+// Hash of everything in the record header after the header hash itself
+static DWORD HashRecordHeader(const DXBCDiskCacheRecord &record)
+{
+	DWORD hash[2];
+	HashBytes(&record.key, sizeof(record) - offsetof(DXBCDiskCacheRecord, key), hash);
+
+	return hash[0] ^ hash[1];
+}
+
+// Reads record header at given offset of the file, if there is a valid one whose data fits into the file
+static bool ReadRecordHeader(const BYTE *pFile, unsigned int inFileSize, unsigned int inOffset, DXBCDiskCacheRecord *pRecord)
+{
+	if(inFileSize - inOffset < sizeof(DXBCDiskCacheRecord))
+		return false;
+
+	memcpy(pRecord, pFile + inOffset, sizeof(*pRecord));
+
+	return	pRecord->magic == DXBC_DISK_CACHE_MAGIC &&
+			pRecord->headerHash == HashRecordHeader(*pRecord) &&
+			pRecord->dataSize <= inFileSize - inOffset - sizeof(*pRecord);
+}
+
+#ifdef _WIN32
+static intptr_t OpenAppendFile(const char *pPath)
+{
+	// Appending data only, every write goes to the end of file atomically
+	HANDLE hFile = CreateFileA(pPath, FILE_APPEND_DATA, FILE_SHARE_READ | FILE_SHARE_WRITE, NULL, OPEN_ALWAYS, FILE_ATTRIBUTE_NORMAL, NULL);
+
+	return (hFile == INVALID_HANDLE_VALUE) ? -1 : (intptr_t)hFile;
+}
+
+static bool AppendFile(intptr_t file, const void *pData, unsigned int inSize)
+{
+	DWORD written = 0;
+
+	return WriteFile((HANDLE)file, pData, inSize, &written, NULL) && written == inSize;
+}
+
+static void CloseAppendFile(intptr_t file)
+{
+	CloseHandle((HANDLE)file);
+}
+#else
+static intptr_t OpenAppendFile(const char *pPath)
+{
+	// With O_APPEND every write goes to the end of file atomically
+	return open(pPath, O_WRONLY | O_CREAT | O_APPEND, 0666);
+}
+
+static bool AppendFile(intptr_t file, const void *pData, unsigned int inSize)
+{
+	ssize_t written;
+
+	do
+	{
+		written = write((int)file, pData, inSize);
+	}
+	while(written < 0 && errno == EINTR);
+
+	return written == (ssize_t)inSize;
+}
+
+static void CloseAppendFile(intptr_t file)
+{
+	close((int)file);
+}
+#endif // _WIN32
+
+bool DXBCDiskCacheKey::operator<(const DXBCDiskCacheKey &other) const
+{
+	return memcmp(this, &other, sizeof(*this)) < 0;
+}
+
+
+
+
+
+//================================================================================================================
+// DXBCDiskCache
+//================================================================================================================
+DXBCDiskCache::DXBCDiskCache() : m_appendFile(-1)
+{
+}
+
+DXBCDiskCache::~DXBCDiskCache()
+{
+	Close();
+}
+
+bool DXBCDiskCache::Open(const char *pPath)
+{
+	Close();
+
+	// Create file if needed, then map what is there
+	m_appendFile = OpenAppendFile(pPath);
+
+	if(m_appendFile == -1 || !m_file.OpenRead(pPath))
+	{
+		Close();
+		return false;
+	}
+
+	// Index record headers. Data is normally checked only once it is used, but a record which is not followed
+	// by another one (or the end of file) might be torn with newer records appended after it - its data is
+	// checked right away then, and if it is torn, scanning continues by looking for the next valid header.
+	const BYTE* pFile = m_file.GetData();
+	unsigned int fileSize = m_file.GetSize();
+	unsigned int offset = 0;
+
+	while(offset < fileSize)
+	{
+		DXBCDiskCacheRecord record, nextRecord;
+
+		if(!ReadRecordHeader(pFile, fileSize, offset, &record))
+		{
+			offset += sizeof(DWORD);
+			continue;
+		}
+
+		unsigned int dataOffset = offset + sizeof(record);
+		unsigned int nextOffset = dataOffset + ((record.dataSize + 3) & ~3u);
+		bool verified = false;
+
+		if(nextOffset < fileSize && !ReadRecordHeader(pFile, fileSize, nextOffset, &nextRecord))
+		{
+			DWORD dataHash[2];
+			HashBytes(pFile + dataOffset, record.dataSize, dataHash);
+
+			if(dataHash[0] != record.dataHash[0] || dataHash[1] != record.dataHash[1])
+			{
+				offset += sizeof(DWORD);
+				continue;
+			}
+
+			verified = true;
+		}
+
+		DXBCDiskCacheEntry entry = { pFile + dataOffset, record.dataSize, { record.dataHash[0], record.dataHash[1] }, verified };
+		m_index[record.key] = entry;
+
+		offset = nextOffset;
+	}
+
+	return true;
+}
+
+void DXBCDiskCache::Close()
+{
+	if(m_appendFile != -1)
+		CloseAppendFile(m_appendFile);
+
+	m_appendFile = -1;
+	m_index.clear();
+	m_inserted.clear();
+	m_file.Close();
+}
+
+bool DXBCDiskCache::MakeKey(const void *pSrcDataShader, unsigned int inSrcShaderSize, const void *pOpcodeStream, unsigned int inOpcodeStreamSize, unsigned int inInsertBeforeOpcode, DXBCDiskCacheKey *pKey) const
+{
+	// Original shader is identified by the checksum it carries, so it is never hashed here
+	if(inSrcShaderSize < 20)
+		return false;
+
+	memset(pKey, 0, sizeof(*pKey));
+	memcpy(pKey->srcChecksum, (const DWORD*)pSrcDataShader + 1, sizeof(pKey->srcChecksum));
+	pKey->srcSize				= inSrcShaderSize;
+	HashBytes(pOpcodeStream, inOpcodeStreamSize, pKey->streamHash);
+	pKey->streamSize			= inOpcodeStreamSize;
+	pKey->insertBeforeOpcode	= inInsertBeforeOpcode;
+	pKey->patcherVersion		= DXBC_PATCHER_VERSION;
+
+	return true;
+}
+
+const BYTE* DXBCDiskCache::Find(const void *pSrcDataShader, unsigned int inSrcShaderSize, const void *pOpcodeStream, unsigned int inOpcodeStreamSize, unsigned int inInsertBeforeOpcode, unsigned int *pDstSize)
+{
+	DXBCDiskCacheKey key;
+
+	if(!MakeKey(pSrcDataShader, inSrcShaderSize, pOpcodeStream, inOpcodeStreamSize, inInsertBeforeOpcode, &key))
+		return NULL;
+
+	std::map<DXBCDiskCacheKey, DXBCDiskCacheEntry>::iterator it = m_index.find(key);
+
+	if(it == m_index.end())
+		return NULL;
+
+	DXBCDiskCacheEntry &entry = it->second;
+
+	// Data is checked once, on first use - torn record (or one holding a corrupt shader) is a miss
+	if(!entry.verified)
+	{
+		DWORD dataHash[2];
+		HashBytes(entry.pData, entry.size, dataHash);
+
+		if(	dataHash[0] != entry.dataHash[0] || dataHash[1] != entry.dataHash[1] ||
+			ValidateDXBC(entry.pData, entry.size, NULL) != DXBC_PATCH_OK)
+		{
+			m_index.erase(it);
+			return NULL;
+		}
+
+		entry.verified = true;
+	}
+
+	*pDstSize = entry.size;
+	return entry.pData;
+}
+
+bool DXBCDiskCache::Insert(const void *pSrcDataShader, unsigned int inSrcShaderSize, const void *pOpcodeStream, unsigned int inOpcodeStreamSize, unsigned int inInsertBeforeOpcode, const void *pPatchedDataShader, unsigned int inPatchedShaderSize)
+{
+	DXBCDiskCacheRecord record;
+
+	if(m_appendFile == -1 || !MakeKey(pSrcDataShader, inSrcShaderSize, pOpcodeStream, inOpcodeStreamSize, inInsertBeforeOpcode, &record.key))
+		return false;
+
+	record.magic = DXBC_DISK_CACHE_MAGIC;
+	record.dataSize = inPatchedShaderSize;
+	HashBytes(pPatchedDataShader, inPatchedShaderSize, record.dataHash);
+	record.headerHash = HashRecordHeader(record);
+
+	// Whole record goes to the file with a single append
+	m_inserted.push_back(std::vector<BYTE>(sizeof(record) + ((inPatchedShaderSize + 3) & ~3u), 0));
+
+	std::vector<BYTE> &data = m_inserted.back();
+	memcpy(data.data(), &record, sizeof(record));
+	memcpy(data.data() + sizeof(record), pPatchedDataShader, inPatchedShaderSize);
+
+	if(!AppendFile(m_appendFile, data.data(), (unsigned int)data.size()))
+	{
+		m_inserted.pop_back();
+		return false;
+	}
+
+	DXBCDiskCacheEntry entry = { data.data() + sizeof(record), inPatchedShaderSize, { record.dataHash[0], record.dataHash[1] }, true };
+	m_index[record.key] = entry;
+
+	return true;
+}
+
+const BYTE* DXBCDiskCache::Patch(const void *pSrcDataShader, unsigned int inSrcShaderSize, const void *pOpcodeStream, unsigned int inOpcodeStreamSize, unsigned int inInsertBeforeOpcode, unsigned int *pDstSize)
+{
+	const BYTE* pPatched = Find(pSrcDataShader, inSrcShaderSize, pOpcodeStream, inOpcodeStreamSize, inInsertBeforeOpcode, pDstSize);
+
+	if(pPatched)
+		return pPatched;
+
+	unsigned int dstSize = GetPatchedDXBCSize(pSrcDataShader, inSrcShaderSize, inOpcodeStreamSize);
+
+	if(!dstSize)
+		return NULL;
+
+	m_scratch.resize(dstSize);
+
+	if(PatchDXBCBounded(pSrcDataShader, inSrcShaderSize, pOpcodeStream, inOpcodeStreamSize, inInsertBeforeOpcode, m_scratch.data(), dstSize, pDstSize) != DXBC_PATCH_OK)
+		return NULL;
+
+	// Even if it can't be cached, patched shader is still good
+	if(Insert(pSrcDataShader, inSrcShaderSize, pOpcodeStream, inOpcodeStreamSize, inInsertBeforeOpcode, m_scratch.data(), dstSize))
+		return Find(pSrcDataShader, inSrcShaderSize, pOpcodeStream, inOpcodeStreamSize, inInsertBeforeOpcode, pDstSize);
+
+	return m_scratch.data();
+}
@@ -0,0 +1,117 @@
+// Author: Henryk Kosobucki, 2016
+
+//=============================================	OVERVIEW =========================================================
+//	Persistent cache of patched shaders, so tools launched over and over again with the same shaders and patches
+//	don't patch (and checksum) them again and again.
+//
+//	Results are keyed by the original shader (its embedded DXBC checksum and size), hash and size of the injected
+//	opcode stream, injection point and DXBC_PATCHER_VERSION. They are appended to a single file as records:
+//
+//		DXBCDiskCacheRecord		(key, size and hash of the data, hash of the record header itself)
+//		patched DXBC			(padded to DWORD)
+//
+//	The file is only ever appended to, each record with a single append write, so records of several processes
+//	using the same file don't interleave and existing records never change. A crash can only leave a torn record
+//	at the end of the file (possibly followed by records appended later): its header hash doesn't match or its
+//	data hash doesn't match, and opening skips it and looks for the next valid header. Torn record that can't be
+//	told apart by its header alone fails its data check on first lookup and is treated as a miss. Later record of
+//	the same key wins, so a torn record is simply replaced once the shader is patched again.
+//
+//	Opening maps the file and indexes record headers only. Hits return pointers straight into the mapping.
+//================================================================================================================
+
+#ifndef DXBC_DISK_CACHE_H
+#define DXBC_DISK_CACHE_H
+
+#include "DXBCMappedFile.h"
+#include <deque>
+#include <stdint.h>
+#include <map>
+#include <vector>
+
+#define DXBC_DISK_CACHE_MAGIC	MAKEFOURCC('D', 'X', 'P', 'C')
+
+struct DXBCDiskCacheKey
+{
+	DWORD			srcChecksum[4];		// DXBC checksum embedded in original shader
+	DWORD			srcSize;			// Size of original shader
+	DWORD			streamHash[2];		// Hash of injected opcode stream
+	DWORD			streamSize;			// Size of injected opcode stream
+	DWORD			insertBeforeOpcode;	// Injection point
+	DWORD			patcherVersion;		// DXBC_PATCHER_VERSION
+
+	bool operator<(const DXBCDiskCacheKey &other) const;
+};
+
+struct DXBCDiskCacheRecord
+{
+	DWORD				magic;			// DXBC_DISK_CACHE_MAGIC
+	DWORD				headerHash;		// Hash of the rest of the header
+	DXBCDiskCacheKey	key;
+	DWORD				dataSize;		// Size of patched shader (without padding)
+	DWORD				dataHash[2];	// Hash of patched shader
+};
+
+// Indexed record
+struct DXBCDiskCacheEntry
+{
+	const BYTE*			pData;			// Patched shader, in the mapping or in memory
+	unsigned int		size;
+	DWORD				dataHash[2];
+	bool				verified;		// Data hash was checked already
+};
+
+class DXBCDiskCache
+{
+public:
+	DXBCDiskCache();
+	~DXBCDiskCache();
+
+	// Opens (or creates) cache file and indexes its records
+	bool				Open(const char *pPath);
+	void				Close();
+
+	// Patched shader for the given patch, NULL if it is not cached yet. Pointer stays valid until the cache is
+	// closed.
+	const BYTE*			Find(	const void			*pSrcDataShader,		//[In]	Original DXBC
+								unsigned int		inSrcShaderSize,		//[In]	Size of original DXBC
+								const void			*pOpcodeStream,			//[In]	Opcode stream to inject
+								unsigned int		inOpcodeStreamSize,		//[In]	Opcode stream size
+								unsigned int		inInsertBeforeOpcode,	//[In]	Original opcode number before which modification will happen
+								unsigned int		*pDstSize				//[Out]	Size of patched DXBC
+		);
+
+	// Appends patched shader to the cache file
+	bool				Insert(	const void			*pSrcDataShader,		//[In]	Original DXBC
+								unsigned int		inSrcShaderSize,		//[In]	Size of original DXBC
+								const void			*pOpcodeStream,			//[In]	Opcode stream to inject
+								unsigned int		inOpcodeStreamSize,		//[In]	Opcode stream size
+								unsigned int		inInsertBeforeOpcode,	//[In]	Original opcode number before which modification will happen
+								const void			*pPatchedDataShader,	//[In]	Patched DXBC
+								unsigned int		inPatchedShaderSize		//[In]	Size of patched DXBC
+		);
+
+	// Cached patched shader, patching (and caching) it first on a miss. NULL if shader can't be patched. If
+	// the result can't be appended to the file, the pointer is only valid until the next Patch.
+	const BYTE*			Patch(	const void			*pSrcDataShader,		//[In]	Original DXBC
+								unsigned int		inSrcShaderSize,		//[In]	Size of original DXBC
+								const void			*pOpcodeStream,			//[In]	Opcode stream to inject
+								unsigned int		inOpcodeStreamSize,		//[In]	Opcode stream size
+								unsigned int		inInsertBeforeOpcode,	//[In]	Original opcode number before which modification will happen
+								unsigned int		*pDstSize				//[Out]	Size of patched DXBC
+		);
+
+private:
+	DXBCDiskCache(const DXBCDiskCache&);
+	DXBCDiskCache&		operator=(const DXBCDiskCache&);
+
+	bool				MakeKey(const void *pSrcDataShader, unsigned int inSrcShaderSize, const void *pOpcodeStream, unsigned int inOpcodeStreamSize, unsigned int inInsertBeforeOpcode, DXBCDiskCacheKey *pKey) const;
+
+	DXBCMappedFile									m_file;			// Records that were in the file when it was opened
+	std::deque<std::vector<BYTE> >					m_inserted;		// Records appended since then
+	std::map<DXBCDiskCacheKey, DXBCDiskCacheEntry>	m_index;
+	std::vector<BYTE>								m_scratch;		// Output of Patch before it is appended
+	intptr_t										m_appendFile;	// Append-only descriptor (handle on Windows), -1 when closed
+};
+
+#endif // DXBC_DISK_CACHE_H
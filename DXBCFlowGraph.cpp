@@ -0,0 +1,465 @@
+//================================================================================================================
+// Include files
+//================================================================================================================
+#include "DXBCFlowGraph.h"
+#include "d3d11TokenizedProgramFormat.hpp"
+#include "DXBCOpcodeInfo.h"
+#include <string.h>
+
+
+
+
+
+//================================================================================================================
+// Structures
+//================================================================================================================
+#define DXBC_BLOCK_START			0x80			// Instruction starts a block (besides its DXBCBlockFlags)
+
+
+
+
+
+//================================================================================================================
+// Opcodes
+//================================================================================================================
+// Subroutines and hull shader phases are entered from outside, nothing falls through into them
+static bool IsEntry(unsigned int inOpcode)
+{
+	return	inOpcode == D3D10_SB_OPCODE_LABEL || inOpcode == D3D11_SB_OPCODE_HS_DECLS ||
+			inOpcode == D3D11_SB_OPCODE_HS_CONTROL_POINT_PHASE || inOpcode == D3D11_SB_OPCODE_HS_FORK_PHASE ||
+			inOpcode == D3D11_SB_OPCODE_HS_JOIN_PHASE;
+}
+
+static bool IsLabel(unsigned int inOpcode)
+{
+	return inOpcode == D3D10_SB_OPCODE_CASE || inOpcode == D3D10_SB_OPCODE_DEFAULT;
+}
+
+// Instruction ends its block
+static bool IsTerminator(unsigned int inOpcode)
+{
+	switch(inOpcode)
+	{
+	case D3D10_SB_OPCODE_IF:
+	case D3D10_SB_OPCODE_ELSE:
+	case D3D10_SB_OPCODE_LOOP:
+	case D3D10_SB_OPCODE_ENDLOOP:
+	case D3D10_SB_OPCODE_BREAK:
+	case D3D10_SB_OPCODE_BREAKC:
+	case D3D10_SB_OPCODE_CONTINUE:
+	case D3D10_SB_OPCODE_CONTINUEC:
+	case D3D10_SB_OPCODE_SWITCH:
+	case D3D10_SB_OPCODE_RET:
+	case D3D10_SB_OPCODE_RETC:
+		return true;
+	}
+
+	return false;
+}
+
+// Execution may go on with the next instruction
+static bool FallsThrough(unsigned int inOpcode)
+{
+	return	inOpcode != D3D10_SB_OPCODE_ELSE && inOpcode != D3D10_SB_OPCODE_ENDLOOP && inOpcode != D3D10_SB_OPCODE_BREAK &&
+			inOpcode != D3D10_SB_OPCODE_CONTINUE && inOpcode != D3D10_SB_OPCODE_SWITCH && inOpcode != D3D10_SB_OPCODE_RET;
+}
+
+// Code in front of it would not run on every entry to its block (jumps land behind merge markers and labels) or
+// would not be code at all (declarations and immediate constant buffers come first)
+static bool IsPrologue(unsigned int inOpcode, bool inIsEntry)
+{
+	if(	inOpcode == D3D10_SB_OPCODE_ENDIF || inOpcode == D3D10_SB_OPCODE_ENDSWITCH || IsLabel(inOpcode) || IsEntry(inOpcode))
+		return true;
+
+	return inIsEntry && (	GetDXBCOpcodeInfo((D3D10_SB_OPCODE_TYPE)inOpcode).category == DXBC_OPCODE_CATEGORY_DECLARATION ||
+							inOpcode == D3D10_SB_OPCODE_CUSTOMDATA);
+}
+
+
+
+
+
+//================================================================================================================
+// Building
+//================================================================================================================
+DXBCFlowGraph::DXBCFlowGraph() : m_pProgram(nullptr)
+{
+	memset(&m_blockTable, 0, sizeof(m_blockTable));
+}
+
+// Marks instructions starting blocks and collects jumps between them (fall through is left to AddEdges)
+DXBCPatchStatus DXBCFlowGraph::FindJumps()
+{
+	const DXBCInstructionTable& instructions = m_pProgram->GetInstructions();
+
+	m_starts.assign(instructions.count + 1, 0);
+	m_jumps.clear();
+	m_constructs.clear();
+	m_breaks.clear();
+
+	if(instructions.count)
+		m_starts[0] = DXBC_BLOCK_START | DXBC_BLOCK_ENTRY;
+
+	for(unsigned int i = 0; i < instructions.count; i++)
+	{
+		unsigned int opcode = instructions.pOpcodes[i];
+		DXBCFlowConstruct* pConstruct = m_constructs.empty() ? nullptr : &m_constructs.back();
+
+		switch(opcode)
+		{
+		case D3D10_SB_OPCODE_IF:
+		case D3D10_SB_OPCODE_LOOP:
+		case D3D10_SB_OPCODE_SWITCH:
+			{
+				DXBCFlowConstruct construct = { opcode, i, 0, (unsigned int)m_breaks.size() };
+
+				if(opcode == D3D10_SB_OPCODE_LOOP)
+					m_starts[i + 1] |= DXBC_BLOCK_LOOP_HEADER;
+
+				m_constructs.push_back(construct);
+			}
+			break;
+
+		case D3D10_SB_OPCODE_ELSE:
+			{
+				if(!pConstruct || pConstruct->opcode != D3D10_SB_OPCODE_IF || pConstruct->alternative)
+					return DXBC_PATCH_INVALID_SHADER;
+
+				// False condition skips the then part
+				DXBCFlowJump jump = { pConstruct->instruction, i + 1 };
+
+				m_jumps.push_back(jump);
+				pConstruct->alternative = i;
+			}
+			break;
+
+		case D3D10_SB_OPCODE_ENDIF:
+			{
+				if(!pConstruct || pConstruct->opcode != D3D10_SB_OPCODE_IF)
+					return DXBC_PATCH_INVALID_SHADER;
+
+				// End of the then part jumps over the else part, without ELSE the condition skips the block
+				DXBCFlowJump jump = { pConstruct->alternative ? pConstruct->alternative : pConstruct->instruction, i };
+
+				m_jumps.push_back(jump);
+				m_starts[i] |= DXBC_BLOCK_START;
+				m_constructs.pop_back();
+			}
+			break;
+
+		case D3D10_SB_OPCODE_BREAK:
+		case D3D10_SB_OPCODE_BREAKC:
+		case D3D10_SB_OPCODE_CONTINUE:
+		case D3D10_SB_OPCODE_CONTINUEC:
+			{
+				bool isBreak = (opcode == D3D10_SB_OPCODE_BREAK || opcode == D3D10_SB_OPCODE_BREAKC);
+				size_t target = m_constructs.size();
+
+				// Breaks leave the innermost loop or switch, continues go to the innermost loop
+				while(	target > 0 && m_constructs[target - 1].opcode != D3D10_SB_OPCODE_LOOP &&
+						(!isBreak || m_constructs[target - 1].opcode != D3D10_SB_OPCODE_SWITCH))
+					target--;
+
+				if(target == 0)
+					return DXBC_PATCH_INVALID_SHADER;
+
+				if(isBreak)
+				{
+					m_breaks.push_back(i);
+				}
+				else
+				{
+					DXBCFlowJump jump = { i, m_constructs[target - 1].instruction + 1 };
+					m_jumps.push_back(jump);
+				}
+			}
+			break;
+
+		case D3D10_SB_OPCODE_ENDLOOP:
+			{
+				if(!pConstruct || pConstruct->opcode != D3D10_SB_OPCODE_LOOP)
+					return DXBC_PATCH_INVALID_SHADER;
+
+				DXBCFlowJump jump = { i, pConstruct->instruction + 1 };
+
+				m_jumps.push_back(jump);
+
+				for(unsigned int b = pConstruct->firstBreak; b < m_breaks.size(); b++)
+				{
+					DXBCFlowJump breakJump = { m_breaks[b], i + 1 };
+					m_jumps.push_back(breakJump);
+				}
+
+				m_breaks.resize(pConstruct->firstBreak);
+				m_constructs.pop_back();
+			}
+			break;
+
+		case D3D10_SB_OPCODE_CASE:
+		case D3D10_SB_OPCODE_DEFAULT:
+			{
+				if(!pConstruct || pConstruct->opcode != D3D10_SB_OPCODE_SWITCH)
+					return DXBC_PATCH_INVALID_SHADER;
+
+				if(opcode == D3D10_SB_OPCODE_DEFAULT)
+				{
+					if(pConstruct->alternative)
+						return DXBC_PATCH_INVALID_SHADER;
+
+					pConstruct->alternative = i;
+				}
+
+				DXBCFlowJump jump = { pConstruct->instruction, i };
+
+				m_jumps.push_back(jump);
+
+				// Labels following each other share a block
+				if(!IsLabel(instructions.pOpcodes[i - 1]))
+					m_starts[i] |= DXBC_BLOCK_START;
+			}
+			break;
+
+		case D3D10_SB_OPCODE_ENDSWITCH:
+			{
+				if(!pConstruct || pConstruct->opcode != D3D10_SB_OPCODE_SWITCH)
+					return DXBC_PATCH_INVALID_SHADER;
+
+				// Without DEFAULT the selector can skip all cases
+				if(!pConstruct->alternative)
+				{
+					DXBCFlowJump jump = { pConstruct->instruction, i };
+					m_jumps.push_back(jump);
+				}
+
+				for(unsigned int b = pConstruct->firstBreak; b < m_breaks.size(); b++)
+				{
+					DXBCFlowJump breakJump = { m_breaks[b], i };
+					m_jumps.push_back(breakJump);
+				}
+
+				m_breaks.resize(pConstruct->firstBreak);
+				m_starts[i] |= DXBC_BLOCK_START;
+				m_constructs.pop_back();
+			}
+			break;
+
+		default:
+			if(IsEntry(opcode))
+			{
+				if(pConstruct)
+					return DXBC_PATCH_INVALID_SHADER;
+
+				m_starts[i] |= DXBC_BLOCK_START | DXBC_BLOCK_ENTRY;
+			}
+			break;
+		}
+
+		if(IsTerminator(opcode))
+			m_starts[i + 1] |= DXBC_BLOCK_START;
+	}
+
+	if(!m_constructs.empty())
+		return DXBC_PATCH_INVALID_SHADER;
+
+	return DXBC_PATCH_OK;
+}
+
+void DXBCFlowGraph::AddBlocks()
+{
+	const DXBCInstructionTable& instructions = m_pProgram->GetInstructions();
+
+	m_firstInstructions.clear();
+	m_insertInstructions.clear();
+	m_flags.clear();
+	m_instructionBlocks.resize(instructions.count + 1);
+
+	for(unsigned int i = 0; i < instructions.count; i++)
+	{
+		if(m_starts[i] & DXBC_BLOCK_START)
+		{
+			m_firstInstructions.push_back(i);
+			m_flags.push_back(m_starts[i] & ~DXBC_BLOCK_START);
+		}
+
+		m_instructionBlocks[i] = (unsigned int)m_firstInstructions.size() - 1;
+	}
+
+	// Jumps past the last instruction leave the program (ENDLOOP or ENDSWITCH without RET after them)
+	m_instructionBlocks[instructions.count] = DXBC_NO_BLOCK;
+	m_firstInstructions.push_back(instructions.count);
+
+	for(unsigned int block = 0; block + 1 < m_firstInstructions.size(); block++)
+	{
+		unsigned int first = m_firstInstructions[block];
+		unsigned int end = m_firstInstructions[block + 1];
+		unsigned int last = instructions.pOpcodes[end - 1];
+		unsigned int insert = first;
+
+		while(insert < end && IsPrologue(instructions.pOpcodes[insert], (m_flags[block] & DXBC_BLOCK_ENTRY) != 0))
+			insert++;
+
+		m_insertInstructions.push_back(insert);
+
+		if(last == D3D10_SB_OPCODE_RET || last == D3D10_SB_OPCODE_RETC)
+			m_flags[block] |= DXBC_BLOCK_RETURN;
+	}
+}
+
+// Appends edge to the bucket of the block unless it is there already (empty then part, labels sharing a block)
+void DXBCFlowGraph::AddSuccessor(unsigned int inBlock, unsigned int inSuccessor)
+{
+	for(unsigned int edge = m_firstSuccessors[inBlock]; edge < m_cursors[inBlock]; edge++)
+		if(m_successors[edge] == inSuccessor)
+			return;
+
+	m_successors[m_cursors[inBlock]++] = inSuccessor;
+}
+
+// Successors of every block (fall through first, then jumps in the order they were found) and predecessors
+// from them (in block order), both bucketed by block with a counting sort
+void DXBCFlowGraph::AddEdges()
+{
+	const DXBCInstructionTable& instructions = m_pProgram->GetInstructions();
+	unsigned int blockCount = (unsigned int)m_flags.size();
+
+	// Room for fall through and jumps of every block
+	m_firstSuccessors.assign(blockCount + 1, 0);
+
+	for(size_t jump = 0; jump < m_jumps.size(); jump++)
+		m_firstSuccessors[m_instructionBlocks[m_jumps[jump].from] + 1]++;
+
+	for(unsigned int block = 0; block < blockCount; block++)
+		m_firstSuccessors[block + 1] += m_firstSuccessors[block] + 1;
+
+	m_successors.resize(m_firstSuccessors[blockCount]);
+	m_cursors.assign(m_firstSuccessors.begin(), m_firstSuccessors.end() - 1);
+
+	for(unsigned int block = 0; block < blockCount; block++)
+	{
+		unsigned int end = m_firstInstructions[block + 1];
+
+		if(end < instructions.count && FallsThrough(instructions.pOpcodes[end - 1]) && !IsEntry(instructions.pOpcodes[end]))
+			AddSuccessor(block, block + 1);
+	}
+
+	for(size_t jump = 0; jump < m_jumps.size(); jump++)
+		if(m_instructionBlocks[m_jumps[jump].to] != DXBC_NO_BLOCK)
+			AddSuccessor(m_instructionBlocks[m_jumps[jump].from], m_instructionBlocks[m_jumps[jump].to]);
+
+	// Close the gaps left by dropped edges
+	unsigned int edgeCount = 0;
+
+	for(unsigned int block = 0; block < blockCount; block++)
+	{
+		unsigned int first = m_firstSuccessors[block];
+
+		m_firstSuccessors[block] = edgeCount;
+
+		for(unsigned int edge = first; edge < m_cursors[block]; edge++)
+			m_successors[edgeCount++] = m_successors[edge];
+	}
+
+	m_firstSuccessors[blockCount] = edgeCount;
+	m_successors.resize(edgeCount);
+
+	// Predecessors are the same edges bucketed by their target
+	m_firstPredecessors.assign(blockCount + 1, 0);
+	m_predecessors.resize(edgeCount);
+
+	for(unsigned int edge = 0; edge < edgeCount; edge++)
+		m_firstPredecessors[m_successors[edge] + 1]++;
+
+	for(unsigned int block = 0; block < blockCount; block++)
+		m_firstPredecessors[block + 1] += m_firstPredecessors[block];
+
+	m_cursors.assign(m_firstPredecessors.begin(), m_firstPredecessors.end() - 1);
+
+	for(unsigned int block = 0; block < blockCount; block++)
+		for(unsigned int edge = m_firstSuccessors[block]; edge < m_firstSuccessors[block + 1]; edge++)
+			m_predecessors[m_cursors[m_successors[edge]]++] = block;
+}
+
+// Immediate dominators in one pass in block order. Only edges back to loop headers go backwards and the header
+// dominates where they come from, so they can't change its dominator and are skipped. Every other predecessor
+// has its dominator already, the dominator is where the dominator chains of all (reachable) predecessors meet.
+void DXBCFlowGraph::AddDominators()
+{
+	unsigned int blockCount = (unsigned int)m_flags.size();
+
+	m_dominators.assign(blockCount, DXBC_NO_BLOCK);
+
+	for(unsigned int block = 0; block < blockCount; block++)
+	{
+		unsigned int dominator = DXBC_NO_BLOCK;
+
+		if(m_flags[block] & DXBC_BLOCK_ENTRY)
+		{
+			m_flags[block] |= DXBC_BLOCK_REACHABLE;
+			continue;
+		}
+
+		for(unsigned int edge = m_firstPredecessors[block]; edge < m_firstPredecessors[block + 1]; edge++)
+		{
+			unsigned int predecessor = m_predecessors[edge];
+
+			if(predecessor >= block || !(m_flags[predecessor] & DXBC_BLOCK_REACHABLE))
+				continue;
+
+			// Dominators have lower numbers, so the higher of the two steps up until they meet
+			while(dominator != DXBC_NO_BLOCK && predecessor != dominator)
+			{
+				if(predecessor > dominator)
+					predecessor = m_dominators[predecessor];
+				else
+					dominator = m_dominators[dominator];
+			}
+
+			dominator = predecessor;
+		}
+
+		if(dominator != DXBC_NO_BLOCK)
+		{
+			m_dominators[block] = dominator;
+			m_flags[block] |= DXBC_BLOCK_REACHABLE;
+		}
+	}
+}
+
+bool DXBCFlowGraph::Dominates(unsigned int inBlock, unsigned int inOtherBlock) const
+{
+	if(!(m_flags[inBlock] & DXBC_BLOCK_REACHABLE) || !(m_flags[inOtherBlock] & DXBC_BLOCK_REACHABLE))
+		return false;
+
+	while(inOtherBlock != DXBC_NO_BLOCK && inOtherBlock > inBlock)
+		inOtherBlock = m_dominators[inOtherBlock];
+
+	return inOtherBlock == inBlock;
+}
+
+DXBCPatchStatus DXBCFlowGraph::Build(const DXBCProgram &program)
+{
+	m_pProgram = &program;
+
+	memset(&m_blockTable, 0, sizeof(m_blockTable));
+
+	DXBCPatchStatus status = FindJumps();
+
+	if(status != DXBC_PATCH_OK)
+		return status;
+
+	AddBlocks();
+	AddEdges();
+	AddDominators();
+
+	m_blockTable.count					= (unsigned int)m_flags.size();
+	m_blockTable.pFirstInstructions		= m_firstInstructions.data();
+	m_blockTable.pInsertInstructions	= m_insertInstructions.data();
+	m_blockTable.pFirstSuccessors		= m_firstSuccessors.data();
+	m_blockTable.pSuccessors			= m_successors.data();
+	m_blockTable.pFirstPredecessors		= m_firstPredecessors.data();
+	m_blockTable.pPredecessors			= m_predecessors.data();
+	m_blockTable.pDominators			= m_dominators.data();
+	m_blockTable.pFlags					= m_flags.data();
+
+	return DXBC_PATCH_OK;
+}
@@ -0,0 +1,127 @@
+// Author: Henryk Kosobucki, 2016
+
+//=============================================	OVERVIEW =========================================================
+//	Control flow graph of a decoded program: basic blocks, their edges and dominators, for passes picking many
+//	injection points at once (every block entry, before every return, loop headers...):
+//
+//		DXBCProgram program;
+//		DXBCFlowGraph graph;
+//
+//		if(program.Decode(layout) == DXBC_PATCH_OK && graph.Build(program) == DXBC_PATCH_OK)
+//		{
+//			const DXBCBlockTable& blocks = graph.GetBlocks();
+//
+//			for(unsigned int b = 0; b < blocks.count; b++)
+//				if(blocks.pFlags[b] & DXBC_BLOCK_REACHABLE)
+//					edits.push_back(MakeInsert(blocks.pInsertInstructions[b], ...));	// DXBCEdit at block entry
+//		}
+//
+//	Blocks start at program, subroutine (LABEL) and hull shader phase entries, at merge points (ENDIF, ENDSWITCH,
+//	CASE / DEFAULT, consecutive labels share a block) and after every instruction ending one (IF, ELSE, LOOP,
+//	ENDLOOP, BREAK(C), CONTINUE(C), SWITCH, RET(C)), so the loop header is the block after LOOP and loop exit the
+//	one after ENDLOOP. Calls return, they stay inside their block. Flow markers are kept in the blocks, so new
+//	code can't always go in front of the first instruction of a block: pInsertInstructions skips leading merge
+//	markers and, at entries, the declarations.
+//
+//	Flow is structured, so every edge goes forward in the code except those back to a loop header, which the
+//	header dominates. Blocks are numbered in code order, so the immediate dominator of a block always has a lower
+//	number and all dominators come out of one forward pass over the blocks (back edges are skipped), just as
+//	blocks and jumps come out of one pass over the instructions. All tables are flat arrays, edges are stored
+//	per block in order: fall through first, then jumps (IF: then and else, SWITCH: cases in code order).
+//================================================================================================================
+
+#ifndef DXBC_FLOW_GRAPH_H
+#define DXBC_FLOW_GRAPH_H
+
+#include "DXBCProgram.h"
+
+#define DXBC_NO_BLOCK				0xFFFFFFFF		// No dominator (entries and unreachable blocks)
+
+enum DXBCBlockFlags
+{
+	DXBC_BLOCK_ENTRY		= 0x1,		// Start of program, subroutine or hull shader phase
+	DXBC_BLOCK_REACHABLE	= 0x2,		// Some path leads here from an entry
+	DXBC_BLOCK_LOOP_HEADER	= 0x4,		// First block of a loop body (target of CONTINUE and ENDLOOP)
+	DXBC_BLOCK_RETURN		= 0x8,		// Ends with RET or RETC
+};
+
+// Block b spans instructions pFirstInstructions[b] to pFirstInstructions[b + 1]. Its successors are pSuccessors
+// from pFirstSuccessors[b] to pFirstSuccessors[b + 1], predecessors alike.
+struct DXBCBlockTable
+{
+	unsigned int			count;
+	const unsigned int*		pFirstInstructions;		// Followed by the instruction count
+	const unsigned int*		pInsertInstructions;	// Where code run on every entry to the block goes in front of
+	const unsigned int*		pFirstSuccessors;		// Followed by the edge count
+	const unsigned int*		pSuccessors;
+	const unsigned int*		pFirstPredecessors;		// Followed by the edge count
+	const unsigned int*		pPredecessors;
+	const unsigned int*		pDominators;			// Immediate dominator, DXBC_NO_BLOCK for entries and unreachable blocks
+	const BYTE*				pFlags;					// DXBCBlockFlags
+};
+
+// Open IF, LOOP or SWITCH while building
+struct DXBCFlowConstruct
+{
+	unsigned int			opcode;					// D3D10_SB_OPCODE_IF, D3D10_SB_OPCODE_LOOP or D3D10_SB_OPCODE_SWITCH
+	unsigned int			instruction;			// Opening instruction
+	unsigned int			alternative;			// ELSE or DEFAULT (0 until found, they never come first)
+	unsigned int			firstBreak;				// BREAK(C)s leaving it start here in the list of pending breaks
+};
+
+// Edge from a block's last instruction to the instruction starting another block
+struct DXBCFlowJump
+{
+	unsigned int			from;
+	unsigned int			to;
+};
+
+class DXBCFlowGraph
+{
+public:
+	DXBCFlowGraph();
+
+	// Builds the graph of the program, which has to outlive it. DXBC_PATCH_INVALID_SHADER on unbalanced flow
+	// (ELSE without IF, BREAK outside of loop and switch, LABEL inside a block...).
+	DXBCPatchStatus		Build(const DXBCProgram &program);
+
+	// Every path from the entry to inOtherBlock goes through inBlock (blocks dominate themselves)
+	bool				Dominates(unsigned int inBlock, unsigned int inOtherBlock) const;
+
+	const DXBCBlockTable&	GetBlocks() const { return m_blockTable; }
+	const unsigned int*		GetInstructionBlocks() const { return m_instructionBlocks.data(); }	// Block of every instruction
+
+private:
+	DXBCFlowGraph(const DXBCFlowGraph&);
+	DXBCFlowGraph&		operator=(const DXBCFlowGraph&);
+
+	DXBCPatchStatus		FindJumps();
+	void				AddBlocks();
+	void				AddSuccessor(unsigned int inBlock, unsigned int inSuccessor);
+	void				AddEdges();
+	void				AddDominators();
+
+	const DXBCProgram*			m_pProgram;
+
+	// Blocks and edges
+	std::vector<unsigned int>	m_firstInstructions;
+	std::vector<unsigned int>	m_insertInstructions;
+	std::vector<unsigned int>	m_firstSuccessors;
+	std::vector<unsigned int>	m_successors;
+	std::vector<unsigned int>	m_firstPredecessors;
+	std::vector<unsigned int>	m_predecessors;
+	std::vector<unsigned int>	m_dominators;
+	std::vector<BYTE>			m_flags;
+	std::vector<unsigned int>	m_instructionBlocks;
+
+	// Scratch of Build, kept to reuse its storage
+	std::vector<BYTE>			m_starts;			// Flags of the block every instruction starts (0 when it starts none)
+	std::vector<DXBCFlowJump>	m_jumps;
+	std::vector<DXBCFlowConstruct>	m_constructs;	// Open IF, LOOP and SWITCH blocks
+	std::vector<unsigned int>	m_breaks;			// BREAK(C)s waiting for the end of their loop or switch
+	std::vector<unsigned int>	m_cursors;			// Fill position in the edge bucket of every block
+
+	DXBCBlockTable				m_blockTable;
+};
+
+#endif // DXBC_FLOW_GRAPH_H
@@ -0,0 +1,232 @@
+// Author: Henryk Kosobucki, 2016
+
+//=============================================	OVERVIEW =========================================================
+//	Forward iteration over SHDR/SHEX opcode streams without repeating the length rules everywhere:
+//
+//		for(DXBCInstruction instruction : IterateDXBCInstructions(layout))
+//		{
+//			if(instruction.GetOpcode() == D3D10_SB_OPCODE_RET)
+//				...
+//		}
+//
+//	Instructions are views (pointer to the opcode token and the end of the stream), nothing is decoded until
+//	asked for: opcode type, length (custom data blocks keep it in their second DWORD), extended opcode tokens
+//	and operands, all read through the DECODE_* macros. Everything is inline, so a loop over the range compiles
+//	to the same code as a hand-written one.
+//
+//	Lengths follow the patcher: never less than one DWORD (so iteration always makes progress) and the last
+//	instruction may claim more DWORDs than the stream has left (IsTruncated tells, iteration still ends there).
+//================================================================================================================
+
+#ifndef DXBC_INSTRUCTION_H
+#define DXBC_INSTRUCTION_H
+
+#include "Patcher.h"
+#include "DXBCOpcodeInfo.h"
+
+// Length (in DWORDs) of operand at pOperand, together with its extended tokens, indices (and their relative
+// operands) and immediate values. 0 when it runs past pEnd.
+static inline unsigned int GetDXBCOperandLength(const DWORD *pOperand, const DWORD *pEnd)
+{
+	const DWORD* p = pOperand;
+
+	if(p >= pEnd)
+		return 0;
+
+	DWORD token = *p++;
+
+	// Extended operand tokens can chain
+	if(DECODE_IS_D3D10_SB_OPERAND_EXTENDED(token))
+	{
+		do
+		{
+			if(p >= pEnd)
+				return 0;
+		}
+		while(DECODE_IS_D3D10_SB_OPERAND_DOUBLE_EXTENDED(*p++));
+	}
+
+	D3D10_SB_OPERAND_TYPE type = DECODE_D3D10_SB_OPERAND_TYPE(token);
+	bool hasFourComponents = (DECODE_D3D10_SB_OPERAND_NUM_COMPONENTS(token) == D3D10_SB_OPERAND_4_COMPONENT);
+
+	if(type == D3D10_SB_OPERAND_TYPE_IMMEDIATE32)
+	{
+		p += hasFourComponents ? 4 : 1;
+	}
+	else if(type == D3D10_SB_OPERAND_TYPE_IMMEDIATE64)
+	{
+		// Four components hold two doubles
+		p += hasFourComponents ? 4 : 2;
+	}
+	else
+	{
+		for(unsigned int i = 0; i < DECODE_D3D10_SB_OPERAND_INDEX_DIMENSION(token); i++)
+		{
+			D3D10_SB_OPERAND_INDEX_REPRESENTATION representation = DECODE_D3D10_SB_OPERAND_INDEX_REPRESENTATION(i, token);
+
+			// Immediate part first, then the operand holding the relative part
+			if(representation == D3D10_SB_OPERAND_INDEX_IMMEDIATE32 || representation == D3D10_SB_OPERAND_INDEX_IMMEDIATE32_PLUS_RELATIVE)
+				p += 1;
+			else if(representation == D3D10_SB_OPERAND_INDEX_IMMEDIATE64 || representation == D3D10_SB_OPERAND_INDEX_IMMEDIATE64_PLUS_RELATIVE)
+				p += 2;
+			else if(representation != D3D10_SB_OPERAND_INDEX_RELATIVE)
+				return 0;
+
+			if(representation >= D3D10_SB_OPERAND_INDEX_RELATIVE)
+			{
+				unsigned int relativeLength = GetDXBCOperandLength(p, pEnd);
+
+				if(!relativeLength)
+					return 0;
+
+				p += relativeLength;
+			}
+		}
+	}
+
+	return (p <= pEnd) ? (unsigned int)(p - pOperand) : 0;
+}
+
+// Operands of a single instruction, stepped over one by one
+struct DXBCOperandCursor
+{
+	const DWORD*	pToken;				// Current operand token
+	const DWORD*	pEnd;				// End of instruction
+
+	bool IsEnd() const { return pToken >= pEnd; }
+
+	// Length of the current operand, 0 when it is broken
+	unsigned int GetLength() const { return GetDXBCOperandLength(pToken, pEnd); }
+
+	// Moves to the next operand. A broken operand ends the cursor (and returns false).
+	bool Next()
+	{
+		unsigned int length = GetLength();
+
+		pToken = length ? pToken + length : pEnd;
+		return length != 0;
+	}
+};
+
+// Single instruction of an opcode stream
+struct DXBCInstruction
+{
+	const DWORD*	pToken;				// Opcode token
+	const DWORD*	pStreamEnd;			// End of the opcode stream
+
+	D3D10_SB_OPCODE_TYPE	GetOpcode() const		{ return DECODE_D3D10_SB_OPCODE_TYPE(pToken[0]); }
+	const DXBCOpcodeInfo&	GetInfo() const			{ return GetDXBCOpcodeInfo(GetOpcode()); }
+	bool					IsCustomData() const	{ return GetOpcode() == D3D10_SB_OPCODE_CUSTOMDATA; }
+	bool					IsExtended() const		{ return !IsCustomData() && DECODE_IS_D3D10_SB_OPCODE_EXTENDED(pToken[0]); }
+
+	// Length in DWORDs, never less than one. Custom data blocks keep it in their second DWORD.
+	unsigned int GetLength() const
+	{
+		DWORD length;
+
+		if(IsCustomData())
+			length = (pStreamEnd - pToken > 1) ? pToken[1] : 1;
+		else
+			length = DECODE_D3D10_SB_TOKENIZED_INSTRUCTION_LENGTH(pToken[0]);
+
+		return (length > 1) ? length : 1;
+	}
+
+	// Instruction claims more DWORDs than the stream has left
+	bool IsTruncated() const { return GetLength() > (unsigned int)(pStreamEnd - pToken); }
+
+	// End of instruction, never past the end of the stream
+	const DWORD* GetEnd() const
+	{
+		unsigned int length = GetLength();
+
+		return (length < (unsigned int)(pStreamEnd - pToken)) ? pToken + length : pStreamEnd;
+	}
+
+	// Extended opcode tokens follow the opcode token, each one says whether another one follows
+	unsigned int GetExtendedCount() const
+	{
+		const DWORD* pEnd = GetEnd();
+		const DWORD* p = pToken;
+
+		if(!IsExtended())
+			return 0;
+
+		while(p + 1 < pEnd && DECODE_IS_D3D10_SB_OPCODE_EXTENDED(*p))
+			p++;
+
+		return (unsigned int)(p - pToken);
+	}
+
+	// Extended token of the given type (D3D10_SB_EXTENDED_OPCODE_SAMPLE_CONTROLS and such)
+	bool FindExtended(D3D10_SB_EXTENDED_OPCODE_TYPE inType, DWORD *pExtendedToken) const
+	{
+		for(unsigned int i = 1; i <= GetExtendedCount(); i++)
+		{
+			if(DECODE_D3D10_SB_EXTENDED_OPCODE_TYPE(pToken[i]) == inType)
+			{
+				*pExtendedToken = pToken[i];
+				return true;
+			}
+		}
+
+		return false;
+	}
+
+	// Operands (right after the extended tokens). Declarations and custom data have their own layouts, the
+	// cursor just starts after their opcode token.
+	DXBCOperandCursor GetOperands() const
+	{
+		DXBCOperandCursor cursor = { pToken + 1 + GetExtendedCount(), GetEnd() };
+		return cursor;
+	}
+};
+
+class DXBCInstructionIterator
+{
+public:
+	DXBCInstructionIterator(const DWORD *pToken, const DWORD *pStreamEnd) : m_pToken(pToken), m_pStreamEnd(pStreamEnd) {}
+
+	DXBCInstruction operator*() const
+	{
+		DXBCInstruction instruction = { m_pToken, m_pStreamEnd };
+		return instruction;
+	}
+
+	DXBCInstructionIterator& operator++()
+	{
+		m_pToken = (**this).GetEnd();
+		return *this;
+	}
+
+	bool operator==(const DXBCInstructionIterator &other) const { return m_pToken == other.m_pToken; }
+	bool operator!=(const DXBCInstructionIterator &other) const { return m_pToken != other.m_pToken; }
+
+	const DWORD* GetToken() const { return m_pToken; }
+
+private:
+	const DWORD*	m_pToken;
+	const DWORD*	m_pStreamEnd;
+};
+
+struct DXBCInstructionRange
+{
+	const DWORD*	pBegin;
+	const DWORD*	pEnd;
+
+	DXBCInstructionIterator begin() const	{ return DXBCInstructionIterator(pBegin, pEnd); }
+	DXBCInstructionIterator end() const		{ return DXBCInstructionIterator(pEnd, pEnd); }
+};
+
+static inline DXBCInstructionRange IterateDXBCInstructions(const DWORD *pOpcodes, unsigned int inNumDWORDs)
+{
+	DXBCInstructionRange range = { pOpcodes, pOpcodes + inNumDWORDs };
+	return range;
+}
+
+static inline DXBCInstructionRange IterateDXBCInstructions(const DXBCLayout &layout)
+{
+	return IterateDXBCInstructions(layout.pOpcodes, layout.opcodeDWORDs);
+}
+
+#endif // DXBC_INSTRUCTION_H
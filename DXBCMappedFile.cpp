@@ -0,0 +1,165 @@
+//================================================================================================================
+// Include files
+//================================================================================================================
+#include "DXBCMappedFile.h"
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif // _WIN32
+
+
+
+
+
+//================================================================================================================
+// Function definitions
+//================================================================================================================
+// Empty files can't be mapped, so they are represented by a non-null pointer to nothing.
+static BYTE s_emptyFile[1];
+
+DXBCMappedFile::DXBCMappedFile() : m_pData(NULL), m_size(0)
+{
+}
+
+DXBCMappedFile::~DXBCMappedFile()
+{
+	Close();
+}
+
+bool DXBCMappedFile::OpenRead(const char *pPath)
+{
+	return Map(pPath, 0, false);
+}
+
+bool DXBCMappedFile::CreateWrite(const char *pPath, unsigned int inSize)
+{
+	return Map(pPath, inSize, true);
+}
+
+#ifdef _WIN32
+bool DXBCMappedFile::Map(const char *pPath, unsigned int inSize, bool inWrite)
+{
+	Close();
+
+	// Files mapped read-only may be open for writing elsewhere (the disk cache appends to the file it maps),
+	// so writers are shared with too
+	HANDLE hFile = CreateFileA(	pPath,
+								inWrite ? (GENERIC_READ | GENERIC_WRITE) : GENERIC_READ,
+								inWrite ? 0 : (FILE_SHARE_READ | FILE_SHARE_WRITE),
+								NULL,
+								inWrite ? CREATE_ALWAYS : OPEN_EXISTING,
+								FILE_ATTRIBUTE_NORMAL,
+								NULL);
+
+	if(hFile == INVALID_HANDLE_VALUE)
+		return false;
+
+	if(!inWrite)
+	{
+		LARGE_INTEGER fileSize;
+
+		if(!GetFileSizeEx(hFile, &fileSize) || fileSize.QuadPart > 0xFFFFFFFF)
+		{
+			CloseHandle(hFile);
+			return false;
+		}
+
+		inSize = (unsigned int)fileSize.QuadPart;
+	}
+
+	if(inSize == 0)
+	{
+		CloseHandle(hFile);
+		m_pData = s_emptyFile;
+		return true;
+	}
+
+	// Mapping a writable file to a size also extends the file to it. Both handles can be closed right away,
+	// the view keeps the mapping alive.
+	HANDLE hMapping = CreateFileMappingA(hFile, NULL, inWrite ? PAGE_READWRITE : PAGE_READONLY, 0, inSize, NULL);
+	CloseHandle(hFile);
+
+	if(!hMapping)
+		return false;
+
+	m_pData = (BYTE*)MapViewOfFile(hMapping, inWrite ? FILE_MAP_WRITE : FILE_MAP_READ, 0, 0, inSize);
+	CloseHandle(hMapping);
+
+	if(!m_pData)
+		return false;
+
+	m_size = inSize;
+	return true;
+}
+
+void DXBCMappedFile::Close()
+{
+	if(m_pData && m_pData != s_emptyFile)
+		UnmapViewOfFile(m_pData);
+
+	m_pData = NULL;
+	m_size = 0;
+}
+#else
+bool DXBCMappedFile::Map(const char *pPath, unsigned int inSize, bool inWrite)
+{
+	Close();
+
+	int file = inWrite ? open(pPath, O_RDWR | O_CREAT | O_TRUNC, 0666) : open(pPath, O_RDONLY);
+
+	if(file < 0)
+		return false;
+
+	if(inWrite)
+	{
+		if(ftruncate(file, inSize) != 0)
+		{
+			close(file);
+			return false;
+		}
+	}
+	else
+	{
+		struct stat fileStat;
+
+		if(fstat(file, &fileStat) != 0 || fileStat.st_size > 0xFFFFFFFF)
+		{
+			close(file);
+			return false;
+		}
+
+		inSize = (unsigned int)fileStat.st_size;
+	}
+
+	if(inSize == 0)
+	{
+		close(file);
+		m_pData = s_emptyFile;
+		return true;
+	}
+
+	// Descriptor can be closed right away, the mapping keeps the file alive. That way thousands of files can be
+	// mapped at once without running out of descriptors.
+	void* pData = mmap(NULL, inSize, inWrite ? (PROT_READ | PROT_WRITE) : PROT_READ, MAP_SHARED, file, 0);
+	close(file);
+
+	if(pData == MAP_FAILED)
+		return false;
+
+	m_pData = (BYTE*)pData;
+	m_size = inSize;
+	return true;
+}
+
+void DXBCMappedFile::Close()
+{
+	if(m_pData && m_pData != s_emptyFile)
+		munmap(m_pData, m_size);
+
+	m_pData = NULL;
+	m_size = 0;
+}
+#endif // _WIN32
@@ -0,0 +1,41 @@
+// Author: Henryk Kosobucki, 2016
+
+//=============================================	OVERVIEW =========================================================
+//	Memory mapped files, so shaders can be patched straight from the file cache into the output file without
+//	reading them into (or writing them from) intermediate heap buffers.
+//================================================================================================================
+
+#ifndef DXBC_MAPPED_FILE_H
+#define DXBC_MAPPED_FILE_H
+
+#include "DXBCPlatform.h"
+
+class DXBCMappedFile
+{
+public:
+	DXBCMappedFile();
+	~DXBCMappedFile();
+
+	// Maps existing file read-only, others may still open it for writing (appends past the mapped size stay unseen)
+	bool				OpenRead(const char *pPath);
+
+	// Creates (or truncates) file of exactly inSize bytes and maps it writable. Content written to the mapping
+	// ends up in the file once it is closed.
+	bool				CreateWrite(const char *pPath, unsigned int inSize);
+
+	void				Close();
+
+	BYTE*				GetData() const { return m_pData; }
+	unsigned int		GetSize() const { return m_size; }
+
+private:
+	DXBCMappedFile(const DXBCMappedFile&);
+	DXBCMappedFile& operator=(const DXBCMappedFile&);
+
+	bool				Map(const char *pPath, unsigned int inSize, bool inWrite);
+
+	BYTE*				m_pData;
+	unsigned int		m_size;
+};
+
+#endif // DXBC_MAPPED_FILE_H
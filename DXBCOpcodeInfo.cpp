@@ -0,0 +1,133 @@
+//================================================================================================================
+// Include files
+//================================================================================================================
+#include "DXBCOpcodeInfo.h"
+#include <algorithm>
+#include <string.h>
+#include <vector>
+
+
+
+
+
+//================================================================================================================
+// Structures
+//================================================================================================================
+// Perfect hash of the mnemonics. Hash of the word picks a bucket, displacement of the bucket moves its mnemonics
+// into slots no other mnemonic uses, so every word is either in its single slot or not known at all.
+#define DXBC_MNEMONIC_BUCKET_BITS	6
+#define DXBC_MNEMONIC_SLOTS			512
+
+struct DXBCMnemonicTable
+{
+	DWORD				displacements[1 << DXBC_MNEMONIC_BUCKET_BITS];
+	short				opcodes[DXBC_MNEMONIC_SLOTS];		// -1 in unused slots
+};
+
+
+
+
+
+//================================================================================================================
+// Function definitions
+//================================================================================================================
+static DWORD HashMnemonic(const char *pName, size_t inLength)
+{
+	DWORD hash = 2166136261u;
+
+	for(size_t i = 0; i < inLength; i++)
+		hash = (hash ^ (BYTE)pName[i]) * 16777619u;
+
+	return hash;
+}
+
+static unsigned int GetMnemonicBucket(DWORD inHash)
+{
+	return inHash >> (32 - DXBC_MNEMONIC_BUCKET_BITS);
+}
+
+static unsigned int GetMnemonicSlot(DWORD inHash, DWORD inDisplacement)
+{
+	DWORD hash = inHash ^ (inDisplacement * 0x9e3779b9u);
+
+	hash ^= hash >> 16;
+	hash *= 0x85ebca6bu;
+	hash ^= hash >> 13;
+
+	return hash & (DXBC_MNEMONIC_SLOTS - 1);
+}
+
+// Places buckets with most mnemonics first (while most slots are free) and searches for displacement of every
+// bucket that puts all its mnemonics into free slots. A quarter of the slots stays free at the end, so each bucket
+// needs a few tries at most.
+static DXBCMnemonicTable BuildMnemonicTable()
+{
+	DXBCMnemonicTable table;
+	DWORD hashes[D3D10_SB_NUM_OPCODES];
+	std::vector<unsigned int> buckets[1 << DXBC_MNEMONIC_BUCKET_BITS];
+	unsigned int bucketOrder[1 << DXBC_MNEMONIC_BUCKET_BITS];
+
+	memset(table.displacements, 0, sizeof(table.displacements));
+	memset(table.opcodes, 0xff, sizeof(table.opcodes));
+
+	for(unsigned int opcode = 0; opcode < D3D10_SB_NUM_OPCODES; opcode++)
+	{
+		const char* pName = s_opcodeInfos[opcode].pName;
+
+		hashes[opcode] = HashMnemonic(pName, strlen(pName));
+		buckets[GetMnemonicBucket(hashes[opcode])].push_back(opcode);
+	}
+
+	for(unsigned int i = 0; i < (1 << DXBC_MNEMONIC_BUCKET_BITS); i++)
+		bucketOrder[i] = i;
+
+	std::stable_sort(bucketOrder, bucketOrder + (1 << DXBC_MNEMONIC_BUCKET_BITS), [&buckets](unsigned int a, unsigned int b) { return buckets[a].size() > buckets[b].size(); });
+
+	std::vector<unsigned int> slots;
+
+	for(unsigned int i = 0; i < (1 << DXBC_MNEMONIC_BUCKET_BITS) && !buckets[bucketOrder[i]].empty(); i++)
+	{
+		const std::vector<unsigned int> &bucket = buckets[bucketOrder[i]];
+
+		for(DWORD displacement = 0; ; displacement++)
+		{
+			slots.clear();
+
+			for(size_t j = 0; j < bucket.size(); j++)
+			{
+				unsigned int slot = GetMnemonicSlot(hashes[bucket[j]], displacement);
+
+				if(table.opcodes[slot] >= 0 || std::find(slots.begin(), slots.end(), slot) != slots.end())
+					break;
+
+				slots.push_back(slot);
+			}
+
+			if(slots.size() == bucket.size())
+			{
+				for(size_t j = 0; j < bucket.size(); j++)
+					table.opcodes[slots[j]] = (short)bucket[j];
+
+				table.displacements[bucketOrder[i]] = displacement;
+				break;
+			}
+		}
+	}
+
+	return table;
+}
+
+int FindDXBCOpcode(const char *pName, size_t inLength)
+{
+	static const DXBCMnemonicTable s_mnemonicTable = BuildMnemonicTable();
+
+	DWORD hash = HashMnemonic(pName, inLength);
+	int opcode = s_mnemonicTable.opcodes[GetMnemonicSlot(hash, s_mnemonicTable.displacements[GetMnemonicBucket(hash)])];
+
+	if(opcode < 0)
+		return -1;
+
+	const char* pMnemonic = s_opcodeInfos[opcode].pName;
+
+	return (strncmp(pMnemonic, pName, inLength) == 0 && pMnemonic[inLength] == 0) ? opcode : -1;
+}
@@ -0,0 +1,283 @@
+// Author: Henryk Kosobucki, 2016
+
+//=============================================	OVERVIEW =========================================================
+//	Properties of every SM4/SM5 opcode, kept in one constexpr table indexed by D3D10_SB_OPCODE_TYPE: mnemonic,
+//	category, operand layout (number of operands and how many of the leading ones are written) and memory
+//	access. Disassembler, assembler, builder and analysis passes all take opcode properties from here instead of
+//	keeping their own switches.
+//
+//	GetDXBCOpcodeInfo is a single array access and works in constant expressions. FindDXBCOpcode goes the other
+//	way, from mnemonic to opcode, through a perfect hash (one hash of the name and a single string compare).
+//================================================================================================================
+
+#ifndef DXBC_OPCODE_INFO_H
+#define DXBC_OPCODE_INFO_H
+
+#include <stddef.h>
+#include "DXBCPlatform.h"
+#include "d3d11TokenizedProgramFormat.hpp"
+
+enum DXBCOpcodeCategory
+{
+	DXBC_OPCODE_CATEGORY_DECLARATION = 0,	// dcl_* (immediate constant buffers are custom data)
+	DXBC_OPCODE_CATEGORY_ALU,				// Arithmetic, bit operations, conversions, derivatives, interpolation
+	DXBC_OPCODE_CATEGORY_FLOW,				// Branches, loops, switches, calls and hull shader phases
+	DXBC_OPCODE_CATEGORY_SAMPLE,			// Texture loads, samples, gathers and resource queries
+	DXBC_OPCODE_CATEGORY_MEMORY,			// UAV and shared memory loads and stores, sync
+	DXBC_OPCODE_CATEGORY_ATOMIC,			// Atomic operations (with or without returned value)
+	DXBC_OPCODE_CATEGORY_OTHER,				// Custom data, stream output (emit, cut), nop and reserved opcodes
+};
+
+enum DXBCOpcodeFlags
+{
+	DXBC_OPCODE_READS_MEMORY	= 0x1,		// Reads texture, buffer, UAV or shared memory
+	DXBC_OPCODE_WRITES_MEMORY	= 0x2,		// Writes UAV or shared memory
+	DXBC_OPCODE_TEST_BOOLEAN	= 0x4,		// Takes _z / _nz test of its first operand
+};
+
+struct DXBCOpcodeInfo
+{
+	const char*			pName;				// Mnemonic as used in disassembly, e.g. "dcl_temps"
+	DXBCOpcodeCategory	category;
+	BYTE				operandCount;		// Operand tokens of the instruction (fcall has function index besides)
+	BYTE				destinationCount;	// Leading operands written by the instruction, they take write masks
+	BYTE				flags;				// DXBCOpcodeFlags
+};
+
+// Name, category, operands, destinations, flags
+static constexpr DXBCOpcodeInfo s_opcodeInfos[] =
+{
+	{ "add",							DXBC_OPCODE_CATEGORY_ALU,			3, 1,	0 },
+	{ "and",							DXBC_OPCODE_CATEGORY_ALU,			3, 1,	0 },
+	{ "break",							DXBC_OPCODE_CATEGORY_FLOW,			0, 0,	0 },
+	{ "breakc",							DXBC_OPCODE_CATEGORY_FLOW,			1, 0,	DXBC_OPCODE_TEST_BOOLEAN },
+	{ "call",							DXBC_OPCODE_CATEGORY_FLOW,			1, 0,	0 },
+	{ "callc",							DXBC_OPCODE_CATEGORY_FLOW,			2, 0,	DXBC_OPCODE_TEST_BOOLEAN },
+	{ "case",							DXBC_OPCODE_CATEGORY_FLOW,			1, 0,	0 },
+	{ "continue",						DXBC_OPCODE_CATEGORY_FLOW,			0, 0,	0 },
+	{ "continuec",						DXBC_OPCODE_CATEGORY_FLOW,			1, 0,	DXBC_OPCODE_TEST_BOOLEAN },
+	{ "cut",							DXBC_OPCODE_CATEGORY_OTHER,			0, 0,	0 },
+	{ "default",						DXBC_OPCODE_CATEGORY_FLOW,			0, 0,	0 },
+	{ "deriv_rtx",						DXBC_OPCODE_CATEGORY_ALU,			2, 1,	0 },
+	{ "deriv_rty",						DXBC_OPCODE_CATEGORY_ALU,			2, 1,	0 },
+	{ "discard",						DXBC_OPCODE_CATEGORY_FLOW,			1, 0,	DXBC_OPCODE_TEST_BOOLEAN },
+	{ "div",							DXBC_OPCODE_CATEGORY_ALU,			3, 1,	0 },
+	{ "dp2",							DXBC_OPCODE_CATEGORY_ALU,			3, 1,	0 },
+	{ "dp3",							DXBC_OPCODE_CATEGORY_ALU,			3, 1,	0 },
+	{ "dp4",							DXBC_OPCODE_CATEGORY_ALU,			3, 1,	0 },
+	{ "else",							DXBC_OPCODE_CATEGORY_FLOW,			0, 0,	0 },
+	{ "emit",							DXBC_OPCODE_CATEGORY_OTHER,			0, 0,	0 },
+	{ "emit_then_cut",					DXBC_OPCODE_CATEGORY_OTHER,			0, 0,	0 },
+	{ "endif",							DXBC_OPCODE_CATEGORY_FLOW,			0, 0,	0 },
+	{ "endloop",						DXBC_OPCODE_CATEGORY_FLOW,			0, 0,	0 },
+	{ "endswitch",						DXBC_OPCODE_CATEGORY_FLOW,			0, 0,	0 },
+	{ "eq",								DXBC_OPCODE_CATEGORY_ALU,			3, 1,	0 },
+	{ "exp",							DXBC_OPCODE_CATEGORY_ALU,			2, 1,	0 },
+	{ "frc",							DXBC_OPCODE_CATEGORY_ALU,			2, 1,	0 },
+	{ "ftoi",							DXBC_OPCODE_CATEGORY_ALU,			2, 1,	0 },
+	{ "ftou",							DXBC_OPCODE_CATEGORY_ALU,			2, 1,	0 },
+	{ "ge",								DXBC_OPCODE_CATEGORY_ALU,			3, 1,	0 },
+	{ "iadd",							DXBC_OPCODE_CATEGORY_ALU,			3, 1,	0 },
+	{ "if",								DXBC_OPCODE_CATEGORY_FLOW,			1, 0,	DXBC_OPCODE_TEST_BOOLEAN },
+	{ "ieq",							DXBC_OPCODE_CATEGORY_ALU,			3, 1,	0 },
+	{ "ige",							DXBC_OPCODE_CATEGORY_ALU,			3, 1,	0 },
+	{ "ilt",							DXBC_OPCODE_CATEGORY_ALU,			3, 1,	0 },
+	{ "imad",							DXBC_OPCODE_CATEGORY_ALU,			4, 1,	0 },
+	{ "imax",							DXBC_OPCODE_CATEGORY_ALU,			3, 1,	0 },
+	{ "imin",							DXBC_OPCODE_CATEGORY_ALU,			3, 1,	0 },
+	{ "imul",							DXBC_OPCODE_CATEGORY_ALU,			4, 2,	0 },
+	{ "ine",							DXBC_OPCODE_CATEGORY_ALU,			3, 1,	0 },
+	{ "ineg",							DXBC_OPCODE_CATEGORY_ALU,			2, 1,	0 },
+	{ "ishl",							DXBC_OPCODE_CATEGORY_ALU,			3, 1,	0 },
+	{ "ishr",							DXBC_OPCODE_CATEGORY_ALU,			3, 1,	0 },
+	{ "itof",							DXBC_OPCODE_CATEGORY_ALU,			2, 1,	0 },
+	{ "label",							DXBC_OPCODE_CATEGORY_FLOW,			1, 0,	0 },
+	{ "ld",								DXBC_OPCODE_CATEGORY_SAMPLE,		3, 1,	DXBC_OPCODE_READS_MEMORY },
+	{ "ld_ms",							DXBC_OPCODE_CATEGORY_SAMPLE,		4, 1,	DXBC_OPCODE_READS_MEMORY },
+	{ "log",							DXBC_OPCODE_CATEGORY_ALU,			2, 1,	0 },
+	{ "loop",							DXBC_OPCODE_CATEGORY_FLOW,			0, 0,	0 },
+	{ "lt",								DXBC_OPCODE_CATEGORY_ALU,			3, 1,	0 },
+	{ "mad",							DXBC_OPCODE_CATEGORY_ALU,			4, 1,	0 },
+	{ "min",							DXBC_OPCODE_CATEGORY_ALU,			3, 1,	0 },
+	{ "max",							DXBC_OPCODE_CATEGORY_ALU,			3, 1,	0 },
+	{ "customdata",						DXBC_OPCODE_CATEGORY_OTHER,			0, 0,	0 },
+	{ "mov",							DXBC_OPCODE_CATEGORY_ALU,			2, 1,	0 },
+	{ "movc",							DXBC_OPCODE_CATEGORY_ALU,			4, 1,	0 },
+	{ "mul",							DXBC_OPCODE_CATEGORY_ALU,			3, 1,	0 },
+	{ "ne",								DXBC_OPCODE_CATEGORY_ALU,			3, 1,	0 },
+	{ "nop",							DXBC_OPCODE_CATEGORY_OTHER,			0, 0,	0 },
+	{ "not",							DXBC_OPCODE_CATEGORY_ALU,			2, 1,	0 },
+	{ "or",								DXBC_OPCODE_CATEGORY_ALU,			3, 1,	0 },
+	{ "resinfo",						DXBC_OPCODE_CATEGORY_SAMPLE,		3, 1,	0 },
+	{ "ret",							DXBC_OPCODE_CATEGORY_FLOW,			0, 0,	0 },
+	{ "retc",							DXBC_OPCODE_CATEGORY_FLOW,			1, 0,	DXBC_OPCODE_TEST_BOOLEAN },
+	{ "round_ne",						DXBC_OPCODE_CATEGORY_ALU,			2, 1,	0 },
+	{ "round_ni",						DXBC_OPCODE_CATEGORY_ALU,			2, 1,	0 },
+	{ "round_pi",						DXBC_OPCODE_CATEGORY_ALU,			2, 1,	0 },
+	{ "round_z",						DXBC_OPCODE_CATEGORY_ALU,			2, 1,	0 },
+	{ "rsq",							DXBC_OPCODE_CATEGORY_ALU,			2, 1,	0 },
+	{ "sample",							DXBC_OPCODE_CATEGORY_SAMPLE,		4, 1,	DXBC_OPCODE_READS_MEMORY },
+	{ "sample_c",						DXBC_OPCODE_CATEGORY_SAMPLE,		5, 1,	DXBC_OPCODE_READS_MEMORY },
+	{ "sample_c_lz",					DXBC_OPCODE_CATEGORY_SAMPLE,		5, 1,	DXBC_OPCODE_READS_MEMORY },
+	{ "sample_l",						DXBC_OPCODE_CATEGORY_SAMPLE,		5, 1,	DXBC_OPCODE_READS_MEMORY },
+	{ "sample_d",						DXBC_OPCODE_CATEGORY_SAMPLE,		6, 1,	DXBC_OPCODE_READS_MEMORY },
+	{ "sample_b",						DXBC_OPCODE_CATEGORY_SAMPLE,		5, 1,	DXBC_OPCODE_READS_MEMORY },
+	{ "sqrt",							DXBC_OPCODE_CATEGORY_ALU,			2, 1,	0 },
+	{ "switch",							DXBC_OPCODE_CATEGORY_FLOW,			1, 0,	0 },
+	{ "sincos",							DXBC_OPCODE_CATEGORY_ALU,			3, 2,	0 },
+	{ "udiv",							DXBC_OPCODE_CATEGORY_ALU,			4, 2,	0 },
+	{ "ult",							DXBC_OPCODE_CATEGORY_ALU,			3, 1,	0 },
+	{ "uge",							DXBC_OPCODE_CATEGORY_ALU,			3, 1,	0 },
+	{ "umul",							DXBC_OPCODE_CATEGORY_ALU,			4, 2,	0 },
+	{ "umad",							DXBC_OPCODE_CATEGORY_ALU,			4, 1,	0 },
+	{ "umax",							DXBC_OPCODE_CATEGORY_ALU,			3, 1,	0 },
+	{ "umin",							DXBC_OPCODE_CATEGORY_ALU,			3, 1,	0 },
+	{ "ushr",							DXBC_OPCODE_CATEGORY_ALU,			3, 1,	0 },
+	{ "utof",							DXBC_OPCODE_CATEGORY_ALU,			2, 1,	0 },
+	{ "xor",							DXBC_OPCODE_CATEGORY_ALU,			3, 1,	0 },
+
+	{ "dcl_resource",					DXBC_OPCODE_CATEGORY_DECLARATION,	1, 0,	0 },
+	{ "dcl_constantbuffer",				DXBC_OPCODE_CATEGORY_DECLARATION,	1, 0,	0 },
+	{ "dcl_sampler",					DXBC_OPCODE_CATEGORY_DECLARATION,	1, 0,	0 },
+	{ "dcl_indexrange",					DXBC_OPCODE_CATEGORY_DECLARATION,	1, 0,	0 },
+	{ "dcl_outputtopology",				DXBC_OPCODE_CATEGORY_DECLARATION,	0, 0,	0 },
+	{ "dcl_inputprimitive",				DXBC_OPCODE_CATEGORY_DECLARATION,	0, 0,	0 },
+	{ "dcl_maxout",						DXBC_OPCODE_CATEGORY_DECLARATION,	0, 0,	0 },
+	{ "dcl_input",						DXBC_OPCODE_CATEGORY_DECLARATION,	1, 0,	0 },
+	{ "dcl_input_sgv",					DXBC_OPCODE_CATEGORY_DECLARATION,	1, 0,	0 },
+	{ "dcl_input_siv",					DXBC_OPCODE_CATEGORY_DECLARATION,	1, 0,	0 },
+	{ "dcl_input_ps",					DXBC_OPCODE_CATEGORY_DECLARATION,	1, 0,	0 },
+	{ "dcl_input_ps_sgv",				DXBC_OPCODE_CATEGORY_DECLARATION,	1, 0,	0 },
+	{ "dcl_input_ps_siv",				DXBC_OPCODE_CATEGORY_DECLARATION,	1, 0,	0 },
+	{ "dcl_output",						DXBC_OPCODE_CATEGORY_DECLARATION,	1, 0,	0 },
+	{ "dcl_output_sgv",					DXBC_OPCODE_CATEGORY_DECLARATION,	1, 0,	0 },
+	{ "dcl_output_siv",					DXBC_OPCODE_CATEGORY_DECLARATION,	1, 0,	0 },
+	{ "dcl_temps",						DXBC_OPCODE_CATEGORY_DECLARATION,	0, 0,	0 },
+	{ "dcl_indexableTemp",				DXBC_OPCODE_CATEGORY_DECLARATION,	0, 0,	0 },
+	{ "dcl_globalFlags",				DXBC_OPCODE_CATEGORY_DECLARATION,	0, 0,	0 },
+
+	{ "reserved0",						DXBC_OPCODE_CATEGORY_OTHER,			0, 0,	0 },
+	{ "lod",							DXBC_OPCODE_CATEGORY_SAMPLE,		4, 1,	0 },
+	{ "gather4",						DXBC_OPCODE_CATEGORY_SAMPLE,		4, 1,	DXBC_OPCODE_READS_MEMORY },
+	{ "sample_pos",						DXBC_OPCODE_CATEGORY_SAMPLE,		3, 1,	0 },
+	{ "sample_info",					DXBC_OPCODE_CATEGORY_SAMPLE,		2, 1,	0 },
+	{ "reserved1",						DXBC_OPCODE_CATEGORY_OTHER,			0, 0,	0 },
+
+	{ "hs_decls",						DXBC_OPCODE_CATEGORY_FLOW,			0, 0,	0 },
+	{ "hs_control_point_phase",			DXBC_OPCODE_CATEGORY_FLOW,			0, 0,	0 },
+	{ "hs_fork_phase",					DXBC_OPCODE_CATEGORY_FLOW,			0, 0,	0 },
+	{ "hs_join_phase",					DXBC_OPCODE_CATEGORY_FLOW,			0, 0,	0 },
+	{ "emit_stream",					DXBC_OPCODE_CATEGORY_OTHER,			1, 0,	0 },
+	{ "cut_stream",						DXBC_OPCODE_CATEGORY_OTHER,			1, 0,	0 },
+	{ "emit_then_cut_stream",			DXBC_OPCODE_CATEGORY_OTHER,			1, 0,	0 },
+	{ "fcall",							DXBC_OPCODE_CATEGORY_FLOW,			1, 0,	0 },
+	{ "bufinfo",						DXBC_OPCODE_CATEGORY_SAMPLE,		2, 1,	0 },
+	{ "deriv_rtx_coarse",				DXBC_OPCODE_CATEGORY_ALU,			2, 1,	0 },
+	{ "deriv_rtx_fine",					DXBC_OPCODE_CATEGORY_ALU,			2, 1,	0 },
+	{ "deriv_rty_coarse",				DXBC_OPCODE_CATEGORY_ALU,			2, 1,	0 },
+	{ "deriv_rty_fine",					DXBC_OPCODE_CATEGORY_ALU,			2, 1,	0 },
+	{ "gather4_c",						DXBC_OPCODE_CATEGORY_SAMPLE,		5, 1,	DXBC_OPCODE_READS_MEMORY },
+	{ "gather4_po",						DXBC_OPCODE_CATEGORY_SAMPLE,		5, 1,	DXBC_OPCODE_READS_MEMORY },
+	{ "gather4_po_c",					DXBC_OPCODE_CATEGORY_SAMPLE,		6, 1,	DXBC_OPCODE_READS_MEMORY },
+	{ "rcp",							DXBC_OPCODE_CATEGORY_ALU,			2, 1,	0 },
+	{ "f32tof16",						DXBC_OPCODE_CATEGORY_ALU,			2, 1,	0 },
+	{ "f16tof32",						DXBC_OPCODE_CATEGORY_ALU,			2, 1,	0 },
+	{ "uaddc",							DXBC_OPCODE_CATEGORY_ALU,			4, 2,	0 },
+	{ "usubb",							DXBC_OPCODE_CATEGORY_ALU,			4, 2,	0 },
+	{ "countbits",						DXBC_OPCODE_CATEGORY_ALU,			2, 1,	0 },
+	{ "firstbit_hi",					DXBC_OPCODE_CATEGORY_ALU,			2, 1,	0 },
+	{ "firstbit_lo",					DXBC_OPCODE_CATEGORY_ALU,			2, 1,	0 },
+	{ "firstbit_shi",					DXBC_OPCODE_CATEGORY_ALU,			2, 1,	0 },
+	{ "ubfe",							DXBC_OPCODE_CATEGORY_ALU,			4, 1,	0 },
+	{ "ibfe",							DXBC_OPCODE_CATEGORY_ALU,			4, 1,	0 },
+	{ "bfi",							DXBC_OPCODE_CATEGORY_ALU,			5, 1,	0 },
+	{ "bfrev",							DXBC_OPCODE_CATEGORY_ALU,			2, 1,	0 },
+	{ "swapc",							DXBC_OPCODE_CATEGORY_ALU,			5, 2,	0 },
+
+	{ "dcl_stream",						DXBC_OPCODE_CATEGORY_DECLARATION,	1, 0,	0 },
+	{ "dcl_function_body",				DXBC_OPCODE_CATEGORY_DECLARATION,	0, 0,	0 },
+	{ "dcl_function_table",				DXBC_OPCODE_CATEGORY_DECLARATION,	0, 0,	0 },
+	{ "dcl_interface",					DXBC_OPCODE_CATEGORY_DECLARATION,	0, 0,	0 },
+	{ "dcl_input_control_point_count",	DXBC_OPCODE_CATEGORY_DECLARATION,	0, 0,	0 },
+	{ "dcl_output_control_point_count",	DXBC_OPCODE_CATEGORY_DECLARATION,	0, 0,	0 },
+	{ "dcl_tessellator_domain",			DXBC_OPCODE_CATEGORY_DECLARATION,	0, 0,	0 },
+	{ "dcl_tessellator_partitioning",	DXBC_OPCODE_CATEGORY_DECLARATION,	0, 0,	0 },
+	{ "dcl_tessellator_output_primitive",	DXBC_OPCODE_CATEGORY_DECLARATION,	0, 0,	0 },
+	{ "dcl_hs_max_tessfactor",			DXBC_OPCODE_CATEGORY_DECLARATION,	0, 0,	0 },
+	{ "dcl_hs_fork_phase_instance_count",	DXBC_OPCODE_CATEGORY_DECLARATION,	0, 0,	0 },
+	{ "dcl_hs_join_phase_instance_count",	DXBC_OPCODE_CATEGORY_DECLARATION,	0, 0,	0 },
+	{ "dcl_thread_group",				DXBC_OPCODE_CATEGORY_DECLARATION,	0, 0,	0 },
+	{ "dcl_uav_typed",					DXBC_OPCODE_CATEGORY_DECLARATION,	1, 0,	0 },
+	{ "dcl_uav_raw",					DXBC_OPCODE_CATEGORY_DECLARATION,	1, 0,	0 },
+	{ "dcl_uav_structured",				DXBC_OPCODE_CATEGORY_DECLARATION,	1, 0,	0 },
+	{ "dcl_tgsm_raw",					DXBC_OPCODE_CATEGORY_DECLARATION,	1, 0,	0 },
+	{ "dcl_tgsm_structured",			DXBC_OPCODE_CATEGORY_DECLARATION,	1, 0,	0 },
+	{ "dcl_resource_raw",				DXBC_OPCODE_CATEGORY_DECLARATION,	1, 0,	0 },
+	{ "dcl_resource_structured",		DXBC_OPCODE_CATEGORY_DECLARATION,	1, 0,	0 },
+
+	{ "ld_uav_typed",					DXBC_OPCODE_CATEGORY_MEMORY,		3, 1,	DXBC_OPCODE_READS_MEMORY },
+	{ "store_uav_typed",				DXBC_OPCODE_CATEGORY_MEMORY,		3, 1,	DXBC_OPCODE_WRITES_MEMORY },
+	{ "ld_raw",							DXBC_OPCODE_CATEGORY_MEMORY,		3, 1,	DXBC_OPCODE_READS_MEMORY },
+	{ "store_raw",						DXBC_OPCODE_CATEGORY_MEMORY,		3, 1,	DXBC_OPCODE_WRITES_MEMORY },
+	{ "ld_structured",					DXBC_OPCODE_CATEGORY_MEMORY,		4, 1,	DXBC_OPCODE_READS_MEMORY },
+	{ "store_structured",				DXBC_OPCODE_CATEGORY_MEMORY,		4, 1,	DXBC_OPCODE_WRITES_MEMORY },
+	{ "atomic_and",						DXBC_OPCODE_CATEGORY_ATOMIC,		3, 1,	DXBC_OPCODE_READS_MEMORY | DXBC_OPCODE_WRITES_MEMORY },
+	{ "atomic_or",						DXBC_OPCODE_CATEGORY_ATOMIC,		3, 1,	DXBC_OPCODE_READS_MEMORY | DXBC_OPCODE_WRITES_MEMORY },
+	{ "atomic_xor",						DXBC_OPCODE_CATEGORY_ATOMIC,		3, 1,	DXBC_OPCODE_READS_MEMORY | DXBC_OPCODE_WRITES_MEMORY },
+	{ "atomic_cmp_store",				DXBC_OPCODE_CATEGORY_ATOMIC,		4, 1,	DXBC_OPCODE_READS_MEMORY | DXBC_OPCODE_WRITES_MEMORY },
+	{ "atomic_iadd",					DXBC_OPCODE_CATEGORY_ATOMIC,		3, 1,	DXBC_OPCODE_READS_MEMORY | DXBC_OPCODE_WRITES_MEMORY },
+	{ "atomic_imax",					DXBC_OPCODE_CATEGORY_ATOMIC,		3, 1,	DXBC_OPCODE_READS_MEMORY | DXBC_OPCODE_WRITES_MEMORY },
+	{ "atomic_imin",					DXBC_OPCODE_CATEGORY_ATOMIC,		3, 1,	DXBC_OPCODE_READS_MEMORY | DXBC_OPCODE_WRITES_MEMORY },
+	{ "atomic_umax",					DXBC_OPCODE_CATEGORY_ATOMIC,		3, 1,	DXBC_OPCODE_READS_MEMORY | DXBC_OPCODE_WRITES_MEMORY },
+	{ "atomic_umin",					DXBC_OPCODE_CATEGORY_ATOMIC,		3, 1,	DXBC_OPCODE_READS_MEMORY | DXBC_OPCODE_WRITES_MEMORY },
+	{ "imm_atomic_alloc",				DXBC_OPCODE_CATEGORY_ATOMIC,		2, 2,	DXBC_OPCODE_READS_MEMORY | DXBC_OPCODE_WRITES_MEMORY },
+	{ "imm_atomic_consume",				DXBC_OPCODE_CATEGORY_ATOMIC,		2, 2,	DXBC_OPCODE_READS_MEMORY | DXBC_OPCODE_WRITES_MEMORY },
+	{ "imm_atomic_iadd",				DXBC_OPCODE_CATEGORY_ATOMIC,		4, 2,	DXBC_OPCODE_READS_MEMORY | DXBC_OPCODE_WRITES_MEMORY },
+	{ "imm_atomic_and",					DXBC_OPCODE_CATEGORY_ATOMIC,		4, 2,	DXBC_OPCODE_READS_MEMORY | DXBC_OPCODE_WRITES_MEMORY },
+	{ "imm_atomic_or",					DXBC_OPCODE_CATEGORY_ATOMIC,		4, 2,	DXBC_OPCODE_READS_MEMORY | DXBC_OPCODE_WRITES_MEMORY },
+	{ "imm_atomic_xor",					DXBC_OPCODE_CATEGORY_ATOMIC,		4, 2,	DXBC_OPCODE_READS_MEMORY | DXBC_OPCODE_WRITES_MEMORY },
+	{ "imm_atomic_exch",				DXBC_OPCODE_CATEGORY_ATOMIC,		4, 2,	DXBC_OPCODE_READS_MEMORY | DXBC_OPCODE_WRITES_MEMORY },
+	{ "imm_atomic_cmp_exch",			DXBC_OPCODE_CATEGORY_ATOMIC,		5, 2,	DXBC_OPCODE_READS_MEMORY | DXBC_OPCODE_WRITES_MEMORY },
+	{ "imm_atomic_imax",				DXBC_OPCODE_CATEGORY_ATOMIC,		4, 2,	DXBC_OPCODE_READS_MEMORY | DXBC_OPCODE_WRITES_MEMORY },
+	{ "imm_atomic_imin",				DXBC_OPCODE_CATEGORY_ATOMIC,		4, 2,	DXBC_OPCODE_READS_MEMORY | DXBC_OPCODE_WRITES_MEMORY },
+	{ "imm_atomic_umax",				DXBC_OPCODE_CATEGORY_ATOMIC,		4, 2,	DXBC_OPCODE_READS_MEMORY | DXBC_OPCODE_WRITES_MEMORY },
+	{ "imm_atomic_umin",				DXBC_OPCODE_CATEGORY_ATOMIC,		4, 2,	DXBC_OPCODE_READS_MEMORY | DXBC_OPCODE_WRITES_MEMORY },
+	{ "sync",							DXBC_OPCODE_CATEGORY_MEMORY,		0, 0,	0 },
+	{ "dadd",							DXBC_OPCODE_CATEGORY_ALU,			3, 1,	0 },
+	{ "dmax",							DXBC_OPCODE_CATEGORY_ALU,			3, 1,	0 },
+	{ "dmin",							DXBC_OPCODE_CATEGORY_ALU,			3, 1,	0 },
+	{ "dmul",							DXBC_OPCODE_CATEGORY_ALU,			3, 1,	0 },
+	{ "deq",							DXBC_OPCODE_CATEGORY_ALU,			3, 1,	0 },
+	{ "dge",							DXBC_OPCODE_CATEGORY_ALU,			3, 1,	0 },
+	{ "dlt",							DXBC_OPCODE_CATEGORY_ALU,			3, 1,	0 },
+	{ "dne",							DXBC_OPCODE_CATEGORY_ALU,			3, 1,	0 },
+	{ "dmov",							DXBC_OPCODE_CATEGORY_ALU,			2, 1,	0 },
+	{ "dmovc",							DXBC_OPCODE_CATEGORY_ALU,			4, 1,	0 },
+	{ "dtof",							DXBC_OPCODE_CATEGORY_ALU,			2, 1,	0 },
+	{ "ftod",							DXBC_OPCODE_CATEGORY_ALU,			2, 1,	0 },
+	{ "eval_snapped",					DXBC_OPCODE_CATEGORY_ALU,			3, 1,	0 },
+	{ "eval_sample_index",				DXBC_OPCODE_CATEGORY_ALU,			3, 1,	0 },
+	{ "eval_centroid",					DXBC_OPCODE_CATEGORY_ALU,			2, 1,	0 },
+
+	{ "dcl_gs_instance_count",			DXBC_OPCODE_CATEGORY_DECLARATION,	0, 0,	0 },
+};
+
+static_assert(sizeof(s_opcodeInfos) / sizeof(s_opcodeInfos[0]) == D3D10_SB_NUM_OPCODES, "Every opcode needs its info");
+
+static constexpr DXBCOpcodeInfo s_unknownOpcodeInfo = { "unknown", DXBC_OPCODE_CATEGORY_OTHER, 0, 0, 0 };
+
+// Info of the opcode (D3D10_SB_OPCODE_TYPE), opcodes past the known ones get "unknown"
+static constexpr const DXBCOpcodeInfo& GetDXBCOpcodeInfo(unsigned int inOpcode)
+{
+	return (inOpcode < D3D10_SB_NUM_OPCODES) ? s_opcodeInfos[inOpcode] : s_unknownOpcodeInfo;
+}
+
+static constexpr bool IsDXBCDeclaration(unsigned int inOpcode)
+{
+	return GetDXBCOpcodeInfo(inOpcode).category == DXBC_OPCODE_CATEGORY_DECLARATION;
+}
+
+// Opcode of the mnemonic (the exact name, without suffixes) or -1 if there is no such one
+int FindDXBCOpcode(const char *pName, size_t inLength);
+
+#endif // DXBC_OPCODE_INFO_H
@@ -0,0 +1,733 @@
+//================================================================================================================
+// Include files
+//================================================================================================================
+#include "DXBCPatchPipeline.h"
+#include "DXBCValidator.h"
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <thread>
+#include <vector>
+
+#ifndef _WIN32
+#include <errno.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif // _WIN32
+
+// io_uring is used whenever the kernel headers know about it
+#if defined(__linux__) && defined(__has_include)
+#if __has_include(<linux/io_uring.h>)
+#define DXBC_PIPELINE_IO_URING_SUPPORTED	1
+#endif
+#endif
+
+#ifndef DXBC_PIPELINE_IO_URING_SUPPORTED
+#define DXBC_PIPELINE_IO_URING_SUPPORTED	0
+#endif
+
+#if DXBC_PIPELINE_IO_URING_SUPPORTED
+#include <linux/io_uring.h>
+#include <sys/eventfd.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#endif // DXBC_PIPELINE_IO_URING_SUPPORTED
+
+
+
+
+
+//================================================================================================================
+// Macro definitions
+//================================================================================================================
+#define DXBC_PIPELINE_DEFAULT_IO_DEPTH		32
+
+
+
+
+
+//================================================================================================================
+// Function definitions
+//================================================================================================================
+// Patches file content read into input, output is resized to exactly fit the patched shader. Files are validated
+// first (see DXBCValidator.h), the patcher itself trusts the lengths in them.
+static void PatchFileData(DXBCPipelineJob &job, DXBCDocument &document, const std::vector<BYTE> &input, std::vector<BYTE> &output)
+{
+	job.status = ValidateDXBC(input.data(), (unsigned int)input.size(), NULL);
+
+	if(job.status == DXBC_PATCH_OK)
+		job.status = document.Parse(input.data(), (unsigned int)input.size());
+
+	if(job.status == DXBC_PATCH_OK)
+	{
+		output.resize(document.GetPatchedSize(job.opcodeStreamSize));
+		job.status = document.Patch(job.pOpcodeStream, job.opcodeStreamSize, job.insertBeforeOpcode, output.data(), (unsigned int)output.size(), NULL);
+	}
+}
+
+static unsigned int CountFailedJobs(const DXBCPipelineJob *pJobs, unsigned int inJobCount)
+{
+	unsigned int failedJobs = 0;
+
+	for(unsigned int i = 0; i < inJobCount; i++)
+	{
+		if(pJobs[i].ioFailed || pJobs[i].status != DXBC_PATCH_OK)
+			failedJobs++;
+	}
+
+	return failedJobs;
+}
+
+#ifdef _WIN32
+static bool ReadWholeFile(const char *pPath, std::vector<BYTE> &data)
+{
+	HANDLE hFile = CreateFileA(pPath, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, NULL);
+
+	if(hFile == INVALID_HANDLE_VALUE)
+		return false;
+
+	LARGE_INTEGER fileSize;
+	bool ok = GetFileSizeEx(hFile, &fileSize) && fileSize.QuadPart <= 0xFFFFFFFF;
+
+	if(ok)
+	{
+		data.resize((size_t)fileSize.QuadPart);
+
+		DWORD read = 0;
+		ok = data.empty() || (ReadFile(hFile, data.data(), (DWORD)data.size(), &read, NULL) && read == data.size());
+	}
+
+	CloseHandle(hFile);
+	return ok;
+}
+
+static bool WriteWholeFile(const char *pPath, const std::vector<BYTE> &data)
+{
+	HANDLE hFile = CreateFileA(pPath, GENERIC_WRITE, 0, NULL, CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL, NULL);
+
+	if(hFile == INVALID_HANDLE_VALUE)
+		return false;
+
+	DWORD written = 0;
+	bool ok = data.empty() || (WriteFile(hFile, data.data(), (DWORD)data.size(), &written, NULL) && written == data.size());
+
+	return CloseHandle(hFile) && ok;
+}
+#else
+static bool ReadWholeFile(const char *pPath, std::vector<BYTE> &data)
+{
+	int file = open(pPath, O_RDONLY | O_CLOEXEC);
+
+	if(file < 0)
+		return false;
+
+	struct stat fileStat;
+	bool ok = fstat(file, &fileStat) == 0 && fileStat.st_size <= 0xFFFFFFFF;
+	size_t done = 0;
+
+	if(ok)
+	{
+		data.resize((size_t)fileStat.st_size);
+
+		while(done < data.size())
+		{
+			ssize_t result = pread(file, data.data() + done, data.size() - done, done);
+
+			if(result < 0 && errno == EINTR)
+				continue;
+
+			if(result <= 0)
+				break;
+
+			done += result;
+		}
+	}
+
+	close(file);
+	return ok && done == data.size();
+}
+
+static bool WriteWholeFile(const char *pPath, const std::vector<BYTE> &data)
+{
+	int file = open(pPath, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0666);
+
+	if(file < 0)
+		return false;
+
+	size_t done = 0;
+
+	while(done < data.size())
+	{
+		ssize_t result = pwrite(file, data.data() + done, data.size() - done, done);
+
+		if(result < 0 && errno == EINTR)
+			continue;
+
+		if(result <= 0)
+			break;
+
+		done += result;
+	}
+
+	return (close(file) == 0) && done == data.size();
+}
+#endif // _WIN32
+
+// Fallback: every thread reads, patches and writes whole files, so ioDepth threads keep that many I/Os in flight
+static unsigned int RunThreadPipeline(DXBCPipelineJob *pJobs, unsigned int inJobCount, unsigned int inIoDepth)
+{
+	std::atomic<unsigned int> nextJob(0);
+	std::vector<std::thread> threads;
+
+	for(unsigned int i = 0; i < inIoDepth && i < inJobCount; i++)
+	{
+		threads.push_back(std::thread([pJobs, inJobCount, &nextJob]()
+		{
+			DXBCDocument document;
+			std::vector<BYTE> input, output;
+
+			for(unsigned int job = nextJob++; job < inJobCount; job = nextJob++)
+			{
+				DXBCPipelineJob &pipelineJob = pJobs[job];
+
+				if(!ReadWholeFile(pipelineJob.pSrcPath, input))
+				{
+					pipelineJob.ioFailed = true;
+					continue;
+				}
+
+				PatchFileData(pipelineJob, document, input, output);
+
+				if(pipelineJob.status == DXBC_PATCH_OK && !WriteWholeFile(pipelineJob.pDstPath, output))
+				{
+					pipelineJob.ioFailed = true;
+					remove(pipelineJob.pDstPath);
+				}
+			}
+		}));
+	}
+
+	for(size_t i = 0; i < threads.size(); i++)
+		threads[i].join();
+
+	return CountFailedJobs(pJobs, inJobCount);
+}
+
+
+
+
+
+#if DXBC_PIPELINE_IO_URING_SUPPORTED
+//================================================================================================================
+// io_uring pipeline
+//================================================================================================================
+// Completion tag of the eventfd read, jobs are tagged with 2 * job + (write ? 1 : 0)
+#define DXBC_PIPELINE_EVENT_TAG		(~0ull)
+
+// Submission and completion rings mapped from the kernel
+struct DXBCIoUring
+{
+	int					file;
+
+	unsigned int*		pSqHead;
+	unsigned int*		pSqTail;
+	unsigned int		sqMask;
+	unsigned int		sqEntries;
+	unsigned int*		pSqArray;
+	io_uring_sqe*		pSqes;
+	unsigned int		sqTail;				// Queued by us, not yet published to the kernel
+	unsigned int		sqSubmitted;		// Consumed by the kernel
+
+	unsigned int*		pCqHead;
+	unsigned int*		pCqTail;
+	unsigned int		cqMask;
+	io_uring_cqe*		pCqes;
+
+	void*				pSqRing;
+	size_t				sqRingSize;
+	void*				pCqRing;
+	size_t				cqRingSize;
+	size_t				sqesSize;
+};
+
+// State of a file going through the pipeline
+struct DXBCPipelineFile
+{
+	int					file;
+	unsigned int		done;				// Bytes read or written so far
+	bool				finished;			// Written, or given up on
+	std::vector<BYTE>	input;
+	std::vector<BYTE>	output;
+};
+
+// Shared by the I/O thread and patching workers
+struct DXBCPipelineQueues
+{
+	std::mutex					lock;
+	std::condition_variable		wakeUpWorkers;
+	std::condition_variable		wakeUpIo;			// Used once the eventfd read fails
+	std::deque<unsigned int>	toPatch;			// Read, waiting for a worker
+	std::deque<unsigned int>	patched;			// Patched (or failed), waiting for the I/O thread
+	bool						stopping;
+	int							event;				// eventfd waking the I/O thread
+};
+
+static void DestroyIoUring(DXBCIoUring &ring)
+{
+	if(ring.pSqes)
+		munmap(ring.pSqes, ring.sqesSize);
+
+	if(ring.pCqRing && ring.pCqRing != ring.pSqRing)
+		munmap(ring.pCqRing, ring.cqRingSize);
+
+	if(ring.pSqRing)
+		munmap(ring.pSqRing, ring.sqRingSize);
+
+	if(ring.file >= 0)
+		close(ring.file);
+
+	memset(&ring, 0, sizeof(ring));
+	ring.file = -1;
+}
+
+// Kernels before 5.6 set io_uring up, but fail every IORING_OP_READ and IORING_OP_WRITE. The probe came with the
+// same kernel, so older ones reject it.
+static bool ProbeIoUringOpcodes(int inRingFile)
+{
+	const unsigned int opCount = 256;
+	std::vector<BYTE> storage(sizeof(io_uring_probe) + opCount * sizeof(io_uring_probe_op));
+	io_uring_probe* pProbe = (io_uring_probe*)storage.data();
+
+	if(syscall(__NR_io_uring_register, inRingFile, IORING_REGISTER_PROBE, pProbe, opCount) < 0)
+		return false;
+
+	return	IORING_OP_READ < pProbe->ops_len && (pProbe->ops[IORING_OP_READ].flags & IO_URING_OP_SUPPORTED) &&
+			IORING_OP_WRITE < pProbe->ops_len && (pProbe->ops[IORING_OP_WRITE].flags & IO_URING_OP_SUPPORTED);
+}
+
+static bool SetupIoUring(DXBCIoUring &ring, unsigned int inEntries)
+{
+	memset(&ring, 0, sizeof(ring));
+
+	io_uring_params params;
+	memset(&params, 0, sizeof(params));
+
+	ring.file = (int)syscall(__NR_io_uring_setup, inEntries, &params);
+
+	if(ring.file < 0)
+		return false;
+
+	if(!ProbeIoUringOpcodes(ring.file))
+	{
+		DestroyIoUring(ring);
+		return false;
+	}
+
+	ring.sqRingSize = params.sq_off.array + params.sq_entries * sizeof(unsigned int);
+	ring.cqRingSize = params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+
+	// Newer kernels map both rings at once
+	if(params.features & IORING_FEAT_SINGLE_MMAP)
+	{
+		if(ring.cqRingSize > ring.sqRingSize)
+			ring.sqRingSize = ring.cqRingSize;
+
+		ring.cqRingSize = ring.sqRingSize;
+	}
+
+	ring.pSqRing = mmap(NULL, ring.sqRingSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ring.file, IORING_OFF_SQ_RING);
+
+	if(ring.pSqRing == MAP_FAILED)
+	{
+		ring.pSqRing = NULL;
+		DestroyIoUring(ring);
+		return false;
+	}
+
+	if(params.features & IORING_FEAT_SINGLE_MMAP)
+		ring.pCqRing = ring.pSqRing;
+	else
+		ring.pCqRing = mmap(NULL, ring.cqRingSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ring.file, IORING_OFF_CQ_RING);
+
+	if(ring.pCqRing == MAP_FAILED)
+	{
+		ring.pCqRing = NULL;
+		DestroyIoUring(ring);
+		return false;
+	}
+
+	ring.sqesSize = params.sq_entries * sizeof(io_uring_sqe);
+	ring.pSqes = (io_uring_sqe*)mmap(NULL, ring.sqesSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ring.file, IORING_OFF_SQES);
+
+	if(ring.pSqes == MAP_FAILED)
+	{
+		ring.pSqes = NULL;
+		DestroyIoUring(ring);
+		return false;
+	}
+
+	BYTE* pSq = (BYTE*)ring.pSqRing;
+	ring.pSqHead	= (unsigned int*)(pSq + params.sq_off.head);
+	ring.pSqTail	= (unsigned int*)(pSq + params.sq_off.tail);
+	ring.sqMask		= *(unsigned int*)(pSq + params.sq_off.ring_mask);
+	ring.sqEntries	= *(unsigned int*)(pSq + params.sq_off.ring_entries);
+	ring.pSqArray	= (unsigned int*)(pSq + params.sq_off.array);
+	ring.sqTail		= *ring.pSqTail;
+	ring.sqSubmitted = ring.sqTail;
+
+	BYTE* pCq = (BYTE*)ring.pCqRing;
+	ring.pCqHead	= (unsigned int*)(pCq + params.cq_off.head);
+	ring.pCqTail	= (unsigned int*)(pCq + params.cq_off.tail);
+	ring.cqMask		= *(unsigned int*)(pCq + params.cq_off.ring_mask);
+	ring.pCqes		= (io_uring_cqe*)(pCq + params.cq_off.cqes);
+
+	return true;
+}
+
+// Queues read or write. Ring has room for everything the pipeline keeps in flight, so it never runs full.
+static void QueueIo(DXBCIoUring &ring, unsigned char inOpcode, int inFile, void *pBuffer, unsigned int inSize, unsigned long long inOffset, unsigned long long inTag)
+{
+	unsigned int index = ring.sqTail & ring.sqMask;
+	io_uring_sqe* pSqe = ring.pSqes + index;
+
+	memset(pSqe, 0, sizeof(*pSqe));
+	pSqe->opcode	= inOpcode;
+	pSqe->fd		= inFile;
+	pSqe->addr		= (unsigned long long)(uintptr_t)pBuffer;
+	pSqe->len		= inSize;
+	pSqe->off		= inOffset;
+	pSqe->user_data	= inTag;
+
+	ring.pSqArray[index] = index;
+	ring.sqTail++;
+}
+
+// Hands queued I/O to the kernel and waits for at least one completion
+static bool SubmitAndWait(DXBCIoUring &ring)
+{
+	__atomic_store_n(ring.pSqTail, ring.sqTail, __ATOMIC_RELEASE);
+
+	for(;;)
+	{
+		long result = syscall(__NR_io_uring_enter, ring.file, ring.sqTail - ring.sqSubmitted, 1, IORING_ENTER_GETEVENTS, NULL, 0);
+
+		if(result >= 0)
+		{
+			ring.sqSubmitted += (unsigned int)result;
+			return true;
+		}
+
+		if(errno != EINTR)
+			return false;
+	}
+}
+
+static void RunPatchWorker(DXBCPipelineJob *pJobs, DXBCPipelineFile *pFiles, DXBCPipelineQueues *pQueues)
+{
+	DXBCDocument document;
+
+	for(;;)
+	{
+		unsigned int job;
+
+		{
+			std::unique_lock<std::mutex> lock(pQueues->lock);
+
+			while(!pQueues->stopping && pQueues->toPatch.empty())
+				pQueues->wakeUpWorkers.wait(lock);
+
+			if(pQueues->stopping)
+				return;
+
+			job = pQueues->toPatch.front();
+			pQueues->toPatch.pop_front();
+		}
+
+		PatchFileData(pJobs[job], document, pFiles[job].input, pFiles[job].output);
+
+		std::vector<BYTE>().swap(pFiles[job].input);
+
+		{
+			std::lock_guard<std::mutex> guard(pQueues->lock);
+			pQueues->patched.push_back(job);
+			pQueues->wakeUpIo.notify_one();
+		}
+
+		// Wake the I/O thread up
+		unsigned long long one = 1;
+
+		while(write(pQueues->event, &one, sizeof(one)) < 0 && errno == EINTR)
+		{
+		}
+	}
+}
+
+// Returns false if io_uring can't be used, nothing has been touched then
+static bool RunIoUringPipeline(DXBCPipelineJob *pJobs, unsigned int inJobCount, unsigned int inIoDepth, unsigned int inWorkerCount, unsigned int *pFailedJobs)
+{
+	DXBCIoUring ring;
+
+	// Every in-flight read or write plus the eventfd read
+	if(!SetupIoUring(ring, inIoDepth + 1))
+		return false;
+
+	DXBCPipelineQueues queues;
+	queues.stopping = false;
+	queues.event = eventfd(0, EFD_CLOEXEC);
+
+	if(queues.event < 0)
+	{
+		DestroyIoUring(ring);
+		return false;
+	}
+
+	std::vector<DXBCPipelineFile> files(inJobCount);
+	std::vector<std::thread> workers;
+
+	for(unsigned int i = 0; i < inWorkerCount; i++)
+		workers.push_back(std::thread(RunPatchWorker, pJobs, files.data(), &queues));
+
+	unsigned long long eventValue = 0;
+	bool eventQueued = true;			// eventfd read is in the ring
+	std::deque<unsigned int> writable;
+	unsigned int nextJob = 0;
+	unsigned int finishedJobs = 0;
+	unsigned int inFlight = 0;			// Reads and writes submitted
+	unsigned int inPipeline = 0;		// Jobs read or being read, but not written yet
+
+	// Bounds memory held by files read ahead of the workers
+	unsigned int maxInPipeline = inIoDepth + 2 * inWorkerCount;
+
+	QueueIo(ring, IORING_OP_READ, queues.event, &eventValue, sizeof(eventValue), 0, DXBC_PIPELINE_EVENT_TAG);
+
+	while(finishedJobs < inJobCount)
+	{
+		// Writes first, they free memory
+		{
+			std::lock_guard<std::mutex> guard(queues.lock);
+			writable.insert(writable.end(), queues.patched.begin(), queues.patched.end());
+			queues.patched.clear();
+		}
+
+		while(!writable.empty() && inFlight < inIoDepth)
+		{
+			unsigned int job = writable.front();
+			writable.pop_front();
+
+			DXBCPipelineFile &file = files[job];
+			file.file = (pJobs[job].status == DXBC_PATCH_OK) ? open(pJobs[job].pDstPath, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0666) : -1;
+
+			if(file.file < 0 || file.output.empty())
+			{
+				if(file.file >= 0)
+					close(file.file);
+				else if(pJobs[job].status == DXBC_PATCH_OK)
+					pJobs[job].ioFailed = true;
+
+				std::vector<BYTE>().swap(file.output);
+				file.finished = true;
+				inPipeline--;
+				finishedJobs++;
+				continue;
+			}
+
+			file.done = 0;
+			QueueIo(ring, IORING_OP_WRITE, file.file, file.output.data(), (unsigned int)file.output.size(), 0, 2ull * job + 1);
+			inFlight++;
+		}
+
+		// Then reads
+		while(nextJob < inJobCount && inFlight < inIoDepth && inPipeline < maxInPipeline)
+		{
+			unsigned int job = nextJob++;
+			DXBCPipelineFile &file = files[job];
+			struct stat fileStat;
+
+			file.file = open(pJobs[job].pSrcPath, O_RDONLY | O_CLOEXEC);
+
+			if(file.file < 0 || fstat(file.file, &fileStat) != 0 || fileStat.st_size > 0xFFFFFFFF)
+			{
+				if(file.file >= 0)
+					close(file.file);
+
+				pJobs[job].ioFailed = true;
+				file.finished = true;
+				finishedJobs++;
+				continue;
+			}
+
+			file.done = 0;
+			file.input.resize((size_t)fileStat.st_size);
+			inPipeline++;
+
+			// Nothing to read, straight to workers (which will reject it)
+			if(file.input.empty())
+			{
+				close(file.file);
+
+				std::lock_guard<std::mutex> guard(queues.lock);
+				queues.toPatch.push_back(job);
+				queues.wakeUpWorkers.notify_one();
+				continue;
+			}
+
+			QueueIo(ring, IORING_OP_READ, file.file, file.input.data(), (unsigned int)file.input.size(), 0, 2ull * job);
+			inFlight++;
+		}
+
+		if(finishedJobs == inJobCount)
+			break;
+
+		// Without the eventfd read nothing in the ring completes when workers finish, so with no I/O in flight
+		// wait for them here
+		if(!eventQueued && inFlight == 0)
+		{
+			std::unique_lock<std::mutex> lock(queues.lock);
+
+			while(queues.patched.empty())
+				queues.wakeUpIo.wait(lock);
+
+			continue;
+		}
+
+		// Ring is unusable, give up on everything not written yet
+		if(!SubmitAndWait(ring))
+			break;
+
+		// Reap completions
+		unsigned int cqHead = *ring.pCqHead;
+		unsigned int cqTail = __atomic_load_n(ring.pCqTail, __ATOMIC_ACQUIRE);
+
+		for(; cqHead != cqTail; cqHead++)
+		{
+			const io_uring_cqe &cqe = ring.pCqes[cqHead & ring.cqMask];
+
+			// Failed eventfd read would fail again right away, workers are waited for above then
+			if(cqe.user_data == DXBC_PIPELINE_EVENT_TAG)
+			{
+				eventQueued = (cqe.res >= 0);
+
+				if(eventQueued)
+					QueueIo(ring, IORING_OP_READ, queues.event, &eventValue, sizeof(eventValue), 0, DXBC_PIPELINE_EVENT_TAG);
+
+				continue;
+			}
+
+			unsigned int job = (unsigned int)(cqe.user_data / 2);
+			bool isWrite = (cqe.user_data & 1) != 0;
+			DXBCPipelineFile &file = files[job];
+			std::vector<BYTE> &buffer = isWrite ? file.output : file.input;
+
+			// Short reads and writes just continue where they stopped
+			if(cqe.res > 0)
+				file.done += cqe.res;
+
+			if(cqe.res > 0 && file.done < buffer.size())
+			{
+				QueueIo(ring, isWrite ? IORING_OP_WRITE : IORING_OP_READ, file.file, buffer.data() + file.done, (unsigned int)buffer.size() - file.done, file.done, cqe.user_data);
+				continue;
+			}
+
+			close(file.file);
+			file.file = -1;
+			inFlight--;
+
+			if(file.done < buffer.size())
+			{
+				pJobs[job].ioFailed = true;
+
+				if(isWrite)
+					remove(pJobs[job].pDstPath);
+
+				std::vector<BYTE>().swap(file.input);
+				std::vector<BYTE>().swap(file.output);
+				file.finished = true;
+				inPipeline--;
+				finishedJobs++;
+			}
+			else if(isWrite)
+			{
+				std::vector<BYTE>().swap(file.output);
+				file.finished = true;
+				inPipeline--;
+				finishedJobs++;
+			}
+			else
+			{
+				std::lock_guard<std::mutex> guard(queues.lock);
+				queues.toPatch.push_back(job);
+				queues.wakeUpWorkers.notify_one();
+			}
+		}
+
+		__atomic_store_n(ring.pCqHead, cqHead, __ATOMIC_RELEASE);
+	}
+
+	{
+		std::lock_guard<std::mutex> guard(queues.lock);
+		queues.stopping = true;
+	}
+
+	queues.wakeUpWorkers.notify_all();
+
+	for(size_t i = 0; i < workers.size(); i++)
+		workers[i].join();
+
+	for(unsigned int job = 0; job < inJobCount; job++)
+	{
+		if(!files[job].finished)
+			pJobs[job].ioFailed = true;
+	}
+
+	close(queues.event);
+	DestroyIoUring(ring);
+
+	*pFailedJobs = CountFailedJobs(pJobs, inJobCount);
+	return true;
+}
+#endif // DXBC_PIPELINE_IO_URING_SUPPORTED
+
+
+
+
+
+unsigned int RunDXBCPatchPipeline(	DXBCPipelineJob				*pJobs,			//[In,Out]	Jobs to run
+									unsigned int				inJobCount,		//[In]	Number of jobs
+									const DXBCPipelineOptions	&options,		//[In]	Pipeline setup
+									DXBCPipelineBackend			*pBackend		//[Out]	Optional backend used
+	)
+{
+	unsigned int ioDepth = options.ioDepth ? options.ioDepth : DXBC_PIPELINE_DEFAULT_IO_DEPTH;
+
+	for(unsigned int i = 0; i < inJobCount; i++)
+	{
+		pJobs[i].status = DXBC_PATCH_OK;
+		pJobs[i].ioFailed = false;
+	}
+
+#if DXBC_PIPELINE_IO_URING_SUPPORTED
+	if(options.allowIoUring)
+	{
+		unsigned int workerCount = options.workerCount ? options.workerCount : std::thread::hardware_concurrency();
+		unsigned int failedJobs = 0;
+
+		if(RunIoUringPipeline(pJobs, inJobCount, ioDepth, workerCount ? workerCount : 1, &failedJobs))
+		{
+			if(pBackend)
+				*pBackend = DXBC_PIPELINE_IO_URING;
+
+			return failedJobs;
+		}
+	}
+#endif // DXBC_PIPELINE_IO_URING_SUPPORTED
+
+	if(pBackend)
+		*pBackend = DXBC_PIPELINE_THREADS;
+
+	return RunThreadPipeline(pJobs, inJobCount, ioDepth);
+}
@@ -0,0 +1,52 @@
+// Author: Henryk Kosobucki, 2016
+
+//=============================================	OVERVIEW =========================================================
+//	File to file patching pipeline for batch runs over slow (cold, network mounted) storage. Reading, patching and
+//	writing of different files overlap: up to ioDepth reads and writes are kept in flight while worker threads
+//	patch (and checksum) files that are already read.
+//
+//	On Linux the I/O goes through io_uring (used directly through its system calls, no library is needed): one
+//	thread submits reads and writes and reaps their completions, workers wake it through an eventfd whose read
+//	sits in the same ring. Where io_uring is not available (other platforms, kernels before 5.6 without reads
+//	and writes in the ring, io_uring disabled by policy) the pipeline falls back to a pool of ioDepth threads,
+//	each one reading (pread), patching and writing (pwrite) whole files.
+//================================================================================================================
+
+#ifndef DXBC_PATCH_PIPELINE_H
+#define DXBC_PATCH_PIPELINE_H
+
+#include "Patcher.h"
+
+enum DXBCPipelineBackend
+{
+	DXBC_PIPELINE_IO_URING = 0,		// Reads and writes submitted through io_uring, patching on worker threads
+	DXBC_PIPELINE_THREADS,			// Pool of threads doing blocking read, patch and write
+};
+
+struct DXBCPipelineOptions
+{
+	unsigned int		ioDepth;				// Reads and writes kept in flight (0 means 32)
+	unsigned int		workerCount;			// Patching threads used with io_uring (0 means one per hardware thread)
+	bool				allowIoUring;			// false forces the thread pool
+};
+
+struct DXBCPipelineJob
+{
+	const char*			pSrcPath;				//[In]	Original DXBC file
+	const char*			pDstPath;				//[In]	File to write patched DXBC to
+	const void*			pOpcodeStream;			//[In]	Opcode stream to inject
+	unsigned int		opcodeStreamSize;		//[In]	Opcode stream size
+	unsigned int		insertBeforeOpcode;		//[In]	Original opcode number before which modification will happen
+
+	DXBCPatchStatus		status;					//[Out]	Result of the patch
+	bool				ioFailed;				//[Out]	Original could not be read or patched one written
+};
+
+// Runs all jobs and returns number of failed ones. Backend actually used is returned in *pBackend (if given).
+unsigned int RunDXBCPatchPipeline(	DXBCPipelineJob				*pJobs,			//[In,Out]	Jobs to run
+									unsigned int				inJobCount,		//[In]	Number of jobs
+									const DXBCPipelineOptions	&options,		//[In]	Pipeline setup
+									DXBCPipelineBackend			*pBackend		//[Out]	Optional backend used
+	);
+
+#endif // DXBC_PATCH_PIPELINE_H
@@ -0,0 +1,191 @@
+//================================================================================================================
+// Include files
+//================================================================================================================
+#include "DXBCPatchQueue.h"
+#include <string.h>
+
+
+
+
+
+//================================================================================================================
+// DXBCPatchRequest
+//================================================================================================================
+void DXBCPatchRequest::GetShader(const void **ppDataShader, unsigned int *pShaderSize) const
+{
+	if(IsReady())
+	{
+		*ppDataShader = m_data.data() + m_patchedOffset;
+		*pShaderSize = m_patchedSize;
+	}
+	else
+	{
+		*ppDataShader = m_data.data();
+		*pShaderSize = m_srcSize;
+	}
+}
+
+bool DXBCPatchRequest::Cancel()
+{
+	DXBCPatchRequestState state = DXBC_REQUEST_PENDING;
+
+	// Worker takes requests the same way, so only one of them wins
+	if(!m_state.compare_exchange_strong(state, DXBC_REQUEST_CANCELLED, std::memory_order_acq_rel))
+		return false;
+
+	Finish(DXBC_REQUEST_CANCELLED);
+	return true;
+}
+
+void DXBCPatchRequest::Finish(DXBCPatchRequestState inState)
+{
+	m_state.store(inState, std::memory_order_release);
+	m_promise.set_value();
+
+	if(m_callback)
+		m_callback(*this);
+}
+
+bool DXBCPatchRequestOrder::operator()(const std::shared_ptr<DXBCPatchRequest> &a, const std::shared_ptr<DXBCPatchRequest> &b) const
+{
+	// priority_queue pops the greatest one
+	if(a->m_priority != b->m_priority)
+		return a->m_priority < b->m_priority;
+
+	return a->m_sequence > b->m_sequence;
+}
+
+
+
+
+
+//================================================================================================================
+// DXBCPatchQueue
+//================================================================================================================
+DXBCPatchQueue::DXBCPatchQueue(unsigned int inThreadCount) : m_sequence(0), m_stopping(false)
+{
+	if(inThreadCount == 0)
+		inThreadCount = std::thread::hardware_concurrency();
+
+	if(inThreadCount == 0)
+		inThreadCount = 1;
+
+	for(unsigned int i = 0; i < inThreadCount; i++)
+		m_workers.push_back(std::thread(&DXBCPatchQueue::RunWorker, this));
+}
+
+DXBCPatchQueue::~DXBCPatchQueue()
+{
+	std::vector<std::shared_ptr<DXBCPatchRequest> > pending;
+
+	{
+		std::lock_guard<std::mutex> guard(m_lock);
+
+		m_stopping = true;
+
+		while(!m_requests.empty())
+		{
+			pending.push_back(m_requests.top());
+			m_requests.pop();
+		}
+	}
+
+	m_wakeUp.notify_all();
+
+	for(size_t i = 0; i < m_workers.size(); i++)
+		m_workers[i].join();
+
+	for(size_t i = 0; i < pending.size(); i++)
+		pending[i]->Cancel();
+}
+
+std::shared_ptr<DXBCPatchRequest> DXBCPatchQueue::Enqueue(	const void			*pSrcDataShader,		//[In]	Original DXBC
+															unsigned int		inSrcShaderSize,		//[In]	Size of original DXBC
+															const void			*pOpcodeStream,			//[In]	Opcode stream to inject
+															unsigned int		inOpcodeStreamSize,		//[In]	Opcode stream size
+															unsigned int		inInsertBeforeOpcode,	//[In]	Original opcode number before which modification will happen
+															int					inPriority,				//[In]	Higher priority requests run first
+															DXBCPatchCallback	callback				//[In]	Optional completion callback
+	)
+{
+	std::shared_ptr<DXBCPatchRequest> request(new DXBCPatchRequest);
+
+	// Everything the request needs is allocated now, so the original shader doesn't move while the caller
+	// uses it and workers never allocate
+	unsigned int patchedSize = GetPatchedDXBCSize(pSrcDataShader, inSrcShaderSize, inOpcodeStreamSize);
+
+	request->m_state.store(DXBC_REQUEST_PENDING, std::memory_order_relaxed);
+	request->m_status				= DXBC_PATCH_OK;
+	request->m_priority				= inPriority;
+	request->m_srcSize				= inSrcShaderSize;
+	request->m_streamSize			= inOpcodeStreamSize;
+	request->m_insertBeforeOpcode	= inInsertBeforeOpcode;
+	request->m_patchedOffset		= (inSrcShaderSize + inOpcodeStreamSize + 3) & ~3u;
+	request->m_patchedSize			= 0;
+	request->m_callback				= callback;
+	request->m_done					= request->m_promise.get_future().share();
+
+	request->m_data.resize(request->m_patchedOffset + patchedSize);
+	memcpy(request->m_data.data(), pSrcDataShader, inSrcShaderSize);
+	memcpy(request->m_data.data() + inSrcShaderSize, pOpcodeStream, inOpcodeStreamSize);
+
+	{
+		std::lock_guard<std::mutex> guard(m_lock);
+
+		request->m_sequence = m_sequence++;
+		m_requests.push(request);
+	}
+
+	m_wakeUp.notify_one();
+
+	return request;
+}
+
+unsigned int DXBCPatchQueue::GetPendingCount() const
+{
+	std::lock_guard<std::mutex> guard(m_lock);
+
+	return (unsigned int)m_requests.size();
+}
+
+void DXBCPatchQueue::RunWorker()
+{
+	DXBCDocument document;
+
+	for(;;)
+	{
+		std::shared_ptr<DXBCPatchRequest> request;
+
+		{
+			std::unique_lock<std::mutex> lock(m_lock);
+
+			while(!m_stopping && m_requests.empty())
+				m_wakeUp.wait(lock);
+
+			if(m_stopping)
+				return;
+
+			request = m_requests.top();
+			m_requests.pop();
+		}
+
+		// Cancelled requests are already done
+		DXBCPatchRequestState state = DXBC_REQUEST_PENDING;
+
+		if(!request->m_state.compare_exchange_strong(state, DXBC_REQUEST_RUNNING, std::memory_order_acq_rel))
+			continue;
+
+		DXBCPatchRequest &r = *request;
+		unsigned int capacity = (unsigned int)r.m_data.size() - r.m_patchedOffset;
+
+		r.m_status = document.Parse(r.m_data.data(), r.m_srcSize);
+
+		if(r.m_status == DXBC_PATCH_OK)
+		{
+			r.m_status = document.Patch(r.m_data.data() + r.m_srcSize, r.m_streamSize, r.m_insertBeforeOpcode,
+										r.m_data.data() + r.m_patchedOffset, capacity, &r.m_patchedSize);
+		}
+
+		r.Finish((r.m_status == DXBC_PATCH_OK) ? DXBC_REQUEST_READY : DXBC_REQUEST_FAILED);
+	}
+}
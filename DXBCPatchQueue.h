@@ -0,0 +1,128 @@
+// Author: Henryk Kosobucki, 2016
+
+//=============================================	OVERVIEW =========================================================
+//	Background patching. Shader creation hooks enqueue patch requests and immediately go on with the original
+//	shader; once a request is ready (see DXBCPatchRequest::GetShader, Wait, GetFuture or the completion callback)
+//	the patched shader can be swapped in.
+//
+//	Requests run by priority (higher first, same priority in order of enqueueing) on a pool of worker threads.
+//	Pending requests can be cancelled. Original shader and opcode stream are copied on enqueue, so the caller
+//	doesn't have to keep them alive.
+//================================================================================================================
+
+#ifndef DXBC_PATCH_QUEUE_H
+#define DXBC_PATCH_QUEUE_H
+
+#include "Patcher.h"
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <queue>
+#include <thread>
+#include <vector>
+
+class DXBCPatchRequest;
+
+enum DXBCPatchRequestState
+{
+	DXBC_REQUEST_PENDING = 0,		// Waiting in the queue
+	DXBC_REQUEST_RUNNING,			// Being patched
+	DXBC_REQUEST_READY,				// Patched shader available
+	DXBC_REQUEST_FAILED,			// Shader could not be patched (see GetStatus)
+	DXBC_REQUEST_CANCELLED,			// Cancelled before it started
+};
+
+// Called once request is done: on worker thread when it is ready or failed, on the cancelling thread when it
+// is cancelled.
+typedef std::function<void(DXBCPatchRequest &request)> DXBCPatchCallback;
+
+class DXBCPatchRequest
+{
+public:
+	DXBCPatchRequestState	GetState() const { return m_state.load(std::memory_order_acquire); }
+	bool					IsReady() const { return GetState() == DXBC_REQUEST_READY; }
+	DXBCPatchStatus			GetStatus() const { return m_status; }
+
+	// Patched shader once it is ready, original one until then (and if patching fails or is cancelled)
+	void					GetShader(const void **ppDataShader, unsigned int *pShaderSize) const;
+
+	// Patched shader, only valid once request is ready
+	const BYTE*				GetPatchedData() const { return m_data.data() + m_patchedOffset; }
+	unsigned int			GetPatchedSize() const { return m_patchedSize; }
+
+	// Blocks until request is done (ready, failed or cancelled)
+	void					Wait() const { m_done.wait(); }
+	std::shared_future<void> GetFuture() const { return m_done; }
+
+	// Cancels request which has not started yet. Returns false if it is already running or done.
+	bool					Cancel();
+
+private:
+	friend class DXBCPatchQueue;
+	friend struct DXBCPatchRequestOrder;
+
+	void					Finish(DXBCPatchRequestState inState);
+
+	std::atomic<DXBCPatchRequestState>	m_state;
+	DXBCPatchStatus						m_status;
+	int									m_priority;
+	unsigned long long					m_sequence;			// Order of enqueueing, keeps same priority FIFO
+
+	// Original shader, opcode stream and (once ready) patched shader, one after another
+	std::vector<BYTE>					m_data;
+	unsigned int						m_srcSize;
+	unsigned int						m_streamSize;
+	unsigned int						m_insertBeforeOpcode;
+	unsigned int						m_patchedOffset;
+	unsigned int						m_patchedSize;
+
+	DXBCPatchCallback					m_callback;
+	std::promise<void>					m_promise;
+	std::shared_future<void>			m_done;
+};
+
+// Orders queue: higher priority first, then older first
+struct DXBCPatchRequestOrder
+{
+	bool operator()(const std::shared_ptr<DXBCPatchRequest> &a, const std::shared_ptr<DXBCPatchRequest> &b) const;
+};
+
+class DXBCPatchQueue
+{
+public:
+	// Starts inThreadCount workers (0 means one per hardware thread)
+	explicit DXBCPatchQueue(unsigned int inThreadCount);
+
+	// Cancels pending requests and waits for the running ones
+	~DXBCPatchQueue();
+
+	std::shared_ptr<DXBCPatchRequest>	Enqueue(	const void			*pSrcDataShader,		//[In]	Original DXBC
+													unsigned int		inSrcShaderSize,		//[In]	Size of original DXBC
+													const void			*pOpcodeStream,			//[In]	Opcode stream to inject
+													unsigned int		inOpcodeStreamSize,		//[In]	Opcode stream size
+													unsigned int		inInsertBeforeOpcode,	//[In]	Original opcode number before which modification will happen
+													int					inPriority = 0,			//[In]	Higher priority requests run first
+													DXBCPatchCallback	callback = nullptr		//[In]	Optional completion callback
+		);
+
+	// Number of requests waiting in the queue (cancelled ones included until a worker drops them)
+	unsigned int						GetPendingCount() const;
+
+private:
+	DXBCPatchQueue(const DXBCPatchQueue&);
+	DXBCPatchQueue&						operator=(const DXBCPatchQueue&);
+
+	void								RunWorker();
+
+	mutable std::mutex					m_lock;
+	std::condition_variable				m_wakeUp;
+	std::priority_queue<std::shared_ptr<DXBCPatchRequest>, std::vector<std::shared_ptr<DXBCPatchRequest> >, DXBCPatchRequestOrder>	m_requests;
+	unsigned long long					m_sequence;
+	bool								m_stopping;
+	std::vector<std::thread>			m_workers;
+};
+
+#endif // DXBC_PATCH_QUEUE_H
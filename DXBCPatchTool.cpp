@@ -0,0 +1,385 @@
+// Author: Henryk Kosobucki, 2016
+
+//=============================================	OVERVIEW =========================================================
+//	dxbc-patch - command line shader patcher:
+//
+//		dxbc-patch <shader file> <opcodes file> <before opcode> <output file>
+//		dxbc-patch [-threads <count>] -manifest <manifest file>
+//		dxbc-patch [-threads <count>] -stream <opcodes file> -before <opcode> <shader file>...
+//
+//	First form patches single shader. Manifest holds one such patch per line (same four fields separated by
+//	whitespace, lines starting with # are skipped), so thousands of shaders can be patched in one process. Last
+//	form injects the same opcode stream into every shader and writes <shader file>.patched next to each of them.
+//	Opcode files ending with .asm hold assembly text, they are assembled once when first used.
+//
+//	Inputs are mapped read-only and every output file is created with its exact final size and mapped, so
+//	patching reads straight from the file cache and writes straight into it, without any heap copies. Jobs are
+//	mapped and patched in windows of a few thousand, each window is unmapped before the next one is mapped.
+//	Timings of every job are printed in job order, so the report does not depend on the number of threads.
+//================================================================================================================
+
+//================================================================================================================
+// Include files
+//================================================================================================================
+#include "PatcherBatch.h"
+#include "DXBCAssembler.h"
+#include "DXBCMappedFile.h"
+#include "DXBCValidator.h"
+#include <chrono>
+#include <deque>
+#include <map>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <string>
+#include <vector>
+
+
+
+
+
+//================================================================================================================
+// Constants
+//================================================================================================================
+// Jobs mapped at once. Each one maps its shader and its output, so a window stays far below the mapping limit
+// of the process (vm.max_map_count is 65530 by default on Linux) however long the manifest is.
+#define DXBC_TOOL_WINDOW_JOBS		4096
+
+
+
+
+
+//================================================================================================================
+// Structures
+//================================================================================================================
+struct DXBCToolJob
+{
+	std::string			shaderPath;
+	std::string			streamPath;
+	unsigned int		insertBeforeOpcode;
+	std::string			outputPath;
+};
+
+// Opcode stream of the jobs, either mapped binary file or assembled text
+struct DXBCToolStream
+{
+	DXBCMappedFile		file;
+	std::vector<DWORD>	assembled;
+	const void*			pData;
+	unsigned int		size;
+};
+
+
+
+
+
+//================================================================================================================
+// Function definitions
+//================================================================================================================
+static int PrintUsage()
+{
+	fprintf(stderr,	"Usage: dxbc-patch <shader file> <opcodes file> <before opcode> <output file>\n"
+					"       dxbc-patch [-threads <count>] -manifest <manifest file>\n"
+					"       dxbc-patch [-threads <count>] -stream <opcodes file> -before <opcode> <shader file>...\n");
+	return 1;
+}
+
+static const char* GetStatusString(DXBCPatchStatus status)
+{
+	switch(status)
+	{
+		case DXBC_PATCH_OK:					return "ok";
+		case DXBC_PATCH_NO_SHADER_CHUNK:	return "no-shader";
+		case DXBC_PATCH_NOT_PARSED:			return "not-parsed";
+		case DXBC_PATCH_INVALID_EDIT:		return "bad-edit";
+		case DXBC_PATCH_CONFLICTING_EDITS:	return "conflict";
+		case DXBC_PATCH_BUFFER_TOO_SMALL:	return "too-small";
+		case DXBC_PATCH_INVALID_SHADER:		return "invalid";
+		case DXBC_PATCH_SYNTAX_ERROR:		return "syntax";
+	}
+
+	return "unknown";
+}
+
+// Reads manifest lines: <shader file> <opcodes file> <before opcode> <output file>
+static bool ReadManifest(const char *pPath, std::vector<DXBCToolJob> &jobs)
+{
+	DXBCMappedFile manifest;
+
+	if(!manifest.OpenRead(pPath))
+	{
+		fprintf(stderr, "Can't read %s\n", pPath);
+		return false;
+	}
+
+	const char* pText = (const char*)manifest.GetData();
+	const char* pEnd = pText + manifest.GetSize();
+	unsigned int line = 0;
+
+	while(pText < pEnd)
+	{
+		const char* pLineEnd = (const char*)memchr(pText, '\n', pEnd - pText);
+
+		if(!pLineEnd)
+			pLineEnd = pEnd;
+
+		line++;
+
+		// Split line into whitespace separated fields
+		std::vector<std::string> fields;
+
+		for(const char* p = pText; p < pLineEnd;)
+		{
+			while(p < pLineEnd && (*p == ' ' || *p == '\t' || *p == '\r'))
+				p++;
+
+			const char* pField = p;
+
+			while(p < pLineEnd && *p != ' ' && *p != '\t' && *p != '\r')
+				p++;
+
+			if(p > pField)
+				fields.push_back(std::string(pField, p));
+		}
+
+		pText = pLineEnd + 1;
+
+		if(fields.empty() || fields[0][0] == '#')
+			continue;
+
+		if(fields.size() != 4)
+		{
+			fprintf(stderr, "%s(%u): expected <shader file> <opcodes file> <before opcode> <output file>\n", pPath, line);
+			return false;
+		}
+
+		DXBCToolJob job = { fields[0], fields[1], (unsigned int)strtoul(fields[2].c_str(), NULL, 0), fields[3] };
+		jobs.push_back(job);
+	}
+
+	return true;
+}
+
+// Maps opcode stream file, .asm files are assembled
+static bool LoadStream(const std::string &path, DXBCToolStream &stream)
+{
+	if(!stream.file.OpenRead(path.c_str()))
+	{
+		fprintf(stderr, "Can't read %s\n", path.c_str());
+		return false;
+	}
+
+	stream.pData = stream.file.GetData();
+	stream.size = stream.file.GetSize();
+
+	if(path.size() > 4 && path.compare(path.size() - 4, 4, ".asm") == 0)
+	{
+		DXBCAssemblyError error;
+
+		if(AssembleDXBCOpcodes((const char*)stream.pData, stream.size, stream.assembled, &error) != DXBC_PATCH_OK)
+		{
+			fprintf(stderr, "%s(%u,%u): %s\n", path.c_str(), error.line, error.column, error.pMessage);
+			return false;
+		}
+
+		stream.file.Close();
+		stream.pData = stream.assembled.data();
+		stream.size = (unsigned int)(stream.assembled.size() * sizeof(DWORD));
+	}
+
+	return true;
+}
+
+static int RunJobs(const std::vector<DXBCToolJob> &toolJobs, unsigned int inThreadCount)
+{
+	unsigned int jobCount = (unsigned int)toolJobs.size();
+
+	// Every distinct opcode stream is mapped (or assembled) once for the whole run
+	std::map<std::string, DXBCToolStream*> streams;
+	std::deque<DXBCToolStream> streamFiles;
+
+	// Shaders and outputs only of the current window are mapped
+	std::vector<DXBCMappedFile> shaders(DXBC_TOOL_WINDOW_JOBS);
+	std::vector<DXBCMappedFile> outputs(DXBC_TOOL_WINDOW_JOBS);
+	std::vector<DXBCPatchJob> jobs(DXBC_TOOL_WINDOW_JOBS);
+	std::vector<bool> mapped(DXBC_TOOL_WINDOW_JOBS);
+	std::vector<DXBCPatchJob> batch;
+	batch.reserve(DXBC_TOOL_WINDOW_JOBS);
+
+	unsigned int failedJobs = 0;
+	double batchMilliseconds = 0.0;
+	double jobMilliseconds = 0.0;
+
+	printf("%8s %8s %10s %10s %10s  %s\n", "job", "worker", "bytes", "ms", "status", "file");
+
+	for(unsigned int first = 0; first < jobCount; first += DXBC_TOOL_WINDOW_JOBS)
+	{
+		unsigned int windowCount = (jobCount - first < DXBC_TOOL_WINDOW_JOBS) ? jobCount - first : DXBC_TOOL_WINDOW_JOBS;
+
+		// Map shaders of the window and outputs of exact patched size
+		for(unsigned int w = 0; w < windowCount; w++)
+		{
+			const DXBCToolJob &toolJob = toolJobs[first + w];
+			DXBCPatchJob &job = jobs[w];
+			memset(&job, 0, sizeof(job));
+			mapped[w] = false;
+
+			DXBCToolStream*& pStream = streams[toolJob.streamPath];
+
+			if(!pStream)
+			{
+				streamFiles.emplace_back();
+				pStream = &streamFiles.back();
+
+				if(!LoadStream(toolJob.streamPath, *pStream))
+					pStream->pData = NULL;
+			}
+
+			if(!pStream->pData)
+				continue;
+
+			if(!shaders[w].OpenRead(toolJob.shaderPath.c_str()))
+			{
+				fprintf(stderr, "Can't read %s\n", toolJob.shaderPath.c_str());
+				continue;
+			}
+
+			// Patcher trusts the lengths in the shader, so broken files are caught here
+			unsigned int failOffset;
+
+			if(ValidateDXBC(shaders[w].GetData(), shaders[w].GetSize(), &failOffset) != DXBC_PATCH_OK)
+			{
+				fprintf(stderr, "Corrupt shader %s (at byte %u)\n", toolJob.shaderPath.c_str(), failOffset);
+				shaders[w].Close();
+				continue;
+			}
+
+			job.pSrcDataShader		= shaders[w].GetData();
+			job.srcShaderSize		= shaders[w].GetSize();
+			job.pOpcodeStream		= pStream->pData;
+			job.opcodeStreamSize	= pStream->size;
+			job.insertBeforeOpcode	= toolJob.insertBeforeOpcode;
+			job.dstCapacity			= GetPatchedDXBCSize(job.pSrcDataShader, job.srcShaderSize, job.opcodeStreamSize);
+
+			// Shaders that can't be patched get no output and fail in the batch with the reason
+			if(job.dstCapacity)
+			{
+				if(!outputs[w].CreateWrite(toolJob.outputPath.c_str(), job.dstCapacity))
+				{
+					fprintf(stderr, "Can't write %s\n", toolJob.outputPath.c_str());
+					shaders[w].Close();
+					continue;
+				}
+
+				job.pDstDataShader = outputs[w].GetData();
+			}
+
+			mapped[w] = true;
+		}
+
+		// Patch whatever got mapped, jobs that did not are moved out of the way
+		batch.clear();
+
+		for(unsigned int w = 0; w < windowCount; w++)
+		{
+			if(mapped[w])
+				batch.push_back(jobs[w]);
+		}
+
+		std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+
+		PatchDXBCBatch(batch.data(), (unsigned int)batch.size(), inThreadCount);
+
+		batchMilliseconds += std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+		// Report every job of the window and unmap it (failed outputs are deleted, they have no valid content)
+		for(unsigned int w = 0, b = 0; w < windowCount; w++)
+		{
+			unsigned int i = first + w;
+
+			if(!mapped[w])
+			{
+				printf("%8u %8s %10u %10.3f %10s  %s\n", i, "-", 0u, 0.0, "io-error", toolJobs[i].shaderPath.c_str());
+				failedJobs++;
+				continue;
+			}
+
+			const DXBCPatchJob &job = batch[b++];
+			jobMilliseconds += job.patchMilliseconds;
+
+			printf("%8u %8u %10u %10.3f %10s  %s\n", i, job.worker, job.dstSize, job.patchMilliseconds, GetStatusString(job.status), toolJobs[i].shaderPath.c_str());
+
+			shaders[w].Close();
+			outputs[w].Close();
+
+			if(job.status != DXBC_PATCH_OK)
+			{
+				if(job.dstCapacity)
+					remove(toolJobs[i].outputPath.c_str());
+
+				failedJobs++;
+			}
+		}
+	}
+
+	printf("%u jobs, %u failed, %.3f ms total (%.3f ms patching)\n", jobCount, failedJobs, batchMilliseconds, jobMilliseconds);
+
+	return (failedJobs == 0) ? 0 : 1;
+}
+
+int main(int argc, char **argv)
+{
+	const char* pManifestPath = NULL;
+	const char* pStreamPath = NULL;
+	unsigned int insertBeforeOpcode = 0;
+	unsigned int threadCount = 0;
+	std::vector<const char*> arguments;
+
+	for(int i = 1; i < argc; i++)
+	{
+		if(!strcmp(argv[i], "-manifest") && i + 1 < argc)
+			pManifestPath = argv[++i];
+		else if(!strcmp(argv[i], "-stream") && i + 1 < argc)
+			pStreamPath = argv[++i];
+		else if(!strcmp(argv[i], "-before") && i + 1 < argc)
+			insertBeforeOpcode = (unsigned int)strtoul(argv[++i], NULL, 0);
+		else if(!strcmp(argv[i], "-threads") && i + 1 < argc)
+			threadCount = (unsigned int)strtoul(argv[++i], NULL, 0);
+		else if(argv[i][0] == '-')
+			return PrintUsage();
+		else
+			arguments.push_back(argv[i]);
+	}
+
+	std::vector<DXBCToolJob> jobs;
+
+	if(pManifestPath)
+	{
+		if(!arguments.empty() || pStreamPath)
+			return PrintUsage();
+
+		if(!ReadManifest(pManifestPath, jobs))
+			return 1;
+	}
+	else if(pStreamPath)
+	{
+		if(arguments.empty())
+			return PrintUsage();
+
+		for(size_t i = 0; i < arguments.size(); i++)
+		{
+			DXBCToolJob job = { arguments[i], pStreamPath, insertBeforeOpcode, std::string(arguments[i]) + ".patched" };
+			jobs.push_back(job);
+		}
+	}
+	else
+	{
+		if(arguments.size() != 4)
+			return PrintUsage();
+
+		DXBCToolJob job = { arguments[0], arguments[1], (unsigned int)strtoul(arguments[2], NULL, 0), arguments[3] };
+		jobs.push_back(job);
+	}
+
+	return RunJobs(jobs, threadCount);
+}
@@ -0,0 +1,40 @@
+// Author: Henryk Kosobucki, 2016
+
+//=============================================	OVERVIEW =========================================================
+//	Windows types used all over the patcher. On Windows they come from Windows.h, elsewhere the few that are
+//	used are defined here, so patching itself (and tools built around it) also works on other platforms.
+//================================================================================================================
+
+#ifndef DXBC_PLATFORM_H
+#define DXBC_PLATFORM_H
+
+#ifdef _WIN32
+#include <Windows.h>
+#else
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+
+typedef uint32_t		DWORD;
+typedef uint8_t			BYTE;
+typedef int				BOOL;
+typedef unsigned int	UINT;
+
+#ifndef TRUE
+#define TRUE	1
+#endif
+
+#ifndef FALSE
+#define FALSE	0
+#endif
+
+#define MAKEFOURCC(ch0, ch1, ch2, ch3)	((DWORD)(BYTE)(ch0) | ((DWORD)(BYTE)(ch1) << 8) | ((DWORD)(BYTE)(ch2) << 16) | ((DWORD)(BYTE)(ch3) << 24))
+
+// There is no debugger output window, standard error is the closest thing
+inline void OutputDebugStringA(const char *pString)
+{
+	fputs(pString, stderr);
+}
+#endif // _WIN32
+
+#endif // DXBC_PLATFORM_H
@@ -0,0 +1,389 @@
+//================================================================================================================
+// Include files
+//================================================================================================================
+#include "DXBCProgram.h"
+#include "d3d11TokenizedProgramFormat.hpp"
+#include "DXBCInstruction.h"
+#include <string.h>
+
+
+
+
+
+//================================================================================================================
+// Structures
+//================================================================================================================
+// Writable view of the tables while decoding. Counting pass has none, it only advances the counters.
+struct DXBCProgramColumns
+{
+	unsigned int*			pInstructionOffsets;
+	unsigned int*			pFirstOperands;
+	unsigned short*			pOpcodes;
+
+	unsigned long long*		pIndexImmediates;
+	unsigned int*			pOffsets;
+	unsigned int*			pValueOffsets;
+	unsigned int*			pIndexRelatives;
+	BYTE*					pLengths;
+	BYTE*					pTypes;
+	BYTE*					pFlags;
+	BYTE*					pNumComponents;
+	BYTE*					pSelectionModes;
+	BYTE*					pComponents;
+	BYTE*					pModifiers;
+	BYTE*					pIndexDimensions;
+	BYTE*					pIndexRepresentations;
+};
+
+struct DXBCProgramCounts
+{
+	unsigned int			instructions;
+	unsigned int			operands;
+};
+
+
+
+
+
+//================================================================================================================
+// Arena
+//================================================================================================================
+// Carves arrays off the arena. Widest elements go first, so every array stays aligned.
+template<typename T>
+static T* TakeArray(BYTE *&pCursor, size_t inCount)
+{
+	T* pArray = (T*)pCursor;
+
+	pCursor += inCount * sizeof(T);
+	return pArray;
+}
+
+static size_t GetArenaSize(const DXBCProgramCounts &counts)
+{
+	size_t instructions = counts.instructions;
+	size_t operands = counts.operands;
+	size_t indices = operands * DXBC_MAX_OPERAND_INDICES;
+
+	return	indices * sizeof(unsigned long long) +
+			(instructions + 1) * 2 * sizeof(unsigned int) + (operands * 2 + indices) * sizeof(unsigned int) +
+			instructions * sizeof(unsigned short) +
+			operands * 8 + indices;
+}
+
+static void SplitArena(BYTE *pArena, const DXBCProgramCounts &counts, DXBCProgramColumns *pColumns)
+{
+	size_t instructions = counts.instructions;
+	size_t operands = counts.operands;
+	size_t indices = operands * DXBC_MAX_OPERAND_INDICES;
+
+	pColumns->pIndexImmediates		= TakeArray<unsigned long long>(pArena, indices);
+	pColumns->pInstructionOffsets	= TakeArray<unsigned int>(pArena, instructions + 1);
+	pColumns->pFirstOperands		= TakeArray<unsigned int>(pArena, instructions + 1);
+	pColumns->pOffsets				= TakeArray<unsigned int>(pArena, operands);
+	pColumns->pValueOffsets			= TakeArray<unsigned int>(pArena, operands);
+	pColumns->pIndexRelatives		= TakeArray<unsigned int>(pArena, indices);
+	pColumns->pOpcodes				= TakeArray<unsigned short>(pArena, instructions);
+	pColumns->pLengths				= TakeArray<BYTE>(pArena, operands);
+	pColumns->pTypes				= TakeArray<BYTE>(pArena, operands);
+	pColumns->pFlags				= TakeArray<BYTE>(pArena, operands);
+	pColumns->pNumComponents		= TakeArray<BYTE>(pArena, operands);
+	pColumns->pSelectionModes		= TakeArray<BYTE>(pArena, operands);
+	pColumns->pComponents			= TakeArray<BYTE>(pArena, operands);
+	pColumns->pModifiers			= TakeArray<BYTE>(pArena, operands);
+	pColumns->pIndexDimensions		= TakeArray<BYTE>(pArena, operands);
+	pColumns->pIndexRepresentations	= TakeArray<BYTE>(pArena, indices);
+}
+
+
+
+
+
+//================================================================================================================
+// Decoding
+//================================================================================================================
+// Decodes operand at pOperand, followed by the operands of its relative indices. Returns its length in DWORDs,
+// 0 when it is broken or runs past pEnd.
+static unsigned int DecodeOperand(	const DWORD				*pOpcodes,			//[In]	First opcode (offsets are relative to it)
+									const DWORD				*pOperand,			//[In]	Operand token
+									const DWORD				*pEnd,				//[In]	End of instruction
+									BYTE					inFlags,			//[In]	DXBCOperandFlags
+									DXBCProgramColumns		*pColumns,			//[Out]	Tables, NULL when only counting
+									DXBCProgramCounts		&counts				//[Out]	Operand is counted here
+	)
+{
+	const DWORD* p = pOperand;
+
+	if(p >= pEnd)
+		return 0;
+
+	DWORD token = *p++;
+	BYTE modifier = D3D10_SB_OPERAND_MODIFIER_NONE;
+
+	// Extended operand tokens can chain, the modifier one is the only kind there is
+	if(DECODE_IS_D3D10_SB_OPERAND_EXTENDED(token))
+	{
+		DWORD extendedToken;
+
+		do
+		{
+			if(p >= pEnd)
+				return 0;
+
+			extendedToken = *p++;
+
+			if(DECODE_D3D10_SB_EXTENDED_OPERAND_TYPE(extendedToken) == D3D10_SB_EXTENDED_OPERAND_MODIFIER)
+				modifier = (BYTE)DECODE_D3D10_SB_OPERAND_MODIFIER(extendedToken);
+		}
+		while(DECODE_IS_D3D10_SB_OPERAND_DOUBLE_EXTENDED(extendedToken));
+	}
+
+	unsigned int operand = counts.operands++;
+	D3D10_SB_OPERAND_TYPE type = DECODE_D3D10_SB_OPERAND_TYPE(token);
+	D3D10_SB_OPERAND_NUM_COMPONENTS numComponents = DECODE_D3D10_SB_OPERAND_NUM_COMPONENTS(token);
+	D3D10_SB_OPERAND_INDEX_DIMENSION dimension = DECODE_D3D10_SB_OPERAND_INDEX_DIMENSION(token);
+
+	if(pColumns)
+	{
+		BYTE selectionMode = 0;
+		BYTE components = 0;
+
+		if(numComponents == D3D10_SB_OPERAND_4_COMPONENT)
+		{
+			selectionMode = (BYTE)DECODE_D3D10_SB_OPERAND_4_COMPONENT_SELECTION_MODE(token);
+
+			if(selectionMode == D3D10_SB_OPERAND_4_COMPONENT_MASK_MODE)
+				components = (BYTE)(DECODE_D3D10_SB_OPERAND_4_COMPONENT_MASK(token) >> D3D10_SB_OPERAND_4_COMPONENT_MASK_SHIFT);
+			else if(selectionMode == D3D10_SB_OPERAND_4_COMPONENT_SWIZZLE_MODE)
+				components = (BYTE)(DECODE_D3D10_SB_OPERAND_4_COMPONENT_SWIZZLE(token) >> D3D10_SB_OPERAND_4_COMPONENT_SWIZZLE_SHIFT);
+			else
+				components = (BYTE)DECODE_D3D10_SB_OPERAND_4_COMPONENT_SELECT_1(token);
+		}
+
+		pColumns->pOffsets[operand]			= (unsigned int)(pOperand - pOpcodes);
+		pColumns->pValueOffsets[operand]	= (unsigned int)(p - pOpcodes);
+		pColumns->pTypes[operand]			= (BYTE)type;
+		pColumns->pFlags[operand]			= inFlags;
+		pColumns->pNumComponents[operand]	= (BYTE)numComponents;
+		pColumns->pSelectionModes[operand]	= selectionMode;
+		pColumns->pComponents[operand]		= components;
+		pColumns->pModifiers[operand]		= modifier;
+		pColumns->pIndexDimensions[operand]	= (BYTE)dimension;
+	}
+
+	unsigned int index = 0;
+
+	if(type == D3D10_SB_OPERAND_TYPE_IMMEDIATE32)
+	{
+		p += (numComponents == D3D10_SB_OPERAND_4_COMPONENT) ? 4 : 1;
+	}
+	else if(type == D3D10_SB_OPERAND_TYPE_IMMEDIATE64)
+	{
+		// Four components hold two doubles
+		p += (numComponents == D3D10_SB_OPERAND_4_COMPONENT) ? 4 : 2;
+	}
+	else
+	{
+		for(; index < (unsigned int)dimension; index++)
+		{
+			D3D10_SB_OPERAND_INDEX_REPRESENTATION representation = DECODE_D3D10_SB_OPERAND_INDEX_REPRESENTATION(index, token);
+			unsigned long long immediate = 0;
+			unsigned int relative = DXBC_NO_OPERAND;
+
+			// Immediate part first (64-bit ones high DWORD first), then the operand holding the relative part
+			if(representation == D3D10_SB_OPERAND_INDEX_IMMEDIATE32 || representation == D3D10_SB_OPERAND_INDEX_IMMEDIATE32_PLUS_RELATIVE)
+			{
+				if(p >= pEnd)
+					return 0;
+
+				immediate = p[0];
+				p += 1;
+			}
+			else if(representation == D3D10_SB_OPERAND_INDEX_IMMEDIATE64 || representation == D3D10_SB_OPERAND_INDEX_IMMEDIATE64_PLUS_RELATIVE)
+			{
+				if(pEnd - p < 2)
+					return 0;
+
+				immediate = ((unsigned long long)p[0] << 32) | p[1];
+				p += 2;
+			}
+			else if(representation != D3D10_SB_OPERAND_INDEX_RELATIVE)
+			{
+				return 0;
+			}
+
+			if(representation >= D3D10_SB_OPERAND_INDEX_RELATIVE)
+			{
+				relative = counts.operands;
+
+				unsigned int relativeLength = DecodeOperand(pOpcodes, p, pEnd, DXBC_OPERAND_RELATIVE, pColumns, counts);
+
+				if(!relativeLength)
+					return 0;
+
+				p += relativeLength;
+			}
+
+			if(pColumns)
+			{
+				pColumns->pIndexImmediates[operand * DXBC_MAX_OPERAND_INDICES + index]		= immediate;
+				pColumns->pIndexRelatives[operand * DXBC_MAX_OPERAND_INDICES + index]		= relative;
+				pColumns->pIndexRepresentations[operand * DXBC_MAX_OPERAND_INDICES + index]	= (BYTE)representation;
+			}
+		}
+	}
+
+	if(p > pEnd)
+		return 0;
+
+	if(pColumns)
+	{
+		for(; index < DXBC_MAX_OPERAND_INDICES; index++)
+		{
+			pColumns->pIndexImmediates[operand * DXBC_MAX_OPERAND_INDICES + index]		= 0;
+			pColumns->pIndexRelatives[operand * DXBC_MAX_OPERAND_INDICES + index]		= DXBC_NO_OPERAND;
+			pColumns->pIndexRepresentations[operand * DXBC_MAX_OPERAND_INDICES + index]	= D3D10_SB_OPERAND_INDEX_IMMEDIATE32;
+		}
+
+		// Instructions are at most 127 DWORDs long, so is every operand in them
+		pColumns->pLengths[operand] = (BYTE)(p - pOperand);
+	}
+
+	return (unsigned int)(p - pOperand);
+}
+
+// Walks the whole stream, counting instructions and operands (pColumns NULL) or filling the tables.
+static bool DecodeInstructions(	const DWORD				*pOpcodes,			//[In]	First opcode
+								unsigned int			inNumDWORDs,		//[In]	Number of opcode DWORDs
+								DXBCProgramColumns		*pColumns,			//[Out]	Tables, NULL when only counting
+								DXBCProgramCounts		&counts				//[Out]	Instructions and operands
+	)
+{
+	counts.instructions = 0;
+	counts.operands = 0;
+
+	for(DXBCInstruction instruction : IterateDXBCInstructions(pOpcodes, inNumDWORDs))
+	{
+		D3D10_SB_OPCODE_TYPE opcode = instruction.GetOpcode();
+
+		if(opcode >= D3D10_SB_NUM_OPCODES || instruction.IsTruncated())
+			return false;
+
+		if(pColumns)
+		{
+			pColumns->pInstructionOffsets[counts.instructions]	= (unsigned int)(instruction.pToken - pOpcodes);
+			pColumns->pFirstOperands[counts.instructions]		= counts.operands;
+			pColumns->pOpcodes[counts.instructions]				= (unsigned short)opcode;
+		}
+
+		counts.instructions++;
+
+		if(instruction.IsCustomData())
+			continue;
+
+		const DXBCOpcodeInfo& info = instruction.GetInfo();
+		DXBCOperandCursor cursor = instruction.GetOperands();
+		bool isDeclaration = IsDXBCDeclaration(opcode);
+
+		// Interface call has the function index in front of its operand
+		if(opcode == D3D11_SB_OPCODE_INTERFACE_CALL)
+			cursor.pToken++;
+
+		// Declarations have their operands first and their own tokens after them, other instructions have nothing
+		// but operands
+		for(unsigned int i = 0; isDeclaration ? (i < info.operandCount) : !cursor.IsEnd(); i++)
+		{
+			BYTE flags = (i < info.destinationCount) ? DXBC_OPERAND_DESTINATION : 0;
+			unsigned int length = DecodeOperand(pOpcodes, cursor.pToken, cursor.pEnd, flags, pColumns, counts);
+
+			if(!length)
+				return false;
+
+			cursor.pToken += length;
+		}
+	}
+
+	if(pColumns)
+	{
+		pColumns->pInstructionOffsets[counts.instructions]	= inNumDWORDs;
+		pColumns->pFirstOperands[counts.instructions]		= counts.operands;
+	}
+
+	return true;
+}
+
+
+
+
+
+//================================================================================================================
+// Function definitions
+//================================================================================================================
+DXBCProgram::DXBCProgram()
+{
+	Clear();
+}
+
+void DXBCProgram::Clear()
+{
+	static const unsigned int s_noInstructions[1] = { 0 };
+
+	m_pOpcodes = nullptr;
+
+	memset(&m_instructions, 0, sizeof(m_instructions));
+	memset(&m_operands, 0, sizeof(m_operands));
+
+	// Empty program still has its end of stream
+	m_instructions.pOffsets = s_noInstructions;
+	m_instructions.pFirstOperands = s_noInstructions;
+}
+
+DXBCPatchStatus DXBCProgram::Decode(	const DWORD		*pOpcodes,				//[In]	First opcode
+										unsigned int	inNumDWORDs				//[In]	Number of opcode DWORDs
+	)
+{
+	DXBCProgramCounts counts;
+	DXBCProgramColumns columns;
+
+	Clear();
+
+	// Counting pass sizes the arena exactly, the second one fills it
+	if(!DecodeInstructions(pOpcodes, inNumDWORDs, nullptr, counts))
+		return DXBC_PATCH_INVALID_SHADER;
+
+	size_t arenaSize = GetArenaSize(counts);
+
+	if(m_arena.size() < arenaSize)
+		m_arena.resize(arenaSize);
+
+	SplitArena(m_arena.data(), counts, &columns);
+	DecodeInstructions(pOpcodes, inNumDWORDs, &columns, counts);
+
+	m_pOpcodes = pOpcodes;
+
+	m_instructions.count			= counts.instructions;
+	m_instructions.pOffsets			= columns.pInstructionOffsets;
+	m_instructions.pFirstOperands	= columns.pFirstOperands;
+	m_instructions.pOpcodes			= columns.pOpcodes;
+
+	m_operands.count					= counts.operands;
+	m_operands.pIndexImmediates			= columns.pIndexImmediates;
+	m_operands.pOffsets					= columns.pOffsets;
+	m_operands.pValueOffsets			= columns.pValueOffsets;
+	m_operands.pIndexRelatives			= columns.pIndexRelatives;
+	m_operands.pLengths					= columns.pLengths;
+	m_operands.pTypes					= columns.pTypes;
+	m_operands.pFlags					= columns.pFlags;
+	m_operands.pNumComponents			= columns.pNumComponents;
+	m_operands.pSelectionModes			= columns.pSelectionModes;
+	m_operands.pComponents				= columns.pComponents;
+	m_operands.pModifiers				= columns.pModifiers;
+	m_operands.pIndexDimensions			= columns.pIndexDimensions;
+	m_operands.pIndexRepresentations	= columns.pIndexRepresentations;
+
+	return DXBC_PATCH_OK;
+}
+
+DXBCPatchStatus DXBCProgram::Decode(const DXBCLayout &layout)
+{
+	return Decode(layout.pOpcodes, layout.opcodeDWORDs);
+}
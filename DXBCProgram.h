@@ -0,0 +1,100 @@
+// Author: Henryk Kosobucki, 2016
+
+//=============================================	OVERVIEW =========================================================
+//	Decoded form of an opcode stream for analysis passes. Every instruction and every operand (relative index
+//	operands included) is expanded once into struct-of-arrays tables, so a pass scans the one field it cares
+//	about instead of parsing tokens again:
+//
+//		DXBCProgram program;
+//
+//		if(program.Decode(layout) == DXBC_PATCH_OK)
+//		{
+//			const DXBCOperandTable& operands = program.GetOperands();
+//
+//			for(unsigned int i = 0; i < operands.count; i++)
+//				if(operands.pTypes[i] == D3D10_SB_OPERAND_TYPE_TEMP && (operands.pFlags[i] & DXBC_OPERAND_DESTINATION))
+//					...
+//		}
+//
+//	All tables live in one arena owned by the program. Decoding counts instructions and operands first, so the
+//	arena is sized exactly and a whole shader costs at most one allocation. Decoding more shaders with the same
+//	program reuses the arena, once it has grown to the largest shader nothing is allocated anymore.
+//
+//	Operands are kept in the order of their tokens: an operand is followed by the operands of its relative
+//	indices (r1.z of cb0[r1.z + 2] comes right after cb0), all within the operand range of their instruction.
+//	Custom data blocks have no operands. Declarations get only their operand tokens, their other tokens (counts,
+//	return types, semantics) are left to the declaration's own layout.
+//================================================================================================================
+
+#ifndef DXBC_PROGRAM_H
+#define DXBC_PROGRAM_H
+
+#include "Patcher.h"
+
+#define DXBC_MAX_OPERAND_INDICES	3				// Index dimensions of an operand
+#define DXBC_NO_OPERAND				0xFFFFFFFF		// Index without relative part
+
+enum DXBCOperandFlags
+{
+	DXBC_OPERAND_DESTINATION	= 0x1,		// Written by its instruction (one of the leading operands)
+	DXBC_OPERAND_RELATIVE		= 0x2,		// Relative part of another operand's index
+};
+
+// Instruction i spans pOffsets[i] to pOffsets[i + 1] and owns operands pFirstOperands[i] to pFirstOperands[i + 1].
+struct DXBCInstructionTable
+{
+	unsigned int			count;
+	const unsigned int*		pOffsets;				// Opcode token (in DWORDs from the first opcode), followed by the end of stream
+	const unsigned int*		pFirstOperands;			// First operand of the instruction, followed by the operand count
+	const unsigned short*	pOpcodes;				// D3D10_SB_OPCODE_TYPE
+};
+
+// Indices are stored DXBC_MAX_OPERAND_INDICES per operand (operand i has index d at i * DXBC_MAX_OPERAND_INDICES + d).
+struct DXBCOperandTable
+{
+	unsigned int				count;
+	const unsigned long long*	pIndexImmediates;		// Immediate part of index (0 for purely relative ones)
+	const unsigned int*			pOffsets;				// Operand token (in DWORDs from the first opcode)
+	const unsigned int*			pValueOffsets;			// First index or immediate value, after the extended operand tokens
+	const unsigned int*			pIndexRelatives;		// Operand holding the relative part of index, or DXBC_NO_OPERAND
+	const BYTE*					pLengths;				// DWORDs of the operand, its relative operands included
+	const BYTE*					pTypes;					// D3D10_SB_OPERAND_TYPE
+	const BYTE*					pFlags;					// DXBCOperandFlags
+	const BYTE*					pNumComponents;			// D3D10_SB_OPERAND_NUM_COMPONENTS
+	const BYTE*					pSelectionModes;		// D3D10_SB_OPERAND_4_COMPONENT_SELECTION_MODE of four component operands
+	const BYTE*					pComponents;			// Write mask (bit per component), swizzle (two bits per component) or selected component
+	const BYTE*					pModifiers;				// D3D10_SB_OPERAND_MODIFIER from the extended operand token
+	const BYTE*					pIndexDimensions;		// D3D10_SB_OPERAND_INDEX_DIMENSION
+	const BYTE*					pIndexRepresentations;	// D3D10_SB_OPERAND_INDEX_REPRESENTATION
+};
+
+class DXBCProgram
+{
+public:
+	DXBCProgram();
+
+	// Decodes the opcode stream. DXBC_PATCH_INVALID_SHADER if an instruction is unknown, runs past the end of the
+	// stream or has a broken operand; the tables are empty then.
+	DXBCPatchStatus		Decode(	const DWORD		*pOpcodes,				//[In]	First opcode
+								unsigned int	inNumDWORDs				//[In]	Number of opcode DWORDs
+		);
+
+	DXBCPatchStatus		Decode(const DXBCLayout &layout);
+
+	const DWORD*				GetOpcodes() const { return m_pOpcodes; }
+	const DXBCInstructionTable&	GetInstructions() const { return m_instructions; }
+	const DXBCOperandTable&		GetOperands() const { return m_operands; }
+
+private:
+	DXBCProgram(const DXBCProgram&);
+	DXBCProgram&		operator=(const DXBCProgram&);
+
+	void				Clear();
+
+	const DWORD*			m_pOpcodes;
+	DXBCInstructionTable	m_instructions;
+	DXBCOperandTable		m_operands;
+	std::vector<BYTE>		m_arena;			// Storage of all the tables
+};
+
+#endif // DXBC_PROGRAM_H
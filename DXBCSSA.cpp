@@ -0,0 +1,649 @@
+//================================================================================================================
+// Include files
+//================================================================================================================
+#include "DXBCSSA.h"
+#include "d3d11TokenizedProgramFormat.hpp"
+#include "DXBCOpcodeInfo.h"
+#include <string.h>
+
+
+
+
+
+//================================================================================================================
+// Structures
+//================================================================================================================
+#define DXBC_NO_EDGE				0xFFFFFFFF		// End of edge list
+
+
+
+
+
+//================================================================================================================
+// Operands
+//================================================================================================================
+// Hull shader phases start over with their own temps, as does the program itself
+static bool IsPhase(unsigned int inOpcode)
+{
+	return	inOpcode == D3D11_SB_OPCODE_HS_DECLS || inOpcode == D3D11_SB_OPCODE_HS_CONTROL_POINT_PHASE ||
+			inOpcode == D3D11_SB_OPCODE_HS_FORK_PHASE || inOpcode == D3D11_SB_OPCODE_HS_JOIN_PHASE;
+}
+
+static bool IsCall(unsigned int inOpcode)
+{
+	return inOpcode == D3D10_SB_OPCODE_CALL || inOpcode == D3D10_SB_OPCODE_CALLC || inOpcode == D3D11_SB_OPCODE_INTERFACE_CALL;
+}
+
+static bool IsTemp(const DXBCOperandTable &operands, unsigned int inOperand)
+{
+	return operands.pTypes[inOperand] == D3D10_SB_OPERAND_TYPE_TEMP;
+}
+
+static unsigned int GetTempRegister(const DXBCOperandTable &operands, unsigned int inOperand)
+{
+	return (unsigned int)operands.pIndexImmediates[inOperand * DXBC_MAX_OPERAND_INDICES];
+}
+
+// Components written by destination operand, a bit per component
+static unsigned int GetWriteMask(const DXBCOperandTable &operands, unsigned int inOperand)
+{
+	if(operands.pNumComponents[inOperand] == D3D10_SB_OPERAND_1_COMPONENT)
+		return 0x1;
+
+	if(operands.pNumComponents[inOperand] != D3D10_SB_OPERAND_4_COMPONENT)
+		return 0;
+
+	if(operands.pSelectionModes[inOperand] == D3D10_SB_OPERAND_4_COMPONENT_MASK_MODE)
+		return operands.pComponents[inOperand];
+	else if(operands.pSelectionModes[inOperand] == D3D10_SB_OPERAND_4_COMPONENT_SELECT_1_MODE)
+		return 1u << operands.pComponents[inOperand];
+
+	return 0xF;
+}
+
+
+
+
+
+//================================================================================================================
+// Building
+//================================================================================================================
+DXBCSSA::DXBCSSA() : m_pProgram(nullptr), m_tempCount(0)
+{
+	memset(&m_valueTable, 0, sizeof(m_valueTable));
+	memset(&m_argumentTable, 0, sizeof(m_argumentTable));
+}
+
+unsigned int DXBCSSA::AddValue(DXBCValueKind inKind, unsigned int inVariable, unsigned int inInstruction, unsigned int inOperand)
+{
+	unsigned int value = (unsigned int)m_kinds.size();
+
+	m_instructions.push_back(inInstruction);
+	m_operands.push_back(inOperand);
+	m_registers.push_back(inVariable >> 2);
+	m_firstArguments.push_back((unsigned int)m_argumentValues.size());
+	m_argumentCounts.push_back(0);
+	m_components.push_back((BYTE)(inVariable & 3));
+	m_kinds.push_back((BYTE)inKind);
+
+	return value;
+}
+
+void DXBCSSA::AddEntryValues(unsigned int inInstruction)
+{
+	for(unsigned int variable = 0; variable < m_current.size(); variable++)
+		m_current[variable] = AddValue(DXBC_VALUE_ENTRY, variable, inInstruction, DXBC_NO_OPERAND);
+}
+
+unsigned int DXBCSSA::AddSnapshot()
+{
+	unsigned int snapshot = (unsigned int)(m_snapshots.size() / (m_current.size() ? m_current.size() : 1));
+
+	m_snapshots.insert(m_snapshots.end(), m_current.begin(), m_current.end());
+	return snapshot;
+}
+
+// Appends edge to the list, so merges see their edges in the order of the code
+void DXBCSSA::AddEdge(unsigned int &list, unsigned int inSnapshot, unsigned int inPredecessor)
+{
+	DXBCSSAEdge edge = { inSnapshot, inPredecessor, DXBC_NO_EDGE };
+	unsigned int* pLink = &list;
+
+	while(*pLink != DXBC_NO_EDGE)
+		pLink = &m_edges[*pLink].next;
+
+	*pLink = (unsigned int)m_edges.size();
+	m_edges.push_back(edge);
+}
+
+// Current values become the merge of the edges, with phis for variables the edges disagree on. Returns false
+// when no edge reaches the merge (current values are left alone then).
+bool DXBCSSA::Merge(unsigned int inEdges, unsigned int inInstruction)
+{
+	unsigned int variables = (unsigned int)m_current.size();
+
+	if(inEdges == DXBC_NO_EDGE)
+		return false;
+
+	for(unsigned int variable = 0; variable < variables; variable++)
+	{
+		unsigned int value = m_snapshots[m_edges[inEdges].snapshot * variables + variable];
+		bool isSame = true;
+
+		for(unsigned int edge = m_edges[inEdges].next; edge != DXBC_NO_EDGE && isSame; edge = m_edges[edge].next)
+			isSame = (m_snapshots[m_edges[edge].snapshot * variables + variable] == value);
+
+		if(!isSame)
+		{
+			value = AddValue(DXBC_VALUE_PHI, variable, inInstruction, DXBC_NO_OPERAND);
+
+			for(unsigned int edge = inEdges; edge != DXBC_NO_EDGE; edge = m_edges[edge].next)
+			{
+				m_argumentValues.push_back(m_snapshots[m_edges[edge].snapshot * variables + variable]);
+				m_argumentPredecessors.push_back(m_edges[edge].predecessor);
+				m_argumentCounts[value]++;
+			}
+		}
+
+		m_current[variable] = value;
+	}
+
+	return true;
+}
+
+void DXBCSSA::ReadOperand(unsigned int inOperand)
+{
+	const DXBCOperandTable& operands = m_pProgram->GetOperands();
+	unsigned int* pValues = &m_operandValues[inOperand * 4];
+	const unsigned int* pCurrent = &m_current[GetTempRegister(operands, inOperand) * 4];
+	unsigned int components = operands.pComponents[inOperand];
+
+	if(operands.pNumComponents[inOperand] == D3D10_SB_OPERAND_1_COMPONENT)
+	{
+		pValues[0] = pCurrent[0];
+	}
+	else if(operands.pNumComponents[inOperand] == D3D10_SB_OPERAND_4_COMPONENT)
+	{
+		switch(operands.pSelectionModes[inOperand])
+		{
+		case D3D10_SB_OPERAND_4_COMPONENT_MASK_MODE:
+			for(unsigned int i = 0; i < 4; i++)
+				if(components & (1u << i))
+					pValues[i] = pCurrent[i];
+			break;
+		case D3D10_SB_OPERAND_4_COMPONENT_SWIZZLE_MODE:
+			for(unsigned int i = 0; i < 4; i++)
+				pValues[i] = pCurrent[(components >> (i * 2)) & 3];
+			break;
+		case D3D10_SB_OPERAND_4_COMPONENT_SELECT_1_MODE:
+			pValues[0] = pCurrent[components & 3];
+			break;
+		}
+	}
+}
+
+void DXBCSSA::WriteOperand(unsigned int inOperand, unsigned int inInstruction)
+{
+	const DXBCOperandTable& operands = m_pProgram->GetOperands();
+	unsigned int variable = GetTempRegister(operands, inOperand) * 4;
+	unsigned int mask = GetWriteMask(operands, inOperand);
+
+	for(unsigned int i = 0; i < 4; i++)
+	{
+		if(mask & (1u << i))
+		{
+			unsigned int value = AddValue(DXBC_VALUE_DEFINITION, variable + i, inInstruction, inOperand);
+
+			m_operandValues[inOperand * 4 + i] = value;
+			m_current[variable + i] = value;
+		}
+	}
+}
+
+// Finds the variables every loop writes (nested loops and calls included), so only those get header phis
+bool DXBCSSA::MarkLoopDefinitions()
+{
+	const DXBCInstructionTable& instructions = m_pProgram->GetInstructions();
+	const DXBCOperandTable& operands = m_pProgram->GetOperands();
+	unsigned int words = (m_tempCount * 4 + 31) / 32;
+	unsigned int loopCount = 0;
+
+	m_loops.clear();
+	m_loopDefinitions.clear();
+
+	for(unsigned int i = 0; i < instructions.count; i++)
+	{
+		unsigned int opcode = instructions.pOpcodes[i];
+
+		if(opcode == D3D10_SB_OPCODE_LOOP)
+		{
+			m_loops.push_back(loopCount++);
+			m_loopDefinitions.resize(loopCount * words, 0);
+			continue;
+		}
+
+		if(opcode == D3D10_SB_OPCODE_ENDLOOP)
+		{
+			if(m_loops.empty())
+				return false;
+
+			unsigned int loop = m_loops.back();
+
+			m_loops.pop_back();
+
+			if(!m_loops.empty())
+			{
+				for(unsigned int word = 0; word < words; word++)
+					m_loopDefinitions[m_loops.back() * words + word] |= m_loopDefinitions[loop * words + word];
+			}
+
+			continue;
+		}
+
+		if(m_loops.empty())
+			continue;
+
+		DWORD* pDefinitions = m_loopDefinitions.data() + m_loops.back() * words;
+
+		if(IsCall(opcode))
+		{
+			for(unsigned int variable = 0; variable < m_tempCount * 4; variable++)
+				pDefinitions[variable / 32] |= 1u << (variable % 32);
+		}
+
+		for(unsigned int operand = instructions.pFirstOperands[i]; operand < instructions.pFirstOperands[i + 1]; operand++)
+		{
+			if(!IsTemp(operands, operand) || !(operands.pFlags[operand] & DXBC_OPERAND_DESTINATION))
+				continue;
+
+			unsigned int variable = GetTempRegister(operands, operand) * 4;
+			unsigned int mask = GetWriteMask(operands, operand);
+
+			for(unsigned int component = 0; component < 4; component++)
+				if(mask & (1u << component))
+					pDefinitions[(variable + component) / 32] |= 1u << ((variable + component) % 32);
+		}
+	}
+
+	return true;
+}
+
+DXBCPatchStatus DXBCSSA::Build(const DXBCProgram &program)
+{
+	const DXBCInstructionTable& instructions = program.GetInstructions();
+	const DXBCOperandTable& operands = program.GetOperands();
+
+	m_pProgram = &program;
+	m_tempCount = 0;
+
+	m_instructions.clear();
+	m_operands.clear();
+	m_registers.clear();
+	m_firstArguments.clear();
+	m_argumentCounts.clear();
+	m_components.clear();
+	m_kinds.clear();
+	m_argumentValues.clear();
+	m_argumentPredecessors.clear();
+	m_snapshots.clear();
+	m_edges.clear();
+	m_blocks.clear();
+
+	memset(&m_valueTable, 0, sizeof(m_valueTable));
+	memset(&m_argumentTable, 0, sizeof(m_argumentTable));
+
+	// Temps are indexed by a single immediate
+	for(unsigned int operand = 0; operand < operands.count; operand++)
+	{
+		if(!IsTemp(operands, operand))
+			continue;
+
+		if(	operands.pIndexDimensions[operand] != D3D10_SB_OPERAND_INDEX_1D ||
+			operands.pIndexRepresentations[operand * DXBC_MAX_OPERAND_INDICES] != D3D10_SB_OPERAND_INDEX_IMMEDIATE32 ||
+			operands.pIndexImmediates[operand * DXBC_MAX_OPERAND_INDICES] >= DXBC_MAX_TEMPS)
+			return DXBC_PATCH_INVALID_SHADER;
+
+		if(GetTempRegister(operands, operand) >= m_tempCount)
+			m_tempCount = GetTempRegister(operands, operand) + 1;
+	}
+
+	if(!MarkLoopDefinitions())
+		return DXBC_PATCH_INVALID_SHADER;
+
+	unsigned int words = (m_tempCount * 4 + 31) / 32;
+	unsigned int loopCount = 0;
+	bool isReachable = true;
+
+	m_operandValues.assign(operands.count * 4, DXBC_NO_VALUE);
+	m_current.resize(m_tempCount * 4);
+
+	AddEntryValues(0);
+
+	for(unsigned int i = 0; i < instructions.count; i++)
+	{
+		unsigned int opcode = instructions.pOpcodes[i];
+		unsigned int firstOperand = instructions.pFirstOperands[i];
+		unsigned int endOperand = instructions.pFirstOperands[i + 1];
+		DXBCSSABlock* pBlock = m_blocks.empty() ? nullptr : &m_blocks.back();
+
+		// Sources (relative indices of destinations too) read values before the instruction writes any
+		for(unsigned int operand = firstOperand; operand < endOperand; operand++)
+			if(IsTemp(operands, operand) && !(operands.pFlags[operand] & DXBC_OPERAND_DESTINATION))
+				ReadOperand(operand);
+
+		switch(opcode)
+		{
+		case D3D10_SB_OPCODE_IF:
+		case D3D10_SB_OPCODE_LOOP:
+		case D3D10_SB_OPCODE_SWITCH:
+			{
+				DXBCSSABlock block = { opcode, i, AddSnapshot(), DXBC_NO_EDGE, DXBC_NO_EDGE, (unsigned int)m_kinds.size(), 0, isReachable, false };
+
+				if(opcode == D3D10_SB_OPCODE_LOOP)
+				{
+					const DWORD* pDefinitions = m_loopDefinitions.data() + loopCount++ * words;
+
+					for(unsigned int variable = 0; variable < m_current.size(); variable++)
+					{
+						if(pDefinitions[variable / 32] & (1u << (variable % 32)))
+						{
+							m_current[variable] = AddValue(DXBC_VALUE_PHI, variable, i, DXBC_NO_OPERAND);
+							block.phiCount++;
+						}
+					}
+				}
+
+				// Nothing reaches code between SWITCH and its first CASE
+				if(opcode == D3D10_SB_OPCODE_SWITCH)
+					isReachable = false;
+
+				m_blocks.push_back(block);
+			}
+			break;
+
+		case D3D10_SB_OPCODE_ELSE:
+			if(!pBlock || pBlock->opcode != D3D10_SB_OPCODE_IF || pBlock->hasAlternative)
+				return DXBC_PATCH_INVALID_SHADER;
+
+			if(isReachable)
+				AddEdge(pBlock->exits, AddSnapshot(), i);
+
+			memcpy(m_current.data(), m_snapshots.data() + pBlock->entry * m_current.size(), m_current.size() * sizeof(unsigned int));
+			isReachable = pBlock->isEntryReachable;
+			pBlock->hasAlternative = true;
+			break;
+
+		case D3D10_SB_OPCODE_ENDIF:
+			if(!pBlock || pBlock->opcode != D3D10_SB_OPCODE_IF)
+				return DXBC_PATCH_INVALID_SHADER;
+
+			if(isReachable)
+				AddEdge(pBlock->exits, AddSnapshot(), i);
+
+			// Without ELSE the condition can skip the block
+			if(!pBlock->hasAlternative && pBlock->isEntryReachable)
+				AddEdge(pBlock->exits, pBlock->entry, pBlock->instruction);
+
+			isReachable = Merge(pBlock->exits, i);
+			m_blocks.pop_back();
+			break;
+
+		case D3D10_SB_OPCODE_BREAK:
+		case D3D10_SB_OPCODE_BREAKC:
+		case D3D10_SB_OPCODE_CONTINUE:
+		case D3D10_SB_OPCODE_CONTINUEC:
+			{
+				bool isBreak = (opcode == D3D10_SB_OPCODE_BREAK || opcode == D3D10_SB_OPCODE_BREAKC);
+				size_t target = m_blocks.size();
+
+				// Breaks leave the innermost loop or switch, continues go to the innermost loop
+				while(	target > 0 && m_blocks[target - 1].opcode != D3D10_SB_OPCODE_LOOP &&
+						(!isBreak || m_blocks[target - 1].opcode != D3D10_SB_OPCODE_SWITCH))
+					target--;
+
+				if(target == 0)
+					return DXBC_PATCH_INVALID_SHADER;
+
+				if(isReachable)
+					AddEdge(isBreak ? m_blocks[target - 1].exits : m_blocks[target - 1].continues, AddSnapshot(), i);
+
+				if(opcode == D3D10_SB_OPCODE_BREAK || opcode == D3D10_SB_OPCODE_CONTINUE)
+					isReachable = false;
+			}
+			break;
+
+		case D3D10_SB_OPCODE_ENDLOOP:
+			if(!pBlock || pBlock->opcode != D3D10_SB_OPCODE_LOOP)
+				return DXBC_PATCH_INVALID_SHADER;
+
+			if(isReachable)
+				AddEdge(pBlock->continues, AddSnapshot(), i);
+
+			// Header phis take the value from before the loop and from every edge back to its start
+			for(unsigned int phi = pBlock->firstPhi; phi < pBlock->firstPhi + pBlock->phiCount; phi++)
+			{
+				unsigned int variable = m_registers[phi] * 4 + m_components[phi];
+
+				m_firstArguments[phi] = (unsigned int)m_argumentValues.size();
+				m_argumentValues.push_back(m_snapshots[pBlock->entry * m_current.size() + variable]);
+				m_argumentPredecessors.push_back(pBlock->instruction);
+
+				for(unsigned int edge = pBlock->continues; edge != DXBC_NO_EDGE; edge = m_edges[edge].next)
+				{
+					m_argumentValues.push_back(m_snapshots[m_edges[edge].snapshot * m_current.size() + variable]);
+					m_argumentPredecessors.push_back(m_edges[edge].predecessor);
+				}
+
+				m_argumentCounts[phi] = (unsigned int)m_argumentValues.size() - m_firstArguments[phi];
+			}
+
+			isReachable = Merge(pBlock->exits, i);
+			m_blocks.pop_back();
+			break;
+
+		case D3D10_SB_OPCODE_CASE:
+		case D3D10_SB_OPCODE_DEFAULT:
+			{
+				unsigned int edges = DXBC_NO_EDGE;
+
+				if(!pBlock || pBlock->opcode != D3D10_SB_OPCODE_SWITCH)
+					return DXBC_PATCH_INVALID_SHADER;
+
+				if(opcode == D3D10_SB_OPCODE_DEFAULT)
+				{
+					if(pBlock->hasAlternative)
+						return DXBC_PATCH_INVALID_SHADER;
+
+					pBlock->hasAlternative = true;
+				}
+
+				// Falling through from the case above, or jumping here from SWITCH
+				if(isReachable)
+					AddEdge(edges, AddSnapshot(), i);
+
+				if(pBlock->isEntryReachable)
+					AddEdge(edges, pBlock->entry, pBlock->instruction);
+
+				isReachable = Merge(edges, i);
+			}
+			break;
+
+		case D3D10_SB_OPCODE_ENDSWITCH:
+			if(!pBlock || pBlock->opcode != D3D10_SB_OPCODE_SWITCH)
+				return DXBC_PATCH_INVALID_SHADER;
+
+			if(isReachable)
+				AddEdge(pBlock->exits, AddSnapshot(), i);
+
+			// Without DEFAULT the selector can skip all cases
+			if(!pBlock->hasAlternative && pBlock->isEntryReachable)
+				AddEdge(pBlock->exits, pBlock->entry, pBlock->instruction);
+
+			isReachable = Merge(pBlock->exits, i);
+			m_blocks.pop_back();
+			break;
+
+		case D3D10_SB_OPCODE_RET:
+			isReachable = false;
+			break;
+
+		case D3D10_SB_OPCODE_CALL:
+		case D3D10_SB_OPCODE_CALLC:
+		case D3D11_SB_OPCODE_INTERFACE_CALL:
+			for(unsigned int variable = 0; variable < m_current.size(); variable++)
+				m_current[variable] = AddValue(DXBC_VALUE_CALL, variable, i, DXBC_NO_OPERAND);
+			break;
+
+		case D3D10_SB_OPCODE_LABEL:
+		case D3D11_SB_OPCODE_HS_DECLS:
+		case D3D11_SB_OPCODE_HS_CONTROL_POINT_PHASE:
+		case D3D11_SB_OPCODE_HS_FORK_PHASE:
+		case D3D11_SB_OPCODE_HS_JOIN_PHASE:
+			if(pBlock)
+				return DXBC_PATCH_INVALID_SHADER;
+
+			AddEntryValues(i);
+			isReachable = true;
+			break;
+		}
+
+		for(unsigned int operand = firstOperand; operand < endOperand; operand++)
+			if(IsTemp(operands, operand) && (operands.pFlags[operand] & DXBC_OPERAND_DESTINATION))
+				WriteOperand(operand, i);
+	}
+
+	if(!m_blocks.empty())
+		return DXBC_PATCH_INVALID_SHADER;
+
+	m_valueTable.count				= (unsigned int)m_kinds.size();
+	m_valueTable.pInstructions		= m_instructions.data();
+	m_valueTable.pOperands			= m_operands.data();
+	m_valueTable.pRegisters			= m_registers.data();
+	m_valueTable.pFirstArguments	= m_firstArguments.data();
+	m_valueTable.pArgumentCounts	= m_argumentCounts.data();
+	m_valueTable.pComponents		= m_components.data();
+	m_valueTable.pKinds				= m_kinds.data();
+
+	m_argumentTable.count			= (unsigned int)m_argumentValues.size();
+	m_argumentTable.pValues			= m_argumentValues.data();
+	m_argumentTable.pPredecessors	= m_argumentPredecessors.data();
+
+	return DXBC_PATCH_OK;
+}
+
+
+
+
+
+//================================================================================================================
+// Encoding
+//================================================================================================================
+// Register of temp operand from the values of its components, DXBC_NO_VALUE when they disagree
+unsigned int DXBCSSA::GetOperandRegister(unsigned int inOperand) const
+{
+	unsigned int tempRegister = DXBC_NO_VALUE;
+
+	for(unsigned int i = 0; i < 4; i++)
+	{
+		unsigned int value = m_operandValues[inOperand * 4 + i];
+
+		if(value == DXBC_NO_VALUE)
+			continue;
+
+		if(tempRegister != DXBC_NO_VALUE && m_registers[value] != tempRegister)
+			return DXBC_NO_VALUE;
+
+		tempRegister = m_registers[value];
+	}
+
+	// Operand touching no component keeps its register
+	return (tempRegister != DXBC_NO_VALUE) ? tempRegister : GetTempRegister(m_pProgram->GetOperands(), inOperand);
+}
+
+DXBCPatchStatus DXBCSSA::Encode(	std::vector<DWORD>	&opcodes			//[Out]	Opcodes are appended here
+	) const
+{
+	if(!m_pProgram)
+		return DXBC_PATCH_NOT_PARSED;
+
+	const DXBCInstructionTable& instructions = m_pProgram->GetInstructions();
+	const DXBCOperandTable& operands = m_pProgram->GetOperands();
+	const DWORD* pOpcodes = m_pProgram->GetOpcodes();
+	size_t startSize = opcodes.size();
+
+	// Phis have to stay in the register of their arguments, there are no copies to put on the edges
+	for(unsigned int value = 0; value < m_kinds.size(); value++)
+	{
+		for(unsigned int argument = m_firstArguments[value]; argument < m_firstArguments[value] + m_argumentCounts[value]; argument++)
+		{
+			if(m_registers[m_argumentValues[argument]] != m_registers[value])
+				return DXBC_PATCH_INVALID_EDIT;
+		}
+	}
+
+	// Program and every hull shader phase have their own dcl_temps
+	for(unsigned int segmentStart = 0; segmentStart < instructions.count; )
+	{
+		unsigned int segmentEnd = segmentStart + 1;
+		unsigned int body = DXBC_NO_VALUE;
+		unsigned int tempCount = 0;
+		bool hasTempsDeclaration = false;
+
+		while(segmentEnd < instructions.count && !IsPhase(instructions.pOpcodes[segmentEnd]))
+			segmentEnd++;
+
+		for(unsigned int i = segmentStart; i < segmentEnd; i++)
+		{
+			unsigned int opcode = instructions.pOpcodes[i];
+
+			if(opcode == D3D10_SB_OPCODE_DCL_TEMPS)
+				hasTempsDeclaration = true;
+			else if(body == DXBC_NO_VALUE && !IsDXBCDeclaration(opcode) && opcode != D3D10_SB_OPCODE_CUSTOMDATA && !IsPhase(opcode))
+				body = i;
+
+			for(unsigned int operand = instructions.pFirstOperands[i]; operand < instructions.pFirstOperands[i + 1]; operand++)
+			{
+				if(!IsTemp(operands, operand))
+					continue;
+
+				unsigned int tempRegister = GetOperandRegister(operand);
+
+				if(tempRegister >= DXBC_MAX_TEMPS)
+				{
+					opcodes.resize(startSize);
+					return DXBC_PATCH_INVALID_EDIT;
+				}
+
+				if(tempRegister >= tempCount)
+					tempCount = tempRegister + 1;
+			}
+		}
+
+		for(unsigned int i = segmentStart; i < segmentEnd; i++)
+		{
+			unsigned int offset = instructions.pOffsets[i];
+			unsigned int length = instructions.pOffsets[i + 1] - offset;
+			size_t position = opcodes.size();
+
+			if(i == body && !hasTempsDeclaration && tempCount)
+			{
+				opcodes.push_back(ENCODE_D3D10_SB_OPCODE_TYPE(D3D10_SB_OPCODE_DCL_TEMPS) | ENCODE_D3D10_SB_TOKENIZED_INSTRUCTION_LENGTH(2));
+				opcodes.push_back(tempCount);
+				position += 2;
+			}
+
+			opcodes.insert(opcodes.end(), pOpcodes + offset, pOpcodes + offset + length);
+
+			if(instructions.pOpcodes[i] == D3D10_SB_OPCODE_DCL_TEMPS && length >= 2)
+				opcodes[position + 1] = tempCount;
+
+			for(unsigned int operand = instructions.pFirstOperands[i]; operand < instructions.pFirstOperands[i + 1]; operand++)
+				if(IsTemp(operands, operand))
+					opcodes[position + operands.pValueOffsets[operand] - offset] = GetOperandRegister(operand);
+		}
+
+		segmentStart = segmentEnd;
+	}
+
+	return DXBC_PATCH_OK;
+}
@@ -0,0 +1,154 @@
+// Author: Henryk Kosobucki, 2016
+
+//=============================================	OVERVIEW =========================================================
+//	Static single assignment form over the temp registers (r#) of a decoded program, and the encoder turning it
+//	back into an opcode stream:
+//
+//		DXBCProgram program;
+//		DXBCSSA ssa;
+//
+//		if(program.Decode(layout) == DXBC_PATCH_OK && ssa.Build(program) == DXBC_PATCH_OK)
+//		{
+//			...										// Analyse or rename values
+//			ssa.Encode(opcodes);					// Opcode stream with dcl_temps fixed
+//			document.Emit(&span, 1, pDstData);		// SHEX chunk with the new opcodes (span covers opcodes)
+//		}
+//
+//	Every component of every temp register is a variable of its own (r1.y is register 1, component 1), as the
+//	write masks make partial writes the norm. Values are defined by destination operands, by phis where control
+//	flow merges, by calls (a subroutine may write any temp) and on entry to the program, a subroutine or a hull
+//	shader phase. Operands map to values through GetOperandValues, four entries per operand record: for sources
+//	the value read by every swizzle position, for destinations the value written to every masked component.
+//
+//	Flow is structured, so phis are placed in one forward walk without building a graph: after ENDIF (then and
+//	else exits), after CASE / DEFAULT (fall through and switch entry), after ENDSWITCH and ENDLOOP (breaks) and
+//	after LOOP (entry, continues and the back edge). Loop header phis are placed only for components written
+//	somewhere in the loop. Phi arguments name the instruction their edge leaves from.
+//
+//	Values stay in the register they came from, so an unmodified program encodes back to the same tokens (only
+//	a dcl_temps larger than what is used shrinks). Passes may move a value to another register with SetRegister;
+//	Encode refuses the result (DXBC_PATCH_INVALID_EDIT) unless every phi stays in one register with its
+//	arguments and all components of an operand agree on their register.
+//================================================================================================================
+
+#ifndef DXBC_SSA_H
+#define DXBC_SSA_H
+
+#include "DXBCProgram.h"
+
+#define DXBC_NO_VALUE				0xFFFFFFFF		// Operand component without value
+#define DXBC_MAX_TEMPS				4096			// r# limit of the shader models
+
+enum DXBCValueKind
+{
+	DXBC_VALUE_ENTRY = 0,			// Register component on entry to program, subroutine or hull shader phase
+	DXBC_VALUE_DEFINITION,			// Written by destination operand
+	DXBC_VALUE_PHI,					// Merge of values where control flow joins
+	DXBC_VALUE_CALL,				// Left by a subroutine or interface call
+};
+
+// Phi v has arguments pFirstArguments[v] to pFirstArguments[v] + pArgumentCounts[v] in DXBCPhiArgumentTable.
+struct DXBCValueTable
+{
+	unsigned int			count;
+	const unsigned int*		pInstructions;			// Defining instruction (phis and entry values take effect after it)
+	const unsigned int*		pOperands;				// Destination operand of definitions, DXBC_NO_OPERAND for others
+	const unsigned int*		pRegisters;				// r#
+	const unsigned int*		pFirstArguments;		// Phi arguments
+	const unsigned int*		pArgumentCounts;
+	const BYTE*				pComponents;			// Component of r#
+	const BYTE*				pKinds;					// DXBCValueKind
+};
+
+struct DXBCPhiArgumentTable
+{
+	unsigned int			count;
+	const unsigned int*		pValues;				// Incoming value
+	const unsigned int*		pPredecessors;			// Instruction the edge leaves from
+};
+
+// Open IF, LOOP or SWITCH block while building
+struct DXBCSSABlock
+{
+	unsigned int			opcode;					// D3D10_SB_OPCODE_IF, D3D10_SB_OPCODE_LOOP or D3D10_SB_OPCODE_SWITCH
+	unsigned int			instruction;			// Opening instruction
+	unsigned int			entry;					// Snapshot of values on entry
+	unsigned int			exits;					// Edges to the end of block (else, break, default...)
+	unsigned int			continues;				// Edges back to loop header
+	unsigned int			firstPhi;				// Loop header phis
+	unsigned int			phiCount;
+	bool					isEntryReachable;
+	bool					hasAlternative;			// IF has its ELSE, SWITCH its DEFAULT
+};
+
+// Control flow edge carrying the values along it
+struct DXBCSSAEdge
+{
+	unsigned int			snapshot;				// Values (index of snapshot)
+	unsigned int			predecessor;			// Instruction the edge leaves from
+	unsigned int			next;					// Next edge of the same list
+};
+
+class DXBCSSA
+{
+public:
+	DXBCSSA();
+
+	// Builds SSA form of the program, which has to outlive it. DXBC_PATCH_INVALID_SHADER on unbalanced flow
+	// (ELSE without IF, BREAK outside of loop and switch, LABEL inside a block...) or indexed temps.
+	DXBCPatchStatus		Build(const DXBCProgram &program);
+
+	// Writes the program's opcode stream with temps taken from the values' registers and every dcl_temps set to
+	// the registers used (added after the declarations if missing).
+	DXBCPatchStatus		Encode(	std::vector<DWORD>	&opcodes			//[Out]	Opcodes are appended here
+		) const;
+
+	void				SetRegister(unsigned int inValue, unsigned int inRegister) { m_registers[inValue] = inRegister; }
+
+	unsigned int				GetTempCount() const { return m_tempCount; }
+	const DXBCValueTable&		GetValues() const { return m_valueTable; }
+	const DXBCPhiArgumentTable&	GetPhiArguments() const { return m_argumentTable; }
+	const unsigned int*			GetOperandValues() const { return m_operandValues.data(); }	// Four per operand record
+
+private:
+	DXBCSSA(const DXBCSSA&);
+	DXBCSSA&			operator=(const DXBCSSA&);
+
+	bool				MarkLoopDefinitions();
+	unsigned int		AddValue(DXBCValueKind inKind, unsigned int inVariable, unsigned int inInstruction, unsigned int inOperand);
+	void				AddEntryValues(unsigned int inInstruction);
+	unsigned int		AddSnapshot();
+	void				AddEdge(unsigned int &list, unsigned int inSnapshot, unsigned int inPredecessor);
+	bool				Merge(unsigned int inEdges, unsigned int inInstruction);
+	void				ReadOperand(unsigned int inOperand);
+	void				WriteOperand(unsigned int inOperand, unsigned int inInstruction);
+	unsigned int		GetOperandRegister(unsigned int inOperand) const;
+
+	const DXBCProgram*			m_pProgram;
+	unsigned int				m_tempCount;
+
+	// Values and phi arguments
+	std::vector<unsigned int>	m_instructions;
+	std::vector<unsigned int>	m_operands;
+	std::vector<unsigned int>	m_registers;
+	std::vector<unsigned int>	m_firstArguments;
+	std::vector<unsigned int>	m_argumentCounts;
+	std::vector<BYTE>			m_components;
+	std::vector<BYTE>			m_kinds;
+	std::vector<unsigned int>	m_argumentValues;
+	std::vector<unsigned int>	m_argumentPredecessors;
+	std::vector<unsigned int>	m_operandValues;
+
+	// Scratch of Build, kept to reuse its storage
+	std::vector<unsigned int>	m_current;			// Value of every variable at the current instruction
+	std::vector<unsigned int>	m_snapshots;		// Copies of m_current carried by edges
+	std::vector<DXBCSSAEdge>	m_edges;
+	std::vector<DXBCSSABlock>	m_blocks;			// Open IF, LOOP and SWITCH blocks
+	std::vector<unsigned int>	m_loops;			// Open loops while marking their definitions
+	std::vector<DWORD>			m_loopDefinitions;	// Bit per variable written in every loop
+
+	DXBCValueTable				m_valueTable;
+	DXBCPhiArgumentTable		m_argumentTable;
+};
+
+#endif // DXBC_SSA_H
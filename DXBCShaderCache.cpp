@@ -0,0 +1,416 @@
+//================================================================================================================
+// Include files
+//================================================================================================================
+#include "DXBCShaderCache.h"
+#include <atomic>
+#include <mutex>
+#include <stdint.h>
+#include <string.h>
+#include <vector>
+
+
+
+
+
+//================================================================================================================
+// Macro definitions
+//================================================================================================================
+// Number of shards (power of two). Shaders are spread by the first checksum DWORD.
+#define DXBC_CACHE_SHARDS			16
+
+// Entry reference word: live flag and number of readers pinning the entry
+#define DXBC_CACHE_LIVE				0x80000000u
+
+
+
+
+
+//================================================================================================================
+// Structures
+//================================================================================================================
+struct DXBCShaderCacheEntry
+{
+	std::atomic<unsigned int>	refs;			// DXBC_CACHE_LIVE while in the cache, plus number of pins
+	std::atomic<DWORD>			tag;			// Copy of second checksum DWORD, lets lookups skip entries without pinning
+	std::atomic<bool>			referenced;		// CLOCK bit, set by every hit
+
+	// Written only while the entry is not live
+	DWORD						checksum[4];
+	unsigned int				srcSize;
+	unsigned int				patchedSize;
+	unsigned int				bucket;			// Bucket pointing to the entry
+	std::vector<BYTE>			data;			// Original shader followed by patched one
+};
+
+struct DXBCShaderCacheShard
+{
+	// Read by lookups
+	std::unique_ptr<std::atomic<DXBCShaderCacheEntry*>[]>	buckets;		// Open addressing, linear probing
+	unsigned int											bucketMask;
+
+	// Changed only under insertLock
+	std::mutex								insertLock;
+	std::unique_ptr<DXBCShaderCacheEntry[]>	entries;
+	unsigned int							entryCount;
+	std::vector<unsigned int>				freeEntries;
+	unsigned int							clockHand;
+	size_t									bytes;
+	size_t									maxBytes;
+
+	// Statistics
+	std::atomic<unsigned long long>			hits;
+	std::atomic<unsigned long long>			misses;
+	std::atomic<unsigned long long>			inserts;
+	std::atomic<unsigned long long>			evictions;
+	std::atomic<unsigned long long>			failedInserts;
+
+	// Keeps statistics (written by every lookup) away from buckets of the next shard
+	char									padding[64];
+};
+
+// Bucket of an evicted entry. Lookups walk over it, inserts reuse it.
+static DXBCShaderCacheEntry* const s_pTombstone = reinterpret_cast<DXBCShaderCacheEntry*>(uintptr_t(1));
+
+
+
+
+
+//================================================================================================================
+// Function definitions
+//================================================================================================================
+// Pins entry unless it is not in the cache (being evicted or filled)
+static bool PinEntry(DXBCShaderCacheEntry *pEntry)
+{
+	unsigned int refs = pEntry->refs.load(std::memory_order_relaxed);
+
+	while(refs & DXBC_CACHE_LIVE)
+	{
+		if(pEntry->refs.compare_exchange_weak(refs, refs + 1, std::memory_order_acquire, std::memory_order_relaxed))
+			return true;
+	}
+
+	return false;
+}
+
+static void UnpinEntry(DXBCShaderCacheEntry *pEntry)
+{
+	pEntry->refs.fetch_sub(1, std::memory_order_release);
+}
+
+// Finds and pins entry of the shader. Safe to run concurrently with inserts and evictions: entry is checked only
+// after it is pinned, as it might have been evicted and reused for another shader since the bucket was read.
+static DXBCShaderCacheEntry* FindEntry(DXBCShaderCacheShard &shard, const BYTE *pSrcData, unsigned int inSrcSize)
+{
+	const DWORD* pChecksum = (const DWORD*)pSrcData + 1;
+
+	for(unsigned int i = 0; i <= shard.bucketMask; i++)
+	{
+		DXBCShaderCacheEntry* pEntry = shard.buckets[(pChecksum[1] + i) & shard.bucketMask].load(std::memory_order_acquire);
+
+		if(!pEntry)
+			break;
+
+		if(pEntry == s_pTombstone || pEntry->tag.load(std::memory_order_relaxed) != pChecksum[1] || !PinEntry(pEntry))
+			continue;
+
+		if(	pEntry->srcSize == inSrcSize &&
+			memcmp(pEntry->checksum, pChecksum, sizeof(pEntry->checksum)) == 0 &&
+			memcmp(pEntry->data.data(), pSrcData, inSrcSize) == 0)
+		{
+			return pEntry;
+		}
+
+		UnpinEntry(pEntry);
+	}
+
+	return nullptr;
+}
+
+// Evicts next unpinned entry which was not hit since CLOCK hand passed it last time. Returns false if every
+// entry is pinned. Called under insertLock.
+static bool EvictEntry(DXBCShaderCacheShard &shard)
+{
+	for(unsigned int i = 0; i < 2 * shard.entryCount; i++)
+	{
+		unsigned int index = shard.clockHand;
+		DXBCShaderCacheEntry &entry = shard.entries[index];
+
+		shard.clockHand = (shard.clockHand + 1) % shard.entryCount;
+
+		if(!(entry.refs.load(std::memory_order_relaxed) & DXBC_CACHE_LIVE))
+			continue;
+
+		// Second chance
+		if(entry.referenced.load(std::memory_order_relaxed))
+		{
+			entry.referenced.store(false, std::memory_order_relaxed);
+			continue;
+		}
+
+		// Only entries nobody has pinned, once it is not live no lookup can pin it anymore
+		unsigned int refs = DXBC_CACHE_LIVE;
+
+		if(!entry.refs.compare_exchange_strong(refs, 0, std::memory_order_acquire, std::memory_order_relaxed))
+			continue;
+
+		shard.buckets[entry.bucket].store(s_pTombstone, std::memory_order_release);
+
+		// Tombstones in front of an empty bucket don't continue any probe sequence, so they can go
+		for(unsigned int bucket = entry.bucket; shard.buckets[(bucket + 1) & shard.bucketMask].load(std::memory_order_relaxed) == nullptr &&
+			shard.buckets[bucket].load(std::memory_order_relaxed) == s_pTombstone; bucket = (bucket - 1) & shard.bucketMask)
+		{
+			shard.buckets[bucket].store(nullptr, std::memory_order_release);
+		}
+
+		shard.bytes -= entry.data.size();
+		std::vector<BYTE>().swap(entry.data);
+		shard.freeEntries.push_back(index);
+		shard.evictions.fetch_add(1, std::memory_order_relaxed);
+
+		return true;
+	}
+
+	return false;
+}
+
+
+
+
+
+//================================================================================================================
+// DXBCCachedShader
+//================================================================================================================
+DXBCCachedShader::DXBCCachedShader() : m_pEntry(nullptr)
+{
+}
+
+DXBCCachedShader::DXBCCachedShader(DXBCCachedShader &&other) : m_pEntry(other.m_pEntry)
+{
+	other.m_pEntry = nullptr;
+}
+
+DXBCCachedShader::~DXBCCachedShader()
+{
+	Release();
+}
+
+DXBCCachedShader& DXBCCachedShader::operator=(DXBCCachedShader &&other)
+{
+	if(this != &other)
+	{
+		Release();
+		m_pEntry = other.m_pEntry;
+		other.m_pEntry = nullptr;
+	}
+
+	return *this;
+}
+
+const BYTE* DXBCCachedShader::GetData() const
+{
+	return m_pEntry ? m_pEntry->data.data() + m_pEntry->srcSize : nullptr;
+}
+
+unsigned int DXBCCachedShader::GetSize() const
+{
+	return m_pEntry ? m_pEntry->patchedSize : 0;
+}
+
+void DXBCCachedShader::Release()
+{
+	if(m_pEntry)
+		UnpinEntry(m_pEntry);
+
+	m_pEntry = nullptr;
+}
+
+
+
+
+
+//================================================================================================================
+// DXBCShaderCache
+//================================================================================================================
+DXBCShaderCache::DXBCShaderCache(size_t inMaxBytes, unsigned int inMaxEntries) : m_shards(new DXBCShaderCacheShard[DXBC_CACHE_SHARDS])
+{
+	unsigned int shardEntries = (inMaxEntries + DXBC_CACHE_SHARDS - 1) / DXBC_CACHE_SHARDS;
+
+	if(shardEntries == 0)
+		shardEntries = 1;
+
+	// At most half of the buckets are used, so probe sequences stay short
+	unsigned int bucketCount = 1;
+
+	while(bucketCount < 2 * shardEntries)
+		bucketCount *= 2;
+
+	for(unsigned int i = 0; i < DXBC_CACHE_SHARDS; i++)
+	{
+		DXBCShaderCacheShard &shard = m_shards[i];
+
+		shard.buckets.reset(new std::atomic<DXBCShaderCacheEntry*>[bucketCount]);
+		shard.bucketMask = bucketCount - 1;
+
+		for(unsigned int bucket = 0; bucket < bucketCount; bucket++)
+			shard.buckets[bucket].store(nullptr, std::memory_order_relaxed);
+
+		shard.entries.reset(new DXBCShaderCacheEntry[shardEntries]);
+		shard.entryCount = shardEntries;
+		shard.freeEntries.reserve(shardEntries);
+
+		for(unsigned int entry = shardEntries; entry > 0; entry--)
+		{
+			shard.entries[entry - 1].refs.store(0, std::memory_order_relaxed);
+			shard.entries[entry - 1].tag.store(0, std::memory_order_relaxed);
+			shard.entries[entry - 1].referenced.store(false, std::memory_order_relaxed);
+			shard.freeEntries.push_back(entry - 1);
+		}
+
+		shard.clockHand = 0;
+		shard.bytes = 0;
+		shard.maxBytes = inMaxBytes / DXBC_CACHE_SHARDS;
+
+		shard.hits.store(0, std::memory_order_relaxed);
+		shard.misses.store(0, std::memory_order_relaxed);
+		shard.inserts.store(0, std::memory_order_relaxed);
+		shard.evictions.store(0, std::memory_order_relaxed);
+		shard.failedInserts.store(0, std::memory_order_relaxed);
+	}
+}
+
+DXBCShaderCache::~DXBCShaderCache()
+{
+}
+
+DXBCShaderCacheShard& DXBCShaderCache::GetShard(const DWORD *pChecksum) const
+{
+	return m_shards[pChecksum[0] & (DXBC_CACHE_SHARDS - 1)];
+}
+
+bool DXBCShaderCache::Find(const void *pSrcDataShader, unsigned int inSrcShaderSize, DXBCCachedShader &shader)
+{
+	shader.Release();
+
+	// Needs at least the checksum
+	if(inSrcShaderSize < 20)
+		return false;
+
+	DXBCShaderCacheShard &shard = GetShard((const DWORD*)pSrcDataShader + 1);
+	DXBCShaderCacheEntry* pEntry = FindEntry(shard, (const BYTE*)pSrcDataShader, inSrcShaderSize);
+
+	if(!pEntry)
+	{
+		shard.misses.fetch_add(1, std::memory_order_relaxed);
+		return false;
+	}
+
+	// Hits shouldn't all write the same cache line, set CLOCK bit only when it is not set yet
+	if(!pEntry->referenced.load(std::memory_order_relaxed))
+		pEntry->referenced.store(true, std::memory_order_relaxed);
+
+	shard.hits.fetch_add(1, std::memory_order_relaxed);
+	shader.m_pEntry = pEntry;
+
+	return true;
+}
+
+bool DXBCShaderCache::Insert(const void *pSrcDataShader, unsigned int inSrcShaderSize, const void *pPatchedDataShader, unsigned int inPatchedShaderSize, DXBCCachedShader *pShader)
+{
+	if(pShader)
+		pShader->Release();
+
+	if(inSrcShaderSize < 20)
+		return false;
+
+	const DWORD* pChecksum = (const DWORD*)pSrcDataShader + 1;
+	DXBCShaderCacheShard &shard = GetShard(pChecksum);
+
+	std::lock_guard<std::mutex> guard(shard.insertLock);
+
+	// Someone else might have been faster
+	DXBCShaderCacheEntry* pEntry = FindEntry(shard, (const BYTE*)pSrcDataShader, inSrcShaderSize);
+
+	if(pEntry)
+	{
+		if(pShader)
+			pShader->m_pEntry = pEntry;
+		else
+			UnpinEntry(pEntry);
+
+		return true;
+	}
+
+	// Make room
+	size_t size = (size_t)inSrcShaderSize + inPatchedShaderSize;
+
+	while(shard.freeEntries.empty() || shard.bytes + size > shard.maxBytes)
+	{
+		if(size > shard.maxBytes || !EvictEntry(shard))
+		{
+			shard.failedInserts.fetch_add(1, std::memory_order_relaxed);
+			return false;
+		}
+	}
+
+	unsigned int index = shard.freeEntries.back();
+	shard.freeEntries.pop_back();
+
+	// Fill entry while it is not live, nobody can pin it yet
+	pEntry = &shard.entries[index];
+	memcpy(pEntry->checksum, pChecksum, sizeof(pEntry->checksum));
+	pEntry->srcSize = inSrcShaderSize;
+	pEntry->patchedSize = inPatchedShaderSize;
+	pEntry->data.resize(size);
+	memcpy(pEntry->data.data(), pSrcDataShader, inSrcShaderSize);
+	memcpy(pEntry->data.data() + inSrcShaderSize, pPatchedDataShader, inPatchedShaderSize);
+	pEntry->tag.store(pChecksum[1], std::memory_order_relaxed);
+	pEntry->referenced.store(false, std::memory_order_relaxed);
+
+	// First empty bucket (or tombstone) of its probe sequence - there are always twice as many buckets as entries
+	unsigned int bucket = pChecksum[1] & shard.bucketMask;
+
+	while(true)
+	{
+		DXBCShaderCacheEntry* pBucketEntry = shard.buckets[bucket].load(std::memory_order_relaxed);
+
+		if(!pBucketEntry || pBucketEntry == s_pTombstone)
+			break;
+
+		bucket = (bucket + 1) & shard.bucketMask;
+	}
+
+	pEntry->bucket = bucket;
+
+	// Publish: entry becomes live (and pinned for the caller if wanted), then visible to lookups
+	pEntry->refs.store(DXBC_CACHE_LIVE | (pShader ? 1 : 0), std::memory_order_release);
+	shard.buckets[bucket].store(pEntry, std::memory_order_release);
+
+	shard.bytes += size;
+	shard.inserts.fetch_add(1, std::memory_order_relaxed);
+
+	if(pShader)
+		pShader->m_pEntry = pEntry;
+
+	return true;
+}
+
+void DXBCShaderCache::GetStats(DXBCShaderCacheStats *pStats) const
+{
+	memset(pStats, 0, sizeof(*pStats));
+
+	for(unsigned int i = 0; i < DXBC_CACHE_SHARDS; i++)
+	{
+		DXBCShaderCacheShard &shard = m_shards[i];
+
+		pStats->hits			+= shard.hits.load(std::memory_order_relaxed);
+		pStats->misses			+= shard.misses.load(std::memory_order_relaxed);
+		pStats->inserts			+= shard.inserts.load(std::memory_order_relaxed);
+		pStats->evictions		+= shard.evictions.load(std::memory_order_relaxed);
+		pStats->failedInserts	+= shard.failedInserts.load(std::memory_order_relaxed);
+
+		std::lock_guard<std::mutex> guard(shard.insertLock);
+
+		pStats->entries			+= shard.entryCount - (unsigned int)shard.freeEntries.size();
+		pStats->bytes			+= shard.bytes;
+	}
+}
@@ -0,0 +1,99 @@
+// Author: Henryk Kosobucki, 2016
+
+//=============================================	OVERVIEW =========================================================
+//	Concurrent cache of patched shaders, meant for CreateXXXShader hooks running on many render threads at once.
+//	One cache holds outputs of one patch, keyed by the original shader: its embedded DXBC checksum picks the slot
+//	and the whole original shader is compared before a hit is reported, so checksum collisions can never return
+//	wrong shader.
+//
+//	Lookups are lock-free. Cache is split into shards (by checksum) and inserts take only the lock of their
+//	shard. Memory is bounded by the byte and entry limits given on construction; when either is reached, CLOCK
+//	eviction (second chance) makes room, skipping shaders that are being used by someone at the moment.
+//
+//	Entries are allocated once and only reused, never freed, so lookups can safely touch an entry that is just
+//	being evicted. A lookup pins the entry (reader count) and checks the key again before it trusts it; evicting
+//	only takes entries nobody has pinned.
+//================================================================================================================
+
+#ifndef DXBC_SHADER_CACHE_H
+#define DXBC_SHADER_CACHE_H
+
+#include "DXBCPlatform.h"
+#include <memory>
+#include <stddef.h>
+
+struct DXBCShaderCacheEntry;
+struct DXBCShaderCacheShard;
+
+struct DXBCShaderCacheStats
+{
+	unsigned long long	hits;
+	unsigned long long	misses;
+	unsigned long long	inserts;
+	unsigned long long	evictions;
+	unsigned long long	failedInserts;		// No room could be made (everything pinned or shader over the limit)
+	unsigned int		entries;			// Shaders in the cache at the moment
+	size_t				bytes;				// Bytes used by them (original and patched shaders)
+};
+
+// Pinned patched shader. The cache won't evict it while any handle to it is alive.
+class DXBCCachedShader
+{
+public:
+	DXBCCachedShader();
+	DXBCCachedShader(DXBCCachedShader &&other);
+	~DXBCCachedShader();
+
+	DXBCCachedShader&	operator=(DXBCCachedShader &&other);
+
+	bool				IsValid() const { return m_pEntry != nullptr; }
+	const BYTE*			GetData() const;
+	unsigned int		GetSize() const;
+
+	void				Release();
+
+private:
+	friend class DXBCShaderCache;
+
+	DXBCCachedShader(const DXBCCachedShader&);
+	DXBCCachedShader&	operator=(const DXBCCachedShader&);
+
+	DXBCShaderCacheEntry*	m_pEntry;
+};
+
+class DXBCShaderCache
+{
+public:
+	DXBCShaderCache(	size_t			inMaxBytes,			//[In]	Limit of bytes held (original and patched shaders)
+						unsigned int	inMaxEntries		//[In]	Limit of shaders held
+		);
+	~DXBCShaderCache();
+
+	// Looks patched version of the shader up. Lock-free.
+	bool				Find(	const void			*pSrcDataShader,		//[In]	Original DXBC
+								unsigned int		inSrcShaderSize,		//[In]	Size of original DXBC
+								DXBCCachedShader	&shader					//[Out]	Patched DXBC
+		);
+
+	// Adds patched version of the shader. If another thread added it in the meantime, that one is kept (and
+	// returned). Returns false if there is no room for it, which is harmless - the caller just keeps using
+	// its own patched shader.
+	bool				Insert(	const void			*pSrcDataShader,		//[In]	Original DXBC
+								unsigned int		inSrcShaderSize,		//[In]	Size of original DXBC
+								const void			*pPatchedDataShader,	//[In]	Patched DXBC
+								unsigned int		inPatchedShaderSize,	//[In]	Size of patched DXBC
+								DXBCCachedShader	*pShader = nullptr		//[Out]	Optional patched DXBC from the cache
+		);
+
+	void				GetStats(DXBCShaderCacheStats *pStats) const;
+
+private:
+	DXBCShaderCache(const DXBCShaderCache&);
+	DXBCShaderCache&	operator=(const DXBCShaderCache&);
+
+	DXBCShaderCacheShard&	GetShard(const DWORD *pChecksum) const;
+
+	std::unique_ptr<DXBCShaderCacheShard[]>	m_shards;
+};
+
+#endif // DXBC_SHADER_CACHE_H
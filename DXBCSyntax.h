@@ -0,0 +1,118 @@
+// Author: Henryk Kosobucki, 2016
+
+//=============================================	OVERVIEW =========================================================
+//	Names used in SM4/SM5 assembly text for registers, declaration enums and flags. Shared by the disassembler,
+//	which prints them, and the assembler, which parses them back, so both always agree on the syntax. Tables are
+//	indexed by the values of the tokenized program format enums, NULL entries are values without a name.
+//================================================================================================================
+
+#ifndef DXBC_SYNTAX_H
+#define DXBC_SYNTAX_H
+
+#include "DXBCPlatform.h"
+#include "d3d11TokenizedProgramFormat.hpp"
+
+struct DXBCFlagName
+{
+	DWORD			flag;
+	const char*		pName;
+};
+
+// Indexed by D3D10_SB_OPERAND_TYPE
+static const char* const s_registerNames[] =
+{
+	"r", "v", "o", "x", "l", "d", "s", "t", "cb", "icb", "l", "vPrim", "oDepth", "null", "rasterizer", "oMask",
+	"m", "fb", "ft", "fp", "fi", "fo", "vOutputControlPointID", "vForkInstanceID", "vJoinInstanceID", "vicp",
+	"vocp", "vpc", "vDomain", "this", "u", "g", "vThreadID", "vThreadGroupID", "vThreadIDInGroup", "vCoverage",
+	"vThreadIDInGroupFlattened", "vGSInstanceID", "oDepthGE", "oDepthLE", "vCycleCounter",
+};
+
+// Indexed by D3D10_SB_RESOURCE_DIMENSION
+static const char* const s_resourceDimensionNames[] =
+{
+	"unknown", "buffer", "texture1d", "texture2d", "texture2dms", "texture3d", "texturecube", "texture1darray",
+	"texture2darray", "texture2dmsarray", "texturecubearray", "raw_buffer", "structured_buffer",
+};
+
+// Indexed by D3D10_SB_RESOURCE_RETURN_TYPE
+static const char* const s_returnTypeNames[] =
+{
+	"unknown", "unorm", "snorm", "sint", "uint", "float", "mixed", "double", "continued", "unused",
+};
+
+// Indexed by D3D10_SB_NAME
+static const char* const s_systemValueNames[] =
+{
+	"undefined", "position", "clip_distance", "cull_distance", "rendertarget_array_index", "viewport_array_index",
+	"vertex_id", "primitive_id", "instance_id", "is_front_face", "sampleIndex", "finalQuadUeq0EdgeTessFactor",
+	"finalQuadVeq0EdgeTessFactor", "finalQuadUeq1EdgeTessFactor", "finalQuadVeq1EdgeTessFactor",
+	"finalQuadUInsideTessFactor", "finalQuadVInsideTessFactor", "finalTriUeq0EdgeTessFactor",
+	"finalTriVeq0EdgeTessFactor", "finalTriWeq0EdgeTessFactor", "finalTriInsideTessFactor",
+	"finalLineDetailTessFactor", "finalLineDensityTessFactor",
+};
+
+// Indexed by D3D10_SB_INTERPOLATION_MODE
+static const char* const s_interpolationNames[] =
+{
+	"undefined", "constant", "linear", "linear centroid", "linear noperspective", "linear noperspective centroid",
+	"linear sample", "linear noperspective sample",
+};
+
+// Indexed by D3D10_SB_PRIMITIVE_TOPOLOGY
+static const char* const s_topologyNames[] =
+{
+	"undefined", "pointlist", "linelist", "linestrip", "trianglelist", "trianglestrip", NULL, NULL, NULL, NULL,
+	"linelist_adj", "linestrip_adj", "trianglelist_adj", "trianglestrip_adj",
+};
+
+// Indexed by D3D10_SB_PRIMITIVE (patches are handled separately)
+static const char* const s_primitiveNames[] =
+{
+	"undefined", "point", "line", "triangle", NULL, NULL, "lineadj", "triangleadj",
+};
+
+static const char* const s_samplerModeNames[] =
+{
+	"mode_default", "mode_comparison", "mode_mono",
+};
+
+static const char* const s_tessDomainNames[] =
+{
+	"domain_undefined", "domain_isoline", "domain_tri", "domain_quad",
+};
+
+static const char* const s_tessPartitioningNames[] =
+{
+	"partitioning_undefined", "partitioning_integer", "partitioning_pow2", "partitioning_fractional_odd",
+	"partitioning_fractional_even",
+};
+
+static const char* const s_tessOutputNames[] =
+{
+	"output_undefined", "output_point", "output_line", "output_triangle_cw", "output_triangle_ccw",
+};
+
+static const char s_componentNames[] = "xyzw";
+
+static const DXBCFlagName s_globalFlagNames[] =
+{
+	{ D3D10_SB_GLOBAL_FLAG_REFACTORING_ALLOWED,					"refactoringAllowed" },
+	{ D3D11_SB_GLOBAL_FLAG_ENABLE_DOUBLE_PRECISION_FLOAT_OPS,	"enableDoublePrecisionFloatOps" },
+	{ D3D11_SB_GLOBAL_FLAG_FORCE_EARLY_DEPTH_STENCIL,			"forceEarlyDepthStencil" },
+	{ D3D11_SB_GLOBAL_FLAG_ENABLE_RAW_AND_STRUCTURED_BUFFERS,	"enableRawAndStructuredBuffers" },
+};
+
+// Indexed by D3D10_SB_TOKENIZED_PROGRAM_TYPE
+static const char* const s_programPrefixes[] =
+{
+	"ps", "vs", "gs", "hs", "ds", "cs",
+};
+
+#define DXBC_NAME(table, index)		LookupName(table, sizeof(table) / sizeof(table[0]), index)
+
+static inline const char* LookupName(const char* const *pNames, unsigned int inNameCount, unsigned int inIndex)
+{
+	return (inIndex < inNameCount && pNames[inIndex]) ? pNames[inIndex] : "unknown";
+}
+
+#endif // DXBC_SYNTAX_H
@@ -0,0 +1,114 @@
+//================================================================================================================
+// Include files
+//================================================================================================================
+#include "DXBCValidator.h"
+#include "d3d11TokenizedProgramFormat.hpp"
+
+
+
+
+
+//================================================================================================================
+// Function definitions
+//================================================================================================================
+static DXBCPatchStatus FailValidation(unsigned int inOffset, unsigned int *pFailOffset)
+{
+	if(pFailOffset)
+		*pFailOffset = inOffset;
+
+	return DXBC_PATCH_INVALID_SHADER;
+}
+
+
+
+
+
+DXBCPatchStatus ValidateDXBCOpcodes(	const DWORD			*pOpcodes,				//[In]	First opcode
+										unsigned int		inNumDWORDs,			//[In]	Number of opcode DWORDs
+										unsigned int		*pFailOffset			//[Out]	Optional offset of the first broken instruction
+	)
+{
+	unsigned int offset = 0;
+
+	while(offset < inNumDWORDs)
+	{
+		DWORD token = pOpcodes[offset];
+		unsigned int length = DECODE_D3D10_SB_TOKENIZED_INSTRUCTION_LENGTH(token);
+
+		// Only the length field is on the path from one instruction to the next. Custom data blocks (they keep
+		// their length in the next DWORD) and broken instructions share one branch, so the common case is a
+		// single never taken branch per instruction.
+		if((DECODE_D3D10_SB_OPCODE_TYPE(token) == D3D10_SB_OPCODE_CUSTOMDATA) | (length == 0) | (length > inNumDWORDs - offset))
+		{
+			if(DECODE_D3D10_SB_OPCODE_TYPE(token) != D3D10_SB_OPCODE_CUSTOMDATA || inNumDWORDs - offset < 2)
+				return FailValidation(offset, pFailOffset);
+
+			length = pOpcodes[offset + 1];
+
+			if(length < 2 || length > inNumDWORDs - offset)
+				return FailValidation(offset, pFailOffset);
+		}
+
+		offset += length;
+	}
+
+	return DXBC_PATCH_OK;
+}
+
+
+
+
+
+DXBCPatchStatus ValidateDXBC(	const void			*pSrcDataShader,		//[In]	DXBC
+								unsigned int		inSrcShaderSize,		//[In]	Size of DXBC
+								unsigned int		*pFailOffset			//[Out]	Optional offset of the first broken field
+	)
+{
+	const BYTE* pData = (const BYTE*)pSrcDataShader;
+	const DWORD* pHeader = (const DWORD*)pSrcDataShader;
+
+	// Header is magic, checksum, version, container size and chunk count
+	if(inSrcShaderSize < 32 || pHeader[0] != MAKEFOURCC('D', 'X', 'B', 'C'))
+		return FailValidation(0, pFailOffset);
+
+	if(pHeader[6] != inSrcShaderSize)
+		return FailValidation(24, pFailOffset);
+
+	if(pHeader[7] > (inSrcShaderSize - 32) / sizeof(DWORD))
+		return FailValidation(28, pFailOffset);
+
+	unsigned int chunkCount = pHeader[7];
+	unsigned int chunkTableEnd = 32 + chunkCount * sizeof(DWORD);
+
+	for(unsigned int i = 0; i < chunkCount; i++)
+	{
+		// Chunks lie after the chunk table, DWORD aligned (everything in them is read as DWORDs), each starting
+		// with its FourCC and size
+		unsigned int chunkOffset = pHeader[8 + i];
+
+		if(chunkOffset < chunkTableEnd || chunkOffset > inSrcShaderSize - 8 || (chunkOffset & 3))
+			return FailValidation(32 + i * sizeof(DWORD), pFailOffset);
+
+		const DWORD* pChunk = (const DWORD*)(pData + chunkOffset);
+
+		if(pChunk[1] > inSrcShaderSize - 8 - chunkOffset)
+			return FailValidation(chunkOffset + 4, pFailOffset);
+
+		if(pChunk[0] != MAKEFOURCC('S', 'H', 'D', 'R') && pChunk[0] != MAKEFOURCC('S', 'H', 'E', 'X'))
+			continue;
+
+		// Shader chunk holds version and length tokens, the length counts both of them and the opcodes
+		if(pChunk[1] < 8)
+			return FailValidation(chunkOffset + 4, pFailOffset);
+
+		if(pChunk[3] < 2 || pChunk[3] > pChunk[1] / sizeof(DWORD))
+			return FailValidation(chunkOffset + 12, pFailOffset);
+
+		unsigned int instructionOffset;
+
+		if(ValidateDXBCOpcodes(pChunk + 4, pChunk[3] - 2, &instructionOffset) != DXBC_PATCH_OK)
+			return FailValidation(chunkOffset + 16 + instructionOffset * sizeof(DWORD), pFailOffset);
+	}
+
+	return DXBC_PATCH_OK;
+}
@@ -0,0 +1,48 @@
+// Author: Henryk Kosobucki, 2016
+
+//=============================================	OVERVIEW =========================================================
+//	Structural validation of untrusted DXBC (shaders read from caches, archives or intercepted from the game)
+//	before anything follows the offsets and lengths stored in it:
+//
+//		unsigned int failOffset;
+//
+//		if(ValidateDXBC(pData, size, &failOffset) != DXBC_PATCH_OK)
+//			printf("corrupt shader at byte %u\n", failOffset);
+//
+//	Checked is everything the patcher walks: 'DXBC' magic and container size in the header, chunk count and the
+//	chunk table, offset and size of every chunk, version and length tokens of every SHDR/SHEX chunk, and the
+//	length of every instruction and custom data block, which have to tile the opcodes exactly. Opcode types and
+//	operands are left to the decoders (see DXBCProgram.h), a container that passes can be walked safely but
+//	doesn't have to be a shader the runtime accepts. Shader chunks may hold more bytes than their length token
+//	counts, patching keeps them after the opcodes.
+//
+//	Patching doesn't validate (PatchDXBC and friends never decode past the injection point), shaders are
+//	validated once where they come in from outside: archive and disk cache lookups, files read by the patch
+//	pipeline and dxbc-patch. Hooks patching shaders from anywhere else call ValidateDXBC themselves.
+//
+//	Checks go front to back (header, chunk table entries together with the chunks they point to, opcodes) and
+//	stop at the first one failing. Walking the instructions costs one load, one extract and one add per
+//	instruction on the dependency chain and a single branch that valid shaders take only for custom data, so
+//	validation runs at several GB/s and costs a fraction of the patch (its checksum alone reads every byte).
+//================================================================================================================
+
+#ifndef DXBC_VALIDATOR_H
+#define DXBC_VALIDATOR_H
+
+#include "Patcher.h"
+
+// Checks container structure (see above). DXBC_PATCH_INVALID_SHADER on the first broken field, *pFailOffset then
+// receives its byte offset from the start of the container. Containers without SHDR/SHEX chunk are valid.
+DXBCPatchStatus ValidateDXBC(	const void			*pSrcDataShader,		//[In]	DXBC
+								unsigned int		inSrcShaderSize,		//[In]	Size of DXBC
+								unsigned int		*pFailOffset			//[Out]	Optional offset of the first broken field
+	);
+
+// Checks that instruction and custom data lengths tile the opcode stream exactly. DXBC_PATCH_INVALID_SHADER on
+// the first broken instruction, *pFailOffset then receives the offset of its opcode token (in DWORDs).
+DXBCPatchStatus ValidateDXBCOpcodes(	const DWORD			*pOpcodes,				//[In]	First opcode
+										unsigned int		inNumDWORDs,			//[In]	Number of opcode DWORDs
+										unsigned int		*pFailOffset			//[Out]	Optional offset of the first broken instruction
+	);
+
+#endif // DXBC_VALIDATOR_H
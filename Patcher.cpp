@@ -1,16 +1,20 @@
 //================================================================================================================
 // Macro definitions
 //================================================================================================================
-// If requested, we can also use D3D disassembler to dump all info to console and HTML file.
+// If requested, we can also disassemble the shader (see DXBCDisassembler.h) and dump it to console and a text
+// file. Defaults to on for Windows builds only, define it to 1 or 0 to choose on any platform.
+#ifndef DUMP_SHADER_DISASSEMBLY
+#ifdef _WIN32
 #define DUMP_SHADER_DISASSEMBLY	1
+#else
+#define DUMP_SHADER_DISASSEMBLY	0
+#endif
+#endif
 
 // Additionally we can also dump raw opcodes into the output window (might be useful to reuse them when forging
 // debug opcodes).
 #define DUMP_RAW_OPCODES		0
 
-// Helper macro to spare some typing
-#define OPCODE_CASE(x) case x: return #x; break;
-
 
 
 
@@ -19,17 +23,18 @@
 // Include files (and optional library links).
 //================================================================================================================
 #include "Patcher.h"
+#include <algorithm>
 #include <map>
+#include <string>
 #include <vector>
-#include <Windows.h>
+#include "DXBCPlatform.h"
 
 #include "DXBCChecksum.h"
 #include "DXBCChecksum.cpp"
 #include "d3d11TokenizedProgramFormat.hpp"
+#include "DXBCInstruction.h"
 #if DUMP_SHADER_DISASSEMBLY
-#include "D3DCompiler.h"
-
-#pragma comment(lib, "D3dcompiler.lib")
+#include "DXBCDisassembler.h"
 #endif //DUMP_SHADER_DISASSEMBLY
 
 
@@ -39,13 +44,25 @@
 //================================================================================================================
 // Structures
 //================================================================================================================
-struct DXBCOpCode
+// Writes output DXBC front to back and (optionally) hashes every piece right after it is written.
+struct DXBCStreamWriter
 {
-	D3D10_SB_OPCODE_TYPE	opcodeType;
-	unsigned int			opcodeLength;
-	unsigned int			isExtended;
-	DWORD*					pRawData;		//Pointer to the beginning of opcode (with opcode header)
-	unsigned int			chunkOffset;	//Offset from start of the shader chunk (in bytes)
+	DXBCStreamWriter(BYTE *pDst, bool hash) : pDst(pDst), offset(0), hash(hash) {}
+
+	void Write(const void *pSrc, unsigned int size)
+	{
+		memcpy(pDst + offset, pSrc, size);
+
+		if(hash)
+			checksum.Update(pDst + offset, size);
+
+		offset += size;
+	}
+
+	BYTE*				pDst;
+	unsigned int		offset;		//Bytes written so far
+	bool				hash;
+	DXBCChecksumStream	checksum;
 };
 
 
@@ -55,265 +72,233 @@ struct DXBCOpCode
 //================================================================================================================
 // Function definitions
 //================================================================================================================
-const char* GetOpcodeNameString(D3D10_SB_OPCODE_TYPE opcode)
+// Walks the opcode stream up to opcode number inOpcodeIndex and returns its offset (in DWORDs). Opcodes after
+// it are never touched. Indices past the last opcode return the end of the stream.
+unsigned int FindOpcodeOffset(const DWORD *pOpcodes, unsigned int inNumDWORDs, unsigned int inOpcodeIndex)
+{
+	DXBCInstructionRange range = IterateDXBCInstructions(pOpcodes, inNumDWORDs);
+	DXBCInstructionIterator it = range.begin();
+
+	for(unsigned int i = 0; i < inOpcodeIndex && it != range.end(); i++)
+		++it;
+
+	return (unsigned int)(it.GetToken() - pOpcodes);
+}
+
+
+
+
+
+// Shader bytecode consists of few chunks. Basic information about each chunk is written in chunk index. This
+// reads it and finds which one is the actual shader opcode chunk and where it begins.
+DXBCPatchStatus ParseDXBCLayout(const void *pSrcDataShader, unsigned int inSrcShaderSize, DXBCLayout *pLayout)
+{
+	// Header (with chunk count) has to be there, as well as the whole chunk index
+	if(inSrcShaderSize < 32 || *((const DWORD*)pSrcDataShader + 7) > (inSrcShaderSize - 32) / sizeof(DWORD))
+		return DXBC_PATCH_INVALID_SHADER;
+
+	pLayout->pSrcData			= (const BYTE*)pSrcDataShader;
+	pLayout->srcSize			= inSrcShaderSize;
+	pLayout->chunkCount			= *((const DWORD*)pSrcDataShader + 7);
+	pLayout->pChunkOffsets		= (const DWORD*)pSrcDataShader + 8;
+	pLayout->pShaderChunk		= NULL;
+
+	unsigned int chunkTableEnd = 32 + pLayout->chunkCount * sizeof(DWORD);
+
+	for(unsigned int i = 0; i < pLayout->chunkCount; i++)
+	{
+		// Every chunk lies after the chunk table, DWORD aligned, and starts with its FourCC and size
+		if(pLayout->pChunkOffsets[i] < chunkTableEnd || pLayout->pChunkOffsets[i] > inSrcShaderSize - 8 || (pLayout->pChunkOffsets[i] & 3))
+			return DXBC_PATCH_INVALID_SHADER;
+
+		const char* pCode = (const char*)pSrcDataShader + pLayout->pChunkOffsets[i];
+
+		// Check for shader opcode chunk (most interesting for our debugging purposes are
+		// SHDR (SM4) or SHEX (SM5) chunks).
+		if(	(MAKEFOURCC(pCode[0], pCode[1], pCode[2], pCode[3]) == MAKEFOURCC('S', 'H', 'D', 'R')) ||
+			(MAKEFOURCC(pCode[0], pCode[1], pCode[2], pCode[3]) == MAKEFOURCC('S', 'H', 'E', 'X')))
+		{
+			pLayout->pShaderChunk		= (const BYTE*)pCode;
+			pLayout->shaderChunkIndex	= i;
+			break;
+		}
+	}
+
+	if(!pLayout->pShaderChunk)
+		return DXBC_PATCH_NO_SHADER_CHUNK;
+
+	// Shader chunk has to fit into the container and hold at least version and length tokens, which in turn
+	// must not claim more DWORDs than the chunk has
+	unsigned int shaderChunkSpace = inSrcShaderSize - 8 - (unsigned int)(pLayout->pShaderChunk - pLayout->pSrcData);
+
+	pLayout->shaderChunkSize	= *(const DWORD*)(pLayout->pShaderChunk + 4);
+
+	if(pLayout->shaderChunkSize > shaderChunkSpace || pLayout->shaderChunkSize < 8)
+		return DXBC_PATCH_INVALID_SHADER;
+
+	DWORD lengthToken = *(const DWORD*)(pLayout->pShaderChunk + 12);
+
+	if(lengthToken < 2 || lengthToken > pLayout->shaderChunkSize / sizeof(DWORD))
+		return DXBC_PATCH_INVALID_SHADER;
+
+	pLayout->pOpcodes			= (const DWORD*)(pLayout->pShaderChunk + 16);
+	pLayout->opcodeDWORDs		= lengthToken - 2;	//Version and length tokens are not opcodes
+
+	return DXBC_PATCH_OK;
+}
+
+
+
+
+
+// Writes the container with the opcodes of its shader chunk replaced by the given spans. Everything about the
+// output is known up front, so it is written front to back in a single pass and every byte is hashed right
+// after it is written, while still hot in cache. For new shader byte what needs to be modified is:
+// 1. Whole DXBC size
+// 2. Chunk table (offsets of all chunks after modified shader chunk)
+// 3. Shader chunk size
+// 4. Number of DWORDS in the chunk
+// 5. Recalculate checksum
+// Output size is known before anything is written, so a buffer that is too small is left untouched.
+DXBCPatchStatus EmitDXBC(	const DXBCLayout	&layout,				//[In]	Source container
+							const DXBCSpan		*pOpcodeSpans,			//[In]	New content of the opcode stream
+							unsigned int		inSpanCount,			//[In]	Number of spans
+							void				*pDstDataShader,		//[Out]	Output buffer to put modified DXBC into
+							unsigned int		inDstCapacity,			//[In]	Size of output buffer
+							unsigned int		*pDstSize,				//[Out]	Optional size of modified DXBC
+							DXBCChecksumContext	*pChecksumContext		//[In]	Optional checksum context kept between patches of the same shader
+	)
+{
+	unsigned int newOpcodesSize = 0;
+
+	for(unsigned int i = 0; i < inSpanCount; i++)
+		newOpcodesSize += pOpcodeSpans[i].size;
+
+	// Wraps around when the stream gets shorter (deletes, shorter replacements), sizes and offsets it is added to
+	// still come out right modulo 2^32
+	unsigned int sizeDelta = newOpcodesSize - layout.opcodeDWORDs * sizeof(DWORD);
+	unsigned int dstSize = layout.srcSize + sizeDelta;
+
+	if(pDstSize)
+		*pDstSize = dstSize;
+
+	if(dstSize > inDstCapacity)
+		return DXBC_PATCH_BUFFER_TOO_SMALL;
+
+	DXBCStreamWriter writer((BYTE*)pDstDataShader, pChecksumContext == nullptr);
+
+	// Header with cleared checksum (it has to be cleared in order to be properly hashed) and new DXBC size
+	DWORD header[8];
+	memcpy(header, layout.pSrcData, sizeof(header));
+	memset(header + 1, 0, 4 * sizeof(DWORD));
+	header[6] += sizeDelta;
+	writer.Write(header, sizeof(header));
+
+	// Chunk table
+	for(unsigned int i = 0; i < layout.chunkCount; i++)
+	{
+		DWORD chunkOffset = (i > layout.shaderChunkIndex) ? layout.pChunkOffsets[i] + sizeDelta : layout.pChunkOffsets[i];
+		writer.Write(&chunkOffset, sizeof(DWORD));
+	}
+
+	// Part of source DXBC buffer that remains unmodified (everything between chunk table and SHDR/SHEX shader chunk)
+	unsigned int chunkTableEnd = 32 + layout.chunkCount * sizeof(DWORD);
+	writer.Write(layout.pSrcData + chunkTableEnd, (unsigned int)(layout.pShaderChunk - layout.pSrcData) - chunkTableEnd);
+
+	// Shader chunk header with new chunk size and number of DWORDs in it
+	DWORD chunkHeader[4];
+	memcpy(chunkHeader, layout.pShaderChunk, sizeof(chunkHeader));
+	chunkHeader[1] += sizeDelta;
+	chunkHeader[3] = 2 + newOpcodesSize / sizeof(DWORD);
+	writer.Write(chunkHeader, sizeof(chunkHeader));
+
+	// New opcode stream
+	for(unsigned int i = 0; i < inSpanCount; i++)
+		writer.Write(pOpcodeSpans[i].pData, pOpcodeSpans[i].size);
+
+	// Then copy remainder of the shader bytecode (starting right after the opcodes, the chunk may hold more bytes
+	// than its length token counts)
+	const BYTE* pRemainder = (const BYTE*)(layout.pOpcodes + layout.opcodeDWORDs);
+	writer.Write(pRemainder, (unsigned int)(layout.pSrcData + layout.srcSize - pRemainder));
+
+	// Finally, store the checksum of the whole stream
+	DWORD* pChecksum = (DWORD*)pDstDataShader + 1;
+
+	if(pChecksumContext)
+		pChecksumContext->Calculate((BYTE*)pDstDataShader, writer.offset, pChecksum);
+	else
+		writer.checksum.Final(pChecksum);
+
+	return DXBC_PATCH_OK;
+}
+
+
+
+
+
+#if DUMP_RAW_OPCODES
+// Dumps every opcode with its raw DWORDs into the output window
+void DumpRawOpcodes(const DWORD *pOpcodes, unsigned int inNumDWORDs)
 {
-	switch (opcode)
+	unsigned int i = 0;
+
+	for(DXBCInstruction instruction : IterateDXBCInstructions(pOpcodes, inNumDWORDs))
 	{
-		OPCODE_CASE(D3D10_SB_OPCODE_DCL_OUTPUT)
-		OPCODE_CASE(D3D10_SB_OPCODE_MOV)
-		OPCODE_CASE(D3D10_SB_OPCODE_DCL_CONSTANT_BUFFER)
-		OPCODE_CASE(D3D10_SB_OPCODE_RET)
-		OPCODE_CASE(D3D10_SB_OPCODE_ADD)
-		OPCODE_CASE(D3D10_SB_OPCODE_AND)
-		OPCODE_CASE(D3D10_SB_OPCODE_BREAK)
-		OPCODE_CASE(D3D10_SB_OPCODE_BREAKC)
-		OPCODE_CASE(D3D10_SB_OPCODE_CALL)
-		OPCODE_CASE(D3D10_SB_OPCODE_CALLC)
-		OPCODE_CASE(D3D10_SB_OPCODE_CASE)
-		OPCODE_CASE(D3D10_SB_OPCODE_CONTINUE)
-		OPCODE_CASE(D3D10_SB_OPCODE_CONTINUEC)
-		OPCODE_CASE(D3D10_SB_OPCODE_CUT)
-		OPCODE_CASE(D3D10_SB_OPCODE_DEFAULT)
-		OPCODE_CASE(D3D10_SB_OPCODE_DERIV_RTX)
-		OPCODE_CASE(D3D10_SB_OPCODE_DERIV_RTY)
-		OPCODE_CASE(D3D10_SB_OPCODE_DISCARD)
-		OPCODE_CASE(D3D10_SB_OPCODE_DIV)
-		OPCODE_CASE(D3D10_SB_OPCODE_DP2)
-		OPCODE_CASE(D3D10_SB_OPCODE_DP3)
-		OPCODE_CASE(D3D10_SB_OPCODE_DP4)
-		OPCODE_CASE(D3D10_SB_OPCODE_ELSE)
-		OPCODE_CASE(D3D10_SB_OPCODE_EMIT)
-		OPCODE_CASE(D3D10_SB_OPCODE_EMITTHENCUT)
-		OPCODE_CASE(D3D10_SB_OPCODE_ENDIF)
-		OPCODE_CASE(D3D10_SB_OPCODE_ENDLOOP)
-		OPCODE_CASE(D3D10_SB_OPCODE_ENDSWITCH)
-		OPCODE_CASE(D3D10_SB_OPCODE_EQ)
-		OPCODE_CASE(D3D10_SB_OPCODE_EXP)
-		OPCODE_CASE(D3D10_SB_OPCODE_FRC)
-		OPCODE_CASE(D3D10_SB_OPCODE_FTOI)
-		OPCODE_CASE(D3D10_SB_OPCODE_FTOU)
-		OPCODE_CASE(D3D10_SB_OPCODE_GE)
-		OPCODE_CASE(D3D10_SB_OPCODE_IADD)
-		OPCODE_CASE(D3D10_SB_OPCODE_IF)
-		OPCODE_CASE(D3D10_SB_OPCODE_IEQ)
-		OPCODE_CASE(D3D10_SB_OPCODE_IGE)
-		OPCODE_CASE(D3D10_SB_OPCODE_ILT)
-		OPCODE_CASE(D3D10_SB_OPCODE_IMAD)
-		OPCODE_CASE(D3D10_SB_OPCODE_IMAX)
-		OPCODE_CASE(D3D10_SB_OPCODE_IMIN)
-		OPCODE_CASE(D3D10_SB_OPCODE_IMUL)
-		OPCODE_CASE(D3D10_SB_OPCODE_INE)
-		OPCODE_CASE(D3D10_SB_OPCODE_INEG)
-		OPCODE_CASE(D3D10_SB_OPCODE_ISHL)
-		OPCODE_CASE(D3D10_SB_OPCODE_ISHR)
-		OPCODE_CASE(D3D10_SB_OPCODE_ITOF)
-		OPCODE_CASE(D3D10_SB_OPCODE_LABEL)
-		OPCODE_CASE(D3D10_SB_OPCODE_LD)
-		OPCODE_CASE(D3D10_SB_OPCODE_LD_MS)
-		OPCODE_CASE(D3D10_SB_OPCODE_LOG)
-		OPCODE_CASE(D3D10_SB_OPCODE_LOOP)
-		OPCODE_CASE(D3D10_SB_OPCODE_LT)
-		OPCODE_CASE(D3D10_SB_OPCODE_MAD)
-		OPCODE_CASE(D3D10_SB_OPCODE_MIN)
-		OPCODE_CASE(D3D10_SB_OPCODE_MAX)
-		OPCODE_CASE(D3D10_SB_OPCODE_CUSTOMDATA)
-		OPCODE_CASE(D3D10_SB_OPCODE_MOVC)
-		OPCODE_CASE(D3D10_SB_OPCODE_MUL)
-		OPCODE_CASE(D3D10_SB_OPCODE_NE)
-		OPCODE_CASE(D3D10_SB_OPCODE_NOP)
-		OPCODE_CASE(D3D10_SB_OPCODE_NOT)
-		OPCODE_CASE(D3D10_SB_OPCODE_OR)
-		OPCODE_CASE(D3D10_SB_OPCODE_RESINFO)
-		OPCODE_CASE(D3D10_SB_OPCODE_RETC)
-		OPCODE_CASE(D3D10_SB_OPCODE_ROUND_NE)
-		OPCODE_CASE(D3D10_SB_OPCODE_ROUND_NI)
-		OPCODE_CASE(D3D10_SB_OPCODE_ROUND_PI)
-		OPCODE_CASE(D3D10_SB_OPCODE_ROUND_Z)
-		OPCODE_CASE(D3D10_SB_OPCODE_RSQ)
-		OPCODE_CASE(D3D10_SB_OPCODE_SAMPLE)
-		OPCODE_CASE(D3D10_SB_OPCODE_SAMPLE_C)
-		OPCODE_CASE(D3D10_SB_OPCODE_SAMPLE_C_LZ)
-		OPCODE_CASE(D3D10_SB_OPCODE_SAMPLE_L)
-		OPCODE_CASE(D3D10_SB_OPCODE_SAMPLE_D)
-		OPCODE_CASE(D3D10_SB_OPCODE_SAMPLE_B)
-		OPCODE_CASE(D3D10_SB_OPCODE_SQRT)
-		OPCODE_CASE(D3D10_SB_OPCODE_SWITCH)
-		OPCODE_CASE(D3D10_SB_OPCODE_SINCOS)
-		OPCODE_CASE(D3D10_SB_OPCODE_UDIV)
-		OPCODE_CASE(D3D10_SB_OPCODE_ULT)
-		OPCODE_CASE(D3D10_SB_OPCODE_UGE)
-		OPCODE_CASE(D3D10_SB_OPCODE_UMUL)
-		OPCODE_CASE(D3D10_SB_OPCODE_UMAD)
-		OPCODE_CASE(D3D10_SB_OPCODE_UMAX)
-		OPCODE_CASE(D3D10_SB_OPCODE_UMIN)
-		OPCODE_CASE(D3D10_SB_OPCODE_USHR)
-		OPCODE_CASE(D3D10_SB_OPCODE_UTOF)
-		OPCODE_CASE(D3D10_SB_OPCODE_XOR)
-		OPCODE_CASE(D3D10_SB_OPCODE_DCL_RESOURCE)
-		OPCODE_CASE(D3D10_SB_OPCODE_DCL_SAMPLER)
-		OPCODE_CASE(D3D10_SB_OPCODE_DCL_INDEX_RANGE)
-		OPCODE_CASE(D3D10_SB_OPCODE_DCL_GS_OUTPUT_PRIMITIVE_TOPOLOGY)
-		OPCODE_CASE(D3D10_SB_OPCODE_DCL_GS_INPUT_PRIMITIVE)
-		OPCODE_CASE(D3D10_SB_OPCODE_DCL_MAX_OUTPUT_VERTEX_COUNT)
-		OPCODE_CASE(D3D10_SB_OPCODE_DCL_INPUT)
-		OPCODE_CASE(D3D10_SB_OPCODE_DCL_INPUT_SGV)
-		OPCODE_CASE(D3D10_SB_OPCODE_DCL_INPUT_SIV)
-		OPCODE_CASE(D3D10_SB_OPCODE_DCL_INPUT_PS)
-		OPCODE_CASE(D3D10_SB_OPCODE_DCL_INPUT_PS_SGV)
-		OPCODE_CASE(D3D10_SB_OPCODE_DCL_INPUT_PS_SIV)
-		OPCODE_CASE(D3D10_SB_OPCODE_DCL_OUTPUT_SGV)
-		OPCODE_CASE(D3D10_SB_OPCODE_DCL_OUTPUT_SIV)
-		OPCODE_CASE(D3D10_SB_OPCODE_DCL_TEMPS)
-		OPCODE_CASE(D3D10_SB_OPCODE_DCL_INDEXABLE_TEMP)
-		OPCODE_CASE(D3D10_SB_OPCODE_DCL_GLOBAL_FLAGS)
-		OPCODE_CASE(D3D10_SB_OPCODE_RESERVED0)
-		OPCODE_CASE(D3D10_1_SB_OPCODE_LOD)
-		OPCODE_CASE(D3D10_1_SB_OPCODE_GATHER4)
-		OPCODE_CASE(D3D10_1_SB_OPCODE_SAMPLE_POS)
-		OPCODE_CASE(D3D10_1_SB_OPCODE_SAMPLE_INFO)
-		OPCODE_CASE(D3D10_1_SB_OPCODE_RESERVED1)
-		OPCODE_CASE(D3D11_SB_OPCODE_HS_DECLS)
-		OPCODE_CASE(D3D11_SB_OPCODE_HS_CONTROL_POINT_PHASE)
-		OPCODE_CASE(D3D11_SB_OPCODE_HS_FORK_PHASE)
-		OPCODE_CASE(D3D11_SB_OPCODE_HS_JOIN_PHASE)
-		OPCODE_CASE(D3D11_SB_OPCODE_EMIT_STREAM)
-		OPCODE_CASE(D3D11_SB_OPCODE_CUT_STREAM)
-		OPCODE_CASE(D3D11_SB_OPCODE_EMITTHENCUT_STREAM)
-		OPCODE_CASE(D3D11_SB_OPCODE_INTERFACE_CALL)
-		OPCODE_CASE(D3D11_SB_OPCODE_BUFINFO)
-		OPCODE_CASE(D3D11_SB_OPCODE_DERIV_RTX_COARSE)
-		OPCODE_CASE(D3D11_SB_OPCODE_DERIV_RTX_FINE)
-		OPCODE_CASE(D3D11_SB_OPCODE_DERIV_RTY_COARSE)
-		OPCODE_CASE(D3D11_SB_OPCODE_DERIV_RTY_FINE)
-		OPCODE_CASE(D3D11_SB_OPCODE_GATHER4_C)
-		OPCODE_CASE(D3D11_SB_OPCODE_GATHER4_PO)
-		OPCODE_CASE(D3D11_SB_OPCODE_GATHER4_PO_C)
-		OPCODE_CASE(D3D11_SB_OPCODE_RCP)
-		OPCODE_CASE(D3D11_SB_OPCODE_F32TOF16)
-		OPCODE_CASE(D3D11_SB_OPCODE_F16TOF32)
-		OPCODE_CASE(D3D11_SB_OPCODE_UADDC)
-		OPCODE_CASE(D3D11_SB_OPCODE_USUBB)
-		OPCODE_CASE(D3D11_SB_OPCODE_COUNTBITS)
-		OPCODE_CASE(D3D11_SB_OPCODE_FIRSTBIT_HI)
-		OPCODE_CASE(D3D11_SB_OPCODE_FIRSTBIT_LO)
-		OPCODE_CASE(D3D11_SB_OPCODE_FIRSTBIT_SHI)
-		OPCODE_CASE(D3D11_SB_OPCODE_UBFE)
-		OPCODE_CASE(D3D11_SB_OPCODE_IBFE)
-		OPCODE_CASE(D3D11_SB_OPCODE_BFI)
-		OPCODE_CASE(D3D11_SB_OPCODE_BFREV)
-		OPCODE_CASE(D3D11_SB_OPCODE_SWAPC)
-		OPCODE_CASE(D3D11_SB_OPCODE_DCL_STREAM)
-		OPCODE_CASE(D3D11_SB_OPCODE_DCL_FUNCTION_BODY)
-		OPCODE_CASE(D3D11_SB_OPCODE_DCL_FUNCTION_TABLE)
-		OPCODE_CASE(D3D11_SB_OPCODE_DCL_INTERFACE)
-		OPCODE_CASE(D3D11_SB_OPCODE_DCL_INPUT_CONTROL_POINT_COUNT)
-		OPCODE_CASE(D3D11_SB_OPCODE_DCL_OUTPUT_CONTROL_POINT_COUNT)
-		OPCODE_CASE(D3D11_SB_OPCODE_DCL_TESS_DOMAIN)
-		OPCODE_CASE(D3D11_SB_OPCODE_DCL_TESS_PARTITIONING)
-		OPCODE_CASE(D3D11_SB_OPCODE_DCL_TESS_OUTPUT_PRIMITIVE)
-		OPCODE_CASE(D3D11_SB_OPCODE_DCL_HS_MAX_TESSFACTOR)
-		OPCODE_CASE(D3D11_SB_OPCODE_DCL_HS_FORK_PHASE_INSTANCE_COUNT)
-		OPCODE_CASE(D3D11_SB_OPCODE_DCL_HS_JOIN_PHASE_INSTANCE_COUNT)
-		OPCODE_CASE(D3D11_SB_OPCODE_DCL_THREAD_GROUP)
-		OPCODE_CASE(D3D11_SB_OPCODE_DCL_UNORDERED_ACCESS_VIEW_TYPED)
-		OPCODE_CASE(D3D11_SB_OPCODE_DCL_UNORDERED_ACCESS_VIEW_RAW)
-		OPCODE_CASE(D3D11_SB_OPCODE_DCL_UNORDERED_ACCESS_VIEW_STRUCTURED)
-		OPCODE_CASE(D3D11_SB_OPCODE_DCL_THREAD_GROUP_SHARED_MEMORY_RAW)
-		OPCODE_CASE(D3D11_SB_OPCODE_DCL_THREAD_GROUP_SHARED_MEMORY_STRUCTURED)
-		OPCODE_CASE(D3D11_SB_OPCODE_DCL_RESOURCE_RAW)
-		OPCODE_CASE(D3D11_SB_OPCODE_DCL_RESOURCE_STRUCTURED)
-		OPCODE_CASE(D3D11_SB_OPCODE_LD_UAV_TYPED)
-		OPCODE_CASE(D3D11_SB_OPCODE_STORE_UAV_TYPED)
-		OPCODE_CASE(D3D11_SB_OPCODE_LD_RAW)
-		OPCODE_CASE(D3D11_SB_OPCODE_STORE_RAW)
-		OPCODE_CASE(D3D11_SB_OPCODE_LD_STRUCTURED)
-		OPCODE_CASE(D3D11_SB_OPCODE_STORE_STRUCTURED)
-		OPCODE_CASE(D3D11_SB_OPCODE_ATOMIC_AND)
-		OPCODE_CASE(D3D11_SB_OPCODE_ATOMIC_OR)
-		OPCODE_CASE(D3D11_SB_OPCODE_ATOMIC_XOR)
-		OPCODE_CASE(D3D11_SB_OPCODE_ATOMIC_CMP_STORE)
-		OPCODE_CASE(D3D11_SB_OPCODE_ATOMIC_IADD)
-		OPCODE_CASE(D3D11_SB_OPCODE_ATOMIC_IMAX)
-		OPCODE_CASE(D3D11_SB_OPCODE_ATOMIC_IMIN)
-		OPCODE_CASE(D3D11_SB_OPCODE_ATOMIC_UMAX)
-		OPCODE_CASE(D3D11_SB_OPCODE_ATOMIC_UMIN)
-		OPCODE_CASE(D3D11_SB_OPCODE_IMM_ATOMIC_ALLOC)
-		OPCODE_CASE(D3D11_SB_OPCODE_IMM_ATOMIC_CONSUME)
-		OPCODE_CASE(D3D11_SB_OPCODE_IMM_ATOMIC_IADD)
-		OPCODE_CASE(D3D11_SB_OPCODE_IMM_ATOMIC_AND)
-		OPCODE_CASE(D3D11_SB_OPCODE_IMM_ATOMIC_OR)
-		OPCODE_CASE(D3D11_SB_OPCODE_IMM_ATOMIC_XOR)
-		OPCODE_CASE(D3D11_SB_OPCODE_IMM_ATOMIC_EXCH)
-		OPCODE_CASE(D3D11_SB_OPCODE_IMM_ATOMIC_CMP_EXCH)
-		OPCODE_CASE(D3D11_SB_OPCODE_IMM_ATOMIC_IMAX)
-		OPCODE_CASE(D3D11_SB_OPCODE_IMM_ATOMIC_IMIN)
-		OPCODE_CASE(D3D11_SB_OPCODE_IMM_ATOMIC_UMAX)
-		OPCODE_CASE(D3D11_SB_OPCODE_IMM_ATOMIC_UMIN)
-		OPCODE_CASE(D3D11_SB_OPCODE_SYNC)
-		OPCODE_CASE(D3D11_SB_OPCODE_DADD)
-		OPCODE_CASE(D3D11_SB_OPCODE_DMAX)
-		OPCODE_CASE(D3D11_SB_OPCODE_DMIN)
-		OPCODE_CASE(D3D11_SB_OPCODE_DMUL)
-		OPCODE_CASE(D3D11_SB_OPCODE_DEQ)
-		OPCODE_CASE(D3D11_SB_OPCODE_DGE)
-		OPCODE_CASE(D3D11_SB_OPCODE_DLT)
-		OPCODE_CASE(D3D11_SB_OPCODE_DNE)
-		OPCODE_CASE(D3D11_SB_OPCODE_DMOV)
-		OPCODE_CASE(D3D11_SB_OPCODE_DMOVC)
-		OPCODE_CASE(D3D11_SB_OPCODE_DTOF)
-		OPCODE_CASE(D3D11_SB_OPCODE_FTOD)
-		OPCODE_CASE(D3D11_SB_OPCODE_EVAL_SNAPPED)
-		OPCODE_CASE(D3D11_SB_OPCODE_EVAL_SAMPLE_INDEX)
-		OPCODE_CASE(D3D11_SB_OPCODE_EVAL_CENTROID)
-		OPCODE_CASE(D3D11_SB_OPCODE_DCL_GS_INSTANCE_COUNT)
-
-	default:
-		return "UNKNOWN_OPCODE";
-		break;
+		std::string opcodeBuffer = "\t{ ";
+
+		for(const DWORD* pToken = instruction.pToken; pToken < instruction.GetEnd(); pToken++)
+		{
+			char opBuffer[32];
+			sprintf(opBuffer, "%u ", *pToken);
+
+			opcodeBuffer += opBuffer;
+		}
+
+		opcodeBuffer += " }";
+
+		char buffer[256];
+		sprintf(buffer, "%03u. [offset: %05u, length: %02u]\t%s\t", i++, (unsigned int)((instruction.pToken - pOpcodes) * sizeof(DWORD)), (unsigned int)(instruction.GetLength() * sizeof(DWORD)), instruction.GetInfo().pName);
+		OutputDebugStringA(buffer);
+		OutputDebugStringA(opcodeBuffer.c_str());
+		OutputDebugStringA("\n");
 	}
 }
+#endif // DUMP_RAW_OPCODES
 
 
 
 
 
-void PatchDXBC(	const void		*pSrcDataShader,		//[In]	Original DXBC
-				unsigned int	inSrcShaderSize,		//[In]	Size of original DXBC
-				void			*pOpcodeStream,			//[In]	Opcode stream to inject
-				unsigned int	inOpcodeStreamSize,		//[In]	Opcode stream size
-				unsigned int	inInsertBeforeOpcode,	//[In]	Original opcode number before which modification will happen
-				void			*pDstDataShader			//[Out]	Output buffer to put modified DXBC into
+void PatchDXBC(	const void			*pSrcDataShader,		//[In]	Original DXBC
+				unsigned int		inSrcShaderSize,		//[In]	Size of original DXBC
+				void				*pOpcodeStream,			//[In]	Opcode stream to inject
+				unsigned int		inOpcodeStreamSize,		//[In]	Opcode stream size
+				unsigned int		inInsertBeforeOpcode,	//[In]	Original opcode number before which modification will happen
+				void				*pDstDataShader,		//[Out]	Output buffer to put modified DXBC into
+				DXBCChecksumContext	*pChecksumContext		//[In]	Optional checksum context kept between patches of the same shader
 	)
 {
 #if DUMP_SHADER_DISASSEMBLY
-	ID3DBlob* pBlob = NULL;
-
-	HRESULT result = D3DDisassemble(pSrcDataShader,
-									inSrcShaderSize,
-									(
-									D3D_DISASM_ENABLE_COLOR_CODE			|	// Enable the output of color codes.
-									D3D_DISASM_ENABLE_DEFAULT_VALUE_PRINTS	|	// Enable the output of default values.
-									D3D_DISASM_ENABLE_INSTRUCTION_NUMBERING |	// Enable instruction numbering.
-									//D3D_DISASM_ENABLE_INSTRUCTION_CYCLE	|	// No effect.
-									//D3D_DISASM_DISABLE_DEBUG_INFO			|	// Disable debug information.
-									D3D_DISASM_ENABLE_INSTRUCTION_OFFSET	//|	// Enable instruction offsets.
-									//D3D_DISASM_INSTRUCTION_ONLY			|	// Disassemble instructions only.
-									//D3D_DISASM_PRINT_HEX_LITERALS				// Use hex symbols in disassemblies.
-									),
-									"// Dummy shader comment\n",
-									&pBlob);
-
-	if(result == S_OK)
+	std::string disassembly;
+
+	if(DisassembleDXBC(	pSrcDataShader,
+						inSrcShaderSize,
+						(
+						DXBC_DISASM_INSTRUCTION_NUMBERING	|	// Instruction numbers (the ones inInsertBeforeOpcode expects).
+						DXBC_DISASM_INSTRUCTION_OFFSET		//|	// Instruction offsets.
+						//DXBC_DISASM_HEX_LITERALS				// Use hex symbols in disassemblies.
+						),
+						disassembly) == DXBC_PATCH_OK)
 	{
 		// Print to debugger output window
-		OutputDebugStringA((char*)pBlob->GetBufferPointer());
+		OutputDebugStringA(disassembly.c_str());
 
-		// And also create to HTML file with disassembly
-		FILE* pFile = fopen("shader_dump.html", "w");
+		// And also create a text file with disassembly
+		FILE* pFile = fopen("shader_dump.txt", "w");
 
 		if(pFile)
 		{
-			fputs((char*)pBlob->GetBufferPointer(), pFile);
+			fputs(disassembly.c_str(), pFile);
 			fclose(pFile);
 		}
 		pFile = nullptr;
@@ -326,209 +311,376 @@ void PatchDXBC(	const void		*pSrcDataShader,		//[In]	Original DXBC
 
 
 
-	// Shader bytecode consists of few chunks. Basic information about each chunk is
-	// written in chunk index. First we will read sizes of each chunk from it.
-	DWORD chunkCount = *((DWORD*)pSrcDataShader + 7);
-	BYTE *pChunkIndexData = (BYTE*)pSrcDataShader + 32;
+	DXBCLayout layout;
 
-	std::vector<unsigned int> chunkIndex;
+	// We've found shader opcode chunk
+	if(ParseDXBCLayout(pSrcDataShader, inSrcShaderSize, &layout) == DXBC_PATCH_OK)
+	{
+#if DUMP_RAW_OPCODES
+		DumpRawOpcodes(layout.pOpcodes, layout.opcodeDWORDs);
+#endif // DUMP_RAW_OPCODES
 
-	for(unsigned int i = 0; i < chunkCount; i++)
-		chunkIndex.push_back(*((DWORD*)pChunkIndexData + i));
+		// Only one split point matters - find it by walking the opcodes in front of it. Everything
+		// after the injection point is never decoded and both halves are copied in bulk.
+		unsigned int splitOffset = FindOpcodeOffset(layout.pOpcodes, layout.opcodeDWORDs, inInsertBeforeOpcode);
 
-	// Now find which one is the actual shader opcode chunk and where it begins.
-	BYTE *pOpcodeChunk	= NULL;
-	DWORD orgOpcodeChunkSize = 0;
-	unsigned int shaderChunkIndex = 0;
+		// Opcodes in front of the injection point, injected opcodes and then all the remaining ones. Injecting
+		// at or past the last opcode appends the stream at the end of the chunk.
+		DXBCSpan spans[3] =
+		{
+			{ layout.pOpcodes,					splitOffset * (unsigned int)sizeof(DWORD) },
+			{ pOpcodeStream,					inOpcodeStreamSize },
+			{ layout.pOpcodes + splitOffset,	(layout.opcodeDWORDs - splitOffset) * (unsigned int)sizeof(DWORD) },
+		};
 
-	for(unsigned int i = 0; i < chunkCount; i++)
+		EmitDXBC(layout, spans, 3, pDstDataShader, ~0u, NULL, pChecksumContext);
+	}
+}
+
+
+
+
+
+unsigned int GetPatchedDXBCSize(	const void			*pSrcDataShader,		//[In]	Original DXBC
+									unsigned int		inSrcShaderSize,		//[In]	Size of original DXBC
+									unsigned int		inOpcodeStreamSize		//[In]	Opcode stream size
+	)
+{
+	DXBCLayout layout;
+
+	// Only opcodes are inserted, everything else keeps its size
+	if(ParseDXBCLayout(pSrcDataShader, inSrcShaderSize, &layout) != DXBC_PATCH_OK)
+		return 0;
+
+	return inSrcShaderSize + inOpcodeStreamSize;
+}
+
+
+
+
+
+DXBCPatchStatus PatchDXBCBounded(	const void			*pSrcDataShader,		//[In]	Original DXBC
+									unsigned int		inSrcShaderSize,		//[In]	Size of original DXBC
+									const void			*pOpcodeStream,			//[In]	Opcode stream to inject
+									unsigned int		inOpcodeStreamSize,		//[In]	Opcode stream size
+									unsigned int		inInsertBeforeOpcode,	//[In]	Original opcode number before which modification will happen
+									void				*pDstDataShader,		//[Out]	Output buffer to put modified DXBC into
+									unsigned int		inDstCapacity,			//[In]	Size of output buffer
+									unsigned int		*pDstSize,				//[Out]	Optional size of modified DXBC
+									DXBCChecksumContext	*pChecksumContext		//[In]	Optional checksum context kept between patches of the same shader
+	)
+{
+	DXBCLayout layout;
+
+	DXBCPatchStatus status = ParseDXBCLayout(pSrcDataShader, inSrcShaderSize, &layout);
+
+	if(status != DXBC_PATCH_OK)
+		return status;
+
+	unsigned int splitOffset = FindOpcodeOffset(layout.pOpcodes, layout.opcodeDWORDs, inInsertBeforeOpcode);
+
+	DXBCSpan spans[3] =
 	{
-		char* pCode = (char*)pSrcDataShader + chunkIndex[i];
+		{ layout.pOpcodes,					splitOffset * (unsigned int)sizeof(DWORD) },
+		{ pOpcodeStream,					inOpcodeStreamSize },
+		{ layout.pOpcodes + splitOffset,	(layout.opcodeDWORDs - splitOffset) * (unsigned int)sizeof(DWORD) },
+	};
 
-		// Check for shader opcode chunk (most interesting for our debugging purposes are
-		// SHDR (SM4) or SHEX (SM5) chunks).
-		if(	(MAKEFOURCC(pCode[0], pCode[1], pCode[2], pCode[3]) == MAKEFOURCC('S', 'H', 'D', 'R')) ||
-			(MAKEFOURCC(pCode[0], pCode[1], pCode[2], pCode[3]) == MAKEFOURCC('S', 'H', 'E', 'X')))
-		{
-			pOpcodeChunk = (BYTE*)pCode;
-			shaderChunkIndex = i;
-			break;
-		}
+	return EmitDXBC(layout, spans, 3, pDstDataShader, inDstCapacity, pDstSize, pChecksumContext);
+}
+
+
+
+
+
+//================================================================================================================
+// DXBCDocument
+//================================================================================================================
+DXBCDocument::DXBCDocument()
+{
+	memset(&m_layout, 0, sizeof(m_layout));
+}
+
+DXBCPatchStatus DXBCDocument::Parse(const void *pSrcDataShader, unsigned int inSrcShaderSize)
+{
+	// Storage is reused between parses, so re-parsing does not allocate unless the shader has more opcodes
+	m_opcodeOffsets.clear();
+
+	DXBCPatchStatus status = ParseDXBCLayout(pSrcDataShader, inSrcShaderSize, &m_layout);
+
+	if(status != DXBC_PATCH_OK)
+	{
+		memset(&m_layout, 0, sizeof(m_layout));
+		return status;
 	}
 
-	// We've found shader opcode chunk
-	if(pOpcodeChunk)
+	// Index every opcode once
+	for(DXBCInstruction instruction : IterateDXBCInstructions(m_layout))
+		m_opcodeOffsets.push_back((unsigned int)(instruction.pToken - m_layout.pOpcodes));
+
+	// End of stream, so opcode i always spans [offset i, offset i + 1)
+	m_opcodeOffsets.push_back(m_layout.opcodeDWORDs);
+
+	return DXBC_PATCH_OK;
+}
+
+unsigned int DXBCDocument::GetOpcodeCount() const
+{
+	return m_opcodeOffsets.empty() ? 0 : (unsigned int)m_opcodeOffsets.size() - 1;
+}
+
+const DWORD* DXBCDocument::GetOpcode(unsigned int inOpcode) const
+{
+	return m_layout.pOpcodes + m_opcodeOffsets[inOpcode];
+}
+
+unsigned int DXBCDocument::GetOpcodeSize(unsigned int inOpcode) const
+{
+	return (m_opcodeOffsets[inOpcode + 1] - m_opcodeOffsets[inOpcode]) * sizeof(DWORD);
+}
+
+unsigned int DXBCDocument::GetOpcodeOffset(unsigned int inOpcode) const
+{
+	unsigned int opcodeCount = GetOpcodeCount();
+
+	return m_opcodeOffsets[(inOpcode < opcodeCount) ? inOpcode : opcodeCount];
+}
+
+unsigned int DXBCDocument::GetPatchedSize(unsigned int inOpcodeStreamSize) const
+{
+	return m_layout.pShaderChunk ? m_layout.srcSize + inOpcodeStreamSize : 0;
+}
+
+unsigned int DXBCDocument::GetEmittedSize(const DXBCSpan *pOpcodeSpans, unsigned int inSpanCount) const
+{
+	if(!m_layout.pShaderChunk)
+		return 0;
+
+	unsigned int size = m_layout.srcSize - m_layout.opcodeDWORDs * sizeof(DWORD);
+
+	for(unsigned int i = 0; i < inSpanCount; i++)
+		size += pOpcodeSpans[i].size;
+
+	return size;
+}
+
+DXBCPatchStatus DXBCDocument::Emit(const DXBCSpan *pOpcodeSpans, unsigned int inSpanCount, void *pDstDataShader, DXBCChecksumContext *pChecksumContext) const
+{
+	return Emit(pOpcodeSpans, inSpanCount, pDstDataShader, ~0u, NULL, pChecksumContext);
+}
+
+DXBCPatchStatus DXBCDocument::Emit(const DXBCSpan *pOpcodeSpans, unsigned int inSpanCount, void *pDstDataShader, unsigned int inDstCapacity, unsigned int *pDstSize, DXBCChecksumContext *pChecksumContext) const
+{
+	if(!m_layout.pShaderChunk)
+		return DXBC_PATCH_NOT_PARSED;
+
+	return EmitDXBC(m_layout, pOpcodeSpans, inSpanCount, pDstDataShader, inDstCapacity, pDstSize, pChecksumContext);
+}
+
+DXBCPatchStatus DXBCDocument::Patch(const void *pOpcodeStream, unsigned int inOpcodeStreamSize, unsigned int inInsertBeforeOpcode, void *pDstDataShader, DXBCChecksumContext *pChecksumContext) const
+{
+	return Patch(pOpcodeStream, inOpcodeStreamSize, inInsertBeforeOpcode, pDstDataShader, ~0u, NULL, pChecksumContext);
+}
+
+DXBCPatchStatus DXBCDocument::Patch(const void *pOpcodeStream, unsigned int inOpcodeStreamSize, unsigned int inInsertBeforeOpcode, void *pDstDataShader, unsigned int inDstCapacity, unsigned int *pDstSize, DXBCChecksumContext *pChecksumContext) const
+{
+	if(!m_layout.pShaderChunk)
+		return DXBC_PATCH_NOT_PARSED;
+
+	unsigned int splitOffset = GetOpcodeOffset(inInsertBeforeOpcode);
+
+	DXBCSpan spans[3] =
 	{
-		orgOpcodeChunkSize = *(DWORD*)(pOpcodeChunk + 4);
-		unsigned char version = *(char*)(pOpcodeChunk + 8);
-		unsigned char verMin = version & 0xF;
-		unsigned char verMaj = version >> 4;
+		{ m_layout.pOpcodes,				splitOffset * (unsigned int)sizeof(DWORD) },
+		{ pOpcodeStream,					inOpcodeStreamSize },
+		{ m_layout.pOpcodes + splitOffset,	(m_layout.opcodeDWORDs - splitOffset) * (unsigned int)sizeof(DWORD) },
+	};
 
-		// 0 = pixel
-		// 1 = vertex
-		unsigned char programType = *(char*)(pOpcodeChunk + 10);
+	return EmitDXBC(m_layout, spans, 3, pDstDataShader, inDstCapacity, pDstSize, pChecksumContext);
+}
 
-		// First copy part of source DXBC buffer that remains unmodified (everything up to SHDR/SHEX shader chunk)
-		unsigned int preambleSize = (unsigned int)(pOpcodeChunk - (BYTE*)pSrcDataShader);
-		memcpy(pDstDataShader, pSrcDataShader, preambleSize);
+// Turns the edit script into the spans of the new opcode stream. Edits are visited in order of the opcode
+// they start at, copying original opcodes between them, so the output is produced front to back in one go.
+DXBCPatchStatus DXBCDocument::BuildEditSpans(const DXBCEdit *pEdits, unsigned int inEditCount, std::vector<DXBCSpan> &spans) const
+{
+	unsigned int opcodeCount = GetOpcodeCount();
+
+	std::vector<unsigned int> order(inEditCount);
+
+	for(unsigned int i = 0; i < inEditCount; i++)
+	{
+		const DXBCEdit &edit = pEdits[i];
 
-		// Then copy our modified opcode chunk
-		void *writeLoc = (BYTE*)pDstDataShader + preambleSize;
+		if(edit.type != DXBC_EDIT_INSERT && (edit.opcodeCount == 0 || edit.opcode >= opcodeCount || edit.opcodeCount > opcodeCount - edit.opcode))
+			return DXBC_PATCH_INVALID_EDIT;
 
-		// Chunk header
-		memcpy(writeLoc, pOpcodeChunk, 16);
-		writeLoc = (BYTE*)writeLoc + 16;
+		order[i] = i;
+	}
+
+	// Inserts go first at the same opcode, otherwise script order is kept
+	std::stable_sort(order.begin(), order.end(), [pEdits, opcodeCount](unsigned int a, unsigned int b)
+	{
+		unsigned int opcodeA = (pEdits[a].opcode < opcodeCount) ? pEdits[a].opcode : opcodeCount;
+		unsigned int opcodeB = (pEdits[b].opcode < opcodeCount) ? pEdits[b].opcode : opcodeCount;
 
-		// Then copy remainder of the shader bytecode
-		unsigned int remainderByteCodeSize = (unsigned int)(inSrcShaderSize -		// Orginal length
-											(pOpcodeChunk - (BYTE*)pSrcDataShader)	// size everything took up to shader chunk
-											- orgOpcodeChunkSize);					// opcode chunk size
+		if(opcodeA != opcodeB)
+			return opcodeA < opcodeB;
 
-		unsigned int numberOfDWORDs = *(DWORD*)(pOpcodeChunk + 12); //should equal always orgOpcodeChunkSize / 4
-		BYTE* pOpcodeData = pOpcodeChunk + 16;
+		return (pEdits[a].type == DXBC_EDIT_INSERT) && (pEdits[b].type != DXBC_EDIT_INSERT);
+	});
 
-		// For new shader byte what needs to be modified is:
-		// 1. Whole DXBC size
-		// 2. Shader chunk size
-		// 3. Number of DWORDS in the chunk
-		// 4. Recalculate checksum
+	spans.clear();
+	spans.reserve(2 * inEditCount + 1);
 
-		DWORD* opcode = (DWORD*) pOpcodeData;
+	// Original opcode from which copying continues
+	unsigned int cursor = 0;
 
-		unsigned int offset = 0;
-		unsigned int of = 0;
+	for(unsigned int i = 0; i < inEditCount; i++)
+	{
+		const DXBCEdit &edit = pEdits[order[i]];
+		unsigned int opcode = (edit.opcode < opcodeCount) ? edit.opcode : opcodeCount;
 
-		// Collect all opcodes
-		std::vector<DXBCOpCode> opcodes;
+		// Previous replace or delete already consumed this opcode
+		if(opcode < cursor)
+			return DXBC_PATCH_CONFLICTING_EDITS;
 
-		for(unsigned int i = 0; i < numberOfDWORDs - 2; i++)
+		// Untouched original opcodes in front of the edit
+		if(opcode > cursor)
 		{
-			DXBCOpCode op;
-
-			//Opcode type is stored in first 10 bits
-			op.opcodeType = (D3D10_SB_OPCODE_TYPE)(opcode[i] & 1023);
-
-			if(op.opcodeType == D3D10_SB_OPCODE_CUSTOMDATA)
-			{
-				OutputDebugStringA("Opcode starts custom data block. This is not supported yet!");
-
-				// DWORD 0 (CustomDataDescTok):
-				// [10:00] == D3D10_SB_OPCODE_CUSTOMDATA
-				// [31:11] == D3D10_SB_CUSTOMDATA_CLASS
-				//
-				// DWORD 1:
-				//          32-bit unsigned integer count of number
-				//          of DWORDs in custom-data block,
-				//          including DWORD 0 and DWORD 1.
-				//          So the minimum value is 0x00000002,
-				//          meaning empty custom-data.
-				//
-				// Layout of custom-data contents, for the various meta-data classes,
-				// not defined in this file.
-				//
-				DWORD op1Len		= opcode[i + 1];
-
-				op.isExtended		= false;
-				op.pRawData			= opcode + i;
-				op.opcodeLength		= op1Len;
-
-				op.chunkOffset = of;
-
-				offset	+= op1Len * 4;
-				of		+= op1Len * 4;
-
-				//Jump to next opcode
-				if(op1Len > 1)
-					i += op1Len - 1;
-			}
-			else
-			{
-				DWORD opControls	= (opcode[i] & 8387584) >> 11;
-				DWORD op1Len		= (opcode[i] & 2139095040) >> 24;
-				DWORD opIsExtended	= (opcode[i] & 2147483648) >> 31;
-
-				op.isExtended		= opIsExtended;
-				op.pRawData			= opcode + i;
-				op.opcodeLength		= op1Len;
-				op.chunkOffset		= of;
-
-				offset	+= op1Len * 4;
-				of		+= op1Len * 4;
-
-				//Jump to next opcode
-				if(op1Len > 1)
-					i += op1Len - 1;
-			}
-
-			opcodes.push_back(op);
+			DXBCSpan original = { GetOpcode(cursor), (m_opcodeOffsets[opcode] - m_opcodeOffsets[cursor]) * (unsigned int)sizeof(DWORD) };
+			spans.push_back(original);
 		}
 
-		unsigned int insertedOpcodesSize = 0;
-
-		// Iterate over all original opcodes and copy them into destination buffer
-		for(size_t i = 0; i < opcodes.size(); i++)
+		if(edit.type != DXBC_EDIT_DELETE)
 		{
-			// Additionally, when found the location we want to inject into, copy new opcodes there
-			if(i == inInsertBeforeOpcode)
-			{
-				insertedOpcodesSize = inOpcodeStreamSize;
-				memcpy((BYTE*)pDstDataShader + preambleSize + 16 + opcodes[i].chunkOffset, pOpcodeStream, insertedOpcodesSize);
-			}
+			DXBCSpan stream = { edit.pOpcodeStream, edit.opcodeStreamSize };
+			spans.push_back(stream);
+		}
 
-			memcpy((BYTE*)pDstDataShader + preambleSize + 16 + opcodes[i].chunkOffset + insertedOpcodesSize, opcodes[i].pRawData, opcodes[i].opcodeLength * sizeof(DWORD));
+		cursor = (edit.type == DXBC_EDIT_INSERT) ? opcode : opcode + edit.opcodeCount;
+	}
 
-#if DUMP_RAW_OPCODES
-			const char *pOpcodeName = GetOpcodeNameString(opcodes[i].opcodeType);
+	// Rest of the original opcodes
+	if(cursor < opcodeCount)
+	{
+		DXBCSpan original = { GetOpcode(cursor), (m_layout.opcodeDWORDs - m_opcodeOffsets[cursor]) * (unsigned int)sizeof(DWORD) };
+		spans.push_back(original);
+	}
 
-			std::string opcodeBuffer = "\t{ ";
-			for(unsigned int j = 0; j < opcodes[i].opcodeLength; j++)
-			{
-				char opBuffer[32];
-				sprintf(opBuffer, "%u ", opcodes[i].pRawData[j]);
+	return DXBC_PATCH_OK;
+}
 
-				opcodeBuffer += opBuffer;
-			}
+DXBCPatchStatus DXBCDocument::GetEditedSize(const DXBCEdit *pEdits, unsigned int inEditCount, unsigned int *pSize) const
+{
+	if(!m_layout.pShaderChunk)
+		return DXBC_PATCH_NOT_PARSED;
 
-			opcodeBuffer += " }";
+	std::vector<DXBCSpan> spans;
 
+	DXBCPatchStatus status = BuildEditSpans(pEdits, inEditCount, spans);
 
-			sprintf(buffer, "%03u. [offset: %05u, length: %02u]\t%s\t%s\n", i, opcodes[i].chunkOffset, opcodes[i].opcodeLength * sizeof(DWORD), pOpcodeName, opcodeBuffer.c_str());
-			OutputDebugStringA(buffer);
-#endif // DUMP_RAW_OPCODES
-		}
+	if(status == DXBC_PATCH_OK)
+		*pSize = GetEmittedSize(spans.data(), (unsigned int)spans.size());
+
+	return status;
+}
+
+DXBCPatchStatus DXBCDocument::ApplyEdits(const DXBCEdit *pEdits, unsigned int inEditCount, void *pDstDataShader, DXBCChecksumContext *pChecksumContext) const
+{
+	return ApplyEdits(pEdits, inEditCount, pDstDataShader, ~0u, NULL, pChecksumContext);
+}
 
-		writeLoc = (BYTE*)writeLoc + offset + inOpcodeStreamSize;
+DXBCPatchStatus DXBCDocument::ApplyEdits(const DXBCEdit *pEdits, unsigned int inEditCount, void *pDstDataShader, unsigned int inDstCapacity, unsigned int *pDstSize, DXBCChecksumContext *pChecksumContext) const
+{
+	if(!m_layout.pShaderChunk)
+		return DXBC_PATCH_NOT_PARSED;
 
-		// Then copy remainder of the shader bytecode
-		memcpy(writeLoc, pOpcodeChunk + orgOpcodeChunkSize + 8, remainderByteCodeSize - 8);
+	std::vector<DXBCSpan> spans;
 
+	DXBCPatchStatus status = BuildEditSpans(pEdits, inEditCount, spans);
 
-		//
-		// Finally, regenerate all shader metadata in the stream
-		//
-		// Increment overall DXBC size by size of injected opcodes
-		*((DWORD*)pDstDataShader + 6) += inOpcodeStreamSize;
-		BYTE* pChunkData = (BYTE*)pDstDataShader + 32;
+	if(status != DXBC_PATCH_OK)
+		return status;
 
-		// Update chunk table (offsets of all chunks after modified shader chunk)
-		if(shaderChunkIndex < chunkCount) // Make sure there are remaining chunks after modified one
-		{
-			for(unsigned int i = shaderChunkIndex + 1; i < chunkCount; i++)
-				*((DWORD*)pChunkData + i) = chunkIndex[i] + inOpcodeStreamSize;
-		}
+	return EmitDXBC(m_layout, spans.data(), (unsigned int)spans.size(), pDstDataShader, inDstCapacity, pDstSize, pChecksumContext);
+}
 
-		// Update shader chunk size and number of DWORDs in it
-		DWORD* pNewShaderChunk = (DWORD*)((BYTE*)pDstDataShader + preambleSize);
-		pNewShaderChunk[1] += inOpcodeStreamSize;
-		pNewShaderChunk[3] += (inOpcodeStreamSize / sizeof(DWORD));
 
-		// Rehash shader MD5 checksum - checksum in buffer has to be cleared to in order to be properly hashed
-		constexpr unsigned int checksumSize = 16;
 
-		DWORD* pChecksum = (DWORD*)pDstDataShader + 1;
-		memset(pChecksum, 0, checksumSize);
-		unsigned int newSize = inSrcShaderSize + inOpcodeStreamSize;
 
-		CalculateDXBCChecksum((BYTE*)pDstDataShader, newSize, pChecksum);
-	}
+
+DXBCPatchStatus PatchDXBCInPlace(	void				*pDataShader,			//[In,Out]	DXBC to modify
+									unsigned int		inShaderSize,			//[In]	Size of DXBC
+									unsigned int		inCapacity,				//[In]	Size of buffer holding DXBC
+									const void			*pOpcodeStream,			//[In]	Opcode stream to inject
+									unsigned int		inOpcodeStreamSize,		//[In]	Opcode stream size
+									unsigned int		inInsertBeforeOpcode,	//[In]	Original opcode number before which modification will happen
+									unsigned int		*pNewSize,				//[Out]	Optional size of modified DXBC
+									DXBCChecksumContext	*pChecksumContext		//[In]	Optional checksum context kept between patches of the same shader
+	)
+{
+	DXBCLayout layout;
+
+	DXBCPatchStatus status = ParseDXBCLayout(pDataShader, inShaderSize, &layout);
+
+	if(status != DXBC_PATCH_OK)
+		return status;
+
+	unsigned int newSize = inShaderSize + inOpcodeStreamSize;
+
+	if(pNewSize)
+		*pNewSize = newSize;
+
+	if(newSize > inCapacity)
+		return DXBC_PATCH_BUFFER_TOO_SMALL;
+
+	BYTE* pData = (BYTE*)pDataShader;
+
+	// Shift everything after the injection point and put the stream into the gap
+	unsigned int splitOffset = FindOpcodeOffset(layout.pOpcodes, layout.opcodeDWORDs, inInsertBeforeOpcode);
+	unsigned int splitByteOffset = (unsigned int)((const BYTE*)(layout.pOpcodes + splitOffset) - pData);
+
+	memmove(pData + splitByteOffset + inOpcodeStreamSize, pData + splitByteOffset, inShaderSize - splitByteOffset);
+	memcpy(pData + splitByteOffset, pOpcodeStream, inOpcodeStreamSize);
+
+	// New DXBC size, offsets of chunks after shader chunk, shader chunk size and number of DWORDs in it
+	DWORD* pHeader = (DWORD*)pData;
+	pHeader[6] += inOpcodeStreamSize;
+
+	for(unsigned int i = layout.shaderChunkIndex + 1; i < layout.chunkCount; i++)
+		pHeader[8 + i] += inOpcodeStreamSize;
+
+	DWORD* pChunkHeader = (DWORD*)layout.pShaderChunk;
+	pChunkHeader[1] += inOpcodeStreamSize;
+	pChunkHeader[3] += inOpcodeStreamSize / sizeof(DWORD);
+
+	// Finally recalculate checksum. With a context, blocks in front of the injection point are not rehashed.
+	if(pChecksumContext)
+		pChecksumContext->Calculate(pData, newSize, pHeader + 1);
+	else
+		CalculateDXBCChecksum(pData, newSize, pHeader + 1);
+
+	return DXBC_PATCH_OK;
+}
+
+
+
+
+
+DXBCPatchStatus PatchDXBCEdits(	const void			*pSrcDataShader,		//[In]	Original DXBC
+								unsigned int		inSrcShaderSize,		//[In]	Size of original DXBC
+								const DXBCEdit		*pEdits,				//[In]	Edit script
+								unsigned int		inEditCount,			//[In]	Number of edits
+								void				*pDstDataShader,		//[Out]	Output buffer to put modified DXBC into
+								DXBCChecksumContext	*pChecksumContext		//[In]	Optional checksum context kept between patches of the same shader
+	)
+{
+	DXBCDocument document;
+
+	DXBCPatchStatus status = document.Parse(pSrcDataShader, inSrcShaderSize);
+
+	if(status != DXBC_PATCH_OK)
+		return status;
+
+	return document.ApplyEdits(pEdits, inEditCount, pDstDataShader, pChecksumContext);
 }
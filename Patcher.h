@@ -11,12 +11,210 @@
 #ifndef PATCH_DXBC_H
 #define PATCH_DXBC_H
 
-void PatchDXBC(	const void		*pSrcDataShader,		//[In]	Original DXBC
-				unsigned int	inSrcShaderSize,		//[In]	Size of original DXBC
-				void			*pOpcodeStream,			//[In]	Opcode stream to inject
-				unsigned int	inOpcodeStreamSize,		//[In]	Opcode stream size
-				unsigned int	inInsertBeforeOpcode,	//[In]	Original opcode number before which modification will happen
-				void			*pDstDataShader			//[Out]	Output buffer to put modified DXBC into
+#include <vector>
+#include "DXBCPlatform.h"
+
+// Version of patcher output. Has to be bumped whenever the same input starts producing different output, so
+// patched shaders cached by older versions (see DXBCDiskCache) are not reused.
+#define DXBC_PATCHER_VERSION	1
+
+class DXBCChecksumContext;
+
+enum DXBCPatchStatus
+{
+	DXBC_PATCH_OK = 0,
+	DXBC_PATCH_NO_SHADER_CHUNK,		// Container has no SHDR/SHEX chunk
+	DXBC_PATCH_NOT_PARSED,			// Document has not parsed a shader yet
+	DXBC_PATCH_INVALID_EDIT,		// Edit touches opcodes past the end of the shader or an empty range
+	DXBC_PATCH_CONFLICTING_EDITS,	// Two edits modify the same opcode (or insert inside a modified range)
+	DXBC_PATCH_BUFFER_TOO_SMALL,	// Output does not fit into destination buffer (nothing is written)
+	DXBC_PATCH_INVALID_SHADER,		// Chunk index, shader chunk or instruction lengths point outside of the container (see DXBCValidator.h)
+	DXBC_PATCH_SYNTAX_ERROR,		// Assembly text could not be assembled
+};
+
+enum DXBCEditType
+{
+	DXBC_EDIT_INSERT = 0,			// Insert opcode stream before opcode
+	DXBC_EDIT_REPLACE,				// Replace opcodeCount opcodes starting at opcode with opcode stream
+	DXBC_EDIT_DELETE,				// Remove opcodeCount opcodes starting at opcode
+};
+
+// Single operation of an edit script. Opcode numbers always refer to the original shader, so no edit needs
+// re-basing because of the other ones.
+struct DXBCEdit
+{
+	DXBCEditType	type;
+	unsigned int	opcode;				// Original opcode number. Inserting at opcode count or more appends.
+	unsigned int	opcodeCount;		// Number of original opcodes replaced or deleted (ignored by insert)
+	const void*		pOpcodeStream;		// Opcodes to insert or replace with (ignored by delete)
+	unsigned int	opcodeStreamSize;	// In bytes
+};
+
+// Where the interesting parts of a DXBC container are. All pointers point into the source container.
+struct DXBCLayout
+{
+	const BYTE*		pSrcData;			// Source container
+	unsigned int	srcSize;			// Size of source container
+	unsigned int	chunkCount;			// Number of chunks
+	const DWORD*	pChunkOffsets;		// Chunk index (offset of every chunk)
+	unsigned int	shaderChunkIndex;	// Index of SHDR/SHEX chunk in chunk index
+	const BYTE*		pShaderChunk;		// SHDR/SHEX chunk (starting with its FourCC)
+	unsigned int	shaderChunkSize;	// Shader chunk size (as stored in the chunk, without FourCC and size)
+	const DWORD*	pOpcodes;			// First opcode (after version and length tokens)
+	unsigned int	opcodeDWORDs;		// Number of opcode DWORDs
+};
+
+// Piece of a new opcode stream
+struct DXBCSpan
+{
+	const void*		pData;
+	unsigned int	size;				// In bytes
+};
+
+// Reads chunk index and finds SHDR/SHEX chunk and its opcodes, checking that all of it lies inside the container
+// and that the chunks up to it lie after the chunk index, DWORD aligned. Costs O(chunk count), instructions are
+// never walked.
+DXBCPatchStatus ParseDXBCLayout(	const void			*pSrcDataShader,		//[In]	DXBC
+									unsigned int		inSrcShaderSize,		//[In]	Size of DXBC
+									DXBCLayout			*pLayout				//[Out]	Where its parts are
+	);
+
+void PatchDXBC(	const void			*pSrcDataShader,		//[In]	Original DXBC
+				unsigned int		inSrcShaderSize,		//[In]	Size of original DXBC
+				void				*pOpcodeStream,			//[In]	Opcode stream to inject
+				unsigned int		inOpcodeStreamSize,		//[In]	Opcode stream size
+				unsigned int		inInsertBeforeOpcode,	//[In]	Original opcode number before which modification will happen
+				void				*pDstDataShader,		//[Out]	Output buffer to put modified DXBC into
+				DXBCChecksumContext	*pChecksumContext = nullptr	//[In]	Optional checksum context kept between patches of the same shader,
+																//		only blocks changed since the previous patch get rehashed
+	);
+
+// Exact size of DXBC produced by PatchDXBC with the same arguments, 0 if it has no (valid) shader chunk.
+unsigned int GetPatchedDXBCSize(	const void			*pSrcDataShader,		//[In]	Original DXBC
+									unsigned int		inSrcShaderSize,		//[In]	Size of original DXBC
+									unsigned int		inOpcodeStreamSize		//[In]	Opcode stream size
+	);
+
+// PatchDXBC that never writes past inDstCapacity bytes. If the output does not fit, nothing is written and
+// DXBC_PATCH_BUFFER_TOO_SMALL is returned. Either way *pDstSize (if given) receives the exact output size.
+DXBCPatchStatus PatchDXBCBounded(	const void			*pSrcDataShader,		//[In]	Original DXBC
+									unsigned int		inSrcShaderSize,		//[In]	Size of original DXBC
+									const void			*pOpcodeStream,			//[In]	Opcode stream to inject
+									unsigned int		inOpcodeStreamSize,		//[In]	Opcode stream size
+									unsigned int		inInsertBeforeOpcode,	//[In]	Original opcode number before which modification will happen
+									void				*pDstDataShader,		//[Out]	Output buffer to put modified DXBC into
+									unsigned int		inDstCapacity,			//[In]	Size of output buffer
+									unsigned int		*pDstSize,				//[Out]	Optional size of modified DXBC
+									DXBCChecksumContext	*pChecksumContext = nullptr	//[In]	Optional checksum context kept between patches of the same shader
+	);
+
+// PatchDXBC for a shader buffer with enough spare room after it. Only opcodes after the injection point (and
+// chunks following the shader chunk) are moved; the untouched prefix stays where it is and no second buffer is
+// needed. Stream to inject must not point into the shader buffer. If the result would not fit into
+// inCapacity bytes, the shader is left untouched and DXBC_PATCH_BUFFER_TOO_SMALL is returned.
+DXBCPatchStatus PatchDXBCInPlace(	void				*pDataShader,			//[In,Out]	DXBC to modify
+									unsigned int		inShaderSize,			//[In]	Size of DXBC
+									unsigned int		inCapacity,				//[In]	Size of buffer holding DXBC
+									const void			*pOpcodeStream,			//[In]	Opcode stream to inject
+									unsigned int		inOpcodeStreamSize,		//[In]	Opcode stream size
+									unsigned int		inInsertBeforeOpcode,	//[In]	Original opcode number before which modification will happen
+									unsigned int		*pNewSize,				//[Out]	Optional size of modified DXBC
+									DXBCChecksumContext	*pChecksumContext = nullptr	//[In]	Optional checksum context kept between patches of the same shader
+	);
+
+// Applies whole edit script in a single output pass with a single checksum. Inserts at the same opcode keep
+// their order in the script and go before a replace or delete starting there.
+DXBCPatchStatus PatchDXBCEdits(	const void			*pSrcDataShader,		//[In]	Original DXBC
+								unsigned int		inSrcShaderSize,		//[In]	Size of original DXBC
+								const DXBCEdit		*pEdits,				//[In]	Edit script
+								unsigned int		inEditCount,			//[In]	Number of edits
+								void				*pDstDataShader,		//[Out]	Output buffer to put modified DXBC into
+								DXBCChecksumContext	*pChecksumContext = nullptr	//[In]	Optional checksum context kept between patches of the same shader
 	);
 
+
+
+
+// Parsed shader that can be patched many times. Parsing reads the chunk index, finds SHDR/SHEX and indexes every
+// opcode once; patching then just looks the insertion point up. Parsing again reuses the storage of the previous
+// parse, so a document kept around for many shaders does not allocate per shader either.
+//
+// The document points into the parsed source DXBC, which has to stay alive (and unmodified) while it is in use.
+// Patch and Emit don't modify the document, so they can be used to produce any number of outputs, also from
+// multiple threads at once.
+class DXBCDocument
+{
+public:
+	DXBCDocument();
+
+	DXBCPatchStatus		Parse(	const void		*pSrcDataShader,		//[In]	Original DXBC
+								unsigned int	inSrcShaderSize			//[In]	Size of original DXBC
+		);
+
+	// Same as PatchDXBC, using the cached opcode index.
+	DXBCPatchStatus		Patch(	const void			*pOpcodeStream,			//[In]	Opcode stream to inject
+								unsigned int		inOpcodeStreamSize,		//[In]	Opcode stream size
+								unsigned int		inInsertBeforeOpcode,	//[In]	Original opcode number before which modification will happen
+								void				*pDstDataShader,		//[Out]	Output buffer to put modified DXBC into
+								DXBCChecksumContext	*pChecksumContext = nullptr	//[In]	Optional checksum context kept between patches
+		) const;
+
+	DXBCPatchStatus		Patch(	const void			*pOpcodeStream,			//[In]	Opcode stream to inject
+								unsigned int		inOpcodeStreamSize,		//[In]	Opcode stream size
+								unsigned int		inInsertBeforeOpcode,	//[In]	Original opcode number before which modification will happen
+								void				*pDstDataShader,		//[Out]	Output buffer to put modified DXBC into
+								unsigned int		inDstCapacity,			//[In]	Size of output buffer
+								unsigned int		*pDstSize,				//[Out]	Optional size of modified DXBC
+								DXBCChecksumContext	*pChecksumContext = nullptr	//[In]	Optional checksum context kept between patches
+		) const;
+
+	// Writes the parsed DXBC with its opcode stream replaced by the concatenation of pOpcodeSpans. Spans
+	// may point into the original opcodes (see GetOpcode) as well as to any new ones.
+	DXBCPatchStatus		Emit(	const DXBCSpan		*pOpcodeSpans,			//[In]	New content of the opcode stream
+								unsigned int		inSpanCount,			//[In]	Number of spans
+								void				*pDstDataShader,		//[Out]	Output buffer to put modified DXBC into
+								DXBCChecksumContext	*pChecksumContext = nullptr	//[In]	Optional checksum context kept between patches
+		) const;
+
+	DXBCPatchStatus		Emit(	const DXBCSpan		*pOpcodeSpans,			//[In]	New content of the opcode stream
+								unsigned int		inSpanCount,			//[In]	Number of spans
+								void				*pDstDataShader,		//[Out]	Output buffer to put modified DXBC into
+								unsigned int		inDstCapacity,			//[In]	Size of output buffer
+								unsigned int		*pDstSize,				//[Out]	Optional size of modified DXBC
+								DXBCChecksumContext	*pChecksumContext = nullptr	//[In]	Optional checksum context kept between patches
+		) const;
+
+	// Same as PatchDXBCEdits, using the cached opcode index.
+	DXBCPatchStatus		ApplyEdits(	const DXBCEdit		*pEdits,				//[In]	Edit script
+									unsigned int		inEditCount,			//[In]	Number of edits
+									void				*pDstDataShader,		//[Out]	Output buffer to put modified DXBC into
+									DXBCChecksumContext	*pChecksumContext = nullptr	//[In]	Optional checksum context kept between patches
+		) const;
+
+	DXBCPatchStatus		ApplyEdits(	const DXBCEdit		*pEdits,				//[In]	Edit script
+									unsigned int		inEditCount,			//[In]	Number of edits
+									void				*pDstDataShader,		//[Out]	Output buffer to put modified DXBC into
+									unsigned int		inDstCapacity,			//[In]	Size of output buffer
+									unsigned int		*pDstSize,				//[Out]	Optional size of modified DXBC
+									DXBCChecksumContext	*pChecksumContext = nullptr	//[In]	Optional checksum context kept between patches
+		) const;
+
+	// Exact output sizes of Patch, Emit and ApplyEdits, so outputs can be placed tightly next to each other.
+	unsigned int		GetPatchedSize(unsigned int inOpcodeStreamSize) const;
+	unsigned int		GetEmittedSize(const DXBCSpan *pOpcodeSpans, unsigned int inSpanCount) const;
+	DXBCPatchStatus		GetEditedSize(const DXBCEdit *pEdits, unsigned int inEditCount, unsigned int *pSize) const;
+
+	const DXBCLayout&	GetLayout() const { return m_layout; }
+	unsigned int		GetOpcodeCount() const;
+	const DWORD*		GetOpcode(unsigned int inOpcode) const;			// Opcode token of the given opcode
+	unsigned int		GetOpcodeSize(unsigned int inOpcode) const;		// In bytes
+	unsigned int		GetOpcodeOffset(unsigned int inOpcode) const;	// In DWORDs from the first opcode, opcode count or more gives the end of stream
+
+private:
+	DXBCPatchStatus		BuildEditSpans(const DXBCEdit *pEdits, unsigned int inEditCount, std::vector<DXBCSpan> &spans) const;
+
+	DXBCLayout					m_layout;
+	std::vector<unsigned int>	m_opcodeOffsets;	// Offset (in DWORDs) of every opcode, followed by the end of stream
+};
+
 #endif // PATCH_DXBC_H
@@ -0,0 +1,167 @@
+//================================================================================================================
+// Include files
+//================================================================================================================
+#include "PatcherBatch.h"
+#include <chrono>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+
+
+
+
+//================================================================================================================
+// Structures
+//================================================================================================================
+// Jobs [next, end) still waiting for a worker. Owner takes them from the front, thieves from the back. Each one
+// sits on its own cache line, so workers don't slow each other down while taking their own jobs.
+struct alignas(64) DXBCJobRange
+{
+	std::mutex			lock;
+	unsigned int		next;
+	unsigned int		end;
+};
+
+struct DXBCBatchWorker
+{
+	DXBCPatchJob*		pJobs;
+	DXBCJobRange*		pRanges;
+	unsigned int		workerCount;
+	unsigned int		index;
+	unsigned int		failedJobs;
+};
+
+
+
+
+
+//================================================================================================================
+// Function definitions
+//================================================================================================================
+// Takes next job of the worker's own range. Returns false when the range is empty.
+static bool TakeJob(DXBCJobRange &range, unsigned int &job)
+{
+	std::lock_guard<std::mutex> guard(range.lock);
+
+	if(range.next >= range.end)
+		return false;
+
+	job = range.next++;
+	return true;
+}
+
+// Moves later half of the first non-empty range of another worker into the worker's own range. Returns false
+// when there is nothing left to steal. Only one lock is held at a time, so workers can't deadlock each other.
+static bool StealJobs(DXBCBatchWorker &worker)
+{
+	for(unsigned int i = 1; i < worker.workerCount; i++)
+	{
+		DXBCJobRange &victim = worker.pRanges[(worker.index + i) % worker.workerCount];
+		unsigned int begin, end;
+
+		{
+			std::lock_guard<std::mutex> guard(victim.lock);
+
+			if(victim.next >= victim.end)
+				continue;
+
+			end = victim.end;
+			begin = end - (end - victim.next + 1) / 2;
+			victim.end = begin;
+		}
+
+		DXBCJobRange &own = worker.pRanges[worker.index];
+		std::lock_guard<std::mutex> guard(own.lock);
+		own.next = begin;
+		own.end = end;
+		return true;
+	}
+
+	return false;
+}
+
+// Every job patches its shader once, so only the instructions up to the injection point are walked (no opcode
+// index is built) and the checksum is calculated while the output is written
+static void RunJob(DXBCBatchWorker &worker, DXBCPatchJob &job)
+{
+	std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+
+	job.worker = worker.index;
+	job.dstSize = 0;
+	job.status = PatchDXBCBounded(	job.pSrcDataShader, job.srcShaderSize, job.pOpcodeStream, job.opcodeStreamSize, job.insertBeforeOpcode,
+									job.pDstDataShader, job.dstCapacity, &job.dstSize);
+
+	job.patchMilliseconds = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+	if(job.status != DXBC_PATCH_OK)
+		worker.failedJobs++;
+}
+
+static void RunWorker(DXBCBatchWorker *pWorker)
+{
+	DXBCJobRange &own = pWorker->pRanges[pWorker->index];
+
+	for(;;)
+	{
+		unsigned int job;
+
+		if(TakeJob(own, job))
+			RunJob(*pWorker, pWorker->pJobs[job]);
+		else if(!StealJobs(*pWorker))
+			break;
+	}
+}
+
+
+
+
+
+unsigned int PatchDXBCBatch(	DXBCPatchJob	*pJobs,				//[In,Out]	Jobs to run
+								unsigned int	inJobCount,			//[In]	Number of jobs
+								unsigned int	inThreadCount		//[In]	Number of worker threads
+	)
+{
+	if(inThreadCount == 0)
+		inThreadCount = std::thread::hardware_concurrency();
+
+	if(inThreadCount == 0)
+		inThreadCount = 1;
+
+	if(inThreadCount > inJobCount)
+		inThreadCount = (inJobCount > 0) ? inJobCount : 1;
+
+	// Every worker starts with an equal contiguous share of jobs
+	std::vector<DXBCJobRange> ranges(inThreadCount);
+	std::vector<DXBCBatchWorker> workers(inThreadCount);
+
+	for(unsigned int i = 0; i < inThreadCount; i++)
+	{
+		ranges[i].next = (unsigned int)((unsigned long long)inJobCount * i / inThreadCount);
+		ranges[i].end = (unsigned int)((unsigned long long)inJobCount * (i + 1) / inThreadCount);
+
+		workers[i].pJobs = pJobs;
+		workers[i].pRanges = ranges.data();
+		workers[i].workerCount = inThreadCount;
+		workers[i].index = i;
+		workers[i].failedJobs = 0;
+	}
+
+	// Calling thread works as well, as worker 0
+	std::vector<std::thread> threads;
+
+	for(unsigned int i = 1; i < inThreadCount; i++)
+		threads.push_back(std::thread(RunWorker, &workers[i]));
+
+	RunWorker(&workers[0]);
+
+	unsigned int failedJobs = workers[0].failedJobs;
+
+	for(unsigned int i = 1; i < inThreadCount; i++)
+	{
+		threads[i - 1].join();
+		failedJobs += workers[i].failedJobs;
+	}
+
+	return failedJobs;
+}
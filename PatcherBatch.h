@@ -0,0 +1,43 @@
+// Author: Henryk Kosobucki, 2016
+
+//=============================================	OVERVIEW =========================================================
+//	Batch patching of whole shader caches. Jobs are spread across worker threads with a work-stealing scheduler:
+//	every worker starts with its own contiguous range of jobs and, once it runs dry, steals the later half of
+//	what is left in the range of another worker.
+//
+//	Every job writes only to its own output, and workers share nothing but the job ranges, so outputs are
+//	identical for any number of threads. Each job is a single injection, patched with PatchDXBCBounded, so the
+//	opcode stream is walked only up to the injection point. Batch patching never goes through PatchDXBC debug
+//	dumps, so it does not touch any global state (like shader_dump.html).
+//================================================================================================================
+
+#ifndef PATCHER_BATCH_H
+#define PATCHER_BATCH_H
+
+#include "Patcher.h"
+
+// Single patch of a batch. Inputs are filled in by the caller, outputs by PatchDXBCBatch.
+struct DXBCPatchJob
+{
+	const void*			pSrcDataShader;			//[In]	Original DXBC
+	unsigned int		srcShaderSize;			//[In]	Size of original DXBC
+	const void*			pOpcodeStream;			//[In]	Opcode stream to inject
+	unsigned int		opcodeStreamSize;		//[In]	Opcode stream size
+	unsigned int		insertBeforeOpcode;		//[In]	Original opcode number before which modification will happen
+	void*				pDstDataShader;			//[In]	Output buffer to put modified DXBC into
+	unsigned int		dstCapacity;			//[In]	Size of output buffer (see GetPatchedDXBCSize)
+
+	DXBCPatchStatus		status;					//[Out]	Result of the patch
+	unsigned int		dstSize;				//[Out]	Size of modified DXBC
+	unsigned int		worker;					//[Out]	Worker that ran the job
+	double				patchMilliseconds;		//[Out]	Time spent patching (parse, copy and checksum)
+};
+
+// Patches all jobs using inThreadCount workers (0 means one per hardware thread) and returns once all of them
+// are done. Returns number of jobs that failed.
+unsigned int PatchDXBCBatch(	DXBCPatchJob	*pJobs,				//[In,Out]	Jobs to run
+								unsigned int	inJobCount,			//[In]	Number of jobs
+								unsigned int	inThreadCount		//[In]	Number of worker threads
+	);
+
+#endif // PATCHER_BATCH_H
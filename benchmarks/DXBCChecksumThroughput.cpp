@@ -0,0 +1,278 @@
+// Author: Henryk Kosobucki, 2016
+
+//=============================================	OVERVIEW =========================================================
+//	Throughput benchmark of CalculateDXBCChecksum against the loop it replaced, over inputs from 64 bytes to 4 MB.
+//	Built from the benchmarks directory:
+//
+//		g++ -O2 -std=c++14 -I.. DXBCChecksumThroughput.cpp ../DXBCChecksum.cpp -o checksum-throughput
+//
+//	The old loop is kept below as a reference: MD5Update staging every input byte into the context buffer and
+//	assembling the words of each block from single bytes before MD5_Transform. The current code is measured on
+//	DWORD aligned and unaligned input. Every size is hashed over and over until 64 MB went through, the best of
+//	three such runs is printed. All three checksums have to be equal (exit code 1 if they are not).
+//================================================================================================================
+
+//================================================================================================================
+// Include files
+//================================================================================================================
+#include "DXBCPlatform.h"
+#include "DXBCChecksum.h"
+#include <chrono>
+#include <stdio.h>
+#include <string.h>
+#include <vector>
+
+
+
+
+
+//================================================================================================================
+// Constants
+//================================================================================================================
+#define DXBC_THROUGHPUT_MIN_SIZE		64
+#define DXBC_THROUGHPUT_MAX_SIZE		(4 << 20)
+#define DXBC_THROUGHPUT_BYTES			(64 << 20)		// Hashed per run and size
+#define DXBC_THROUGHPUT_RUNS			3
+
+// Hashing starts after the checksum, at byte 20 of the container
+#define DXBC_THROUGHPUT_HEADER			20
+
+// Reference MD5 steps, same as in DXBCChecksum.cpp
+#define DXBC_REF_ROTL(x, n)				(((x) << (n)) | ((x) >> (32 - (n))))
+#define DXBC_REF_F(x, y, z)				(((x) & (y)) | ((~x) & (z)))
+#define DXBC_REF_G(x, y, z)				(((x) & (z)) | ((y) & (~z)))
+#define DXBC_REF_H(x, y, z)				((x) ^ (y) ^ (z))
+#define DXBC_REF_I(x, y, z)				((y) ^ ((x) | (~z)))
+#define DXBC_REF_STEP(f, a, b, c, d, x, s, ac)	{ (a) += f((b), (c), (d)) + (x) + (DWORD)(ac); (a) = DXBC_REF_ROTL((a), (s)); (a) += (b); }
+
+typedef std::chrono::steady_clock DXBCThroughputClock;
+typedef BOOL (*DXBCChecksumFunction)(BYTE *pData, DWORD dwSize, DWORD dwHash[4]);
+
+
+
+
+
+//================================================================================================================
+// Structures
+//================================================================================================================
+struct DXBCReferenceMD5
+{
+	DWORD				bits;				// Number of bits hashed (mod 2^32, DXBC never needs more)
+	DWORD				buf[4];
+	BYTE				in[64];
+};
+
+
+
+
+
+//================================================================================================================
+// Reference checksum (the loop CalculateDXBCChecksum used before)
+//================================================================================================================
+static void ReferenceTransform(DWORD *buf, const DWORD *in)
+{
+	DWORD a = buf[0], b = buf[1], c = buf[2], d = buf[3];
+
+	DXBC_REF_STEP(DXBC_REF_F, a, b, c, d, in[ 0],  7, 3614090360u);
+	DXBC_REF_STEP(DXBC_REF_F, d, a, b, c, in[ 1], 12, 3905402710u);
+	DXBC_REF_STEP(DXBC_REF_F, c, d, a, b, in[ 2], 17,  606105819u);
+	DXBC_REF_STEP(DXBC_REF_F, b, c, d, a, in[ 3], 22, 3250441966u);
+	DXBC_REF_STEP(DXBC_REF_F, a, b, c, d, in[ 4],  7, 4118548399u);
+	DXBC_REF_STEP(DXBC_REF_F, d, a, b, c, in[ 5], 12, 1200080426u);
+	DXBC_REF_STEP(DXBC_REF_F, c, d, a, b, in[ 6], 17, 2821735955u);
+	DXBC_REF_STEP(DXBC_REF_F, b, c, d, a, in[ 7], 22, 4249261313u);
+	DXBC_REF_STEP(DXBC_REF_F, a, b, c, d, in[ 8],  7, 1770035416u);
+	DXBC_REF_STEP(DXBC_REF_F, d, a, b, c, in[ 9], 12, 2336552879u);
+	DXBC_REF_STEP(DXBC_REF_F, c, d, a, b, in[10], 17, 4294925233u);
+	DXBC_REF_STEP(DXBC_REF_F, b, c, d, a, in[11], 22, 2304563134u);
+	DXBC_REF_STEP(DXBC_REF_F, a, b, c, d, in[12],  7, 1804603682u);
+	DXBC_REF_STEP(DXBC_REF_F, d, a, b, c, in[13], 12, 4254626195u);
+	DXBC_REF_STEP(DXBC_REF_F, c, d, a, b, in[14], 17, 2792965006u);
+	DXBC_REF_STEP(DXBC_REF_F, b, c, d, a, in[15], 22, 1236535329u);
+
+	DXBC_REF_STEP(DXBC_REF_G, a, b, c, d, in[ 1],  5, 4129170786u);
+	DXBC_REF_STEP(DXBC_REF_G, d, a, b, c, in[ 6],  9, 3225465664u);
+	DXBC_REF_STEP(DXBC_REF_G, c, d, a, b, in[11], 14,  643717713u);
+	DXBC_REF_STEP(DXBC_REF_G, b, c, d, a, in[ 0], 20, 3921069994u);
+	DXBC_REF_STEP(DXBC_REF_G, a, b, c, d, in[ 5],  5, 3593408605u);
+	DXBC_REF_STEP(DXBC_REF_G, d, a, b, c, in[10],  9,   38016083u);
+	DXBC_REF_STEP(DXBC_REF_G, c, d, a, b, in[15], 14, 3634488961u);
+	DXBC_REF_STEP(DXBC_REF_G, b, c, d, a, in[ 4], 20, 3889429448u);
+	DXBC_REF_STEP(DXBC_REF_G, a, b, c, d, in[ 9],  5,  568446438u);
+	DXBC_REF_STEP(DXBC_REF_G, d, a, b, c, in[14],  9, 3275163606u);
+	DXBC_REF_STEP(DXBC_REF_G, c, d, a, b, in[ 3], 14, 4107603335u);
+	DXBC_REF_STEP(DXBC_REF_G, b, c, d, a, in[ 8], 20, 1163531501u);
+	DXBC_REF_STEP(DXBC_REF_G, a, b, c, d, in[13],  5, 2850285829u);
+	DXBC_REF_STEP(DXBC_REF_G, d, a, b, c, in[ 2],  9, 4243563512u);
+	DXBC_REF_STEP(DXBC_REF_G, c, d, a, b, in[ 7], 14, 1735328473u);
+	DXBC_REF_STEP(DXBC_REF_G, b, c, d, a, in[12], 20, 2368359562u);
+
+	DXBC_REF_STEP(DXBC_REF_H, a, b, c, d, in[ 5],  4, 4294588738u);
+	DXBC_REF_STEP(DXBC_REF_H, d, a, b, c, in[ 8], 11, 2272392833u);
+	DXBC_REF_STEP(DXBC_REF_H, c, d, a, b, in[11], 16, 1839030562u);
+	DXBC_REF_STEP(DXBC_REF_H, b, c, d, a, in[14], 23, 4259657740u);
+	DXBC_REF_STEP(DXBC_REF_H, a, b, c, d, in[ 1],  4, 2763975236u);
+	DXBC_REF_STEP(DXBC_REF_H, d, a, b, c, in[ 4], 11, 1272893353u);
+	DXBC_REF_STEP(DXBC_REF_H, c, d, a, b, in[ 7], 16, 4139469664u);
+	DXBC_REF_STEP(DXBC_REF_H, b, c, d, a, in[10], 23, 3200236656u);
+	DXBC_REF_STEP(DXBC_REF_H, a, b, c, d, in[13],  4,  681279174u);
+	DXBC_REF_STEP(DXBC_REF_H, d, a, b, c, in[ 0], 11, 3936430074u);
+	DXBC_REF_STEP(DXBC_REF_H, c, d, a, b, in[ 3], 16, 3572445317u);
+	DXBC_REF_STEP(DXBC_REF_H, b, c, d, a, in[ 6], 23,   76029189u);
+	DXBC_REF_STEP(DXBC_REF_H, a, b, c, d, in[ 9],  4, 3654602809u);
+	DXBC_REF_STEP(DXBC_REF_H, d, a, b, c, in[12], 11, 3873151461u);
+	DXBC_REF_STEP(DXBC_REF_H, c, d, a, b, in[15], 16,  530742520u);
+	DXBC_REF_STEP(DXBC_REF_H, b, c, d, a, in[ 2], 23, 3299628645u);
+
+	DXBC_REF_STEP(DXBC_REF_I, a, b, c, d, in[ 0],  6, 4096336452u);
+	DXBC_REF_STEP(DXBC_REF_I, d, a, b, c, in[ 7], 10, 1126891415u);
+	DXBC_REF_STEP(DXBC_REF_I, c, d, a, b, in[14], 15, 2878612391u);
+	DXBC_REF_STEP(DXBC_REF_I, b, c, d, a, in[ 5], 21, 4237533241u);
+	DXBC_REF_STEP(DXBC_REF_I, a, b, c, d, in[12],  6, 1700485571u);
+	DXBC_REF_STEP(DXBC_REF_I, d, a, b, c, in[ 3], 10, 2399980690u);
+	DXBC_REF_STEP(DXBC_REF_I, c, d, a, b, in[10], 15, 4293915773u);
+	DXBC_REF_STEP(DXBC_REF_I, b, c, d, a, in[ 1], 21, 2240044497u);
+	DXBC_REF_STEP(DXBC_REF_I, a, b, c, d, in[ 8],  6, 1873313359u);
+	DXBC_REF_STEP(DXBC_REF_I, d, a, b, c, in[15], 10, 4264355552u);
+	DXBC_REF_STEP(DXBC_REF_I, c, d, a, b, in[ 6], 15, 2734768916u);
+	DXBC_REF_STEP(DXBC_REF_I, b, c, d, a, in[13], 21, 1309151649u);
+	DXBC_REF_STEP(DXBC_REF_I, a, b, c, d, in[ 4],  6, 4149444226u);
+	DXBC_REF_STEP(DXBC_REF_I, d, a, b, c, in[11], 10, 3174756917u);
+	DXBC_REF_STEP(DXBC_REF_I, c, d, a, b, in[ 2], 15,  718787259u);
+	DXBC_REF_STEP(DXBC_REF_I, b, c, d, a, in[ 9], 21, 3951481745u);
+
+	buf[0] += a;
+	buf[1] += b;
+	buf[2] += c;
+	buf[3] += d;
+}
+
+// Every byte goes through the context buffer, full blocks are assembled from single bytes
+static void ReferenceUpdate(DXBCReferenceMD5 &md5, const BYTE *pData, unsigned int inSize)
+{
+	unsigned int mdi = (md5.bits >> 3) & 0x3F;
+	md5.bits += inSize << 3;
+
+	while(inSize--)
+	{
+		md5.in[mdi++] = *pData++;
+
+		if(mdi == 64)
+		{
+			DWORD in[16];
+
+			for(unsigned int i = 0; i < 16; i++)
+				in[i] = ((DWORD)md5.in[i * 4 + 3] << 24) | ((DWORD)md5.in[i * 4 + 2] << 16) | ((DWORD)md5.in[i * 4 + 1] << 8) | (DWORD)md5.in[i * 4];
+
+			ReferenceTransform(md5.buf, in);
+			mdi = 0;
+		}
+	}
+}
+
+static BOOL CalculateReferenceChecksum(BYTE *pData, DWORD dwSize, DWORD dwHash[4])
+{
+	static const BYTE s_padding[64] = { 0x80 };
+
+	DXBCReferenceMD5 md5;
+	md5.bits = 0;
+	md5.buf[0] = 0x67452301;
+	md5.buf[1] = 0xefcdab89;
+	md5.buf[2] = 0x98badcfe;
+	md5.buf[3] = 0x10325476;
+
+	dwSize -= DXBC_THROUGHPUT_HEADER;
+	pData += DXBC_THROUGHPUT_HEADER;
+
+	DWORD numberOfBits = dwSize * 8;
+	DWORD fullBlocksSize = dwSize & ~0x3Fu;
+	DWORD lastBlockSize = dwSize - fullBlocksSize;
+	DWORD in[16];
+
+	ReferenceUpdate(md5, pData, fullBlocksSize);
+
+	// DXBC puts the bit count first into the last block and (bit count / 4) | 1 last
+	if(lastBlockSize >= 56)
+	{
+		ReferenceUpdate(md5, pData + fullBlocksSize, lastBlockSize);
+		ReferenceUpdate(md5, s_padding, 64 - lastBlockSize);
+
+		memset(in, 0, sizeof(in));
+		in[0] = numberOfBits;
+	}
+	else
+	{
+		ReferenceUpdate(md5, (const BYTE*)&numberOfBits, sizeof(numberOfBits));
+		ReferenceUpdate(md5, pData + fullBlocksSize, lastBlockSize);
+
+		memcpy(&md5.in[lastBlockSize + sizeof(DWORD)], s_padding, 64 - sizeof(DWORD) - lastBlockSize);
+		memcpy(in, md5.in, sizeof(in));
+	}
+
+	in[15] = (numberOfBits >> 2) | 1;
+	ReferenceTransform(md5.buf, in);
+
+	memcpy(dwHash, md5.buf, sizeof(md5.buf));
+	return TRUE;
+}
+
+
+
+
+
+//================================================================================================================
+// Function definitions
+//================================================================================================================
+// Best throughput in MB/s of hashing inSize bytes (after the header) at pData
+static double MeasureChecksum(DXBCChecksumFunction checksum, BYTE *pData, unsigned int inSize, DWORD hash[4])
+{
+	unsigned int iterations = DXBC_THROUGHPUT_BYTES / inSize;
+	double best = 1e9;
+
+	for(unsigned int run = 0; run < DXBC_THROUGHPUT_RUNS; run++)
+	{
+		DXBCThroughputClock::time_point start = DXBCThroughputClock::now();
+
+		for(unsigned int i = 0; i < iterations; i++)
+			checksum(pData, inSize + DXBC_THROUGHPUT_HEADER, hash);
+
+		double seconds = std::chrono::duration<double>(DXBCThroughputClock::now() - start).count();
+
+		if(seconds < best)
+			best = seconds;
+	}
+
+	return (double)inSize * iterations / best / 1e6;
+}
+
+int main()
+{
+	// Same bytes twice, the second copy one byte off
+	std::vector<BYTE> aligned(DXBC_THROUGHPUT_MAX_SIZE + DXBC_THROUGHPUT_HEADER);
+	std::vector<BYTE> unaligned(aligned.size() + 1);
+
+	for(size_t i = 0; i < aligned.size(); i++)
+		aligned[i] = unaligned[i + 1] = (BYTE)(i * 7);
+
+	bool mismatch = false;
+
+	for(unsigned int size = DXBC_THROUGHPUT_MIN_SIZE; size <= DXBC_THROUGHPUT_MAX_SIZE; size *= 4)
+	{
+		DWORD referenceHash[4];
+		DWORD alignedHash[4];
+		DWORD unalignedHash[4];
+
+		double referenceSpeed = MeasureChecksum(CalculateReferenceChecksum, aligned.data(), size, referenceHash);
+		double alignedSpeed = MeasureChecksum(CalculateDXBCChecksum, aligned.data(), size, alignedHash);
+		double unalignedSpeed = MeasureChecksum(CalculateDXBCChecksum, unaligned.data() + 1, size, unalignedHash);
+
+		bool same =	memcmp(referenceHash, alignedHash, sizeof(alignedHash)) == 0 &&
+					memcmp(referenceHash, unalignedHash, sizeof(unalignedHash)) == 0;
+
+		printf(	"%8u B: old %6.0f MB/s, new %6.0f MB/s (x%.2f), new unaligned %6.0f MB/s%s\n", size,
+				referenceSpeed, alignedSpeed, alignedSpeed / referenceSpeed, unalignedSpeed, same ? "" : "  CHECKSUMS DIFFER");
+		mismatch |= !same;
+	}
+
+	return mismatch ? 1 : 0;
+}
@@ -0,0 +1,183 @@
+// Author: Henryk Kosobucki, 2016
+
+//=============================================	OVERVIEW =========================================================
+//	Benchmark of IterateDXBCInstructions against the hand-written loop it replaced, both walking the same opcode
+//	stream (opcodes of all given shaders, repeated 20 times). Built from the benchmarks directory:
+//
+//		g++ -O2 -std=c++14 -I.. DXBCInstructionIteration.cpp ../Patcher.cpp ../DXBCOpcodeInfo.cpp ../DXBCDisassembler.cpp -o instruction-iteration
+//
+//		instruction-iteration <shader file>...
+//
+//	Both loops count instructions and sum their opcode types, so they do the same work and must agree. Each one
+//	is timed 30 times (alternating with the other), the best time is printed, three rounds in a row.
+//================================================================================================================
+
+//================================================================================================================
+// Include files
+//================================================================================================================
+#include "DXBCInstruction.h"
+#include <chrono>
+#include <stdio.h>
+#include <vector>
+
+#ifdef _MSC_VER
+#define DXBC_BENCH_NOINLINE		__declspec(noinline)
+#else
+#define DXBC_BENCH_NOINLINE		__attribute__((noinline))
+#endif // _MSC_VER
+
+
+
+
+
+//================================================================================================================
+// Constants
+//================================================================================================================
+#define DXBC_ITERATION_REPEATS		20				// Copies of the corpus opcodes in the stream
+#define DXBC_ITERATION_RUNS			30				// Timed runs of each loop per round
+#define DXBC_ITERATION_ROUNDS		3
+
+typedef std::chrono::steady_clock DXBCIterationClock;
+typedef unsigned int (*DXBCIterationLoop)(const DWORD *pOpcodes, unsigned int inNumDWORDs, unsigned int *pCount);
+
+
+
+
+
+//================================================================================================================
+// Function definitions
+//================================================================================================================
+static bool ReadFile(const char *pPath, std::vector<BYTE> &data)
+{
+	FILE* pFile = fopen(pPath, "rb");
+
+	if(!pFile)
+		return false;
+
+	data.clear();
+
+	BYTE buffer[65536];
+	size_t read;
+
+	while((read = fread(buffer, 1, sizeof(buffer), pFile)) > 0)
+		data.insert(data.end(), buffer, buffer + read);
+
+	fclose(pFile);
+	return true;
+}
+
+// Loop the patcher used before DXBCInstruction.h: custom data keeps its length in the next DWORD, everything
+// else in the opcode token, instructions are never shorter than one DWORD
+static DXBC_BENCH_NOINLINE unsigned int WalkHandWritten(const DWORD *pOpcodes, unsigned int inNumDWORDs, unsigned int *pCount)
+{
+	unsigned int opcodeSum = 0;
+	unsigned int count = 0;
+
+	for(unsigned int offset = 0; offset < inNumDWORDs; )
+	{
+		DWORD token = pOpcodes[offset];
+		DWORD length;
+
+		if(DECODE_D3D10_SB_OPCODE_TYPE(token) == D3D10_SB_OPCODE_CUSTOMDATA)
+			length = (inNumDWORDs - offset > 1) ? pOpcodes[offset + 1] : 1;
+		else
+			length = DECODE_D3D10_SB_TOKENIZED_INSTRUCTION_LENGTH(token);
+
+		if(length < 1)
+			length = 1;
+
+		opcodeSum += DECODE_D3D10_SB_OPCODE_TYPE(token);
+		count++;
+		offset += length;
+	}
+
+	*pCount = count;
+	return opcodeSum;
+}
+
+static DXBC_BENCH_NOINLINE unsigned int WalkRange(const DWORD *pOpcodes, unsigned int inNumDWORDs, unsigned int *pCount)
+{
+	unsigned int opcodeSum = 0;
+	unsigned int count = 0;
+
+	for(DXBCInstruction instruction : IterateDXBCInstructions(pOpcodes, inNumDWORDs))
+	{
+		opcodeSum += instruction.GetOpcode();
+		count++;
+	}
+
+	*pCount = count;
+	return opcodeSum;
+}
+
+int main(int argc, char *argv[])
+{
+	if(argc < 2)
+	{
+		printf("Usage: instruction-iteration <shader file>...\n");
+		return 1;
+	}
+
+	std::vector<BYTE> shader;
+	std::vector<DWORD> corpus;
+
+	for(int i = 1; i < argc; i++)
+	{
+		DXBCLayout layout;
+
+		if(!ReadFile(argv[i], shader) || ParseDXBCLayout(shader.data(), (unsigned int)shader.size(), &layout) != DXBC_PATCH_OK)
+		{
+			printf("Skipping %s, not a shader\n", argv[i]);
+			continue;
+		}
+
+		corpus.insert(corpus.end(), layout.pOpcodes, layout.pOpcodes + layout.opcodeDWORDs);
+	}
+
+	std::vector<DWORD> stream;
+
+	for(unsigned int i = 0; i < DXBC_ITERATION_REPEATS; i++)
+		stream.insert(stream.end(), corpus.begin(), corpus.end());
+
+	const char* pNames[2] = { "hand-written", "range" };
+	DXBCIterationLoop loops[2] = { WalkHandWritten, WalkRange };
+	unsigned int counts[2];
+	unsigned int sums[2];
+
+	for(unsigned int l = 0; l < 2; l++)
+		sums[l] = loops[l](stream.data(), (unsigned int)stream.size(), &counts[l]);
+
+	printf("%zu DWORDs, %u instructions\n", stream.size(), counts[0]);
+
+	if(counts[0] != counts[1] || sums[0] != sums[1])
+	{
+		printf("Loops disagree: hand-written %u / %u, range %u / %u (instructions / opcode sum)\n", counts[0], sums[0], counts[1], sums[1]);
+		return 1;
+	}
+
+	for(unsigned int round = 0; round < DXBC_ITERATION_ROUNDS; round++)
+	{
+		double best[2] = { 1e9, 1e9 };
+
+		for(unsigned int run = 0; run < DXBC_ITERATION_RUNS; run++)
+		{
+			for(unsigned int l = 0; l < 2; l++)
+			{
+				unsigned int count;
+				DXBCIterationClock::time_point start = DXBCIterationClock::now();
+				volatile unsigned int sum = loops[l](stream.data(), (unsigned int)stream.size(), &count);
+				double seconds = std::chrono::duration<double>(DXBCIterationClock::now() - start).count();
+
+				(void)sum;
+
+				if(seconds < best[l])
+					best[l] = seconds;
+			}
+		}
+
+		for(unsigned int l = 0; l < 2; l++)
+			printf("%s %.3f ms (%.2f GB/s)%s", pNames[l], best[l] * 1e3, stream.size() * sizeof(DWORD) / best[l] / 1e9, (l == 0) ? ", " : "\n");
+	}
+
+	return 0;
+}
@@ -0,0 +1,187 @@
+// Author: Henryk Kosobucki, 2016
+
+//=============================================	OVERVIEW =========================================================
+//	Latency benchmark of DXBCPatchQueue: how long a request takes from Enqueue until its patched shader is ready,
+//	for high and normal priority requests. Built from the benchmarks directory:
+//
+//		g++ -O2 -std=c++14 -pthread -I.. DXBCPatchQueueLatency.cpp ../DXBCPatchQueue.cpp ../Patcher.cpp ../DXBCOpcodeInfo.cpp ../DXBCDisassembler.cpp ../DXBCMappedFile.cpp -o patch-queue-latency
+//
+//		patch-queue-latency [-threads <count>] [-before <opcode>] <shader file>...
+//
+//	Shaders are enqueued in bursts (a game loading a level), every tenth request with high priority, and a few
+//	requests of every burst are cancelled right away. Two nops are injected before the given opcode (3 by
+//	default) of every shader. Latencies are measured in the completion callback, so they include the wait in the
+//	queue; p50, p99 and p999 are printed per priority. Every patched shader is compared with the output of
+//	PatchDXBCBounded.
+//================================================================================================================
+
+//================================================================================================================
+// Include files
+//================================================================================================================
+#include "DXBCPatchQueue.h"
+#include "DXBCMappedFile.h"
+#include "d3d11TokenizedProgramFormat.hpp"
+#include <algorithm>
+#include <chrono>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+
+
+
+
+//================================================================================================================
+// Constants
+//================================================================================================================
+#define DXBC_LATENCY_BURSTS				40
+#define DXBC_LATENCY_BURST_SIZE			500
+#define DXBC_LATENCY_HIGH_EVERY			10				// Every tenth request has high priority
+#define DXBC_LATENCY_CANCEL_EVERY		50				// Every fiftieth request is cancelled
+
+#define DXBC_LATENCY_NOP				(ENCODE_D3D10_SB_OPCODE_TYPE(D3D10_SB_OPCODE_NOP) | ENCODE_D3D10_SB_TOKENIZED_INSTRUCTION_LENGTH(1))
+
+typedef std::chrono::steady_clock DXBCLatencyClock;
+
+static const DWORD s_injectedNops[] = { DXBC_LATENCY_NOP, DXBC_LATENCY_NOP };
+
+
+
+
+
+//================================================================================================================
+// Structures
+//================================================================================================================
+// Enqueue-to-ready times in microseconds, [0] normal and [1] high priority
+struct DXBCLatencies
+{
+	std::mutex				lock;
+	std::vector<double>		times[2];
+};
+
+
+
+
+
+//================================================================================================================
+// Function definitions
+//================================================================================================================
+static void PrintPercentiles(const char *pName, std::vector<double> &times)
+{
+	if(times.empty())
+	{
+		printf("%s priority: no request ready\n", pName);
+		return;
+	}
+
+	std::sort(times.begin(), times.end());
+
+	printf(	"%s priority: n=%zu p50=%.1f us p99=%.1f us p999=%.1f us\n", pName, times.size(),
+			times[times.size() / 2], times[times.size() * 99 / 100], times[times.size() * 999 / 1000]);
+}
+
+int main(int argc, char *argv[])
+{
+	unsigned int threadCount = 2;
+	unsigned int insertBeforeOpcode = 3;
+	int firstShader = 1;
+
+	for(; firstShader + 1 < argc && argv[firstShader][0] == '-'; firstShader += 2)
+	{
+		if(strcmp(argv[firstShader], "-threads") == 0)
+			threadCount = (unsigned int)atoi(argv[firstShader + 1]);
+		else if(strcmp(argv[firstShader], "-before") == 0)
+			insertBeforeOpcode = (unsigned int)atoi(argv[firstShader + 1]);
+		else
+			break;
+	}
+
+	if(firstShader >= argc)
+	{
+		printf("Usage: patch-queue-latency [-threads <count>] [-before <opcode>] <shader file>...\n");
+		return 1;
+	}
+
+	// Shaders are read into memory once, so file access doesn't show up in the latencies
+	std::vector<std::vector<BYTE> > shaders;
+
+	for(int i = firstShader; i < argc; i++)
+	{
+		DXBCMappedFile file;
+
+		if(!file.OpenRead(argv[i]))
+		{
+			printf("Can't read %s\n", argv[i]);
+			return 1;
+		}
+
+		shaders.push_back(std::vector<BYTE>(file.GetData(), file.GetData() + file.GetSize()));
+	}
+
+	DXBCLatencies latencies;
+	unsigned int cancelled = 0;
+	unsigned int failed = 0;
+	unsigned int wrongShaders = 0;
+	std::vector<BYTE> reference;
+
+	{
+		DXBCPatchQueue queue(threadCount);
+
+		for(unsigned int burst = 0; burst < DXBC_LATENCY_BURSTS; burst++)
+		{
+			std::vector<std::shared_ptr<DXBCPatchRequest> > requests;
+
+			for(unsigned int i = 0; i < DXBC_LATENCY_BURST_SIZE; i++)
+			{
+				const std::vector<BYTE> &shader = shaders[(burst * DXBC_LATENCY_BURST_SIZE + i) % shaders.size()];
+				int priority = (i % DXBC_LATENCY_HIGH_EVERY == 0) ? 1 : 0;
+				DXBCLatencyClock::time_point enqueued = DXBCLatencyClock::now();
+
+				requests.push_back(queue.Enqueue(	shader.data(), (unsigned int)shader.size(), s_injectedNops, sizeof(s_injectedNops), insertBeforeOpcode, priority,
+													[&latencies, priority, enqueued](DXBCPatchRequest &request)
+				{
+					if(request.GetState() != DXBC_REQUEST_READY)
+						return;
+
+					double us = std::chrono::duration<double, std::micro>(DXBCLatencyClock::now() - enqueued).count();
+
+					std::lock_guard<std::mutex> guard(latencies.lock);
+					latencies.times[priority].push_back(us);
+				}));
+			}
+
+			for(unsigned int i = DXBC_LATENCY_CANCEL_EVERY / 10; i < DXBC_LATENCY_BURST_SIZE; i += DXBC_LATENCY_CANCEL_EVERY)
+			{
+				if(requests[i]->Cancel())
+					cancelled++;
+			}
+
+			for(unsigned int i = 0; i < DXBC_LATENCY_BURST_SIZE; i++)
+			{
+				DXBCPatchRequest &request = *requests[i];
+				request.Wait();
+
+				if(request.GetState() == DXBC_REQUEST_FAILED)
+					failed++;
+
+				if(!request.IsReady())
+					continue;
+
+				const std::vector<BYTE> &shader = shaders[(burst * DXBC_LATENCY_BURST_SIZE + i) % shaders.size()];
+				unsigned int referenceSize = 0;
+				reference.resize(request.GetPatchedSize());
+
+				if(	PatchDXBCBounded(shader.data(), (unsigned int)shader.size(), s_injectedNops, sizeof(s_injectedNops), insertBeforeOpcode,
+									reference.data(), (unsigned int)reference.size(), &referenceSize) != DXBC_PATCH_OK ||
+					referenceSize != reference.size() || memcmp(reference.data(), request.GetPatchedData(), reference.size()) != 0)
+					wrongShaders++;
+			}
+		}
+	}
+
+	PrintPercentiles("high", latencies.times[1]);
+	PrintPercentiles("normal", latencies.times[0]);
+	printf("threads=%u shaders=%zu cancelled=%u failed=%u bad=%u\n", threadCount, shaders.size(), cancelled, failed, wrongShaders);
+
+	return (wrongShaders == 0) ? 0 : 1;
+}
@@ -0,0 +1,134 @@
+// Author: Henryk Kosobucki, 2016
+
+//=============================================	OVERVIEW =========================================================
+//	Test of the patch entry points on containers whose chunk table is corrupt in ways only the chunk offsets show:
+//	shader chunk overlapping the chunk table, shader chunk at an unaligned offset. Patching never validates the
+//	whole shader, so these have to be caught by ParseDXBCLayout itself. Built from the tests directory:
+//
+//		g++ -O2 -std=c++14 -I.. DXBCCorruptLayoutTest.cpp ../Patcher.cpp ../DXBCValidator.cpp ../DXBCOpcodeInfo.cpp ../DXBCDisassembler.cpp -o corrupt-layout-test
+//
+//	Every corrupt container has to be rejected by ValidateDXBC, ParseDXBCLayout, GetPatchedDXBCSize,
+//	PatchDXBCBounded and DXBCDocument::Parse, while the intact one patches (exit code 1 otherwise).
+//================================================================================================================
+
+//================================================================================================================
+// Include files
+//================================================================================================================
+#include "Patcher.h"
+#include "DXBCValidator.h"
+#include "d3d11TokenizedProgramFormat.hpp"
+#include <stdio.h>
+#include <string.h>
+#include <vector>
+
+
+
+
+
+//================================================================================================================
+// Constants
+//================================================================================================================
+#define DXBC_TEST_NOP			(ENCODE_D3D10_SB_OPCODE_TYPE(D3D10_SB_OPCODE_NOP) | ENCODE_D3D10_SB_TOKENIZED_INSTRUCTION_LENGTH(1))
+#define DXBC_TEST_SHEX			MAKEFOURCC('S', 'H', 'E', 'X')
+
+static const DWORD s_injectedNop[] = { DXBC_TEST_NOP };
+
+
+
+
+
+//================================================================================================================
+// Structures
+//================================================================================================================
+struct DXBCLayoutTestCase
+{
+	const char*			pName;
+	std::vector<BYTE>	container;
+	bool				isValid;
+};
+
+
+
+
+
+//================================================================================================================
+// Function definitions
+//================================================================================================================
+// Header of inSize bytes with inChunkCount chunks, rest of the container zeroed
+static std::vector<BYTE> MakeHeader(unsigned int inSize, unsigned int inChunkCount)
+{
+	std::vector<BYTE> container(inSize);
+	DWORD header[8] = { MAKEFOURCC('D', 'X', 'B', 'C'), 0, 0, 0, 0, 1, inSize, inChunkCount };
+
+	memcpy(container.data(), header, sizeof(header));
+	return container;
+}
+
+static void WriteDWORDs(std::vector<BYTE> &container, unsigned int inOffset, const std::vector<DWORD> &values)
+{
+	memcpy(&container[inOffset], values.data(), values.size() * sizeof(DWORD));
+}
+
+int main()
+{
+	std::vector<DXBCLayoutTestCase> cases(3);
+
+	// One SHEX chunk right after the table: version, length, nop, nop
+	cases[0].pName = "intact";
+	cases[0].isValid = true;
+	cases[0].container = MakeHeader(36 + 24, 1);
+	WriteDWORDs(cases[0].container, 32, { 36, DXBC_TEST_SHEX, 16, 0x00050050, 4, DXBC_TEST_NOP, DXBC_TEST_NOP });
+
+	// Chunk 0 points into the chunk table, at entry 2 holding 'SHEX' and entry 3 holding its size
+	cases[1].pName = "shader chunk overlapping chunk table";
+	cases[1].isValid = false;
+	cases[1].container = MakeHeader(48 + 16, 4);
+	WriteDWORDs(cases[1].container, 32, { 40, 48, DXBC_TEST_SHEX, 16, 0x00050050, 4, DXBC_TEST_NOP, DXBC_TEST_NOP });
+
+	// Same as intact, one byte further
+	cases[2].pName = "unaligned shader chunk";
+	cases[2].isValid = false;
+	cases[2].container = MakeHeader(37 + 24 + 3, 1);
+	WriteDWORDs(cases[2].container, 32, { 37 });
+	WriteDWORDs(cases[2].container, 37, { DXBC_TEST_SHEX, 16, 0x00050050, 4, DXBC_TEST_NOP, DXBC_TEST_NOP });
+
+	unsigned int problems = 0;
+
+	for(size_t c = 0; c < cases.size(); c++)
+	{
+		const DXBCLayoutTestCase &test = cases[c];
+		const BYTE* pData = test.container.data();
+		unsigned int size = (unsigned int)test.container.size();
+
+		DXBCPatchStatus expected = test.isValid ? DXBC_PATCH_OK : DXBC_PATCH_INVALID_SHADER;
+		DXBCLayout layout;
+		DXBCDocument document;
+
+		// Output buffer big enough for anything, so a failure can only come from the layout
+		std::vector<BYTE> output(size + 4096);
+		unsigned int outputSize = 0;
+
+		DXBCPatchStatus validated = ValidateDXBC(pData, size, NULL);
+		DXBCPatchStatus parsed = ParseDXBCLayout(pData, size, &layout);
+		unsigned int patchedSize = GetPatchedDXBCSize(pData, size, sizeof(s_injectedNop));
+		DXBCPatchStatus patched = PatchDXBCBounded(pData, size, s_injectedNop, sizeof(s_injectedNop), 1, output.data(), (unsigned int)output.size(), &outputSize);
+		DXBCPatchStatus documentParsed = document.Parse(pData, size);
+
+		bool ok =	validated == expected && parsed == expected && patched == expected && documentParsed == expected &&
+					patchedSize == (test.isValid ? size + sizeof(s_injectedNop) : 0);
+
+		// Patched intact container has to stay intact
+		if(ok && test.isValid)
+			ok = outputSize == patchedSize && ValidateDXBC(output.data(), outputSize, NULL) == DXBC_PATCH_OK;
+
+		if(!ok)
+		{
+			printf(	"%s: validate %d, parse %d, patched size %u, patch %d, document %d\n", test.pName,
+					validated, parsed, patchedSize, patched, documentParsed);
+			problems++;
+		}
+	}
+
+	printf("%u cases, %u problems\n", (unsigned int)cases.size(), problems);
+	return (problems == 0) ? 0 : 1;
+}
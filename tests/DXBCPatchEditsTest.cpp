@@ -0,0 +1,233 @@
+// Author: Henryk Kosobucki, 2016
+
+//=============================================	OVERVIEW =========================================================
+//	Test of edit scripts that change the length of the opcode stream both ways: deletes, replacements shorter and
+//	longer than what they replace, inserts. Built from the tests directory:
+//
+//		g++ -O2 -std=c++14 -I.. DXBCPatchEditsTest.cpp ../Patcher.cpp ../DXBCValidator.cpp ../DXBCOpcodeInfo.cpp ../DXBCDisassembler.cpp -o patch-edits-test
+//
+//	Every script runs through PatchDXBCEdits and DXBCDocument::ApplyEdits on a small container with chunks before
+//	and after the shader chunk. Both outputs have to be equal, pass ValidateDXBC, carry a correct checksum, hold
+//	the expected opcodes with a matching length token and keep every other chunk intact (exit code 1 otherwise).
+//================================================================================================================
+
+//================================================================================================================
+// Include files
+//================================================================================================================
+#include "Patcher.h"
+#include "DXBCChecksum.h"
+#include "DXBCValidator.h"
+#include "d3d11TokenizedProgramFormat.hpp"
+#include <initializer_list>
+#include <stdio.h>
+#include <string.h>
+#include <vector>
+
+
+
+
+
+//================================================================================================================
+// Constants
+//================================================================================================================
+#define DXBC_TEST_OPCODE(type, length)	(ENCODE_D3D10_SB_OPCODE_TYPE(type) | ENCODE_D3D10_SB_TOKENIZED_INSTRUCTION_LENGTH(length))
+
+// dcl_temps 1, nop, nop, nop, ret
+static const DWORD s_dclTemps[] = { DXBC_TEST_OPCODE(D3D10_SB_OPCODE_DCL_TEMPS, 2), 1 };
+static const DWORD s_nop[] = { DXBC_TEST_OPCODE(D3D10_SB_OPCODE_NOP, 1) };
+static const DWORD s_ret[] = { DXBC_TEST_OPCODE(D3D10_SB_OPCODE_RET, 1) };
+
+// Stand-in for longer code: dcl_temps 2 twice (4 DWORDs)
+static const DWORD s_twoDcls[] = { DXBC_TEST_OPCODE(D3D10_SB_OPCODE_DCL_TEMPS, 2), 2, DXBC_TEST_OPCODE(D3D10_SB_OPCODE_DCL_TEMPS, 2), 2 };
+
+
+
+
+
+//================================================================================================================
+// Structures
+//================================================================================================================
+struct DXBCEditTestCase
+{
+	const char*				pName;
+	std::vector<DXBCEdit>	edits;
+	std::vector<DWORD>		expectedOpcodes;
+};
+
+
+
+
+
+//================================================================================================================
+// Function definitions
+//================================================================================================================
+static void AppendDWORDs(std::vector<DWORD> &dst, std::initializer_list<std::vector<DWORD> > parts)
+{
+	for(const std::vector<DWORD> &part : parts)
+		dst.insert(dst.end(), part.begin(), part.end());
+}
+
+static std::vector<DWORD> ToVector(const DWORD *pData, unsigned int inSize)
+{
+	return std::vector<DWORD>(pData, pData + inSize / sizeof(DWORD));
+}
+
+// Container with an ISGN-like chunk before the SHEX chunk and an STAT-like chunk after it
+static std::vector<DWORD> MakeContainer(const std::vector<DWORD> &opcodes)
+{
+	std::vector<DWORD> container(8 + 3);
+	container[0] = MAKEFOURCC('D', 'X', 'B', 'C');
+	container[5] = 1;
+	container[7] = 3;
+
+	container[8] = (DWORD)(container.size() * sizeof(DWORD));
+	AppendDWORDs(container, { { MAKEFOURCC('I', 'S', 'G', 'N'), 8, 0x11111111, 0x22222222 } });
+
+	container[9] = (DWORD)(container.size() * sizeof(DWORD));
+	AppendDWORDs(container, { { MAKEFOURCC('S', 'H', 'E', 'X'), (DWORD)(8 + opcodes.size() * sizeof(DWORD)), 0x00050050, (DWORD)(2 + opcodes.size()) }, opcodes });
+
+	container[10] = (DWORD)(container.size() * sizeof(DWORD));
+	AppendDWORDs(container, { { MAKEFOURCC('S', 'T', 'A', 'T'), 12, 0x33333333, 0x44444444, 0x55555555 } });
+
+	container[6] = (DWORD)(container.size() * sizeof(DWORD));
+	CalculateDXBCChecksum((BYTE*)container.data(), container[6], &container[1]);
+	return container;
+}
+
+static DXBCEdit MakeEdit(DXBCEditType inType, unsigned int inOpcode, unsigned int inOpcodeCount, const DWORD *pStream, unsigned int inStreamSize)
+{
+	DXBCEdit edit = { inType, inOpcode, inOpcodeCount, pStream, inStreamSize };
+	return edit;
+}
+
+// Returns number of problems found in the output of one path
+static unsigned int CheckOutput(const char *pName, const char *pPath, const std::vector<DWORD> &output, const std::vector<DWORD> &expected)
+{
+	unsigned int problems = 0;
+	unsigned int size = (unsigned int)(output.size() * sizeof(DWORD));
+	unsigned int failOffset = 0;
+
+	if(ValidateDXBC(output.data(), size, &failOffset) != DXBC_PATCH_OK)
+	{
+		printf("%s (%s): ValidateDXBC fails at byte %u\n", pName, pPath, failOffset);
+		return 1;
+	}
+
+	DWORD checksum[4];
+	std::vector<DWORD> copy(output);
+	CalculateDXBCChecksum((BYTE*)copy.data(), size, checksum);
+
+	if(memcmp(checksum, &output[1], sizeof(checksum)) != 0)
+	{
+		printf("%s (%s): wrong checksum\n", pName, pPath);
+		problems++;
+	}
+
+	DXBCLayout layout;
+
+	if(ParseDXBCLayout(output.data(), size, &layout) != DXBC_PATCH_OK || ToVector(layout.pOpcodes, layout.opcodeDWORDs * sizeof(DWORD)) != expected)
+	{
+		printf("%s (%s): wrong opcodes\n", pName, pPath);
+		problems++;
+	}
+
+	// Chunks around the shader chunk are moved, never changed
+	std::vector<DWORD> reference = MakeContainer(expected);
+
+	if(output.size() != reference.size() || memcmp(output.data() + 5, reference.data() + 5, (reference.size() - 5) * sizeof(DWORD)) != 0)
+	{
+		printf("%s (%s): container differs from the expected one\n", pName, pPath);
+		problems++;
+	}
+
+	return problems;
+}
+
+int main()
+{
+	std::vector<DWORD> opcodes;
+	AppendDWORDs(opcodes, { ToVector(s_dclTemps, sizeof(s_dclTemps)), ToVector(s_nop, sizeof(s_nop)), ToVector(s_nop, sizeof(s_nop)), ToVector(s_nop, sizeof(s_nop)), ToVector(s_ret, sizeof(s_ret)) });
+
+	std::vector<DWORD> source = MakeContainer(opcodes);
+	unsigned int sourceSize = (unsigned int)(source.size() * sizeof(DWORD));
+
+	if(ValidateDXBC(source.data(), sourceSize, NULL) != DXBC_PATCH_OK)
+	{
+		printf("Test container is broken\n");
+		return 1;
+	}
+
+	std::vector<DXBCEditTestCase> cases(6);
+
+	cases[0].pName = "delete one 1-DWORD opcode";
+	cases[0].edits.push_back(MakeEdit(DXBC_EDIT_DELETE, 2, 1, NULL, 0));
+	AppendDWORDs(cases[0].expectedOpcodes, { ToVector(s_dclTemps, sizeof(s_dclTemps)), ToVector(s_nop, sizeof(s_nop)), ToVector(s_nop, sizeof(s_nop)), ToVector(s_ret, sizeof(s_ret)) });
+
+	cases[1].pName = "delete everything";
+	cases[1].edits.push_back(MakeEdit(DXBC_EDIT_DELETE, 0, 5, NULL, 0));
+
+	cases[2].pName = "replace 2 DWORDs with 1";
+	cases[2].edits.push_back(MakeEdit(DXBC_EDIT_REPLACE, 0, 1, s_nop, sizeof(s_nop)));
+	AppendDWORDs(cases[2].expectedOpcodes, { ToVector(s_nop, sizeof(s_nop)), ToVector(s_nop, sizeof(s_nop)), ToVector(s_nop, sizeof(s_nop)), ToVector(s_nop, sizeof(s_nop)), ToVector(s_ret, sizeof(s_ret)) });
+
+	cases[3].pName = "replace 3 DWORDs with 4";
+	cases[3].edits.push_back(MakeEdit(DXBC_EDIT_REPLACE, 1, 3, s_twoDcls, sizeof(s_twoDcls)));
+	AppendDWORDs(cases[3].expectedOpcodes, { ToVector(s_dclTemps, sizeof(s_dclTemps)), ToVector(s_twoDcls, sizeof(s_twoDcls)), ToVector(s_ret, sizeof(s_ret)) });
+
+	cases[4].pName = "insert and delete in one script";
+	cases[4].edits.push_back(MakeEdit(DXBC_EDIT_INSERT, 1, 0, s_twoDcls, sizeof(s_twoDcls)));
+	cases[4].edits.push_back(MakeEdit(DXBC_EDIT_DELETE, 1, 3, NULL, 0));
+	AppendDWORDs(cases[4].expectedOpcodes, { ToVector(s_dclTemps, sizeof(s_dclTemps)), ToVector(s_twoDcls, sizeof(s_twoDcls)), ToVector(s_ret, sizeof(s_ret)) });
+
+	cases[5].pName = "insert";
+	cases[5].edits.push_back(MakeEdit(DXBC_EDIT_INSERT, 4, 0, s_nop, sizeof(s_nop)));
+	AppendDWORDs(cases[5].expectedOpcodes, { ToVector(s_dclTemps, sizeof(s_dclTemps)), ToVector(s_nop, sizeof(s_nop)), ToVector(s_nop, sizeof(s_nop)), ToVector(s_nop, sizeof(s_nop)), ToVector(s_nop, sizeof(s_nop)), ToVector(s_ret, sizeof(s_ret)) });
+
+	DXBCDocument document;
+
+	if(document.Parse(source.data(), sourceSize) != DXBC_PATCH_OK)
+	{
+		printf("Test container doesn't parse\n");
+		return 1;
+	}
+
+	unsigned int problems = 0;
+
+	for(size_t c = 0; c < cases.size(); c++)
+	{
+		const DXBCEditTestCase &test = cases[c];
+		unsigned int editCount = (unsigned int)test.edits.size();
+		unsigned int size = 0;
+
+		if(document.GetEditedSize(test.edits.data(), editCount, &size) != DXBC_PATCH_OK || size != sourceSize + (test.expectedOpcodes.size() - opcodes.size()) * sizeof(DWORD))
+		{
+			printf("%s: wrong edited size %u\n", test.pName, size);
+			problems++;
+			continue;
+		}
+
+		std::vector<DWORD> edited(size / sizeof(DWORD));
+		std::vector<DWORD> applied(size / sizeof(DWORD));
+		unsigned int appliedSize = 0;
+
+		if(PatchDXBCEdits(source.data(), sourceSize, test.edits.data(), editCount, edited.data()) != DXBC_PATCH_OK)
+		{
+			printf("%s: PatchDXBCEdits fails\n", test.pName);
+			problems++;
+			continue;
+		}
+
+		if(document.ApplyEdits(test.edits.data(), editCount, applied.data(), size, &appliedSize) != DXBC_PATCH_OK || appliedSize != size)
+		{
+			printf("%s: DXBCDocument::ApplyEdits fails\n", test.pName);
+			problems++;
+			continue;
+		}
+
+		problems += CheckOutput(test.pName, "PatchDXBCEdits", edited, test.expectedOpcodes);
+		problems += CheckOutput(test.pName, "DXBCDocument::ApplyEdits", applied, test.expectedOpcodes);
+	}
+
+	printf("%u cases, %u problems\n", (unsigned int)cases.size(), problems);
+	return (problems == 0) ? 0 : 1;
+}
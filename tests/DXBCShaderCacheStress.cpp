@@ -0,0 +1,162 @@
+// Author: Henryk Kosobucki, 2016
+
+//=============================================	OVERVIEW =========================================================
+//	Stress test of DXBCShaderCache: many threads look shaders up and insert them at once, the way CreateXXXShader
+//	hooks do on render threads, into a cache small enough to evict all the time. Built from the tests directory:
+//
+//		g++ -O2 -std=c++14 -pthread -I.. DXBCShaderCacheStress.cpp ../DXBCShaderCache.cpp -o shader-cache-stress
+//
+//		shader-cache-stress [<threads> [<operations per thread>]]		(8 threads, 200000 operations by default)
+//
+//	Shaders are random bytes with a made-up checksum (the cache only reads the checksum and compares the rest),
+//	every two of them share one so collisions are always in play. Most lookups go to a small hot set, the rest to
+//	a tail many times larger than the cache. Every shader returned is compared with what was inserted for its
+//	original, even a single wrong byte fails the test (exit code 1).
+//================================================================================================================
+
+//================================================================================================================
+// Include files
+//================================================================================================================
+#include "DXBCShaderCache.h"
+#include <chrono>
+#include <random>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <thread>
+#include <vector>
+
+
+
+
+
+//================================================================================================================
+// Constants
+//================================================================================================================
+#define DXBC_STRESS_SHADERS			3000
+#define DXBC_STRESS_HOT_SHADERS		300				// Three of four lookups go to them
+#define DXBC_STRESS_CACHE_BYTES		(200 * 1024)
+#define DXBC_STRESS_CACHE_ENTRIES	800
+
+
+
+
+
+//================================================================================================================
+// Structures
+//================================================================================================================
+struct DXBCStressShader
+{
+	std::vector<BYTE>	original;
+	std::vector<BYTE>	patched;
+};
+
+struct DXBCStressThread
+{
+	DXBCShaderCache*						pCache;
+	const std::vector<DXBCStressShader>*	pShaders;
+	unsigned int							seed;
+	unsigned int							operations;
+	unsigned int							wrongShaders;			// Returned shaders not matching what was inserted
+};
+
+
+
+
+
+//================================================================================================================
+// Function definitions
+//================================================================================================================
+static void MakeShaders(std::vector<DXBCStressShader> &shaders)
+{
+	std::mt19937 random(1);
+
+	shaders.resize(DXBC_STRESS_SHADERS);
+
+	for(unsigned int i = 0; i < DXBC_STRESS_SHADERS; i++)
+	{
+		// Header and checksum (24 bytes) followed by up to 600 bytes of DWORDs
+		std::vector<BYTE> &original = shaders[i].original;
+		original.resize(24 + random() % 600 / 4 * 4);
+
+		for(size_t b = 0; b < original.size(); b++)
+			original[b] = (BYTE)random();
+
+		DWORD checksum[4] = { (i / 2) * 2654435761u, (i / 2) * 40503u, 7, 9 };
+		memcpy(&original[4], checksum, sizeof(checksum));
+
+		// Patched shader is two DWORDs longer and differs from every other one
+		std::vector<BYTE> &patched = shaders[i].patched;
+		patched.resize(original.size() + 8);
+
+		for(size_t b = 0; b < patched.size(); b++)
+			patched[b] = (BYTE)(original[b % original.size()] ^ 0x5A ^ i);
+	}
+}
+
+static void RunStressThread(DXBCStressThread *pThread)
+{
+	const std::vector<DXBCStressShader> &shaders = *pThread->pShaders;
+	std::mt19937 random(pThread->seed);
+
+	for(unsigned int i = 0; i < pThread->operations; i++)
+	{
+		unsigned int index = (random() % 4 == 0) ? random() % DXBC_STRESS_SHADERS : random() % DXBC_STRESS_HOT_SHADERS;
+		const DXBCStressShader &shader = shaders[index];
+		DXBCCachedShader cached;
+
+		if(!pThread->pCache->Find(shader.original.data(), (unsigned int)shader.original.size(), cached))
+			pThread->pCache->Insert(	shader.original.data(), (unsigned int)shader.original.size(),
+										shader.patched.data(), (unsigned int)shader.patched.size(), &cached);
+
+		// No room for it is fine, wrong shader never is
+		if(cached.IsValid() && (cached.GetSize() != shader.patched.size() || memcmp(cached.GetData(), shader.patched.data(), cached.GetSize()) != 0))
+			pThread->wrongShaders++;
+	}
+}
+
+int main(int argc, char *argv[])
+{
+	unsigned int threadCount = (argc > 1) ? (unsigned int)atoi(argv[1]) : 8;
+	unsigned int operations = (argc > 2) ? (unsigned int)atoi(argv[2]) : 200000;
+
+	std::vector<DXBCStressShader> shaders;
+	MakeShaders(shaders);
+
+	DXBCShaderCache cache(DXBC_STRESS_CACHE_BYTES, DXBC_STRESS_CACHE_ENTRIES);
+	std::vector<DXBCStressThread> stressThreads(threadCount);
+	std::vector<std::thread> threads;
+
+	std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+
+	for(unsigned int i = 0; i < threadCount; i++)
+	{
+		stressThreads[i].pCache = &cache;
+		stressThreads[i].pShaders = &shaders;
+		stressThreads[i].seed = 100 + i;
+		stressThreads[i].operations = operations;
+		stressThreads[i].wrongShaders = 0;
+		threads.push_back(std::thread(RunStressThread, &stressThreads[i]));
+	}
+
+	unsigned int wrongShaders = 0;
+
+	for(unsigned int i = 0; i < threadCount; i++)
+	{
+		threads[i].join();
+		wrongShaders += stressThreads[i].wrongShaders;
+	}
+
+	double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+	unsigned long long totalOperations = (unsigned long long)threadCount * operations;
+
+	DXBCShaderCacheStats stats;
+	cache.GetStats(&stats);
+
+	printf("threads=%u ops=%llu %.1f ms (%.0f ns/op)\n", threadCount, totalOperations, ms, totalOperations ? ms * 1e6 / totalOperations : 0.0);
+	printf("hits=%llu misses=%llu inserts=%llu evictions=%llu failed=%llu entries=%u bytes=%zu\n",
+		stats.hits, stats.misses, stats.inserts, stats.evictions, stats.failedInserts, stats.entries, stats.bytes);
+	printf("bad=%u\n", wrongShaders);
+
+	return (wrongShaders == 0) ? 0 : 1;
+}